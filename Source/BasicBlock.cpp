@@ -1,8 +1,11 @@
 #include "BasicBlock.h"
+#include "BlockCodeCache.h"
+#include "IdleLoopAnalysis.h"
 #include "MemStream.h"
 #include "offsetof_def.h"
 #include "MipsJitter.h"
 #include "Jitter_CodeGenFactory.h"
+#include "xxhash.h"
 
 #if defined(AOT_BUILD_CACHE) || defined(AOT_USE_CACHE)
 #define AOT_ENABLED
@@ -10,8 +13,6 @@
 
 #ifdef AOT_ENABLED
 
-#include "xxhash.h"
-
 #include "StdStream.h"
 #include "StdStreamUtils.h"
 
@@ -47,6 +48,7 @@ CBasicBlock::CBasicBlock(CMIPS& context, uint32 begin, uint32 end, BLOCK_CATEGOR
     , m_end(end)
     , m_category(category)
     , m_context(context)
+    , m_codeGenState(context.GetCodeGenState(begin, end))
 #ifdef AOT_USE_CACHE
     , m_function(nullptr)
 #endif
@@ -74,31 +76,81 @@ void CBasicBlock::SetAotBlockOutputStream(Framework::CStdStream* outputStream)
 
 #endif
 
+#ifndef AOT_USE_CACHE
+
+std::atomic<CBlockCodeCache*> CBasicBlock::m_codeCache(nullptr);
+
+void CBasicBlock::SetCodeCache(CBlockCodeCache* codeCache)
+{
+	m_codeCache = codeCache;
+}
+
+static CBlockCodeCache::KEY MakeCodeCacheKey(BLOCK_CATEGORY category, uint128 opcodeHash, uint32 blockSizeByte, uint32 compileHints)
+{
+	CBlockCodeCache::KEY key = {};
+	key.blockKey.category = category;
+	key.blockKey.hash = opcodeHash;
+	key.blockKey.size = blockSizeByte;
+	key.compileHints = compileHints;
+	return key;
+}
+
+#endif
+
 void CBasicBlock::Compile()
 {
 #ifndef AOT_USE_CACHE
 
-	Framework::CMemStream stream;
-	{
-		static
-#ifdef AOT_BUILD_CACHE
-		    thread_local
+#if !defined(AOT_BUILD_CACHE) && !defined(__EMSCRIPTEN__)
+	m_hasIndirectBranchLink = (m_context.m_indirectBranchCache != nullptr) && EndsWithIndirectBranch();
+	m_endsWithCall = (m_context.m_indirectBranchCache != nullptr) && EndsWithCall();
+	m_endsWithReturn = m_hasIndirectBranchLink && EndsWithReturn();
 #endif
-		    CMipsJitter* jitter = nullptr;
-		if(jitter == nullptr)
+
+	auto codeCache = m_codeCache.load();
+	bool useCodeCache = (codeCache != nullptr) && IsCodeCacheable();
+	uint128 opcodeHash = {};
+	if(useCodeCache)
+	{
+		opcodeHash = ComputeOpcodeHash();
+	}
+
+	if(!useCodeCache || !LoadFromCodeCache(*codeCache, opcodeHash))
+	{
+		Framework::CMemStream stream;
+		ExternalReferenceArray externalReferences;
 		{
-			Jitter::CCodeGen* codeGen = Jitter::CreateCodeGen();
-			jitter = new CMipsJitter(codeGen);
+			//Blocks can be compiled from the background compile thread, each thread needs its own jitter.
+			//Architecture objects keep state while translating instructions, only one block per architecture
+			//can be compiled at a time. Other processors' compiles are unaffected.
+#ifndef AOT_BUILD_CACHE
+			std::lock_guard<std::mutex> compileLock(m_context.m_pArch->GetCompileMutex());
+#endif
+			static thread_local CMipsJitter* jitter = nullptr;
+			if(jitter == nullptr)
+			{
+				Jitter::CCodeGen* codeGen = Jitter::CreateCodeGen();
+				jitter = new CMipsJitter(codeGen);
+			}
+
+			jitter->GetCodeGen()->SetExternalSymbolReferencedHandler(
+			    [&](auto symbol, auto offset, auto refType) {
+				    externalReferences.push_back({symbol, offset, refType});
+				    this->HandleExternalFunctionReference(symbol, offset, refType);
+			    });
+			jitter->SetStream(&stream);
+			jitter->Begin();
+			CompileRange(jitter);
+			jitter->End();
 		}
 
-		jitter->GetCodeGen()->SetExternalSymbolReferencedHandler([&](auto symbol, auto offset, auto refType) { this->HandleExternalFunctionReference(symbol, offset, refType); });
-		jitter->SetStream(&stream);
-		jitter->Begin();
-		CompileRange(jitter);
-		jitter->End();
-	}
+		m_function = BlockFunction(stream.GetBuffer(), stream.GetSize());
 
-	m_function = CMemoryFunction(stream.GetBuffer(), stream.GetSize());
+		if(useCodeCache)
+		{
+			SaveToCodeCache(*codeCache, opcodeHash, stream.GetBuffer(), stream.GetSize(), externalReferences);
+		}
+	}
 
 #ifdef VTUNE_ENABLED
 	if(iJIT_IsProfilingActive() == iJIT_SAMPLING_ON)
@@ -191,6 +243,41 @@ void CBasicBlock::AddBlockCompileHints(uint32 compileHints)
 	m_blockCompileHints |= compileHints;
 }
 
+static void CompileSideExit(CMipsJitter* jitter, uint32 executedInstructionCount, Jitter::CJitter::LABEL sideExitLabel)
+{
+	jitter->PushCst(MIPS_INVALID_PC);
+	jitter->PushRel(offsetof(CMIPS, m_State.nDelayedJumpAddr));
+	jitter->BeginIf(Jitter::CONDITION_NE);
+	{
+		//Only account for the instructions that were executed
+		jitter->PushRel(offsetof(CMIPS, m_State.cycleQuota));
+		jitter->PushCst(executedInstructionCount);
+		jitter->Sub();
+		jitter->PullRel(offsetof(CMIPS, m_State.cycleQuota));
+
+		jitter->PushRel(offsetof(CMIPS, m_State.cycleQuota));
+		jitter->PushCst(0);
+		jitter->BeginIf(Jitter::CONDITION_LE);
+		{
+			jitter->PushRel(offsetof(CMIPS, m_State.nHasException));
+			jitter->PushCst(MIPS_EXCEPTION_STATUS_QUOTADONE);
+			jitter->Or();
+			jitter->PullRel(offsetof(CMIPS, m_State.nHasException));
+		}
+		jitter->EndIf();
+
+		jitter->PushRel(offsetof(CMIPS, m_State.nDelayedJumpAddr));
+		jitter->PullRel(offsetof(CMIPS, m_State.nPC));
+
+		jitter->PushCst(MIPS_INVALID_PC);
+		jitter->PullRel(offsetof(CMIPS, m_State.nDelayedJumpAddr));
+
+		//Side exits aren't linked, we go back to the executor's loop
+		jitter->Goto(sideExitLabel);
+	}
+	jitter->EndIf();
+}
+
 void CBasicBlock::CompileRange(CMipsJitter* jitter)
 {
 	if(IsEmpty())
@@ -219,10 +306,16 @@ void CBasicBlock::CompileRange(CMipsJitter* jitter)
 	}();
 
 	m_context.m_pArch->SetCompileHints(m_blockCompileHints);
+	m_context.m_pArch->SetCodeGenState(m_codeGenState);
+	for(auto cop : m_context.m_pCOP)
+	{
+		if(cop) cop->SetCodeGenState(m_codeGenState);
+	}
 
 	CompileProlog(jitter);
 	jitter->MarkFirstBlockLabel();
 
+	Jitter::CJitter::LABEL sideExitLabel = -1;
 	for(uint32 address = m_begin; address <= m_end; address += 4)
 	{
 		m_context.m_pArch->CompileInstruction(
@@ -231,10 +324,77 @@ void CBasicBlock::CompileRange(CMipsJitter* jitter)
 		    &m_context, address - m_begin);
 		//Sanity check
 		assert(jitter->IsStackEmpty());
+
+		//Superblocks contain branches before their end, leave if one of them was taken
+		if((address != m_begin) && (address != m_end) && IsBranchAt(address - 4))
+		{
+			jitter->MarkLastBlockLabel();
+			if(sideExitLabel == -1)
+			{
+				sideExitLabel = jitter->CreateLabel();
+			}
+			CompileSideExit(jitter, ((address - m_begin) / 4) + 1, sideExitLabel);
+		}
 	}
 
 	jitter->MarkLastBlockLabel();
 	CompileEpilog(jitter, loopsOnItself);
+
+	if(sideExitLabel != -1)
+	{
+		jitter->MarkLabel(sideExitLabel);
+	}
+}
+
+bool CBasicBlock::IsBranchAt(uint32 address) const
+{
+	uint32 inst = m_context.m_pMemoryMap->GetInstruction(address);
+	return m_context.m_pArch->IsInstructionBranch(&m_context, address, inst) == MIPS_BRANCH_NORMAL;
+}
+
+//Jumps to registers (JR, JALR) can't be linked when the block is created
+bool CBasicBlock::EndsWithIndirectBranch() const
+{
+	if(m_begin == m_end)
+	{
+		return false;
+	}
+	uint32 branchInstAddr = m_end - 4;
+	uint32 inst = m_context.m_pMemoryMap->GetInstruction(branchInstAddr);
+	if(m_context.m_pArch->IsInstructionBranch(&m_context, branchInstAddr, inst) != MIPS_BRANCH_NORMAL)
+	{
+		return false;
+	}
+	return m_context.m_pArch->GetInstructionEffectiveAddress(&m_context, branchInstAddr, inst) == MIPS_INVALID_PC;
+}
+
+//Calls are JAL and JALR linking to $ra, their return address is right after the delay slot
+bool CBasicBlock::EndsWithCall() const
+{
+	if(m_begin == m_end)
+	{
+		return false;
+	}
+	uint32 inst = m_context.m_pMemoryMap->GetInstruction(m_end - 4);
+	uint32 opcode = (inst >> 26);
+	if(opcode == 0x03)
+	{
+		return true;
+	}
+	uint32 rd = (inst >> 11) & 0x1F;
+	return (opcode == 0x00) && ((inst & 0x3F) == 0x09) && (rd == CMIPS::RA);
+}
+
+//Returns are JR $ra
+bool CBasicBlock::EndsWithReturn() const
+{
+	if(m_begin == m_end)
+	{
+		return false;
+	}
+	uint32 inst = m_context.m_pMemoryMap->GetInstruction(m_end - 4);
+	uint32 rs = (inst >> 21) & 0x1F;
+	return ((inst >> 26) == 0x00) && ((inst & 0x3F) == 0x08) && (rs == CMIPS::RA);
 }
 
 void CBasicBlock::CompileProlog(CMipsJitter* jitter)
@@ -255,8 +415,34 @@ void CBasicBlock::CompileProlog(CMipsJitter* jitter)
 #endif
 }
 
+bool CBasicBlock::IsIdleLoop() const
+{
+	if((m_blockCompileHints & MIPS_COMPILEHINT_IDLELOOPDETECTION) == 0) return false;
+	//Other categories get the R3000 subset which is common to all our MIPS processors
+	auto architecture = (m_category == BLOCK_CATEGORY_PS2_EE) ? IdleLoopAnalysis::ARCHITECTURE_EE : IdleLoopAnalysis::ARCHITECTURE_IOP;
+	return IdleLoopAnalysis::IsIdleLoop(m_context, architecture, m_begin, m_end);
+}
+
 void CBasicBlock::CompileEpilog(CMipsJitter* jitter, bool loopsOnItself)
 {
+	if(IsIdleLoop())
+	{
+		//Don't hide exceptions raised by the loop's loads
+		jitter->PushRel(offsetof(CMIPS, m_State.nHasException));
+		jitter->PushCst(0);
+		jitter->BeginIf(Jitter::CONDITION_EQ);
+		{
+			jitter->PushCst(MIPS_EXCEPTION_IDLE);
+			jitter->PullRel(offsetof(CMIPS, m_State.nHasException));
+		}
+		jitter->EndIf();
+	}
+
+	if(m_profiling)
+	{
+		CompileProfileUpdate(jitter);
+	}
+
 	//Update cycle quota
 	jitter->PushRel(offsetof(CMIPS, m_State.cycleQuota));
 	jitter->PushCst(((m_end - m_begin) / 4) + 1);
@@ -279,6 +465,25 @@ void CBasicBlock::CompileEpilog(CMipsJitter* jitter, bool loopsOnItself)
 	jitter->PushRel(offsetof(CMIPS, m_State.nDelayedJumpAddr));
 	jitter->BeginIf(Jitter::CONDITION_NE);
 	{
+		if(m_endsWithCall)
+		{
+			CompileReturnAddressPush(jitter);
+		}
+
+		if(m_hasIndirectBranchLink)
+		{
+			//nPC still holds the address of this block, it identifies the branch in the cache.
+			//Only record it if the block completed normally, an exception leaves nPC elsewhere.
+			jitter->PushRel(offsetof(CMIPS, m_State.nHasException));
+			jitter->PushCst(0);
+			jitter->BeginIf(Jitter::CONDITION_EQ);
+			{
+				jitter->PushRel(offsetof(CMIPS, m_State.nPC));
+				jitter->PullRel(offsetof(CMIPS, m_indirectBranchSite));
+			}
+			jitter->EndIf();
+		}
+
 		jitter->PushRel(offsetof(CMIPS, m_State.nDelayedJumpAddr));
 		jitter->PullRel(offsetof(CMIPS, m_State.nPC));
 
@@ -295,6 +500,24 @@ void CBasicBlock::CompileEpilog(CMipsJitter* jitter, bool loopsOnItself)
 			}
 			jitter->EndIf();
 		}
+		else if(m_hasIndirectBranchLink)
+		{
+			jitter->PushRel(offsetof(CMIPS, m_State.nHasException));
+			jitter->PushCst(0);
+			jitter->BeginIf(Jitter::CONDITION_EQ);
+			{
+				if(m_endsWithReturn)
+				{
+					CompileReturnAddressPop(jitter);
+				}
+				CompileIndirectBranchLink(jitter);
+				if(m_endsWithReturn)
+				{
+					CompileReturnPrediction(jitter);
+				}
+			}
+			jitter->EndIf();
+		}
 		else
 		{
 #if !defined(AOT_BUILD_CACHE) && !defined(__EMSCRIPTEN__)
@@ -328,6 +551,153 @@ void CBasicBlock::CompileEpilog(CMipsJitter* jitter, bool loopsOnItself)
 	jitter->EndIf();
 }
 
+//The branch link slot is set to the last target the branch has taken. We can only use it if the
+//cache entry for this block says that it's the target we're going to. Otherwise, we go back to
+//the executor which will find the right block and update the link.
+void CBasicBlock::CompileIndirectBranchLink(CMipsJitter* jitter)
+{
+	auto pushCacheEntryField =
+	    [&](uint32 fieldOffset) {
+		    jitter->PushRelRef(offsetof(CMIPS, m_indirectBranchCache));
+
+		    jitter->PushRel(offsetof(CMIPS, m_indirectBranchSite));
+		    jitter->Srl(2);
+		    jitter->PushCst(MIPS_INDIRECT_BRANCH_CACHE_SIZE - 1);
+		    jitter->And();
+		    jitter->Shl(3); //Multiply by sizeof(MIPS_INDIRECT_BRANCH_CACHE_ENTRY)
+		    if(fieldOffset != 0)
+		    {
+			    jitter->PushCst(fieldOffset);
+			    jitter->Add();
+		    }
+
+		    jitter->LoadFromRefIdx(1);
+	    };
+
+	pushCacheEntryField(offsetof(MIPS_INDIRECT_BRANCH_CACHE_ENTRY, site));
+	jitter->PushRel(offsetof(CMIPS, m_indirectBranchSite));
+	jitter->BeginIf(Jitter::CONDITION_EQ);
+	{
+		pushCacheEntryField(offsetof(MIPS_INDIRECT_BRANCH_CACHE_ENTRY, target));
+		jitter->PushRel(offsetof(CMIPS, m_State.nPC));
+		jitter->BeginIf(Jitter::CONDITION_EQ);
+		{
+			jitter->PushCst(MIPS_INVALID_PC);
+			jitter->PullRel(offsetof(CMIPS, m_indirectBranchSite));
+
+			jitter->PushRel(offsetof(CMIPS, m_indirectBranchHitCount));
+			jitter->PushCst(1);
+			jitter->Add();
+			jitter->PullRel(offsetof(CMIPS, m_indirectBranchHitCount));
+
+			jitter->JumpToDynamic(reinterpret_cast<void*>(&BranchBlockTrampoline));
+		}
+		jitter->EndIf();
+	}
+	jitter->EndIf();
+}
+
+void CBasicBlock::CompileReturnAddressPush(CMipsJitter* jitter)
+{
+	jitter->PushRel(offsetof(CMIPS, m_returnStackTop));
+	jitter->PushCst(1);
+	jitter->Add();
+	jitter->PushCst(MIPS_RETURN_STACK_SIZE - 1);
+	jitter->And();
+	jitter->PullRel(offsetof(CMIPS, m_returnStackTop));
+
+	jitter->PushRelAddrRef(offsetof(CMIPS, m_returnStack));
+	jitter->PushRel(offsetof(CMIPS, m_returnStackTop));
+	jitter->PushCst(m_end + 4);
+	jitter->StoreAtRefIdx();
+}
+
+//The popped entry stays in place until the next push, CompileReturnPrediction reads it back from there
+void CBasicBlock::CompileReturnAddressPop(CMipsJitter* jitter)
+{
+	jitter->PushRel(offsetof(CMIPS, m_returnStackTop));
+	jitter->PushCst(1);
+	jitter->Sub();
+	jitter->PushCst(MIPS_RETURN_STACK_SIZE - 1);
+	jitter->And();
+	jitter->PullRel(offsetof(CMIPS, m_returnStackTop));
+}
+
+//Returns that didn't go through the branch link but went where the return stack predicted are
+//handed to the executor's predicted return handler. It runs the target block without going back
+//to the executor's loop and without relinking this block, which would keep flipping between the
+//callers of a function.
+void CBasicBlock::CompileReturnPrediction(CMipsJitter* jitter)
+{
+	jitter->PushRelAddrRef(offsetof(CMIPS, m_returnStack));
+	jitter->PushRel(offsetof(CMIPS, m_returnStackTop));
+	jitter->PushCst(1);
+	jitter->Add();
+	jitter->PushCst(MIPS_RETURN_STACK_SIZE - 1);
+	jitter->And();
+	jitter->LoadFromRefIdx();
+
+	jitter->PushRel(offsetof(CMIPS, m_State.nPC));
+	jitter->BeginIf(Jitter::CONDITION_EQ);
+	{
+		jitter->PushCst(MIPS_INVALID_PC);
+		jitter->PullRel(offsetof(CMIPS, m_indirectBranchSite));
+
+		jitter->PushRel(offsetof(CMIPS, m_returnPredictionHitCount));
+		jitter->PushCst(1);
+		jitter->Add();
+		jitter->PullRel(offsetof(CMIPS, m_returnPredictionHitCount));
+
+		jitter->JumpTo(reinterpret_cast<void*>(&PredictedReturnHandler));
+	}
+	jitter->EndIf();
+}
+
+//Counters are updated by the block itself, it stays linked to the blocks around it while it's profiled
+void CBasicBlock::CompileProfileUpdate(CMipsJitter* jitter)
+{
+	auto incrementCounter =
+	    [&](uint32* counter) {
+		    jitter->PushCstPtr(reinterpret_cast<uintptr_t>(counter));
+		    jitter->PushCstPtr(reinterpret_cast<uintptr_t>(counter));
+		    jitter->LoadFromRef();
+		    jitter->PushCst(1);
+		    jitter->Add();
+		    jitter->StoreAtRef();
+	    };
+
+	incrementCounter(&m_profile.executionCount);
+
+	jitter->PushCst(MIPS_INVALID_PC);
+	jitter->PushRel(offsetof(CMIPS, m_State.nDelayedJumpAddr));
+	jitter->BeginIf(Jitter::CONDITION_NE);
+	{
+		incrementCounter(&m_profile.takenCount);
+	}
+	jitter->EndIf();
+
+	jitter->PushCstPtr(reinterpret_cast<uintptr_t>(&m_profile.executionCount));
+	jitter->LoadFromRef();
+	jitter->PushCst(PROFILE_SAMPLE_COUNT);
+	jitter->BeginIf(Jitter::CONDITION_EQ);
+	{
+		jitter->PushCst(m_begin);
+		jitter->PullRel(offsetof(CMIPS, m_profiledBlockSite));
+	}
+	jitter->EndIf();
+}
+
+bool CBasicBlock::IsCodeCacheable() const
+{
+#ifdef DEBUGGER_INCLUDED
+	if(HasBreakpoint())
+	{
+		return false;
+	}
+#endif
+	return !IsEmpty() && !m_profiling;
+}
+
 void CBasicBlock::Execute()
 {
 	m_function(&m_context);
@@ -369,6 +739,11 @@ bool CBasicBlock::IsEmpty() const
 	       (m_end == MIPS_INVALID_PC);
 }
 
+bool CBasicBlock::HasIndirectBranchLink() const
+{
+	return m_hasIndirectBranchLink;
+}
+
 uint32 CBasicBlock::GetRecycleCount() const
 {
 	return m_recycleCount;
@@ -379,6 +754,22 @@ void CBasicBlock::SetRecycleCount(uint32 recycleCount)
 	m_recycleCount = recycleCount;
 }
 
+void CBasicBlock::EnableProfiling()
+{
+	assert(!IsCompiled());
+	m_profiling = true;
+}
+
+bool CBasicBlock::IsProfiling() const
+{
+	return m_profiling;
+}
+
+const CBasicBlock::PROFILE& CBasicBlock::GetProfile() const
+{
+	return m_profile;
+}
+
 bool CBasicBlock::HasLinkSlot(LINK_SLOT linkSlot) const
 {
 	return m_linkBlockTrampolineOffset[linkSlot] != INVALID_LINK_SLOT;
@@ -449,10 +840,106 @@ void CBasicBlock::HandleExternalFunctionReference(uintptr_t symbol, uint32 offse
 	}
 }
 
+uint128 CBasicBlock::ComputeOpcodeHash() const
+{
+	assert(!IsEmpty());
+
+	uint32 blockSize = ((m_end - m_begin) / 4) + 1;
+	std::vector<uint32> blockData(blockSize);
+	for(uint32 i = 0; i < blockSize; i++)
+	{
+		blockData[i] = m_context.m_pMemoryMap->GetInstruction(m_begin + (i * 4));
+	}
+
+	auto xxHash = XXH3_128bits(blockData.data(), blockSize * 4);
+	uint128 hash;
+	memcpy(&hash, &xxHash, sizeof(xxHash));
+	static_assert(sizeof(hash) == sizeof(xxHash));
+	return hash;
+}
+
+const MIPS_CODEGEN_STATE& CBasicBlock::GetCodeGenState() const
+{
+	return m_codeGenState;
+}
+
+#ifndef AOT_USE_CACHE
+
+bool CBasicBlock::LoadFromCodeCache(const CBlockCodeCache& codeCache, uint128 opcodeHash)
+{
+	uint32 blockSizeByte = (m_end - m_begin) + 4;
+	CBlockCodeCache::ENTRY entry;
+	if(!codeCache.Find(MakeCodeCacheKey(m_category, opcodeHash, blockSizeByte, m_blockCompileHints), entry))
+	{
+		return false;
+	}
+
+	for(const auto& relocation : entry.relocations)
+	{
+		if((static_cast<size_t>(relocation.offset) + sizeof(uintptr_t)) > entry.code.size())
+		{
+			assert(false);
+			return false;
+		}
+	}
+
+	for(const auto& relocation : entry.relocations)
+	{
+		uintptr_t symbol = CBlockCodeCache::ResolveSymbolOffset(relocation.symbolOffset);
+		memcpy(entry.code.data() + relocation.offset, &symbol, sizeof(uintptr_t));
+		HandleExternalFunctionReference(symbol, relocation.offset, Jitter::CCodeGen::SYMBOL_REF_TYPE::NATIVE_POINTER);
+	}
+
+	m_function = BlockFunction(entry.code.data(), entry.code.size());
+	return true;
+}
+
+void CBasicBlock::SaveToCodeCache(CBlockCodeCache& codeCache, uint128 opcodeHash, const void* code, size_t codeSize,
+                                  const ExternalReferenceArray& externalReferences) const
+{
+	auto codeBytes = reinterpret_cast<const uint8*>(code);
+
+	CBlockCodeCache::ENTRY entry;
+	entry.code.assign(codeBytes, codeBytes + codeSize);
+	entry.relocations.reserve(externalReferences.size());
+	for(const auto& reference : externalReferences)
+	{
+		//We only know how to relocate plain pointers embedded in the code
+		if(reference.refType != Jitter::CCodeGen::SYMBOL_REF_TYPE::NATIVE_POINTER)
+		{
+			return;
+		}
+		if((static_cast<size_t>(reference.offset) + sizeof(uintptr_t)) > codeSize)
+		{
+			return;
+		}
+		if(memcmp(codeBytes + reference.offset, &reference.symbol, sizeof(uintptr_t)) != 0)
+		{
+			return;
+		}
+		int64 symbolOffset = 0;
+		if(!CBlockCodeCache::MakeSymbolOffset(reference.symbol, symbolOffset))
+		{
+			return;
+		}
+		entry.relocations.push_back({reference.offset, symbolOffset});
+	}
+
+	uint32 blockSizeByte = (m_end - m_begin) + 4;
+	codeCache.Insert(MakeCodeCacheKey(m_category, opcodeHash, blockSizeByte, m_blockCompileHints), std::move(entry));
+}
+
+#endif
+
 void CBasicBlock::CopyFunctionFrom(const std::shared_ptr<CBasicBlock>& other)
 {
+	//Code of profiled blocks refers to their own counters
+	assert(!other->m_profiling);
 #ifndef AOT_USE_CACHE
 	m_function = other->m_function.CreateInstance();
+	m_hasIndirectBranchLink = other->m_hasIndirectBranchLink;
+	m_endsWithCall = other->m_endsWithCall;
+	m_endsWithReturn = other->m_endsWithReturn;
 	std::copy(std::begin(other->m_linkBlockTrampolineOffset), std::end(other->m_linkBlockTrampolineOffset), m_linkBlockTrampolineOffset);
 #ifdef _DEBUG
 	std::copy(std::begin(other->m_linkBlock), std::end(other->m_linkBlock), m_linkBlock);
@@ -484,7 +971,7 @@ void CBasicBlock::CopyFunctionFrom(const std::shared_ptr<CBasicBlock>& other)
 
 bool CBasicBlock::HasBreakpoint() const
 {
-	return m_context.HasBreakpointInRange(GetBeginAddress(), GetEndAddress());
+	return m_codeGenState.hasBreakpoint;
 }
 
 uint32 CBasicBlock::BreakpointFilter(CMIPS* context)
@@ -512,3 +999,8 @@ void NextBlockTrampoline(CMIPS* context)
 void BranchBlockTrampoline(CMIPS* context)
 {
 }
+
+void PredictedReturnHandler(CMIPS* context)
+{
+	context->m_predictedReturnHandler(context);
+}
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <atomic>
+#include <mutex>
+#include <vector>
 #include "MIPS.h"
 #include "MemoryFunction.h"
+#include "CodeArena.h"
 #ifdef AOT_BUILD_CACHE
 #include "StdStream.h"
-#include <mutex>
 #endif
 
 enum BLOCK_CATEGORY : uint32
@@ -38,11 +41,20 @@ namespace Jitter
 	class CJitter;
 };
 
+class CBlockCodeCache;
+
+#ifdef CODEARENA_SUPPORTED
+typedef CCodeArenaFunction BlockFunction;
+#else
+typedef CMemoryFunction BlockFunction;
+#endif
+
 extern "C"
 {
 	void EmptyBlockHandler(CMIPS*);
 	void NextBlockTrampoline(CMIPS*);
 	void BranchBlockTrampoline(CMIPS*);
+	void PredictedReturnHandler(CMIPS*);
 }
 
 enum LINK_SLOT
@@ -70,6 +82,17 @@ typedef BlockOutLinkMap::iterator BlockOutLinkPointer;
 class CBasicBlock : public std::enable_shared_from_this<CBasicBlock>
 {
 public:
+	enum
+	{
+		PROFILE_SAMPLE_COUNT = 32,
+	};
+
+	struct PROFILE
+	{
+		uint32 executionCount = 0;
+		uint32 takenCount = 0;
+	};
+
 	CBasicBlock(CMIPS&, uint32 = MIPS_INVALID_PC, uint32 = MIPS_INVALID_PC, BLOCK_CATEGORY = BLOCK_CATEGORY_UNKNOWN);
 	virtual ~CBasicBlock() = default;
 	void Execute();
@@ -82,10 +105,17 @@ public:
 	uint32 GetEndAddress() const;
 	bool IsCompiled() const;
 	bool IsEmpty() const;
+	bool HasIndirectBranchLink() const;
 
 	uint32 GetRecycleCount() const;
 	void SetRecycleCount(uint32);
 
+	//Profiled blocks count their executions and taken branches, this needs to be enabled before compiling.
+	//Once the block has run PROFILE_SAMPLE_COUNT times, its address is written in CMIPS::m_profiledBlockSite.
+	void EnableProfiling();
+	bool IsProfiling() const;
+	const PROFILE& GetProfile() const;
+
 	bool HasLinkSlot(LINK_SLOT) const;
 	BlockOutLinkPointer GetOutLink(LINK_SLOT) const;
 	void SetOutLink(LINK_SLOT, BlockOutLinkPointer);
@@ -97,8 +127,15 @@ public:
 	static void SetAotBlockOutputStream(Framework::CStdStream*);
 #endif
 
+#ifndef AOT_USE_CACHE
+	static void SetCodeCache(CBlockCodeCache*);
+#endif
+
 	void CopyFunctionFrom(const std::shared_ptr<CBasicBlock>& basicBlock);
 
+	uint128 ComputeOpcodeHash() const;
+	const MIPS_CODEGEN_STATE& GetCodeGenState() const;
+
 protected:
 	uint32 m_begin;
 	uint32 m_end;
@@ -106,13 +143,44 @@ protected:
 	CMIPS& m_context;
 
 	uint32 m_blockCompileHints = 0;
+	MIPS_CODEGEN_STATE m_codeGenState;
 
 	virtual void CompileProlog(CMipsJitter*);
 	virtual void CompileEpilog(CMipsJitter*, bool);
 
+	//True if idle loop detection is enabled for this block and it was found to be one
+	bool IsIdleLoop() const;
+
+	//Returns false if the generated code depends on more than the block's
+	//opcodes and compile hints and thus can't be shared through the code cache
+	virtual bool IsCodeCacheable() const;
+
 private:
+	struct EXTERNAL_REFERENCE
+	{
+		uintptr_t symbol;
+		uint32 offset;
+		Jitter::CCodeGen::SYMBOL_REF_TYPE refType;
+	};
+	typedef std::vector<EXTERNAL_REFERENCE> ExternalReferenceArray;
+
 	void HandleExternalFunctionReference(uintptr_t, uint32, Jitter::CCodeGen::SYMBOL_REF_TYPE);
 
+	bool IsBranchAt(uint32) const;
+	bool EndsWithIndirectBranch() const;
+	bool EndsWithCall() const;
+	bool EndsWithReturn() const;
+	void CompileIndirectBranchLink(CMipsJitter*);
+	void CompileReturnAddressPush(CMipsJitter*);
+	void CompileReturnAddressPop(CMipsJitter*);
+	void CompileReturnPrediction(CMipsJitter*);
+	void CompileProfileUpdate(CMipsJitter*);
+
+#ifndef AOT_USE_CACHE
+	bool LoadFromCodeCache(const CBlockCodeCache&, uint128);
+	void SaveToCodeCache(CBlockCodeCache&, uint128, const void*, size_t, const ExternalReferenceArray&) const;
+#endif
+
 #ifdef DEBUGGER_INCLUDED
 	bool HasBreakpoint() const;
 	static uint32 BreakpointFilter(CMIPS*);
@@ -125,11 +193,20 @@ private:
 #endif
 
 #ifndef AOT_USE_CACHE
-	CMemoryFunction m_function;
+	static std::atomic<CBlockCodeCache*> m_codeCache;
+#endif
+
+#ifndef AOT_USE_CACHE
+	BlockFunction m_function;
 #else
 	void (*m_function)(void*);
 #endif
 	uint32 m_recycleCount = 0;
+	bool m_hasIndirectBranchLink = false;
+	bool m_endsWithCall = false;
+	bool m_endsWithReturn = false;
+	bool m_profiling = false;
+	PROFILE m_profile;
 	BlockOutLinkPointer m_outLinks[LINK_SLOT_MAX];
 	uint32 m_linkBlockTrampolineOffset[LINK_SLOT_MAX];
 #ifdef _DEBUG
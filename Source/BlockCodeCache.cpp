@@ -0,0 +1,377 @@
+#include <cassert>
+#include <cstring>
+#include <string>
+#include "BlockCodeCache.h"
+#include "MemoryUtils.h"
+#include "StdStreamUtils.h"
+#include "Log.h"
+#include "xxhash.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <Windows.h>
+#elif defined(__unix__) || defined(__ANDROID__) || defined(__APPLE__)
+#include <dlfcn.h>
+#endif
+
+#if defined(__APPLE__)
+#include <mach-o/loader.h>
+#elif defined(__unix__) || defined(__ANDROID__)
+#include <link.h>
+#endif
+
+#define LOG_NAME "BlockCodeCache"
+
+bool CBlockCodeCache::KEY::operator<(const KEY& rhs) const
+{
+	return std::tie(blockKey, compileHints) < std::tie(rhs.blockKey, rhs.compileHints);
+}
+
+void CBlockCodeCache::Open(const fs::path& path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if(m_outputStream && (m_path == path))
+	{
+		return;
+	}
+
+	FlushPendingEntries();
+	m_outputStream.reset();
+	m_entries.clear();
+	m_path.clear();
+
+	if(GetModuleBase(reinterpret_cast<uintptr_t>(&EmptyBlockHandler)) == 0)
+	{
+		//Can't figure out where our code lives, relocations won't work
+		return;
+	}
+
+	//Our code doesn't change while we run, no need to hash it every time
+	static const uint64 fingerprint = ComputeFingerprint();
+
+	try
+	{
+		bool valid = false;
+		bool complete = false;
+		if(fs::exists(path))
+		{
+			auto inputStream = Framework::CreateInputStdStream(path.native());
+			uint32 magic = inputStream.Read32();
+			uint32 version = inputStream.Read32();
+			uint64 fileFingerprint = 0;
+			inputStream.Read(&fileFingerprint, sizeof(fileFingerprint));
+			valid = (magic == FILE_MAGIC) && (version == FILE_VERSION) && (fileFingerprint == fingerprint);
+			if(valid)
+			{
+				complete = LoadEntries(inputStream);
+			}
+		}
+
+		if(valid && complete)
+		{
+			m_outputStream = std::make_unique<Framework::CStdStream>(Framework::CreateUpdateExistingStdStream(path.native()));
+			m_outputStream->Seek(0, Framework::STREAM_SEEK_END);
+		}
+		else
+		{
+			//Cache is missing, damaged or was built by a different executable.
+			//Rewrite it with whatever entries we managed to salvage.
+			m_outputStream = std::make_unique<Framework::CStdStream>(Framework::CreateOutputStdStream(path.native()));
+			m_outputStream->Write32(FILE_MAGIC);
+			m_outputStream->Write32(FILE_VERSION);
+			m_outputStream->Write(&fingerprint, sizeof(fingerprint));
+			for(const auto& entryPair : m_entries)
+			{
+				WriteEntry(*m_outputStream, entryPair.first, entryPair.second);
+			}
+			m_outputStream->Flush();
+		}
+		m_path = path;
+	}
+	catch(const std::exception& exception)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to open block code cache: %s.\r\n", exception.what());
+		m_outputStream.reset();
+		m_entries.clear();
+	}
+}
+
+void CBlockCodeCache::Close()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	FlushPendingEntries();
+	m_outputStream.reset();
+	m_entries.clear();
+	m_path.clear();
+}
+
+bool CBlockCodeCache::Find(const KEY& key, ENTRY& entry) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto entryIterator = m_entries.find(key);
+	if(entryIterator == std::end(m_entries))
+	{
+		return false;
+	}
+	entry = entryIterator->second;
+	return true;
+}
+
+void CBlockCodeCache::Insert(const KEY& key, ENTRY entry)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(!m_outputStream)
+	{
+		return;
+	}
+	if(m_entries.find(key) != std::end(m_entries))
+	{
+		return;
+	}
+	//Blocks get compiled in bursts, writing them one by one would stall the caller on every block
+	WriteEntry(m_pendingStream, key, entry);
+	m_entries.emplace(key, std::move(entry));
+	if(m_pendingStream.GetSize() >= WRITE_BATCH_SIZE)
+	{
+		FlushPendingEntries();
+	}
+}
+
+void CBlockCodeCache::Flush()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	FlushPendingEntries();
+}
+
+void CBlockCodeCache::FlushPendingEntries()
+{
+	if(m_outputStream && (m_pendingStream.GetSize() != 0))
+	{
+		try
+		{
+			m_outputStream->Write(m_pendingStream.GetBuffer(), m_pendingStream.GetSize());
+			m_outputStream->Flush();
+		}
+		catch(const std::exception& exception)
+		{
+			CLog::GetInstance().Warn(LOG_NAME, "Failed to write to block code cache: %s.\r\n", exception.what());
+			m_outputStream.reset();
+		}
+	}
+	m_pendingStream.ResetBuffer();
+}
+
+bool CBlockCodeCache::MakeSymbolOffset(uintptr_t symbol, int64& symbolOffset)
+{
+	uintptr_t moduleBase = GetModuleBase(reinterpret_cast<uintptr_t>(&EmptyBlockHandler));
+	//Only symbols from our own module have a stable location relative to it
+	if((moduleBase == 0) || (GetModuleBase(symbol) != moduleBase))
+	{
+		return false;
+	}
+	symbolOffset = static_cast<int64>(symbol - moduleBase);
+	return true;
+}
+
+uintptr_t CBlockCodeCache::ResolveSymbolOffset(int64 symbolOffset)
+{
+	uintptr_t moduleBase = GetModuleBase(reinterpret_cast<uintptr_t>(&EmptyBlockHandler));
+	assert(moduleBase != 0);
+	return moduleBase + static_cast<uintptr_t>(symbolOffset);
+}
+
+uintptr_t CBlockCodeCache::GetModuleBase(uintptr_t address)
+{
+#if defined(_WIN32)
+	HMODULE module = NULL;
+	if(!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+	                       reinterpret_cast<LPCWSTR>(address), &module))
+	{
+		return 0;
+	}
+	return reinterpret_cast<uintptr_t>(module);
+#elif defined(__unix__) || defined(__ANDROID__) || defined(__APPLE__)
+	Dl_info info = {};
+	if(dladdr(reinterpret_cast<void*>(address), &info) == 0)
+	{
+		return 0;
+	}
+	return reinterpret_cast<uintptr_t>(info.dli_fbase);
+#else
+	return 0;
+#endif
+}
+
+bool CBlockCodeCache::HashModuleCode(uintptr_t address, uint64& hash)
+{
+#if defined(_WIN32)
+	//Linker stamps these on every build (deterministic builds derive the time stamp from the contents)
+	uintptr_t moduleBase = GetModuleBase(address);
+	if(moduleBase == 0) return false;
+	auto dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(moduleBase);
+	auto ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*>(moduleBase + dosHeader->e_lfanew);
+	uint32 buildId[3] =
+	    {
+	        ntHeaders->FileHeader.TimeDateStamp,
+	        ntHeaders->OptionalHeader.SizeOfImage,
+	        ntHeaders->OptionalHeader.CheckSum,
+	    };
+	hash = XXH3_64bits(buildId, sizeof(buildId));
+	return true;
+#elif defined(__APPLE__)
+	//Linker gives each build a unique identifier
+	Dl_info info = {};
+	if(dladdr(reinterpret_cast<void*>(address), &info) == 0) return false;
+	auto header = reinterpret_cast<const mach_header_64*>(info.dli_fbase);
+	auto command = reinterpret_cast<const load_command*>(header + 1);
+	for(uint32 i = 0; i < header->ncmds; i++)
+	{
+		if(command->cmd == LC_UUID)
+		{
+			auto uuidCommand = reinterpret_cast<const uuid_command*>(command);
+			hash = XXH3_64bits(uuidCommand->uuid, sizeof(uuidCommand->uuid));
+			return true;
+		}
+		command = reinterpret_cast<const load_command*>(reinterpret_cast<const uint8*>(command) + command->cmdsize);
+	}
+	return false;
+#elif defined(__unix__) || defined(__ANDROID__)
+	//Build ids are optional, hash the executable segments of the module instead
+	struct MODULE_SEARCH
+	{
+		uintptr_t address = 0;
+		uint64 hash = 0;
+		bool found = false;
+	};
+	MODULE_SEARCH search;
+	search.address = address;
+	dl_iterate_phdr(
+	    [](dl_phdr_info* info, size_t, void* param) {
+		    auto search = reinterpret_cast<MODULE_SEARCH*>(param);
+		    bool containsAddress = false;
+		    for(unsigned int i = 0; i < info->dlpi_phnum; i++)
+		    {
+			    const auto& header = info->dlpi_phdr[i];
+			    if(header.p_type != PT_LOAD) continue;
+			    uintptr_t segmentBegin = info->dlpi_addr + header.p_vaddr;
+			    containsAddress |= (search->address >= segmentBegin) && (search->address < (segmentBegin + header.p_memsz));
+		    }
+		    if(!containsAddress) return 0;
+		    for(unsigned int i = 0; i < info->dlpi_phnum; i++)
+		    {
+			    const auto& header = info->dlpi_phdr[i];
+			    if((header.p_type != PT_LOAD) || ((header.p_flags & PF_X) == 0)) continue;
+			    auto segment = reinterpret_cast<const void*>(info->dlpi_addr + header.p_vaddr);
+			    search->hash = XXH3_64bits_withSeed(segment, header.p_filesz, search->hash);
+		    }
+		    search->found = true;
+		    return 1;
+	    },
+	    &search);
+	hash = search.hash;
+	return search.found;
+#else
+	return false;
+#endif
+}
+
+uint64 CBlockCodeCache::ComputeFingerprint()
+{
+	//Any change to the executable is very likely to move at least one of these functions around,
+	//which will invalidate caches generated by other builds
+	static const uintptr_t anchors[] =
+	    {
+	        reinterpret_cast<uintptr_t>(&EmptyBlockHandler),
+	        reinterpret_cast<uintptr_t>(&NextBlockTrampoline),
+	        reinterpret_cast<uintptr_t>(&BranchBlockTrampoline),
+	        reinterpret_cast<uintptr_t>(&MemoryUtils_GetWordProxy),
+	        reinterpret_cast<uintptr_t>(&MemoryUtils_SetWordProxy),
+	        reinterpret_cast<uintptr_t>(&MemoryUtils_GetQuadProxy),
+	        reinterpret_cast<uintptr_t>(&MemoryUtils_SetQuadProxy),
+	    };
+
+	std::string fingerprintData;
+#ifdef PLAY_VERSION
+	fingerprintData += PLAY_VERSION;
+#endif
+	fingerprintData += std::to_string(sizeof(void*));
+	for(const auto& anchor : anchors)
+	{
+		int64 anchorOffset = 0;
+		MakeSymbolOffset(anchor, anchorOffset);
+		fingerprintData += ";" + std::to_string(anchorOffset);
+	}
+	//Catches changes to the code generator that leave the anchors in place
+	uint64 moduleCodeHash = 0;
+	if(HashModuleCode(reinterpret_cast<uintptr_t>(&EmptyBlockHandler), moduleCodeHash))
+	{
+		fingerprintData += ";" + std::to_string(moduleCodeHash);
+	}
+	else
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to identify the emulator's build, cache relies on symbol locations only.\r\n");
+	}
+	return XXH3_64bits(fingerprintData.data(), fingerprintData.size());
+}
+
+bool CBlockCodeCache::LoadEntries(Framework::CStream& stream)
+{
+	//Entries are appended as we go, a truncated entry at the end of the file
+	//means we were interrupted while writing it. Ignore it.
+	try
+	{
+		while(true)
+		{
+			KEY key = {};
+			auto keyReadSize = stream.Read(&key.blockKey, sizeof(key.blockKey));
+			if(keyReadSize == 0)
+			{
+				return true;
+			}
+			if(keyReadSize != sizeof(key.blockKey))
+			{
+				break;
+			}
+			key.compileHints = stream.Read32();
+
+			ENTRY entry;
+			uint32 codeSize = stream.Read32();
+			uint32 relocationCount = stream.Read32();
+			entry.code.resize(codeSize);
+			if(stream.Read(entry.code.data(), codeSize) != codeSize)
+			{
+				break;
+			}
+			entry.relocations.resize(relocationCount);
+			for(auto& relocation : entry.relocations)
+			{
+				relocation.offset = stream.Read32();
+				stream.Read(&relocation.symbolOffset, sizeof(relocation.symbolOffset));
+			}
+			if(stream.IsEOF())
+			{
+				break;
+			}
+			m_entries.emplace(key, std::move(entry));
+		}
+	}
+	catch(...)
+	{
+	}
+	return false;
+}
+
+void CBlockCodeCache::WriteEntry(Framework::CStream& stream, const KEY& key, const ENTRY& entry)
+{
+	stream.Write(&key.blockKey, sizeof(key.blockKey));
+	stream.Write32(key.compileHints);
+	stream.Write32(static_cast<uint32>(entry.code.size()));
+	stream.Write32(static_cast<uint32>(entry.relocations.size()));
+	stream.Write(entry.code.data(), entry.code.size());
+	for(const auto& relocation : entry.relocations)
+	{
+		stream.Write32(relocation.offset);
+		stream.Write(&relocation.symbolOffset, sizeof(relocation.symbolOffset));
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "filesystem_def.h"
+#include "StdStream.h"
+#include "MemStream.h"
+#include "BasicBlock.h"
+
+//Persistent cache of compiled basic block code. Entries are appended to a file in batches as
+//blocks are compiled and reloaded on the next run, which saves us from recompiling everything.
+//The file is keyed on the code of the emulator's module, any other build starts a new cache.
+//External symbol references are stored relative to the base of the module that contains
+//the emulator's code and are relocated when an entry is loaded back.
+class CBlockCodeCache
+{
+public:
+	struct KEY
+	{
+		AOT_BLOCK_KEY blockKey;
+		uint32 compileHints;
+
+		bool operator<(const KEY&) const;
+	};
+
+	struct RELOCATION
+	{
+		uint32 offset;
+		int64 symbolOffset;
+	};
+
+	struct ENTRY
+	{
+		std::vector<uint8> code;
+		std::vector<RELOCATION> relocations;
+	};
+
+	CBlockCodeCache() = default;
+	CBlockCodeCache(const CBlockCodeCache&) = delete;
+
+	CBlockCodeCache& operator=(const CBlockCodeCache&) = delete;
+
+	void Open(const fs::path&);
+	void Close();
+
+	//Writes entries that are still waiting in the batch
+	void Flush();
+
+	bool Find(const KEY&, ENTRY&) const;
+	void Insert(const KEY&, ENTRY);
+
+	static bool MakeSymbolOffset(uintptr_t, int64&);
+	static uintptr_t ResolveSymbolOffset(int64);
+
+private:
+	typedef std::map<KEY, ENTRY> EntryMap;
+
+	enum
+	{
+		FILE_MAGIC = 0x43434A50, //'PJCC'
+		FILE_VERSION = 1,
+		WRITE_BATCH_SIZE = 0x40000,
+	};
+
+	static uintptr_t GetModuleBase(uintptr_t);
+	static uint64 ComputeFingerprint();
+	static bool HashModuleCode(uintptr_t, uint64&);
+
+	bool LoadEntries(Framework::CStream&);
+	static void WriteEntry(Framework::CStream&, const KEY&, const ENTRY&);
+	void FlushPendingEntries();
+
+	mutable std::mutex m_mutex;
+	fs::path m_path;
+	EntryMap m_entries;
+	std::unique_ptr<Framework::CStdStream> m_outputStream;
+	//Entries inserted since the last write, written to the file once there's enough of them
+	Framework::CMemStream m_pendingStream;
+};
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cassert>
+#include "BlockCompileWorker.h"
+#include "ThreadUtils.h"
+
+CBlockCompileWorker::~CBlockCompileWorker()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_threadDone = true;
+	}
+	m_jobCondition.notify_all();
+	if(m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+bool CBlockCompileWorker::IsTracking(uint32 address) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_jobs.find(address) != std::end(m_jobs);
+}
+
+void CBlockCompileWorker::Enqueue(std::shared_ptr<CBasicBlock> block)
+{
+	assert(!block->IsEmpty());
+	assert(!block->IsCompiled());
+
+	uint32 address = block->GetBeginAddress();
+	auto opcodeHash = block->ComputeOpcodeHash();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_jobs.size() >= MAX_PENDING_BLOCKS)
+		{
+			return;
+		}
+		if(m_jobs.find(address) != std::end(m_jobs))
+		{
+			return;
+		}
+
+		JOB job;
+		job.block = std::move(block);
+		job.opcodeHash = opcodeHash;
+		job.codeGenState = job.block->GetCodeGenState();
+		job.enqueueTime = Clock::now();
+		m_jobs.emplace(address, std::move(job));
+		m_queue.push_back(address);
+
+		m_stats.queueDepth = static_cast<uint32>(m_queue.size());
+		m_stats.maxQueueDepth = std::max(m_stats.maxQueueDepth, m_stats.queueDepth);
+
+		if(!m_thread.joinable())
+		{
+			m_thread = std::thread([this]() { ThreadProc(); });
+			Framework::ThreadUtils::SetThreadName(m_thread, "Block Compile Thread");
+		}
+	}
+	m_jobCondition.notify_one();
+}
+
+std::shared_ptr<CBasicBlock> CBlockCompileWorker::Take(uint32 begin, uint32 end, const MIPS_CODEGEN_STATE& codeGenState)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	auto jobIterator = m_jobs.find(begin);
+	if(jobIterator == std::end(m_jobs))
+	{
+		return std::shared_ptr<CBasicBlock>();
+	}
+
+	//If the block is being compiled right now, it's cheaper to wait than to start over
+	WaitForActiveJob(lock, begin);
+
+	jobIterator = m_jobs.find(begin);
+	if(jobIterator == std::end(m_jobs))
+	{
+		return std::shared_ptr<CBasicBlock>();
+	}
+
+	auto job = std::move(jobIterator->second);
+	m_jobs.erase(jobIterator);
+
+	if(!job.compiled)
+	{
+		m_queue.erase(std::remove(std::begin(m_queue), std::end(m_queue), begin), std::end(m_queue));
+		m_stats.queueDepth = static_cast<uint32>(m_queue.size());
+		m_stats.discardedCount++;
+		return std::shared_ptr<CBasicBlock>();
+	}
+
+	//Make sure the code, the address translation mode or the breakpoints didn't change since we compiled it
+	if((job.block->GetEndAddress() != end) || !(job.block->ComputeOpcodeHash() == job.opcodeHash) ||
+	   (job.codeGenState != codeGenState))
+	{
+		m_stats.discardedCount++;
+		return std::shared_ptr<CBasicBlock>();
+	}
+
+	auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - job.enqueueTime);
+	m_stats.usedCount++;
+	m_stats.totalLatencyUs += latency.count();
+	return job.block;
+}
+
+void CBlockCompileWorker::Cancel(uint32 address)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto jobIterator = m_jobs.find(address);
+	if(jobIterator == std::end(m_jobs))
+	{
+		return;
+	}
+	//If the job is currently being compiled, the worker will notice it's gone and drop the result
+	m_jobs.erase(jobIterator);
+	m_queue.erase(std::remove(std::begin(m_queue), std::end(m_queue), address), std::end(m_queue));
+	m_stats.queueDepth = static_cast<uint32>(m_queue.size());
+	m_stats.discardedCount++;
+}
+
+void CBlockCompileWorker::Clear()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_jobs.clear();
+	m_queue.clear();
+	m_stats.queueDepth = 0;
+	//Blocks being compiled reference guest memory, wait for the worker to be done with it
+	WaitForActiveJob(lock, m_activeJobAddress);
+}
+
+CBlockCompileWorker::STATS CBlockCompileWorker::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void CBlockCompileWorker::WaitForActiveJob(std::unique_lock<std::mutex>& lock, uint32 address)
+{
+	if(address == MIPS_INVALID_PC) return;
+	m_jobDoneCondition.wait(lock, [&]() { return m_activeJobAddress != address; });
+}
+
+void CBlockCompileWorker::ThreadProc()
+{
+	while(true)
+	{
+		uint32 address = MIPS_INVALID_PC;
+		std::shared_ptr<CBasicBlock> block;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobCondition.wait(lock, [&]() { return m_threadDone || !m_queue.empty(); });
+			if(m_threadDone)
+			{
+				break;
+			}
+			address = m_queue.front();
+			m_queue.pop_front();
+			m_stats.queueDepth = static_cast<uint32>(m_queue.size());
+
+			auto jobIterator = m_jobs.find(address);
+			assert(jobIterator != std::end(m_jobs));
+			block = jobIterator->second.block;
+			m_activeJobAddress = address;
+		}
+
+		auto compileStartTime = Clock::now();
+		block->Compile();
+		auto compileTime = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - compileStartTime);
+		auto opcodeHash = block->ComputeOpcodeHash();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_activeJobAddress = MIPS_INVALID_PC;
+
+			m_stats.compiledCount++;
+			m_stats.totalCompileTimeUs += compileTime.count();
+			m_stats.maxCompileTimeUs = std::max<uint64>(m_stats.maxCompileTimeUs, compileTime.count());
+
+			auto jobIterator = m_jobs.find(address);
+			if((jobIterator != std::end(m_jobs)) && (jobIterator->second.block == block))
+			{
+				auto& job = jobIterator->second;
+				if(job.opcodeHash == opcodeHash)
+				{
+					job.compiled = true;
+				}
+				else
+				{
+					//Code was modified while we were compiling
+					m_jobs.erase(jobIterator);
+					m_stats.discardedCount++;
+				}
+			}
+		}
+		m_jobDoneCondition.notify_all();
+	}
+}
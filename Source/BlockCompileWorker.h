@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "BasicBlock.h"
+
+//Compiles blocks on a background thread ahead of execution. The executor enqueues blocks
+//it expects to run soon and picks them up once execution reaches them. If a block isn't
+//ready at that point, the executor compiles it itself as it would normally do.
+//Blocks are compiled from the context state they copied when created, on the executor's
+//thread, and are only used if that state still matches when they're taken.
+class CBlockCompileWorker
+{
+public:
+	enum
+	{
+		MAX_PENDING_BLOCKS = 64,
+	};
+
+	struct STATS
+	{
+		uint32 queueDepth = 0;
+		uint32 maxQueueDepth = 0;
+		uint32 compiledCount = 0;
+		uint32 usedCount = 0;
+		uint32 discardedCount = 0;
+		uint64 totalCompileTimeUs = 0;
+		uint64 maxCompileTimeUs = 0;
+		uint64 totalLatencyUs = 0;
+	};
+
+	CBlockCompileWorker() = default;
+	CBlockCompileWorker(const CBlockCompileWorker&) = delete;
+	~CBlockCompileWorker();
+
+	CBlockCompileWorker& operator=(const CBlockCompileWorker&) = delete;
+
+	bool IsTracking(uint32) const;
+	void Enqueue(std::shared_ptr<CBasicBlock>);
+	std::shared_ptr<CBasicBlock> Take(uint32, uint32, const MIPS_CODEGEN_STATE&);
+	void Cancel(uint32);
+	void Clear();
+
+	STATS GetStats() const;
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct JOB
+	{
+		std::shared_ptr<CBasicBlock> block;
+		uint128 opcodeHash;
+		MIPS_CODEGEN_STATE codeGenState;
+		Clock::time_point enqueueTime;
+		bool compiled = false;
+	};
+	typedef std::map<uint32, JOB> JobMap;
+
+	void WaitForActiveJob(std::unique_lock<std::mutex>&, uint32);
+	void ThreadProc();
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_jobCondition;
+	std::condition_variable m_jobDoneCondition;
+	std::deque<uint32> m_queue;
+	JobMap m_jobs;
+	uint32 m_activeJobAddress = MIPS_INVALID_PC;
+	std::thread m_thread;
+	bool m_threadDone = false;
+	STATS m_stats;
+};
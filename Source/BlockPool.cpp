@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <cassert>
+#include <new>
+#include "BlockPool.h"
+
+CBlockPool& CBlockPool::GetInstance()
+{
+	//Never destroyed, blocks owned by static objects can still be freed during exit
+	static auto pool = new CBlockPool();
+	return *pool;
+}
+
+size_t CBlockPool::GetSizeClass(size_t size)
+{
+	assert(size != 0);
+	return (size - 1) / ITEM_ALIGNMENT;
+}
+
+void* CBlockPool::Allocate(size_t size)
+{
+	if(size > MAX_ITEM_SIZE)
+	{
+		return ::operator new(size);
+	}
+
+	size_t sizeClass = GetSizeClass(size);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto& availableSlabs = m_availableSlabs[sizeClass];
+	if(availableSlabs.empty())
+	{
+		availableSlabs.push_back(CreateSlab(sizeClass));
+	}
+	auto slab = availableSlabs.back();
+	auto item = slab->freeItems;
+	assert(item);
+	slab->freeItems = item->next;
+	slab->freeCount--;
+	if(slab->freeCount == 0)
+	{
+		availableSlabs.pop_back();
+	}
+	return item;
+}
+
+void CBlockPool::Free(void* ptr, size_t size)
+{
+	if(size > MAX_ITEM_SIZE)
+	{
+		::operator delete(ptr);
+		return;
+	}
+
+	size_t sizeClass = GetSizeClass(size);
+	auto item = reinterpret_cast<FREE_ITEM*>(ptr);
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto slabIterator = m_slabs.upper_bound(reinterpret_cast<const uint8*>(ptr));
+	assert(slabIterator != std::begin(m_slabs));
+	slabIterator--;
+	auto slab = slabIterator->second.get();
+	assert(slab->sizeClass == sizeClass);
+
+	item->next = slab->freeItems;
+	slab->freeItems = item;
+	slab->freeCount++;
+
+	auto& availableSlabs = m_availableSlabs[sizeClass];
+	if(slab->freeCount == 1)
+	{
+		availableSlabs.push_back(slab);
+	}
+	else if((slab->freeCount == ITEMS_PER_SLAB) && (availableSlabs.size() > 1))
+	{
+		DestroySlab(slab);
+	}
+}
+
+CBlockPool::SLAB* CBlockPool::CreateSlab(size_t sizeClass)
+{
+	size_t itemSize = (sizeClass + 1) * ITEM_ALIGNMENT;
+	auto slab = std::make_unique<SLAB>();
+	slab->memory = std::make_unique<uint8[]>(itemSize * ITEMS_PER_SLAB);
+	slab->sizeClass = sizeClass;
+	for(uint32 i = 0; i < ITEMS_PER_SLAB; i++)
+	{
+		auto item = reinterpret_cast<FREE_ITEM*>(slab->memory.get() + (i * itemSize));
+		item->next = slab->freeItems;
+		slab->freeItems = item;
+	}
+	slab->freeCount = ITEMS_PER_SLAB;
+	auto result = slab.get();
+	m_slabs.emplace(result->memory.get(), std::move(slab));
+	return result;
+}
+
+void CBlockPool::DestroySlab(SLAB* slab)
+{
+	auto& availableSlabs = m_availableSlabs[slab->sizeClass];
+	auto availableIterator = std::find(std::begin(availableSlabs), std::end(availableSlabs), slab);
+	assert(availableIterator != std::end(availableSlabs));
+	std::swap(*availableIterator, availableSlabs.back());
+	availableSlabs.pop_back();
+	m_slabs.erase(slab->memory.get());
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Types.h"
+
+//Fixed size slabs for block objects. Blocks are created and destroyed often and keeping
+//them packed together is friendlier to the cache than spreading them in the general heap.
+//Slabs that become empty are given back, except for one per size class to avoid churn.
+class CBlockPool
+{
+public:
+	CBlockPool() = default;
+	CBlockPool(const CBlockPool&) = delete;
+
+	CBlockPool& operator=(const CBlockPool&) = delete;
+
+	static CBlockPool& GetInstance();
+
+	void* Allocate(size_t);
+	void Free(void*, size_t);
+
+private:
+	enum
+	{
+		ITEM_ALIGNMENT = 0x10,
+		MAX_ITEM_SIZE = 0x800,
+		ITEMS_PER_SLAB = 0x100,
+		SIZE_CLASS_COUNT = MAX_ITEM_SIZE / ITEM_ALIGNMENT,
+	};
+
+	struct FREE_ITEM
+	{
+		FREE_ITEM* next;
+	};
+
+	struct SLAB
+	{
+		std::unique_ptr<uint8[]> memory;
+		size_t sizeClass = 0;
+		FREE_ITEM* freeItems = nullptr;
+		uint32 freeCount = 0;
+	};
+	typedef std::map<const uint8*, std::unique_ptr<SLAB>> SlabMap;
+	typedef std::vector<SLAB*> SlabArray;
+
+	static size_t GetSizeClass(size_t);
+
+	SLAB* CreateSlab(size_t);
+	void DestroySlab(SLAB*);
+
+	std::mutex m_mutex;
+	//Slabs indexed by their address, used to find the slab an item belongs to
+	SlabMap m_slabs;
+	//Slabs that have free items, for each size class
+	SlabArray m_availableSlabs[SIZE_CLASS_COUNT];
+};
+
+template <typename T>
+class CBlockPoolAllocator
+{
+public:
+	typedef T value_type;
+
+	CBlockPoolAllocator() = default;
+
+	template <typename U>
+	CBlockPoolAllocator(const CBlockPoolAllocator<U>&)
+	{
+	}
+
+	T* allocate(size_t count)
+	{
+		return reinterpret_cast<T*>(CBlockPool::GetInstance().Allocate(count * sizeof(T)));
+	}
+
+	void deallocate(T* ptr, size_t count)
+	{
+		CBlockPool::GetInstance().Free(ptr, count * sizeof(T));
+	}
+
+	template <typename U>
+	bool operator==(const CBlockPoolAllocator<U>&) const
+	{
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const CBlockPoolAllocator<U>&) const
+	{
+		return false;
+	}
+};
+
+template <typename BlockType, typename... Args>
+std::shared_ptr<BlockType> MakeBlock(Args&&... args)
+{
+	return std::allocate_shared<BlockType>(CBlockPoolAllocator<BlockType>(), std::forward<Args>(args)...);
+}
@@ -0,0 +1,338 @@
+#include <cassert>
+#include <cstring>
+#include <utility>
+#include "CodeArena.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(CODEARENA_SUPPORTED)
+#include <sys/mman.h>
+#endif
+
+//Regions are aligned on huge page boundaries to let the OS back them with huge pages
+#define HUGE_DISCARD_CHUNK_SIZE (0x200000)
+//Free space is given back to the OS in chunks of this size, a multiple of the page size on supported platforms
+#define DISCARD_CHUNK_SIZE (0x10000)
+
+CCodeArena::REGION::REGION(size_t requestedSize)
+{
+	size_t size = (requestedSize + (HUGE_DISCARD_CHUNK_SIZE - 1)) & ~static_cast<size_t>(HUGE_DISCARD_CHUNK_SIZE - 1);
+#if defined(_WIN32)
+	//Large pages require a privilege most users don't have, fallback to regular pages if that fails
+	size_t largePageSize = GetLargePageMinimum();
+	if((largePageSize != 0) && ((size % largePageSize) == 0))
+	{
+		memory = reinterpret_cast<uint8*>(VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_EXECUTE_READWRITE));
+	}
+	if(!memory)
+	{
+		memory = reinterpret_cast<uint8*>(VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_EXECUTE_READWRITE));
+	}
+#elif defined(CODEARENA_SUPPORTED)
+	//Reserve more than needed and trim to get an aligned range
+	size_t mapSize = size + HUGE_DISCARD_CHUNK_SIZE;
+	void* mapMemory = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(mapMemory != MAP_FAILED)
+	{
+		auto mapBegin = reinterpret_cast<uintptr_t>(mapMemory);
+		auto alignedBegin = (mapBegin + (HUGE_DISCARD_CHUNK_SIZE - 1)) & ~static_cast<uintptr_t>(HUGE_DISCARD_CHUNK_SIZE - 1);
+		auto alignedEnd = alignedBegin + size;
+		if(alignedBegin != mapBegin)
+		{
+			munmap(mapMemory, alignedBegin - mapBegin);
+		}
+		if(alignedEnd != (mapBegin + mapSize))
+		{
+			munmap(reinterpret_cast<void*>(alignedEnd), (mapBegin + mapSize) - alignedEnd);
+		}
+		memory = reinterpret_cast<uint8*>(alignedBegin);
+#ifdef MADV_HUGEPAGE
+		madvise(memory, size, MADV_HUGEPAGE);
+#endif
+	}
+#endif
+	assert(memory);
+	this->size = memory ? size : 0;
+}
+
+CCodeArena::REGION::~REGION()
+{
+	if(!memory) return;
+#if defined(_WIN32)
+	VirtualFree(memory, 0, MEM_RELEASE);
+#elif defined(CODEARENA_SUPPORTED)
+	munmap(memory, size);
+#endif
+}
+
+CCodeArena& CCodeArena::GetInstance()
+{
+	//Never destroyed, functions owned by static objects can still be freed during exit
+	static auto arena = new CCodeArena();
+	return *arena;
+}
+
+size_t CCodeArena::GetAllocSize(size_t size)
+{
+	return (size + (CODE_ALIGNMENT - 1)) & ~static_cast<size_t>(CODE_ALIGNMENT - 1);
+}
+
+uint8* CCodeArena::Allocate(const void* code, size_t size, RegionPtr& region)
+{
+	size_t allocSize = GetAllocSize(size);
+	uint8* result = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		//Nothing else lives in the current region anymore, we can start over from its beginning
+		if(m_currentRegion && (m_currentRegion.use_count() == 1))
+		{
+			m_currentRegion->freeRanges.clear();
+			m_currentRegion->freeRangesBySize.clear();
+			m_currentOffset = 0;
+		}
+
+		if(allocSize > REGION_SIZE)
+		{
+			//Too big to be shared, give it its own region
+			region = std::make_shared<REGION>(allocSize);
+			result = region->memory;
+		}
+		else
+		{
+			//Reuse space of functions that are gone before taking more from the current region
+			for(auto regionIterator = std::begin(m_regions); regionIterator != std::end(m_regions);)
+			{
+				auto freeRegion = regionIterator->lock();
+				if(!freeRegion)
+				{
+					regionIterator = m_regions.erase(regionIterator);
+					continue;
+				}
+				size_t offset = 0;
+				if(AllocateFreeRange(*freeRegion, allocSize, offset))
+				{
+					region = std::move(freeRegion);
+					result = region->memory + offset;
+					break;
+				}
+				regionIterator++;
+			}
+
+			if(!result)
+			{
+				if(!m_currentRegion || ((m_currentOffset + allocSize) > m_currentRegion->size))
+				{
+					if(m_currentRegion && (m_currentOffset != m_currentRegion->size))
+					{
+						//Tail of the current region can still be used by smaller functions
+						AddFreeRange(*m_currentRegion, m_currentOffset, m_currentRegion->size - m_currentOffset);
+					}
+					m_currentRegion = std::make_shared<REGION>(REGION_SIZE);
+					m_currentOffset = 0;
+					m_regions.push_back(m_currentRegion);
+				}
+				region = m_currentRegion;
+				result = m_currentRegion->memory + m_currentOffset;
+				m_currentOffset += allocSize;
+			}
+		}
+	}
+	memcpy(result, code, size);
+	return result;
+}
+
+void CCodeArena::Free(uint8* code, size_t size, RegionPtr& region)
+{
+	assert(region);
+	size_t allocSize = GetAllocSize(size);
+	if(allocSize <= REGION_SIZE)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		assert((code >= region->memory) && ((code + allocSize) <= (region->memory + region->size)));
+		AddFreeRange(*region, code - region->memory, allocSize);
+	}
+	//Region is unmapped outside of the lock if this was its last function
+	region.reset();
+}
+
+void CCodeArena::Trim()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_currentRegion && (m_currentRegion.use_count() == 1))
+	{
+		m_currentRegion.reset();
+		m_currentOffset = 0;
+	}
+	for(auto regionIterator = std::begin(m_regions); regionIterator != std::end(m_regions);)
+	{
+		auto region = regionIterator->lock();
+		if(!region)
+		{
+			regionIterator = m_regions.erase(regionIterator);
+			continue;
+		}
+		//Functions that are still alive keep their pages, the rest of the region doesn't need to be resident
+		for(const auto& freeRange : region->freeRanges)
+		{
+			DiscardPages(*region, freeRange.first, freeRange.second);
+		}
+		if(region == m_currentRegion)
+		{
+			DiscardPages(*region, m_currentOffset, region->size - m_currentOffset);
+		}
+		regionIterator++;
+	}
+}
+
+bool CCodeArena::AllocateFreeRange(REGION& region, size_t allocSize, size_t& offset)
+{
+	//Best fit, keeps large ranges available for large functions
+	auto rangeIterator = region.freeRangesBySize.lower_bound(allocSize);
+	if(rangeIterator == std::end(region.freeRangesBySize)) return false;
+
+	size_t rangeSize = rangeIterator->first;
+	size_t rangeOffset = rangeIterator->second;
+	region.freeRangesBySize.erase(rangeIterator);
+	region.freeRanges.erase(rangeOffset);
+	if(rangeSize != allocSize)
+	{
+		region.freeRanges.emplace(rangeOffset + allocSize, rangeSize - allocSize);
+		region.freeRangesBySize.emplace(rangeSize - allocSize, rangeOffset + allocSize);
+	}
+	offset = rangeOffset;
+	return true;
+}
+
+void CCodeArena::AddFreeRange(REGION& region, size_t offset, size_t size)
+{
+	auto& freeRanges = region.freeRanges;
+	auto nextIterator = freeRanges.lower_bound(offset);
+	if((nextIterator != std::end(freeRanges)) && ((offset + size) == nextIterator->first))
+	{
+		size += nextIterator->second;
+		RemoveFreeRangeBySize(region, nextIterator->first, nextIterator->second);
+		nextIterator = freeRanges.erase(nextIterator);
+	}
+	if(nextIterator != std::begin(freeRanges))
+	{
+		auto prevIterator = std::prev(nextIterator);
+		if((prevIterator->first + prevIterator->second) == offset)
+		{
+			offset = prevIterator->first;
+			size += prevIterator->second;
+			RemoveFreeRangeBySize(region, prevIterator->first, prevIterator->second);
+			freeRanges.erase(prevIterator);
+		}
+	}
+	freeRanges.emplace(offset, size);
+	region.freeRangesBySize.emplace(size, offset);
+}
+
+void CCodeArena::RemoveFreeRangeBySize(REGION& region, size_t offset, size_t size)
+{
+	auto sizeRange = region.freeRangesBySize.equal_range(size);
+	for(auto rangeIterator = sizeRange.first; rangeIterator != sizeRange.second; rangeIterator++)
+	{
+		if(rangeIterator->second == offset)
+		{
+			region.freeRangesBySize.erase(rangeIterator);
+			return;
+		}
+	}
+	assert(false);
+}
+
+void CCodeArena::DiscardPages(REGION& region, size_t offset, size_t size)
+{
+	//Only whole pages can be discarded, contents read back as zero (or garbage on Windows) until written again
+	size_t pageBegin = (offset + (DISCARD_CHUNK_SIZE - 1)) & ~static_cast<size_t>(DISCARD_CHUNK_SIZE - 1);
+	size_t pageEnd = (offset + size) & ~static_cast<size_t>(DISCARD_CHUNK_SIZE - 1);
+	if(pageEnd <= pageBegin) return;
+#if defined(_WIN32)
+	VirtualAlloc(region.memory + pageBegin, pageEnd - pageBegin, MEM_RESET, PAGE_EXECUTE_READWRITE);
+#elif defined(CODEARENA_SUPPORTED)
+	madvise(region.memory + pageBegin, pageEnd - pageBegin, MADV_DONTNEED);
+#endif
+}
+
+CCodeArenaFunction::CCodeArenaFunction(const void* code, size_t size)
+{
+	if(size == 0) return;
+	m_code = CCodeArena::GetInstance().Allocate(code, size, m_region);
+	m_size = size;
+	ClearCache();
+}
+
+CCodeArenaFunction::CCodeArenaFunction(CCodeArenaFunction&& src)
+{
+	(*this) = std::move(src);
+}
+
+CCodeArenaFunction::~CCodeArenaFunction()
+{
+	Release();
+}
+
+CCodeArenaFunction& CCodeArenaFunction::operator=(CCodeArenaFunction&& rhs)
+{
+	Release();
+	m_region = std::move(rhs.m_region);
+	m_code = std::exchange(rhs.m_code, nullptr);
+	m_size = std::exchange(rhs.m_size, 0);
+	return (*this);
+}
+
+void CCodeArenaFunction::operator()(void* context)
+{
+	assert(m_code);
+	reinterpret_cast<void (*)(void*)>(m_code)(context);
+}
+
+void* CCodeArenaFunction::GetCode() const
+{
+	return m_code;
+}
+
+size_t CCodeArenaFunction::GetSize() const
+{
+	return m_size;
+}
+
+bool CCodeArenaFunction::IsEmpty() const
+{
+	return (m_code == nullptr);
+}
+
+void CCodeArenaFunction::BeginModify()
+{
+	//Regions are always writable
+}
+
+void CCodeArenaFunction::EndModify()
+{
+	ClearCache();
+}
+
+CCodeArenaFunction CCodeArenaFunction::CreateInstance() const
+{
+	if(IsEmpty()) return CCodeArenaFunction();
+	return CCodeArenaFunction(m_code, m_size);
+}
+
+void CCodeArenaFunction::Release()
+{
+	if(!m_code) return;
+	CCodeArena::GetInstance().Free(m_code, m_size, m_region);
+	m_code = nullptr;
+	m_size = 0;
+}
+
+void CCodeArenaFunction::ClearCache()
+{
+#if defined(_WIN32)
+	FlushInstructionCache(GetCurrentProcess(), m_code, m_size);
+#elif defined(CODEARENA_SUPPORTED)
+	__builtin___clear_cache(reinterpret_cast<char*>(m_code), reinterpret_cast<char*>(m_code + m_size));
+#endif
+}
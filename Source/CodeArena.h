@@ -0,0 +1,108 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Types.h"
+
+//Regions are mapped writable and executable at the same time, Android doesn't always allow that
+#if (defined(_WIN32) || defined(__linux__)) && !defined(__EMSCRIPTEN__) && !defined(__ANDROID__)
+#define CODEARENA_SUPPORTED
+#endif
+
+//Allocates generated code in large executable regions instead of giving each function
+//its own executable allocation. Keeps code of blocks close together (less iTLB pressure) and
+//makes creating functions cheaper. Space of destroyed functions goes in a free list and is
+//reused before a region grows or a new one is created. A region is released when all the
+//functions it holds are gone, so clearing all blocks (ie.: on reset) gives the memory back.
+class CCodeArena
+{
+public:
+	struct REGION
+	{
+		REGION(size_t);
+		REGION(const REGION&) = delete;
+		~REGION();
+
+		REGION& operator=(const REGION&) = delete;
+
+		uint8* memory = nullptr;
+		size_t size = 0;
+
+		//Free ranges by offset and by size, adjacent ranges are merged
+		std::map<size_t, size_t> freeRanges;
+		std::multimap<size_t, size_t> freeRangesBySize;
+	};
+	typedef std::shared_ptr<REGION> RegionPtr;
+
+	CCodeArena() = default;
+	CCodeArena(const CCodeArena&) = delete;
+
+	CCodeArena& operator=(const CCodeArena&) = delete;
+
+	static CCodeArena& GetInstance();
+
+	//Copies code in a region and returns its location, region must be kept alive while code is used
+	uint8* Allocate(const void*, size_t, RegionPtr&);
+
+	//Gives back the space used by code and drops the reference to its region
+	void Free(uint8*, size_t, RegionPtr&);
+
+	//Releases the current region if nothing uses it and gives back pages of free space to the OS
+	void Trim();
+
+private:
+	enum
+	{
+		REGION_SIZE = 0x2000000,
+		CODE_ALIGNMENT = 0x10,
+	};
+
+	typedef std::weak_ptr<REGION> RegionWeakPtr;
+
+	static size_t GetAllocSize(size_t);
+	static bool AllocateFreeRange(REGION&, size_t, size_t&);
+	static void AddFreeRange(REGION&, size_t, size_t);
+	static void RemoveFreeRangeBySize(REGION&, size_t, size_t);
+	static void DiscardPages(REGION&, size_t, size_t);
+
+	std::mutex m_mutex;
+	RegionPtr m_currentRegion;
+	size_t m_currentOffset = 0;
+	//All shared regions, including the current one. Others are kept alive by their functions only.
+	std::vector<RegionWeakPtr> m_regions;
+};
+
+//Same interface as CMemoryFunction, but code lives in the code arena
+class CCodeArenaFunction
+{
+public:
+	CCodeArenaFunction() = default;
+	CCodeArenaFunction(const void*, size_t);
+	CCodeArenaFunction(const CCodeArenaFunction&) = delete;
+	CCodeArenaFunction(CCodeArenaFunction&&);
+	~CCodeArenaFunction();
+
+	CCodeArenaFunction& operator=(const CCodeArenaFunction&) = delete;
+	CCodeArenaFunction& operator=(CCodeArenaFunction&&);
+
+	void operator()(void*);
+
+	void* GetCode() const;
+	size_t GetSize() const;
+	bool IsEmpty() const;
+
+	void BeginModify();
+	void EndModify();
+
+	CCodeArenaFunction CreateInstance() const;
+
+private:
+	void Release();
+	void ClearCache();
+
+	CCodeArena::RegionPtr m_region;
+	uint8* m_code = nullptr;
+	size_t m_size = 0;
+};
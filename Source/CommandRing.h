@@ -0,0 +1,241 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include "Types.h"
+
+struct COMMANDRING_STATS
+{
+	uint32 capacity = 0;
+	uint32 occupancy = 0;
+	uint32 peakOccupancy = 0;
+	uint64 pushCount = 0;
+	uint64 producerStallCount = 0;
+	uint64 overflowCount = 0;
+};
+
+//Bounded ring of fixed size command records. Any thread can push, only one thread pops.
+//Records are written and read in place, pushing and popping don't take any lock. The
+//mutex is only involved when one side needs to sleep until the other one catches up.
+//The consumer can push too, see PushFromConsumer.
+template <typename CommandType>
+class CCommandRing
+{
+public:
+	explicit CCommandRing(uint32 capacity)
+	    : m_capacity(capacity)
+	    , m_slots(std::make_unique<SLOT[]>(capacity))
+	{
+		assert((capacity & (capacity - 1)) == 0);
+		for(uint32 i = 0; i < capacity; i++)
+		{
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	CCommandRing(const CCommandRing&) = delete;
+	CCommandRing& operator=(const CCommandRing&) = delete;
+
+	//Calls writeFunction on a free record and publishes it. Returns false if the ring is full
+	//or if commands pushed by the consumer are still waiting to get in.
+	template <typename WriteFunction>
+	bool TryPush(const WriteFunction& writeFunction)
+	{
+		return PushRecord(writeFunction, true);
+	}
+
+	//Consumer side, for commands pushed while executing another one. Never blocks: if the ring
+	//is full, the command is kept aside and moved to the ring as soon as Pop makes room for it.
+	//Other producers are held back until then, so they can't get ahead of it.
+	template <typename WriteFunction>
+	void PushFromConsumer(const WriteFunction& writeFunction)
+	{
+		if(m_overflow.empty() && PushRecord(writeFunction, false)) return;
+		m_overflowPending.store(true, std::memory_order_relaxed);
+		m_overflow.emplace_back();
+		writeFunction(m_overflow.back());
+		m_overflowCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//Consumer side
+	bool IsPending() const
+	{
+		uint64 position = m_dequeuePosition.load(std::memory_order_relaxed);
+		const auto& slot = m_slots[position & (m_capacity - 1)];
+		return slot.sequence.load(std::memory_order_acquire) == (position + 1);
+	}
+
+	bool Pop(CommandType& command)
+	{
+		uint64 position = m_dequeuePosition.load(std::memory_order_relaxed);
+		auto& slot = m_slots[position & (m_capacity - 1)];
+		if(slot.sequence.load(std::memory_order_acquire) != (position + 1)) return false;
+
+		//Record is moved out before being released, commands can push while being executed
+		command = std::move(slot.command);
+		slot.sequence.store(position + m_capacity, std::memory_order_release);
+		m_dequeuePosition.store(position + 1, std::memory_order_relaxed);
+
+		if(!m_overflow.empty())
+		{
+			//Producers are held back while overflow is pending, the released record is ours
+			auto moveOverflow = [&](CommandType& ringCommand) { ringCommand = std::move(m_overflow.front()); };
+			while(!m_overflow.empty() && PushRecord(moveOverflow, false))
+			{
+				m_overflow.pop_front();
+			}
+			if(!m_overflow.empty()) return true;
+			m_overflowPending.store(false, std::memory_order_relaxed);
+		}
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(m_producerWaitCount.load(std::memory_order_relaxed) != 0)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_spaceCondition.notify_all();
+		}
+
+		return true;
+	}
+
+	void WaitForCommand()
+	{
+		if(IsPending()) return;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_consumerWaiting.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		m_commandCondition.wait(lock, [&]() { return IsPending(); });
+		m_consumerWaiting.store(false, std::memory_order_relaxed);
+	}
+
+	void WaitForCommand(unsigned int timeOut)
+	{
+		if(IsPending()) return;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_consumerWaiting.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		m_commandCondition.wait_for(lock, std::chrono::milliseconds(timeOut), [&]() { return IsPending(); });
+		m_consumerWaiting.store(false, std::memory_order_relaxed);
+	}
+
+	//Producer side, called after TryPush failed
+	void WaitForSpace()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_producerWaitCount.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		m_spaceCondition.wait(lock, [&]() { return HasSpace(); });
+		m_producerWaitCount.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	COMMANDRING_STATS GetStats() const
+	{
+		COMMANDRING_STATS stats;
+		stats.capacity = m_capacity;
+		stats.occupancy = GetOccupancy(m_enqueuePosition.load(std::memory_order_relaxed), m_dequeuePosition.load(std::memory_order_relaxed));
+		stats.peakOccupancy = m_peakOccupancy.load(std::memory_order_relaxed);
+		stats.pushCount = m_pushCount.load(std::memory_order_relaxed);
+		stats.producerStallCount = m_producerStallCount.load(std::memory_order_relaxed);
+		stats.overflowCount = m_overflowCount.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+private:
+	struct SLOT
+	{
+		std::atomic<uint64> sequence = 0;
+		CommandType command;
+	};
+
+	template <typename WriteFunction>
+	bool PushRecord(const WriteFunction& writeFunction, bool holdForOverflow)
+	{
+		uint64 position = m_enqueuePosition.load(std::memory_order_relaxed);
+		SLOT* slot = nullptr;
+		while(true)
+		{
+			slot = &m_slots[position & (m_capacity - 1)];
+			uint64 sequence = slot->sequence.load(std::memory_order_acquire);
+			int64 difference = static_cast<int64>(sequence - position);
+			if(difference == 0)
+			{
+				//Checked after seeing the record released, Pop sets the flag before releasing it
+				if(holdForOverflow && m_overflowPending.load(std::memory_order_relaxed))
+				{
+					m_producerStallCount.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+				if(m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+			}
+			else if(difference < 0)
+			{
+				m_producerStallCount.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			else
+			{
+				position = m_enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		writeFunction(slot->command);
+		slot->sequence.store(position + 1, std::memory_order_release);
+
+		m_pushCount.fetch_add(1, std::memory_order_relaxed);
+		uint32 occupancy = GetOccupancy(position + 1, m_dequeuePosition.load(std::memory_order_relaxed));
+		uint32 peakOccupancy = m_peakOccupancy.load(std::memory_order_relaxed);
+		while((occupancy > peakOccupancy) && !m_peakOccupancy.compare_exchange_weak(peakOccupancy, occupancy, std::memory_order_relaxed))
+		{
+		}
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(m_consumerWaiting.load(std::memory_order_relaxed))
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_commandCondition.notify_one();
+		}
+
+		return true;
+	}
+
+	//Positions are loaded separately, the consumer might have moved past what the producer saw
+	static uint32 GetOccupancy(uint64 enqueuePosition, uint64 dequeuePosition)
+	{
+		return (enqueuePosition > dequeuePosition) ? static_cast<uint32>(enqueuePosition - dequeuePosition) : 0;
+	}
+
+	bool HasSpace() const
+	{
+		uint64 position = m_enqueuePosition.load(std::memory_order_relaxed);
+		const auto& slot = m_slots[position & (m_capacity - 1)];
+		if(static_cast<int64>(slot.sequence.load(std::memory_order_acquire) - position) < 0) return false;
+		return !m_overflowPending.load(std::memory_order_relaxed);
+	}
+
+	const uint32 m_capacity;
+	std::unique_ptr<SLOT[]> m_slots;
+
+	//Keep both ends on their own cache line
+	alignas(64) std::atomic<uint64> m_enqueuePosition = 0;
+	alignas(64) std::atomic<uint64> m_dequeuePosition = 0;
+
+	alignas(64) std::atomic<bool> m_consumerWaiting = false;
+	std::atomic<uint32> m_producerWaitCount = 0;
+	std::mutex m_mutex;
+	std::condition_variable m_commandCondition;
+	std::condition_variable m_spaceCondition;
+
+	std::atomic<uint32> m_peakOccupancy = 0;
+	std::atomic<uint64> m_pushCount = 0;
+	std::atomic<uint64> m_producerStallCount = 0;
+
+	//Only touched by the consumer, producers only look at the flag
+	std::deque<CommandType> m_overflow;
+	std::atomic<bool> m_overflowPending = false;
+	std::atomic<uint64> m_overflowCount = 0;
+};
@@ -0,0 +1,133 @@
+#include <cassert>
+#include <algorithm>
+#include "FastMemory.h"
+#include "AlignedAlloc.h"
+#include "maybe_unused.h"
+
+#ifdef FASTMEMORY_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define GUEST_ADDRESS_SPACE_SIZE (0x100000000ULL)
+#define GUEST_PAGE_SIZE (0x1000)
+
+CFastMemory::CFastMemory()
+{
+	assert(IsSupported());
+	m_pageSize = framework_getpagesize();
+#ifdef FASTMEMORY_SUPPORTED
+	void* base = mmap(nullptr, GUEST_ADDRESS_SPACE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	assert(base != MAP_FAILED);
+	m_base = reinterpret_cast<uint8*>(base);
+#endif
+}
+
+CFastMemory::~CFastMemory()
+{
+#ifdef FASTMEMORY_SUPPORTED
+	munmap(m_base, GUEST_ADDRESS_SPACE_SIZE);
+	for(const auto& block : m_blocks)
+	{
+		munmap(block.memory, block.size);
+		close(block.fd);
+	}
+#endif
+}
+
+bool CFastMemory::IsSupported()
+{
+#ifdef FASTMEMORY_SUPPORTED
+	//Guest pages need to map on host pages
+	return (framework_getpagesize() == GUEST_PAGE_SIZE);
+#else
+	return false;
+#endif
+}
+
+uint8* CFastMemory::GetBase() const
+{
+	return m_base;
+}
+
+uint8* CFastMemory::Allocate(uint32 size)
+{
+	assert((size % m_pageSize) == 0);
+	BLOCK block;
+	block.size = size;
+#ifdef FASTMEMORY_SUPPORTED
+	block.fd = memfd_create("fastmem", MFD_CLOEXEC);
+	assert(block.fd >= 0);
+	FRAMEWORK_MAYBE_UNUSED int result = ftruncate(block.fd, size);
+	assert(result == 0);
+	void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, block.fd, 0);
+	assert(memory != MAP_FAILED);
+	block.memory = reinterpret_cast<uint8*>(memory);
+#endif
+	m_blocks.push_back(block);
+	return block.memory;
+}
+
+void CFastMemory::Map(uint32 address, uint8* memory, uint32 size)
+{
+	assert((address % m_pageSize) == 0);
+	assert((size % m_pageSize) == 0);
+	auto block = FindBlock(memory);
+	assert(block);
+	assert((memory + size) <= (block->memory + block->size));
+
+	MIRROR mirror;
+	mirror.address = address;
+	mirror.offset = static_cast<uint32>(memory - block->memory);
+	mirror.size = size;
+#ifdef FASTMEMORY_SUPPORTED
+	FRAMEWORK_MAYBE_UNUSED void* result = mmap(m_base + address, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, block->fd, mirror.offset);
+	assert(result == (m_base + address));
+#endif
+	block->mirrors.push_back(mirror);
+}
+
+void CFastMemory::SetProtected(uint8* memory, uint32 size, bool protect)
+{
+	auto block = FindBlock(memory);
+	if(!block) return;
+
+	uint32 offset = static_cast<uint32>(memory - block->memory);
+	uint32 beginOffset = offset & ~(m_pageSize - 1);
+	uint32 endOffset = (offset + size + (m_pageSize - 1)) & ~(m_pageSize - 1);
+
+	for(const auto& mirror : block->mirrors)
+	{
+		uint32 mirrorBegin = std::max(beginOffset, mirror.offset);
+		uint32 mirrorEnd = std::min(endOffset, mirror.offset + mirror.size);
+		if(mirrorBegin >= mirrorEnd) continue;
+#ifdef FASTMEMORY_SUPPORTED
+		uint8* mirrorMemory = m_base + mirror.address + (mirrorBegin - mirror.offset);
+		FRAMEWORK_MAYBE_UNUSED int result = mprotect(mirrorMemory, mirrorEnd - mirrorBegin, protect ? PROT_READ : PROT_READ | PROT_WRITE);
+		assert(result == 0);
+#endif
+	}
+}
+
+bool CFastMemory::GetGuestAddress(uintptr_t hostAddress, uint32& guestAddress) const
+{
+	uintptr_t base = reinterpret_cast<uintptr_t>(m_base);
+	if((hostAddress < base) || ((hostAddress - base) >= GUEST_ADDRESS_SPACE_SIZE))
+	{
+		return false;
+	}
+	guestAddress = static_cast<uint32>(hostAddress - base);
+	return true;
+}
+
+CFastMemory::BLOCK* CFastMemory::FindBlock(uint8* memory)
+{
+	for(auto& block : m_blocks)
+	{
+		if((memory >= block.memory) && (memory < (block.memory + block.size)))
+		{
+			return &block;
+		}
+	}
+	return nullptr;
+}
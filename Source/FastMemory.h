@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include "Types.h"
+
+#if defined(__linux__) && !defined(__ANDROID__) && defined(__x86_64__)
+#define FASTMEMORY_SUPPORTED
+#endif
+
+//Reserves a 4GB range of host address space in which guest memory blocks are mapped at
+//their guest addresses, mirrors included. Generated code can then access guest memory with a
+//single base + offset operation. Accesses to areas that are not mapped (ie.: IO registers)
+//fault and must be handled by the executor.
+class CFastMemory
+{
+public:
+	CFastMemory();
+	CFastMemory(const CFastMemory&) = delete;
+	~CFastMemory();
+
+	CFastMemory& operator=(const CFastMemory&) = delete;
+
+	static bool IsSupported();
+
+	uint8* GetBase() const;
+
+	//Allocates a block that can be mapped in the guest address space
+	uint8* Allocate(uint32);
+	void Map(uint32, uint8*, uint32);
+
+	//Changes protection of a block's range and of all its mirrors
+	void SetProtected(uint8*, uint32, bool);
+
+	bool GetGuestAddress(uintptr_t, uint32&) const;
+
+private:
+	struct MIRROR
+	{
+		uint32 address = 0;
+		uint32 offset = 0;
+		uint32 size = 0;
+	};
+
+	struct BLOCK
+	{
+		int fd = -1;
+		uint8* memory = nullptr;
+		uint32 size = 0;
+		std::vector<MIRROR> mirrors;
+	};
+
+	BLOCK* FindBlock(uint8*);
+
+	uint8* m_base = nullptr;
+	size_t m_pageSize = 0;
+	std::vector<BLOCK> m_blocks;
+};
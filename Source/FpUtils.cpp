@@ -1,3 +1,4 @@
+#include <fenv.h>
 #include "FpUtils.h"
 #include "MipsJitter.h"
 
@@ -43,6 +44,12 @@ void FpUtils::SetDenormalHandlingMode()
 #endif
 }
 
+void FpUtils::SetEmulationFpEnvironment()
+{
+	fesetround(FE_TOWARDZERO);
+	SetDenormalHandlingMode();
+}
+
 void FpUtils::EnableFpExceptions()
 {
 #ifdef _WIN32
@@ -7,6 +7,10 @@ class CMipsJitter;
 namespace FpUtils
 {
 	void SetDenormalHandlingMode();
+
+	//Rounding and denormal handling expected by emulated code, every thread running
+	//or emulating guest code (EE, IOP, VU1, SPU rendering, etc.) needs to call this
+	void SetEmulationFpEnvironment();
 	void EnableFpExceptions();
 
 	void IsZero(CMipsJitter*, size_t);
@@ -3,6 +3,8 @@
 #include <unordered_set>
 #include "MIPS.h"
 #include "BasicBlock.h"
+#include "BlockCompileWorker.h"
+#include "BlockPool.h"
 
 #include "BlockLookupOneWay.h"
 #include "BlockLookupTwoWay.h"
@@ -30,10 +32,12 @@ public:
 	enum
 	{
 		RECYCLE_NOLINK_THRESHOLD = 16,
+		//Each predicted return run from the handler nests in the native stack, go back to the loop after this many
+		MAX_PREDICTED_RETURN_DEPTH = 16,
 	};
 
 	CGenericMipsExecutor(CMIPS& context, uint32 maxAddress, BLOCK_CATEGORY blockCategory)
-	    : m_emptyBlock(std::make_shared<CBasicBlock>(context, MIPS_INVALID_PC, MIPS_INVALID_PC, blockCategory))
+	    : m_emptyBlock(MakeBlock<CBasicBlock>(context, MIPS_INVALID_PC, MIPS_INVALID_PC, blockCategory))
 	    , m_context(context)
 	    , m_maxAddress(maxAddress)
 	    , m_addressMask(maxAddress - 1)
@@ -43,6 +47,27 @@ public:
 		m_emptyBlock->Compile();
 		ResetBlockOutLinks(m_emptyBlock.get());
 
+		//VU blocks don't end with their branch and don't use the indirect branch cache
+		if(instructionSize == 4)
+		{
+			m_indirectBranchCache.resize(MIPS_INDIRECT_BRANCH_CACHE_SIZE);
+			ResetIndirectBranchCache();
+			context.m_indirectBranchCache = m_indirectBranchCache.data();
+
+			assert(!context.m_predictedReturnHandler);
+			context.m_predictedReturnHandler =
+			    [&](CMIPS* context) {
+				    if(m_predictedReturnDepth == MAX_PREDICTED_RETURN_DEPTH) return;
+				    auto block = m_blockLookup.FindBlockAt(m_context.m_State.nPC & m_addressMask);
+				    if(block->IsEmpty()) return;
+				    //Anything the loop would have handled after the block (ie.: indirect branch
+				    //misses) makes it return all the way out to the loop
+				    m_predictedReturnDepth++;
+				    block->Execute();
+				    m_predictedReturnDepth--;
+			    };
+		}
+
 		assert(!context.m_emptyBlockHandler);
 		context.m_emptyBlockHandler =
 		    [&](CMIPS* context) {
@@ -68,6 +93,14 @@ public:
 			uint32 address = m_context.m_State.nPC & m_addressMask;
 			auto block = m_blockLookup.FindBlockAt(address);
 			block->Execute();
+			if(m_context.m_indirectBranchSite != MIPS_INVALID_PC)
+			{
+				UpdateIndirectBranchLink();
+			}
+			if(m_context.m_profiledBlockSite != MIPS_INVALID_PC)
+			{
+				HandleProfiledBlock();
+			}
 		}
 		m_context.m_State.nHasException &= ~MIPS_EXCEPTION_STATUS_QUOTADONE;
 #ifdef DEBUGGER_INCLUDED
@@ -88,9 +121,12 @@ public:
 
 	void Reset() override
 	{
+		m_compileWorker.Clear();
 		m_blockLookup.Clear();
 		m_blocks.clear();
 		m_blockOutLinks.clear();
+		m_context.m_profiledBlockSite = MIPS_INVALID_PC;
+		ResetIndirectBranchCache();
 #ifdef DEBUGGER_INCLUDED
 		m_mustBreak = false;
 #endif
@@ -107,6 +143,47 @@ public:
 		ClearActiveBlocksInRangeInternal(start, end, currentBlock);
 	}
 
+	CBlockCompileWorker::STATS GetCompileWorkerStats() const
+	{
+		return m_compileWorker.GetStats();
+	}
+
+	//When enabled, new blocks ending with a branch count how often they take it. Once they have enough
+	//samples, blocks that almost always fall through are merged with their successor and blocks that
+	//almost always branch back are merged with the rest of their loop.
+	void SetSuperblocksEnabled(bool superblocksEnabled)
+	{
+		m_superblocksEnabled = superblocksEnabled;
+	}
+
+	uint32 GetSuperblockCount() const
+	{
+		return m_superblockCount;
+	}
+
+	//Hints given to blocks created by the default block factories
+	void AddBlockCompileHints(uint32 blockCompileHints)
+	{
+		m_blockCompileHints |= blockCompileHints;
+	}
+
+	//Hits are indirect branches that went straight to the next block, misses went through the executor
+	uint32 GetIndirectBranchHitCount() const
+	{
+		return m_context.m_indirectBranchHitCount;
+	}
+
+	uint32 GetIndirectBranchMissCount() const
+	{
+		return m_indirectBranchMissCount;
+	}
+
+	//Returns that missed their branch link but went where the return stack predicted
+	uint32 GetReturnPredictionHitCount() const
+	{
+		return m_context.m_returnPredictionHitCount;
+	}
+
 #ifdef DEBUGGER_INCLUDED
 	bool MustBreak() const override
 	{
@@ -137,6 +214,10 @@ protected:
 	{
 		assert(!HasBlockAt(start));
 		auto block = BlockFactory(m_context, start, end);
+		//Drop any background compile request for this block if the factory didn't use it
+		m_compileWorker.Cancel(start);
+		//A previous block at this address might have left an entry that doesn't match our link
+		InvalidateIndirectBranchCacheEntry(start);
 		ResetBlockOutLinks(block.get());
 		m_blockLookup.AddBlock(block.get());
 		m_blocks.insert(std::move(block));
@@ -152,11 +233,74 @@ protected:
 
 	virtual BasicBlockPtr BlockFactory(CMIPS& context, uint32 start, uint32 end)
 	{
-		auto result = std::make_shared<CBasicBlock>(context, start, end, m_blockCategory);
+		auto codeGenState = context.GetCodeGenState(start, end);
+		if(!codeGenState.hasBreakpoint)
+		{
+			if(auto result = m_compileWorker.Take(start, end, codeGenState))
+			{
+				return result;
+			}
+		}
+		auto result = MakeBlock<CBasicBlock>(context, start, end, m_blockCategory);
+		result->AddBlockCompileHints(m_blockCompileHints);
+		if(ShouldProfileBlock(start, end))
+		{
+			result->EnableProfiling();
+		}
 		result->Compile();
 		return result;
 	}
 
+	//Creates a block that will be compiled on the background compile thread.
+	//Returning nullptr prevents the block from being compiled ahead of time.
+	virtual BasicBlockPtr PrefetchBlockFactory(CMIPS& context, uint32 start, uint32 end)
+	{
+		auto result = MakeBlock<CBasicBlock>(context, start, end, m_blockCategory);
+		result->AddBlockCompileHints(m_blockCompileHints);
+		if(ShouldProfileBlock(start, end))
+		{
+			result->EnableProfiling();
+		}
+		return result;
+	}
+
+	//Only blocks ending with a branch that has a known target can become part of a superblock.
+	//Blocks branching to themselves already loop without going through the executor.
+	bool ShouldProfileBlock(uint32 start, uint32 end) const
+	{
+#if defined(AOT_BUILD_CACHE) || defined(AOT_USE_CACHE)
+		return false;
+#else
+		if(!m_superblocksEnabled) return false;
+		if(start == end) return false;
+		uint32 branchAddress = end - 4;
+		uint32 opcode = m_context.m_pMemoryMap->GetInstruction(branchAddress);
+		if(m_context.m_pArch->IsInstructionBranch(&m_context, branchAddress, opcode) != MIPS_BRANCH_NORMAL) return false;
+		uint32 target = m_context.m_pArch->GetInstructionEffectiveAddress(&m_context, branchAddress, opcode);
+		return (target != MIPS_INVALID_PC) && (target != start);
+#endif
+	}
+
+	void PrefetchBlock(uint32 address)
+	{
+#if !defined(AOT_BUILD_CACHE) && !defined(AOT_USE_CACHE)
+		address &= m_addressMask;
+		if(HasBlockAt(address)) return;
+		if(m_compileWorker.IsTracking(address)) return;
+		//Only look at plain memory, we don't want to trigger handlers or compile garbage
+		auto instructionMap = m_context.m_pMemoryMap->GetInstructionMap(address);
+		if(!instructionMap || (instructionMap->nType != CMemoryMap::MEMORYMAP_TYPE_MEMORY)) return;
+		uint32 endAddress = MIPS_INVALID_PC;
+		uint32 branchAddress = MIPS_INVALID_PC;
+		ComputeBlockRange(address, endAddress, branchAddress);
+		if(endAddress > instructionMap->nEnd) return;
+		if(auto block = PrefetchBlockFactory(m_context, address, endAddress))
+		{
+			m_compileWorker.Enqueue(std::move(block));
+		}
+#endif
+	}
+
 	void SetupBlockLinks(uint32 startAddress, uint32 endAddress, uint32 branchAddress)
 	{
 		auto block = m_blockLookup.FindBlockAt(startAddress);
@@ -210,7 +354,7 @@ protected:
 		}
 	}
 
-	virtual void PartitionFunction(uint32 startAddress)
+	void ComputeBlockRange(uint32 startAddress, uint32& outEndAddress, uint32& outBranchAddress) const
 	{
 		uint32 endAddress = startAddress + MAX_BLOCK_SIZE;
 		uint32 branchAddress = MIPS_INVALID_PC;
@@ -243,12 +387,185 @@ protected:
 		}
 		assert((endAddress - startAddress) <= MAX_BLOCK_SIZE);
 		assert(endAddress <= m_maxAddress);
+		outEndAddress = endAddress;
+		outBranchAddress = branchAddress;
+	}
+
+	virtual void PartitionFunction(uint32 startAddress)
+	{
+		uint32 endAddress = MIPS_INVALID_PC;
+		uint32 branchAddress = MIPS_INVALID_PC;
+		ComputeBlockRange(startAddress, endAddress, branchAddress);
 		CreateBlock(startAddress, endAddress);
 		auto block = FindBlockStartingAt(startAddress);
 		if(block->GetRecycleCount() < RECYCLE_NOLINK_THRESHOLD)
 		{
 			SetupBlockLinks(startAddress, endAddress, branchAddress);
 		}
+		//Get the blocks we're likely to run next ready while this one executes
+		PrefetchBlock(endAddress + 4);
+		if(branchAddress != MIPS_INVALID_PC)
+		{
+			PrefetchBlock(branchAddress);
+		}
+	}
+
+	void ResetIndirectBranchCache()
+	{
+		for(auto& entry : m_indirectBranchCache)
+		{
+			entry.site = MIPS_INVALID_PC;
+			entry.target = MIPS_INVALID_PC;
+		}
+		m_context.m_indirectBranchSite = MIPS_INVALID_PC;
+		std::fill(std::begin(m_context.m_returnStack), std::end(m_context.m_returnStack), MIPS_INVALID_PC);
+		m_context.m_returnStackTop = 0;
+	}
+
+	MIPS_INDIRECT_BRANCH_CACHE_ENTRY* GetIndirectBranchCacheEntry(uint32 site)
+	{
+		assert(!m_indirectBranchCache.empty());
+		return &m_indirectBranchCache[(site / 4) & (MIPS_INDIRECT_BRANCH_CACHE_SIZE - 1)];
+	}
+
+	void InvalidateIndirectBranchCacheEntry(uint32 address)
+	{
+		if(m_indirectBranchCache.empty()) return;
+		auto entry = GetIndirectBranchCacheEntry(address);
+		if((entry->site & m_addressMask) == address)
+		{
+			entry->site = MIPS_INVALID_PC;
+			entry->target = MIPS_INVALID_PC;
+		}
+	}
+
+	//Called when a block ending with an indirect branch couldn't go to its target through its
+	//branch link. Links the block to that target, it will be used as long as the target stays the same.
+	void UpdateIndirectBranchLink()
+	{
+		uint32 site = m_context.m_indirectBranchSite;
+		uint32 target = m_context.m_State.nPC;
+		m_context.m_indirectBranchSite = MIPS_INVALID_PC;
+		m_indirectBranchMissCount++;
+
+		auto block = m_blockLookup.FindBlockAt(site & m_addressMask);
+		if(block->IsEmpty() || !block->HasIndirectBranchLink()) return;
+		if(block->GetRecycleCount() >= RECYCLE_NOLINK_THRESHOLD) return;
+		assert(block->HasLinkSlot(LINK_SLOT_BRANCH));
+
+		const auto linkSlot = LINK_SLOT_BRANCH;
+		{
+			auto link = block->GetOutLink(linkSlot);
+			if(link != std::end(m_blockOutLinks))
+			{
+				if(link->second.live)
+				{
+					block->UnlinkBlock(linkSlot);
+				}
+				m_blockOutLinks.erase(link);
+			}
+		}
+
+		uint32 targetAddress = target & m_addressMask;
+		auto link = m_blockOutLinks.insert(std::make_pair(targetAddress, BLOCK_OUT_LINK{linkSlot, block->GetBeginAddress(), false}));
+		block->SetOutLink(linkSlot, link);
+
+		//If the target block doesn't exist yet, link will be resolved when it's created
+		auto targetBlock = m_blockLookup.FindBlockAt(targetAddress);
+		if(!targetBlock->IsEmpty())
+		{
+			block->LinkBlock(linkSlot, targetBlock);
+			link->second.live = true;
+		}
+
+		auto entry = GetIndirectBranchCacheEntry(site);
+		entry->site = site;
+		entry->target = target;
+	}
+
+	uint32 GetBranchTarget(uint32 address) const
+	{
+		uint32 opcode = m_context.m_pMemoryMap->GetInstruction(address);
+		return m_context.m_pArch->GetInstructionEffectiveAddress(&m_context, address, opcode);
+	}
+
+	MIPS_BRANCH_TYPE GetBranchType(uint32 address) const
+	{
+		uint32 opcode = m_context.m_pMemoryMap->GetInstruction(address);
+		return m_context.m_pArch->IsInstructionBranch(&m_context, address, opcode);
+	}
+
+	//Called when a profiled block has run enough times to know where its branch usually goes
+	void HandleProfiledBlock()
+	{
+		uint32 site = m_context.m_profiledBlockSite;
+		m_context.m_profiledBlockSite = MIPS_INVALID_PC;
+
+		//Block might have been replaced since it reported
+		auto block = m_blockLookup.FindBlockAt(site & m_addressMask);
+		if(block->IsEmpty() || !block->IsProfiling()) return;
+		if(block->GetRecycleCount() >= RECYCLE_NOLINK_THRESHOLD) return;
+
+		const auto& profile = block->GetProfile();
+		uint32 beginAddress = block->GetBeginAddress();
+		uint32 endAddress = block->GetEndAddress();
+		if((profile.takenCount * 8) <= profile.executionCount)
+		{
+			//Mostly falls through, append the block that follows
+			uint32 nextBeginAddress = endAddress + 4;
+			if(nextBeginAddress >= m_maxAddress) return;
+			uint32 nextEndAddress = MIPS_INVALID_PC;
+			uint32 nextBranchAddress = MIPS_INVALID_PC;
+			ComputeBlockRange(nextBeginAddress, nextEndAddress, nextBranchAddress);
+			TryCreateSuperblock(beginAddress, nextEndAddress);
+		}
+		else if((profile.takenCount * 8) >= (profile.executionCount * 7))
+		{
+			//Mostly branches back, merge the whole loop body so that it loops on itself
+			uint32 branchTarget = GetBranchTarget(endAddress - 4) & m_addressMask;
+			if(branchTarget < beginAddress)
+			{
+				TryCreateSuperblock(branchTarget, endAddress);
+			}
+		}
+	}
+
+	//Replaces the blocks covering [beginAddress, endAddress] by a single one.
+	//Branches before the end of the range become side exits of the new block.
+	bool TryCreateSuperblock(uint32 beginAddress, uint32 endAddress)
+	{
+		if((endAddress - beginAddress) >= MAX_BLOCK_SIZE) return false;
+		auto instructionMap = m_context.m_pMemoryMap->GetInstructionMap(beginAddress);
+		if(!instructionMap || (instructionMap->nType != CMemoryMap::MEMORYMAP_TYPE_MEMORY)) return false;
+		if(endAddress > instructionMap->nEnd) return false;
+
+		//Every branch needs its delay slot inside the range, only the last instruction can end the block otherwise
+		for(uint32 address = beginAddress; address < endAddress; address += 4)
+		{
+			auto branchType = GetBranchType(address);
+			if(branchType == MIPS_BRANCH_NODELAY) return false;
+			if((branchType == MIPS_BRANCH_NORMAL) && (GetBranchType(address + 4) != MIPS_BRANCH_NONE)) return false;
+		}
+		if(!IsSuperblockCandidate(beginAddress, endAddress)) return false;
+
+		ClearActiveBlocksInRangeInternal(beginAddress, endAddress, nullptr);
+		if(HasBlockAt(beginAddress)) return false;
+
+		uint32 branchAddress = MIPS_INVALID_PC;
+		if((beginAddress != endAddress) && (GetBranchType(endAddress - 4) == MIPS_BRANCH_NORMAL))
+		{
+			branchAddress = GetBranchTarget(endAddress - 4);
+		}
+		CreateBlock(beginAddress, endAddress);
+		SetupBlockLinks(beginAddress, endAddress, branchAddress);
+		m_superblockCount++;
+		return true;
+	}
+
+	//Allows executors to prevent blocks with special compilation requirements from being merged
+	virtual bool IsSuperblockCandidate(uint32 beginAddress, uint32 endAddress)
+	{
+		return !m_context.HasBreakpointInRange(beginAddress, endAddress);
 	}
 
 	//Unlink and removes block from all of our bookkeeping structures
@@ -326,6 +643,15 @@ protected:
 	BLOCK_CATEGORY m_blockCategory = BLOCK_CATEGORY_UNKNOWN;
 
 	BlockLookupType m_blockLookup;
+	CBlockCompileWorker m_compileWorker;
+
+	bool m_superblocksEnabled = false;
+	uint32 m_superblockCount = 0;
+	uint32 m_blockCompileHints = 0;
+
+	std::vector<MIPS_INDIRECT_BRANCH_CACHE_ENTRY> m_indirectBranchCache;
+	uint32 m_indirectBranchMissCount = 0;
+	uint32 m_predictedReturnDepth = 0;
 
 #ifdef DEBUGGER_INCLUDED
 	bool m_mustBreak = false;
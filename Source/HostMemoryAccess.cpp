@@ -0,0 +1,130 @@
+#include <cstring>
+#include "HostMemoryAccess.h"
+
+uint64 HostMemoryAccess_SignExtend(uint64 value, uint32 size)
+{
+	uint32 shift = 64 - (size * 8);
+	return static_cast<uint64>(static_cast<int64>(value << shift) >> shift);
+}
+
+bool HostMemoryAccess_Decode(const uint8* code, HOST_MEMORY_ACCESS& access)
+{
+	const uint8* ptr = code;
+	bool hasOperandSizePrefix = false;
+	while(true)
+	{
+		uint8 prefix = *ptr;
+		if(prefix == 0x66)
+		{
+			hasOperandSizePrefix = true;
+		}
+		else if((prefix != 0x67) && (prefix != 0x2E) && (prefix != 0x3E) && (prefix != 0x26) && (prefix != 0x36))
+		{
+			break;
+		}
+		ptr++;
+	}
+
+	uint8 rex = 0;
+	if((*ptr & 0xF0) == 0x40)
+	{
+		rex = *ptr++;
+	}
+	bool rexW = (rex & 0x08) != 0;
+	uint32 operandSize = rexW ? 8 : (hasOperandSizePrefix ? 2 : 4);
+	uint32 immediateSize = 0;
+
+	uint8 opcode = *ptr++;
+	switch(opcode)
+	{
+	case 0x88:
+		access.isStore = true;
+		access.size = 1;
+		break;
+	case 0x89:
+		access.isStore = true;
+		access.size = operandSize;
+		break;
+	case 0x8A:
+		access.size = 1;
+		access.registerSize = 1;
+		break;
+	case 0x8B:
+		access.size = operandSize;
+		access.registerSize = operandSize;
+		break;
+	case 0x63:
+		if(!rexW) return false;
+		access.size = 4;
+		access.registerSize = 8;
+		access.extend = HOST_MEMORY_ACCESS::EXTEND_SIGN;
+		break;
+	case 0xC6:
+		access.isStore = true;
+		access.size = 1;
+		immediateSize = 1;
+		break;
+	case 0xC7:
+		access.isStore = true;
+		access.size = operandSize;
+		immediateSize = (operandSize == 2) ? 2 : 4;
+		break;
+	case 0x0F:
+		opcode = *ptr++;
+		switch(opcode)
+		{
+		case 0xB6:
+		case 0xB7:
+		case 0xBE:
+		case 0xBF:
+			access.size = (opcode & 1) ? 2 : 1;
+			access.registerSize = operandSize;
+			access.extend = (opcode & 8) ? HOST_MEMORY_ACCESS::EXTEND_SIGN : HOST_MEMORY_ACCESS::EXTEND_ZERO;
+			break;
+		default:
+			return false;
+		}
+		break;
+	default:
+		return false;
+	}
+
+	uint8 modRm = *ptr++;
+	uint8 mod = (modRm >> 6) & 3;
+	uint8 rm = modRm & 7;
+	if(mod == 3) return false;
+	if(rm == 4)
+	{
+		uint8 sib = *ptr++;
+		if((mod == 0) && ((sib & 7) == 5)) ptr += 4;
+	}
+	else if((mod == 0) && (rm == 5))
+	{
+		ptr += 4;
+	}
+	if(mod == 1) ptr += 1;
+	if(mod == 2) ptr += 4;
+
+	if(immediateSize != 0)
+	{
+		if(((modRm >> 3) & 7) != 0) return false;
+		uint64 immediate = 0;
+		memcpy(&immediate, ptr, immediateSize);
+		access.immediate = HostMemoryAccess_SignExtend(immediate, immediateSize);
+		ptr += immediateSize;
+	}
+	else
+	{
+		access.reg = ((modRm >> 3) & 7) | ((rex & 0x04) ? 8 : 0);
+		bool isByteRegister = access.isStore ? (access.size == 1) : (access.registerSize == 1);
+		if(isByteRegister && (rex == 0) && (access.reg >= 4))
+		{
+			//AH, CH, DH or BH
+			access.reg -= 4;
+			access.isHighByteReg = true;
+		}
+	}
+
+	access.length = static_cast<uint32>(ptr - code);
+	return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Types.h"
+
+//Memory access instruction emitted by the code generator that hit something else than memory
+struct HOST_MEMORY_ACCESS
+{
+	enum EXTEND
+	{
+		EXTEND_ZERO,
+		EXTEND_SIGN,
+	};
+
+	bool isStore = false;
+	uint32 size = 0;
+	uint32 registerSize = 0;
+	EXTEND extend = EXTEND_ZERO;
+	int reg = -1;
+	bool isHighByteReg = false;
+	uint64 immediate = 0;
+	uint32 length = 0;
+};
+
+//Decodes an x86-64 instruction. Only handles the moves used for loads and stores (mov, movzx,
+//movsx, movsxd) with a memory operand, returns false for anything else.
+bool HostMemoryAccess_Decode(const uint8*, HOST_MEMORY_ACCESS&);
+
+uint64 HostMemoryAccess_SignExtend(uint64, uint32);
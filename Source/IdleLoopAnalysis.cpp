@@ -0,0 +1,267 @@
+#include "IdleLoopAnalysis.h"
+#include "MIPS.h"
+
+enum OP
+{
+	OP_SPECIAL = 0x00,
+	OP_REGIMM = 0x01,
+	OP_BEQ = 0x04,
+	OP_BNE = 0x05,
+	OP_BLEZ = 0x06,
+	OP_BGTZ = 0x07,
+	OP_ADDIU = 0x09,
+	OP_SLTI = 0x0A,
+	OP_SLTIU = 0x0B,
+	OP_ANDI = 0x0C,
+	OP_ORI = 0x0D,
+	OP_XORI = 0x0E,
+	OP_LUI = 0x0F,
+	OP_COP0 = 0x10,
+	OP_BEQL = 0x14,
+	OP_BNEL = 0x15,
+	OP_BLEZL = 0x16,
+	OP_BGTZL = 0x17,
+	OP_LQ = 0x1E,
+	OP_LB = 0x20,
+	OP_LH = 0x21,
+	OP_LW = 0x23,
+	OP_LBU = 0x24,
+	OP_LHU = 0x25,
+	OP_LWU = 0x27,
+	OP_LD = 0x37,
+};
+
+enum SPECIAL
+{
+	SPECIAL_SLL = 0x00,
+	SPECIAL_SRL = 0x02,
+	SPECIAL_SRA = 0x03,
+	SPECIAL_SYNC = 0x0F,
+	SPECIAL_ADDU = 0x21,
+	SPECIAL_SUBU = 0x23,
+	SPECIAL_AND = 0x24,
+	SPECIAL_OR = 0x25,
+	SPECIAL_XOR = 0x26,
+	SPECIAL_NOR = 0x27,
+	SPECIAL_SLT = 0x2A,
+	SPECIAL_SLTU = 0x2B,
+	SPECIAL_DSLL32 = 0x3C,
+	SPECIAL_DSRL32 = 0x3E,
+};
+
+enum REGIMM
+{
+	REGIMM_BLTZ = 0x00,
+	REGIMM_BGEZ = 0x01,
+	REGIMM_BLTZL = 0x02,
+	REGIMM_BGEZL = 0x03,
+};
+
+enum
+{
+	COP0_MF = 0x00,
+};
+
+//Returns registers compared by a conditional branch, 0 if this isn't a branch we know
+static uint32 GetBranchUse(uint32 inst)
+{
+	uint32 op = (inst >> 26) & 0x3F;
+	uint32 rt = (inst >> 16) & 0x1F;
+	uint32 rs = (inst >> 21) & 0x1F;
+
+	switch(op)
+	{
+	case OP_BEQ:
+	case OP_BNE:
+	case OP_BEQL:
+	case OP_BNEL:
+		return (1 << rs) | (1 << rt);
+	case OP_BLEZ:
+	case OP_BGTZ:
+	case OP_BLEZL:
+	case OP_BGTZL:
+		return (1 << rs);
+	case OP_REGIMM:
+		switch(rt)
+		{
+		case REGIMM_BLTZ:
+		case REGIMM_BGEZ:
+		case REGIMM_BLTZL:
+		case REGIMM_BGEZL:
+			return (1 << rs);
+		}
+		break;
+	}
+	return 0;
+}
+
+enum
+{
+	COP0_REG_COUNT = 0x09,
+};
+
+//How an instruction uses and defines registers
+enum INSTRUCTION_CLASS : uint8
+{
+	CLASS_UNKNOWN = 0, //Could have a side effect
+	CLASS_NONE,        //Doesn't use or define registers
+	CLASS_RT,          //rt = immediate
+	CLASS_RT_RS,       //rt = f(rs, immediate), includes loads
+	CLASS_RD_RT,       //rd = f(rt, immediate)
+	CLASS_RD_RS_RT,    //rd = f(rs, rt)
+	CLASS_COP0,        //COP0 instructions
+};
+
+struct OPCODE_TABLE
+{
+	uint8 general[0x40] = {};
+	uint8 special[0x40] = {};
+	uint32 volatileCop0Registers = 0; //COP0 registers that change by themselves
+};
+
+//Instructions available on both the IOP (R3000) and the EE (R5900)
+static OPCODE_TABLE MakeIopOpcodeTable()
+{
+	OPCODE_TABLE table;
+
+	table.general[OP_LUI] = CLASS_RT;
+	for(uint32 op : {OP_ADDIU, OP_SLTI, OP_SLTIU, OP_ANDI, OP_ORI, OP_XORI, OP_LB, OP_LH, OP_LW, OP_LBU, OP_LHU})
+	{
+		table.general[op] = CLASS_RT_RS;
+	}
+	table.general[OP_COP0] = CLASS_COP0;
+
+	table.special[SPECIAL_SYNC] = CLASS_NONE;
+	for(uint32 special : {SPECIAL_SLL, SPECIAL_SRL, SPECIAL_SRA})
+	{
+		table.special[special] = CLASS_RD_RT;
+	}
+	for(uint32 special : {SPECIAL_ADDU, SPECIAL_SUBU, SPECIAL_AND, SPECIAL_OR, SPECIAL_XOR, SPECIAL_NOR, SPECIAL_SLT, SPECIAL_SLTU})
+	{
+		table.special[special] = CLASS_RD_RS_RT;
+	}
+
+	return table;
+}
+
+static OPCODE_TABLE MakeEeOpcodeTable()
+{
+	OPCODE_TABLE table = MakeIopOpcodeTable();
+
+	for(uint32 op : {OP_LQ, OP_LWU, OP_LD})
+	{
+		table.general[op] = CLASS_RT_RS;
+	}
+	for(uint32 special : {SPECIAL_DSLL32, SPECIAL_DSRL32})
+	{
+		table.special[special] = CLASS_RD_RT;
+	}
+	table.volatileCop0Registers = (1 << COP0_REG_COUNT);
+
+	return table;
+}
+
+static const OPCODE_TABLE& GetOpcodeTable(IdleLoopAnalysis::ARCHITECTURE architecture)
+{
+	static const OPCODE_TABLE g_iopOpcodeTable = MakeIopOpcodeTable();
+	static const OPCODE_TABLE g_eeOpcodeTable = MakeEeOpcodeTable();
+	return (architecture == IdleLoopAnalysis::ARCHITECTURE_EE) ? g_eeOpcodeTable : g_iopOpcodeTable;
+}
+
+//Finds registers used and defined by an instruction, returns false if it could have a side effect
+static bool GetInstructionUseDef(const OPCODE_TABLE& table, uint32 inst, uint32& use, uint32& def)
+{
+	uint32 special = inst & 0x3F;
+	uint32 rd = (inst >> 11) & 0x1F;
+	uint32 rt = (inst >> 16) & 0x1F;
+	uint32 rs = (inst >> 21) & 0x1F;
+	uint32 op = (inst >> 26) & 0x3F;
+
+	use = 0;
+	def = 0;
+
+	auto instClass = (op == OP_SPECIAL) ? table.special[special] : table.general[op];
+	switch(instClass)
+	{
+	case CLASS_NONE:
+		return true;
+	case CLASS_RT:
+		def = (1 << rt);
+		return true;
+	case CLASS_RT_RS:
+		use = (1 << rs);
+		def = (1 << rt);
+		return true;
+	case CLASS_RD_RT:
+		use = (1 << rt);
+		def = (1 << rd);
+		return true;
+	case CLASS_RD_RS_RT:
+		use = (1 << rs) | (1 << rt);
+		def = (1 << rd);
+		return true;
+	case CLASS_COP0:
+		//Only reads from COP0 registers that don't change on their own (ie.: Count does)
+		if(rs != COP0_MF) return false;
+		if(table.volatileCop0Registers & (1 << rd)) return false;
+		def = (1 << rt);
+		return true;
+	}
+
+	//We don't know what this does, let's not take a chance
+	return false;
+}
+
+bool IdleLoopAnalysis::IsIdleLoop(CMIPS& context, ARCHITECTURE architecture, uint32 begin, uint32 end)
+{
+	if(begin == end) return false;
+
+	const auto& opcodeTable = GetOpcodeTable(architecture);
+
+	//We need a branch at the end of the block
+	uint32 branchAddress = end - 4;
+	uint32 branchInst = context.m_pMemoryMap->GetInstruction(branchAddress);
+	if(context.m_pArch->IsInstructionBranch(&context, branchAddress, branchInst) != MIPS_BRANCH_NORMAL) return false;
+
+	//Check that the branch target is ourself
+	uint32 branchTarget = context.m_pArch->GetInstructionEffectiveAddress(&context, branchAddress, branchInst);
+	if(branchTarget != begin) return false;
+
+	uint32 branchUse = GetBranchUse(branchInst);
+	if(branchUse == 0) return false;
+
+	uint32 defState = 0; //Set of completely new definitions of registers within this block
+	uint32 useState = 0; //Set of previous state usage within this block
+
+	//Check all instructions inside to see if we can prove it's waiting for some kind of flag
+	for(uint32 address = begin; address <= end; address += 4)
+	{
+		//Don't check branch instruction as we've checked it already
+		if(address == branchAddress) continue;
+
+		uint32 inst = context.m_pMemoryMap->GetInstruction(address);
+		if(inst == 0) continue;
+
+		uint32 newUse = 0;
+		uint32 newDef = 0;
+		if(!GetInstructionUseDef(opcodeTable, inst, newUse, newDef)) return false;
+
+		//R0 never changes
+		newUse &= ~1;
+		newDef &= ~1;
+
+		//Remove uses from defs within this block
+		newUse &= ~defState;
+		useState |= newUse;
+
+		//Bail if this defines any state that we previously used, next iteration would be different
+		if(useState & newDef) return false;
+
+		defState |= newDef;
+	}
+
+	//Branch must depend on something loaded in the loop, unless it always branches (waiting for an interrupt)
+	branchUse &= ~1;
+	if(branchUse == 0) return true;
+	return (defState & branchUse) != 0;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Types.h"
+
+class CMIPS;
+
+namespace IdleLoopAnalysis
+{
+	//Selects the instructions the analysis knows about
+	enum ARCHITECTURE
+	{
+		ARCHITECTURE_IOP,
+		ARCHITECTURE_EE,
+	};
+
+	//Checks if a block only branches back to itself while polling memory or a COP0 register.
+	//Such a block can't change anything by running again, so the CPU can skip ahead to the
+	//next event. Block needs to end with its branch's delay slot.
+	bool IsIdleLoop(CMIPS&, ARCHITECTURE, uint32, uint32);
+}
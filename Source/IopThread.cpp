@@ -0,0 +1,144 @@
+#include <cassert>
+#include "IopThread.h"
+#include "FpUtils.h"
+#include "ThreadUtils.h"
+
+CIopThread::CIopThread(const StepHandler& stepHandler, const ThreadInitHandler& threadInitHandler, bool threaded)
+    : m_stepHandler(stepHandler)
+    , m_threadInitHandler(threadInitHandler)
+    , m_threaded(threaded)
+{
+}
+
+CIopThread::~CIopThread()
+{
+	if(m_stepPending.load(std::memory_order_acquire))
+	{
+		WaitForStep(true);
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_threadDone = true;
+	}
+	m_stepCondition.notify_all();
+	if(m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+bool CIopThread::IsThreaded() const
+{
+	return m_threaded;
+}
+
+void CIopThread::BeginStep()
+{
+	if(!m_threaded) return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		assert(!m_stepPending);
+		m_stepPending.store(true, std::memory_order_release);
+		m_stepRequested = true;
+
+		if(!m_thread.joinable())
+		{
+			m_thread = std::thread([this]() { ThreadProc(); });
+			m_threadId = m_thread.get_id();
+			Framework::ThreadUtils::SetThreadName(m_thread, "IOP Thread");
+		}
+	}
+	m_stepCondition.notify_one();
+}
+
+void CIopThread::EndStep()
+{
+	if(m_threaded)
+	{
+		//IOP might be waiting on the EE, its calls can run here
+		WaitForStep(true);
+	}
+	else
+	{
+		m_stepHandler();
+	}
+}
+
+void CIopThread::RunOnEe(const FunctionType& function)
+{
+	if(std::this_thread::get_id() != m_threadId)
+	{
+		//Already on the EE side
+		function();
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	assert(m_eeCall.load(std::memory_order_relaxed) == nullptr);
+	m_eeCall.store(&function, std::memory_order_release);
+	m_eeCondition.notify_one();
+	m_eeCallDoneCondition.wait(lock, [&]() { return m_eeCall.load(std::memory_order_relaxed) == nullptr; });
+}
+
+void CIopThread::WaitForStep(bool processEeCalls)
+{
+	//IOP code can end up in a sync point (ie.: through a SIF call), it doesn't need to wait for itself
+	if(std::this_thread::get_id() == m_threadId) return;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while(true)
+	{
+		m_eeCondition.wait(lock, [&]() { return !m_stepPending.load(std::memory_order_relaxed) || (m_eeCall.load(std::memory_order_relaxed) != nullptr); });
+		if(m_eeCall.load(std::memory_order_relaxed) == nullptr) break;
+
+		//IOP is stopped until its call is done, so it's safe to touch its state. The call itself
+		//has to wait if we're in the middle of executing EE code.
+		if(!processEeCalls) break;
+		RunEeCall(lock);
+	}
+}
+
+void CIopThread::RunEeCall(std::unique_lock<std::mutex>& lock)
+{
+	auto eeCall = m_eeCall.load(std::memory_order_relaxed);
+	if(eeCall == nullptr) return;
+
+	//IOP is waiting on us, it won't touch anything until we're done
+	lock.unlock();
+	(*eeCall)();
+	lock.lock();
+	m_eeCall.store(nullptr, std::memory_order_relaxed);
+	m_eeCallDoneCondition.notify_one();
+}
+
+void CIopThread::ThreadProc()
+{
+	FpUtils::SetEmulationFpEnvironment();
+
+	if(m_threadInitHandler)
+	{
+		m_threadInitHandler();
+	}
+
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_stepCondition.wait(lock, [&]() { return m_threadDone || m_stepRequested; });
+			if(m_threadDone)
+			{
+				break;
+			}
+			m_stepRequested = false;
+		}
+
+		m_stepHandler();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stepPending.store(false, std::memory_order_release);
+		}
+		m_eeCondition.notify_all();
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+//Runs IOP execution steps on a separate thread while the EE executes its own step.
+//Between BeginStep and the end of the step, the worker owns the IOP (CPU, BIOS, HLE modules).
+//Anything on the EE side that touches IOP state (SIF, DMA, IOP modules) must call Sync first.
+//Once synced, the IOP stays idle until the next step, so both CPUs never drift apart by more
+//than a step. IOP code that needs to touch EE state goes through RunOnEe, which waits for the
+//EE to call ProcessEeCalls (out of generated code) or reach the end of its step. While the
+//IOP waits there, syncs from the EE return right away since the IOP is stopped.
+//When not threaded, the step runs in EndStep, right after the EE's step, which is exactly what
+//the single threaded path does. This is the deterministic mode.
+class CIopThread
+{
+public:
+	typedef std::function<void()> StepHandler;
+	typedef std::function<void()> ThreadInitHandler;
+	typedef std::function<void()> FunctionType;
+
+	CIopThread(const StepHandler&, const ThreadInitHandler&, bool);
+	CIopThread(const CIopThread&) = delete;
+	~CIopThread();
+
+	CIopThread& operator=(const CIopThread&) = delete;
+
+	bool IsThreaded() const;
+
+	void BeginStep();
+	void EndStep();
+
+	inline void Sync()
+	{
+		if(!m_stepPending.load(std::memory_order_acquire)) return;
+		WaitForStep(false);
+	}
+
+	//Only call this from the EE thread between executions, never from a sync point
+	inline void ProcessEeCalls()
+	{
+		if(m_eeCall.load(std::memory_order_acquire) == nullptr) return;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		RunEeCall(lock);
+	}
+
+	void RunOnEe(const FunctionType&);
+
+private:
+	void WaitForStep(bool);
+	void RunEeCall(std::unique_lock<std::mutex>&);
+	void ThreadProc();
+
+	StepHandler m_stepHandler;
+	ThreadInitHandler m_threadInitHandler;
+	bool m_threaded = false;
+
+	std::mutex m_mutex;
+	std::condition_variable m_stepCondition;
+	std::condition_variable m_eeCondition;
+	std::condition_variable m_eeCallDoneCondition;
+	std::atomic<bool> m_stepPending = false;
+	bool m_stepRequested = false;
+	bool m_threadDone = false;
+	std::atomic<const FunctionType*> m_eeCall = nullptr;
+	std::thread m_thread;
+	std::thread::id m_threadId;
+};
@@ -94,6 +94,15 @@ void CMA_MIPSIV::Template_Load32Idx(const MemoryAccessIdxTraits& traits)
 		    m_codeGen->PullRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
 	    };
 
+	if(m_compileHints & MIPS_COMPILEHINT_FASTMEM)
+	{
+		//Accesses that don't hit mapped memory will fault and be handled by the executor
+		ComputeMemAccessFastRefIdx(traits.elementSize);
+		((m_codeGen)->*(traits.loadFunction))(1);
+		finishLoad();
+		return;
+	}
+
 	bool usePageLookup = (m_pCtx->m_pageLookup != nullptr);
 
 	if(usePageLookup)
@@ -133,6 +142,14 @@ void CMA_MIPSIV::Template_Store32Idx(const MemoryAccessIdxTraits& traits)
 {
 	CheckTLBExceptions(true);
 
+	if(m_compileHints & MIPS_COMPILEHINT_FASTMEM)
+	{
+		ComputeMemAccessFastRefIdx(traits.elementSize);
+		m_codeGen->PushRel(offsetof(CMIPS, m_State.nGPR[m_nRT].nV[0]));
+		((m_codeGen)->*(traits.storeFunction))(1);
+		return;
+	}
+
 	bool usePageLookup = (m_pCtx->m_pageLookup != nullptr);
 
 	if(usePageLookup)
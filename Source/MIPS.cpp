@@ -85,6 +85,15 @@ bool CMIPS::HasBreakpointInRange(uint32 begin, uint32 end) const
 	return false;
 }
 
+MIPS_CODEGEN_STATE CMIPS::GetCodeGenState(uint32 begin, uint32 end) const
+{
+	MIPS_CODEGEN_STATE state;
+	state.addrTranslator = m_pAddrTranslator;
+	state.tlbExceptionChecker = m_TLBExceptionChecker;
+	state.hasBreakpoint = HasBreakpointInRange(begin, end);
+	return state;
+}
+
 int32 CMIPS::GetBranch(uint16 nData)
 {
 	if(nData & 0x8000)
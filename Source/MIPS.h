@@ -142,6 +142,18 @@ struct MIPSSTATE
 #define MIPS_INVALID_PC (0x00000001)
 #define MIPS_PAGE_SIZE (0x1000)
 
+//Last target taken by an indirect branch (JR, JALR), indexed by the address of the block containing the branch
+struct MIPS_INDIRECT_BRANCH_CACHE_ENTRY
+{
+	uint32 site;
+	uint32 target;
+};
+static_assert(sizeof(MIPS_INDIRECT_BRANCH_CACHE_ENTRY) == 8);
+static constexpr uint32 MIPS_INDIRECT_BRANCH_CACHE_SIZE = 0x1000;
+
+//Return addresses pushed by calls (JAL, JALR) and popped by returns (JR $ra), wraps around when full
+static constexpr uint32 MIPS_RETURN_STACK_SIZE = 0x10;
+
 class CMIPS
 {
 public:
@@ -154,6 +166,7 @@ public:
 	~CMIPS();
 	void ToggleBreakpoint(uint32);
 	bool HasBreakpointInRange(uint32, uint32) const;
+	MIPS_CODEGEN_STATE GetCodeGenState(uint32, uint32) const;
 	bool IsBranch(uint32);
 	static int32 GetBranch(uint16);
 	static uint32 TranslateAddress64(CMIPS*, uint32);
@@ -170,6 +183,20 @@ public:
 
 	void* m_vuMem = nullptr;
 	void** m_pageLookup = nullptr;
+	uint8* m_fastMemoryBase = nullptr;
+
+	MIPS_INDIRECT_BRANCH_CACHE_ENTRY* m_indirectBranchCache = nullptr;
+	uint32 m_indirectBranchSite = MIPS_INVALID_PC;
+	uint32 m_indirectBranchHitCount = 0;
+
+	//Shadow of the guest call stack used to predict where returns go, see CBasicBlock::CompileReturnPrediction
+	uint32 m_returnStack[MIPS_RETURN_STACK_SIZE] = {};
+	uint32 m_returnStackTop = 0;
+	uint32 m_returnPredictionHitCount = 0;
+	std::function<void(CMIPS*)> m_predictedReturnHandler;
+
+	//Set by profiled blocks when they have enough samples, see CBasicBlock::EnableProfiling
+	uint32 m_profiledBlockSite = MIPS_INVALID_PC;
 
 	std::function<void(CMIPS*)> m_emptyBlockHandler;
 
@@ -17,11 +17,33 @@ CMIPSInstructionFactory::CMIPSInstructionFactory(MIPS_REGSIZE nRegSize)
 {
 }
 
+std::mutex& CMIPSInstructionFactory::GetCompileMutex()
+{
+	return m_compileMutex;
+}
+
+bool MIPS_CODEGEN_STATE::operator==(const MIPS_CODEGEN_STATE& rhs) const
+{
+	return (addrTranslator == rhs.addrTranslator) &&
+	       (tlbExceptionChecker == rhs.tlbExceptionChecker) &&
+	       (hasBreakpoint == rhs.hasBreakpoint);
+}
+
+bool MIPS_CODEGEN_STATE::operator!=(const MIPS_CODEGEN_STATE& rhs) const
+{
+	return !(*this == rhs);
+}
+
 void CMIPSInstructionFactory::SetCompileHints(uint32 compileHints)
 {
 	m_compileHints = compileHints;
 }
 
+void CMIPSInstructionFactory::SetCodeGenState(const MIPS_CODEGEN_STATE& codeGenState)
+{
+	m_codeGenState = codeGenState;
+}
+
 void CMIPSInstructionFactory::SetupQuickVariables(uint32 nAddress, CMipsJitter* codeGen, CMIPS* pCtx, uint32 instrPosition)
 {
 	m_pCtx = pCtx;
@@ -39,8 +61,8 @@ static void HandleTLBException(CMIPS*)
 
 void CMIPSInstructionFactory::CheckTLBExceptions(bool isWrite)
 {
-	if(m_pCtx->m_pAddrTranslator == &CMIPS::TranslateAddress64) return;
-	if(m_pCtx->m_TLBExceptionChecker == nullptr) return;
+	if(m_codeGenState.addrTranslator == &CMIPS::TranslateAddress64) return;
+	if(m_codeGenState.tlbExceptionChecker == nullptr) return;
 
 	uint8 nRS = (uint8)((m_nOpcode >> 21) & 0x001F);
 	uint16 nImmediate = (uint16)((m_nOpcode >> 0) & 0xFFFF);
@@ -60,7 +82,7 @@ void CMIPSInstructionFactory::CheckTLBExceptions(bool isWrite)
 	m_codeGen->PushCst(isWrite ? 1 : 0);
 
 	//Call
-	m_codeGen->Call(reinterpret_cast<void*>(m_pCtx->m_TLBExceptionChecker), 3, Jitter::CJitter::RETURN_VALUE_32);
+	m_codeGen->Call(reinterpret_cast<void*>(m_codeGenState.tlbExceptionChecker), 3, Jitter::CJitter::RETURN_VALUE_32);
 
 	m_codeGen->PushCst(MIPS_EXCEPTION_NONE);
 	m_codeGen->BeginIf(Jitter::CONDITION_NE);
@@ -90,7 +112,7 @@ void CMIPSInstructionFactory::ComputeMemAccessAddr()
 	uint8 nRS = (uint8)((m_nOpcode >> 21) & 0x001F);
 	uint16 nImmediate = (uint16)((m_nOpcode >> 0) & 0xFFFF);
 
-	if(m_pCtx->m_pAddrTranslator == &CMIPS::TranslateAddress64)
+	if(m_codeGenState.addrTranslator == &CMIPS::TranslateAddress64)
 	{
 		m_codeGen->PushRel(offsetof(CMIPS, m_State.nGPR[nRS].nV[0]));
 		if(nImmediate != 0)
@@ -119,7 +141,7 @@ void CMIPSInstructionFactory::ComputeMemAccessAddr()
 		}
 
 		//Call
-		m_codeGen->Call(reinterpret_cast<void*>(m_pCtx->m_pAddrTranslator), 2, Jitter::CJitter::RETURN_VALUE_32);
+		m_codeGen->Call(reinterpret_cast<void*>(m_codeGenState.addrTranslator), 2, Jitter::CJitter::RETURN_VALUE_32);
 	}
 }
 
@@ -165,6 +187,25 @@ void CMIPSInstructionFactory::ComputeMemAccessPageRef()
 	m_codeGen->LoadRefFromRefIdx();
 }
 
+void CMIPSInstructionFactory::ComputeMemAccessFastRefIdx(uint32 accessSize)
+{
+	assert(m_pCtx->m_fastMemoryBase);
+
+	auto rs = static_cast<uint8>((m_nOpcode >> 21) & 0x001F);
+	auto immediate = static_cast<int16>((m_nOpcode >> 0) & 0xFFFF);
+
+	m_codeGen->PushRelRef(offsetof(CMIPS, m_fastMemoryBase));
+
+	m_codeGen->PushRel(offsetof(CMIPS, m_State.nGPR[rs].nV[0]));
+	if(immediate != 0)
+	{
+		m_codeGen->PushCst(immediate);
+		m_codeGen->Add();
+	}
+	m_codeGen->PushCst(~(accessSize - 1));
+	m_codeGen->And();
+}
+
 void CMIPSInstructionFactory::Branch(Jitter::CONDITION condition)
 {
 	uint16 nImmediate = (uint16)(m_nOpcode & 0xFFFF);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <mutex>
 #include "Types.h"
 #include "MipsJitter.h"
 
@@ -11,6 +12,25 @@ enum MIPS_REGSIZE
 	MIPS_REGSIZE_64 = 1,
 };
 
+//Architecture specific hints are allocated from the lowest bit, these from the highest
+enum MIPS_COMPILEHINT : uint32
+{
+	MIPS_COMPILEHINT_FASTMEM = 0x80000000,
+	MIPS_COMPILEHINT_IDLELOOPDETECTION = 0x40000000,
+};
+
+//Context state generated code depends on, besides opcodes and compile hints. Blocks take
+//a copy when they're created, they can then be compiled without looking at the live context.
+struct MIPS_CODEGEN_STATE
+{
+	uint32 (*addrTranslator)(CMIPS*, uint32) = nullptr;
+	uint32 (*tlbExceptionChecker)(CMIPS*, uint32, uint32) = nullptr;
+	bool hasBreakpoint = false;
+
+	bool operator==(const MIPS_CODEGEN_STATE&) const;
+	bool operator!=(const MIPS_CODEGEN_STATE&) const;
+};
+
 enum MIPS_BRANCH_TYPE
 {
 	MIPS_BRANCH_NONE = 0,
@@ -25,13 +45,18 @@ public:
 	virtual ~CMIPSInstructionFactory() = default;
 	virtual void CompileInstruction(uint32, CMipsJitter*, CMIPS*, uint32) = 0;
 	virtual void SetCompileHints(uint32);
+	void SetCodeGenState(const MIPS_CODEGEN_STATE&);
 	void Illegal();
 
+	//Translation state below is shared, threads compiling for this factory need to hold this
+	std::mutex& GetCompileMutex();
+
 protected:
 	void ComputeMemAccessAddr();
 	void ComputeMemAccessAddrNoXlat();
 	void ComputeMemAccessRefIdx(uint32);
 	void ComputeMemAccessPageRef();
+	void ComputeMemAccessFastRefIdx(uint32);
 
 	void CheckTLBExceptions(bool);
 	void CheckTrap();
@@ -46,5 +71,9 @@ protected:
 	uint32 m_nAddress = 0;
 	uint32 m_instrPosition = 0;
 	uint32 m_compileHints = 0;
+	MIPS_CODEGEN_STATE m_codeGenState;
 	MIPS_REGSIZE m_regSize;
+
+private:
+	std::mutex m_compileMutex;
 };
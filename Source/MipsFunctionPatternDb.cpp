@@ -111,7 +111,7 @@ bool CMipsFunctionPatternDb::ParsePatternItem(const char* source, PATTERNITEM& r
 	return true;
 }
 
-bool CMipsFunctionPatternDb::Pattern::Matches(uint32* text, uint32 textSize) const
+bool CMipsFunctionPatternDb::Pattern::Matches(uint32* text, uint32 textSize, uint32* matchSize) const
 {
 	textSize /= 4;
 	if(textSize < items.size()) return false;
@@ -131,5 +131,10 @@ bool CMipsFunctionPatternDb::Pattern::Matches(uint32* text, uint32 textSize) con
 		matchCount++;
 	}
 
+	if(matchSize)
+	{
+		//Includes the null words that were skipped
+		*matchSize = textIndex * 4;
+	}
 	return (matchCount == items.size());
 }
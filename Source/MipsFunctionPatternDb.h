@@ -20,7 +20,7 @@ public:
 	public:
 		typedef std::vector<PATTERNITEM> ItemArray;
 
-		bool Matches(uint32*, uint32) const;
+		bool Matches(uint32*, uint32, uint32* = nullptr) const;
 
 		std::string name;
 		ItemArray items;
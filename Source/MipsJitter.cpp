@@ -92,6 +92,8 @@ void CMipsJitter::MarkLastBlockLabel()
 	if(m_lastBlockLabel != -1)
 	{
 		MarkLabel(m_lastBlockLabel);
+		//Superblocks have one of these per branch, next one needs a new label
+		m_lastBlockLabel = -1;
 	}
 }
 
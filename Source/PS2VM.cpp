@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <cstdio>
 #include <exception>
 #include <memory>
 #include <climits>
-#include <fenv.h>
+#include <cstring>
+#include "CodeArena.h"
 #include "FpUtils.h"
 #include "make_unique.h"
 #include "string_format.h"
@@ -10,6 +12,7 @@
 #include "PS2VM_Preferences.h"
 #include "ee/PS2OS.h"
 #include "ee/EeExecutor.h"
+#include "ee/Ee_NativeFunctions.h"
 #include "Ps2Const.h"
 #include "iop/Iop_SifManPs2.h"
 #include "iop/UsbBuzzerDevice.h"
@@ -45,6 +48,8 @@
 #define STATE_VM_TIMING_EE_EXECUTION_TICKS ("eeExecutionTicks")
 #define STATE_VM_TIMING_IOP_EXECUTION_TICKS ("iopExecutionTicks")
 #define STATE_VM_TIMING_SPU_UPDATE_TICKS ("spuUpdateTicks")
+#define STATE_VM_TIMING_UNIT_UPDATE_TICKS ("unitUpdateTicks")
+#define STATE_VM_TIMING_UNIT_ELAPSED_TICKS ("unitElapsedTicks")
 
 #define PREF_PS2_ROM0_DIRECTORY_DEFAULT ("vfs/rom0")
 #define PREF_PS2_HOST_DIRECTORY_DEFAULT ("vfs/host")
@@ -91,15 +96,35 @@ CPS2VM::CPS2VM()
 	CAppConfig::GetInstance().RegisterPreferencePath(PREF_PS2_CDROM0_PATH, "");
 
 	Framework::PathUtils::EnsurePathExists(GetStateDirectoryPath());
+	Framework::PathUtils::EnsurePathExists(GetCodeCacheDirectoryPath());
 
 	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_LIMIT_FRAMERATE, true);
 	ReloadFrameRateLimit();
 
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_CODECACHE_ENABLED, true);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_EE_SUPERBLOCKS_ENABLED, false);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_IOP_SUPERBLOCKS_ENABLED, false);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_EE_FASTMEM_ENABLED, false);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_EE_NATIVEFUNCTIONS_ENABLED, false);
+
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_IOP_THREAD_ENABLED, false);
+	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_PS2_IOP_THREAD_MAXSKEW, m_eeTickStep);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_VU1_THREAD_ENABLED, false);
+
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_REWIND_ENABLED, false);
+	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_PS2_REWIND_BUFFERSIZE, 256);
+
 	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_AUDIO_SPUBLOCKCOUNT, 100);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_AUDIO_SPUTHREAD_ENABLED, false);
 	ReloadSpuBlockCountImpl();
 
 	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_ARCADE_IO_SERVER_ENABLED, false);
 	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_PS2_ARCADE_IO_SERVER_PORT, 9876);
+
+	m_hblankEvent = m_scheduler.RegisterEvent([this]() { HandleHBlank(); });
+	m_vblankEvent = m_scheduler.RegisterEvent([this]() { HandleVBlank(); });
+	m_spuUpdateEvent = m_scheduler.RegisterEvent([this]() { HandleSpuUpdate(); });
+	m_unitUpdateEvent = m_scheduler.RegisterEvent([this]() { HandleUnitUpdate(); });
 }
 
 //////////////////////////////////////////////////
@@ -346,6 +371,11 @@ fs::path CPS2VM::GenerateStatePath(unsigned int slot) const
 	return GetStateDirectoryPath() / fs::path(stateFileName);
 }
 
+fs::path CPS2VM::GetCodeCacheDirectoryPath()
+{
+	return CAppConfig::GetInstance().GetBasePath() / fs::path("codecache/");
+}
+
 std::future<bool> CPS2VM::SaveState(const fs::path& statePath)
 {
 	auto promise = std::make_shared<std::promise<bool>>();
@@ -370,6 +400,23 @@ std::future<bool> CPS2VM::LoadState(const fs::path& statePath)
 	return future;
 }
 
+std::future<bool> CPS2VM::Rewind(uint32 frameCount)
+{
+	auto promise = std::make_shared<std::promise<bool>>();
+	auto future = promise->get_future();
+	m_mailBox.SendCall(
+	    [this, promise, frameCount]() {
+		    auto result = RewindVMState(frameCount);
+		    promise->set_value(result);
+	    });
+	return future;
+}
+
+CRewindBuffer::STATS CPS2VM::GetRewindStats() const
+{
+	return m_rewindStats;
+}
+
 CPS2VM::CPU_UTILISATION_INFO CPS2VM::GetCpuUtilisationInfo() const
 {
 	return m_cpuUtilisation;
@@ -473,11 +520,33 @@ void CPS2VM::CreateVM()
 	m_iop = std::make_unique<Iop::CSubSystem>(true);
 	auto iopOs = dynamic_cast<CIopBios*>(m_iop->m_bios.get());
 
-	m_ee = std::make_unique<Ee::CSubSystem>(m_iop->m_ram, *iopOs);
+	bool eeFastMemoryEnabled = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_EE_FASTMEM_ENABLED) && CFastMemory::IsSupported();
+	bool vu1ThreadEnabled = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_VU1_THREAD_ENABLED);
+	m_ee = std::make_unique<Ee::CSubSystem>(m_iop->m_ram, *iopOs, eeFastMemoryEnabled, vu1ThreadEnabled);
 	m_OnRequestLoadExecutableConnection = m_ee->m_os->OnRequestLoadExecutable.Connect(std::bind(&CPS2VM::ReloadExecutable, this, std::placeholders::_1, std::placeholders::_2));
 	m_OnExecutableChangeConnection = m_ee->m_os->OnExecutableChange.Connect(std::bind(&CPS2VM::OnExecutableChange, this));
 	m_OnCrtModeChangeConnection = m_ee->m_os->OnCrtModeChange.Connect(std::bind(&CPS2VM::OnCrtModeChange, this));
 
+	CBasicBlock::SetCodeCache(&m_blockCodeCache);
+
+	{
+		bool iopThreadEnabled = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_IOP_THREAD_ENABLED);
+		m_iopThreadMaxSkew = std::max<uint32>(CAppConfig::GetInstance().GetPreferenceInteger(PREF_PS2_IOP_THREAD_MAXSKEW), m_eeMinTickStep);
+		m_iopThread = std::make_unique<CIopThread>(
+		    [this]() { UpdateIop(); },
+		    [this]() { static_cast<CEeExecutor*>(m_ee->m_EE.m_executor.get())->AttachExceptionHandlerToThread(); },
+		    iopThreadEnabled);
+		m_ee->m_sif.SetIopSyncHandler([this]() { m_iopThread->Sync(); });
+		m_ee->m_sif.SetEeCallHandler([this](const CSIF::EeFunction& function) { m_iopThread->RunOnEe(function); });
+	}
+
+	{
+		auto eeExecutor = static_cast<CEeExecutor*>(m_ee->m_EE.m_executor.get());
+		eeExecutor->SetSuperblocksEnabled(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_EE_SUPERBLOCKS_ENABLED));
+		auto iopExecutor = static_cast<CGenericMipsExecutor<BlockLookupOneWay>*>(m_iop->m_cpu.m_executor.get());
+		iopExecutor->SetSuperblocksEnabled(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_IOP_SUPERBLOCKS_ENABLED));
+	}
+
 	ResetVM();
 }
 
@@ -492,6 +561,15 @@ void CPS2VM::ResetVM()
 	m_ee->Reset(m_eeRamSize);
 	m_iop->Reset();
 
+#ifdef CODEARENA_SUPPORTED
+	//Executors dropped their blocks, give back the code memory they used
+	CCodeArena::GetInstance().Trim();
+#endif
+
+	m_rewindBuffer.Clear();
+	m_rewindEnabled = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_REWIND_ENABLED);
+	m_rewindBuffer.SetMaxMemoryUsage(static_cast<uint64>(CAppConfig::GetInstance().GetPreferenceInteger(PREF_PS2_REWIND_BUFFERSIZE)) * 1024 * 1024);
+
 	if(m_ee->m_gs != NULL)
 	{
 		m_ee->m_gs->Reset();
@@ -513,22 +591,33 @@ void CPS2VM::ResetVM()
 		iopOs->GetIoman()->RegisterDevice("cdrom1", Iop::Ioman::DevicePtr(new Iop::Ioman::COpticalMediaDevice(m_cdrom0)));
 		iopOs->GetIoman()->RegisterDevice("hdd0", std::make_shared<Iop::Ioman::CHardDiskDevice>());
 
-		iopOs->GetLoadcore()->SetLoadExecutableHandler(std::bind(&CPS2OS::LoadExecutable, m_ee->m_os, std::placeholders::_1, std::placeholders::_2));
+		iopOs->GetLoadcore()->SetLoadExecutableHandler(
+		    [this](const char* path, const char* section) {
+			    //Comes from the IOP, but loads stuff in EE memory
+			    uint32 result = 0;
+			    m_ee->m_sif.CallOnEe([&]() { result = m_ee->m_os->LoadExecutable(path, section); });
+			    return result;
+		    });
 	}
 
 	CDROM0_SyncPath();
 
 	SetEeFrequencyScale(1, 1);
 
-	m_hblankTicks = m_hblankTicksTotal;
-	m_vblankTicks = m_onScreenTicksTotal;
-	m_spuUpdateTicks = m_spuUpdateTicksTotal;
+	m_scheduler.Reset();
+	m_scheduler.Schedule(m_hblankEvent, m_hblankTicksTotal);
+	m_scheduler.Schedule(m_vblankEvent, m_onScreenTicksTotal);
+	//First update is one period away, only the fraction of that period is carried over
+	m_scheduler.Schedule(m_spuUpdateEvent, SplitSpuUpdateTicks(m_spuUpdateTicksTotal));
+	m_unitUpdateTime = 0;
 	m_inVblank = false;
 
 	m_eeExecutionTicks = 0;
 	m_iopExecutionTicks = 0;
+	m_iopExecutionTicksRemain = 0;
 
 	m_currentSpuBlock = 0;
+	m_spuThreadEnabled = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_AUDIO_SPUTHREAD_ENABLED);
 	m_iop->m_spuCore0.SetDestinationSamplingRate(DST_SAMPLE_RATE);
 	m_iop->m_spuCore1.SetDestinationSamplingRate(DST_SAMPLE_RATE);
 
@@ -604,34 +693,238 @@ bool CPS2VM::LoadVMState(const fs::path& statePath)
 		return false;
 	}
 
+	m_rewindBuffer.Clear();
 	OnMachineStateChange();
 
 	return true;
 }
 
+void CPS2VM::SaveRewindSnapshot()
+{
+	if(m_ee->m_gs == NULL) return;
+
+	//Large memory areas are handled by the rewind buffer, only the rest goes in the raw state
+	size_t stateSize = m_ee->GetRawStateSize(false) + m_iop->GetRawStateSize(false) +
+	                   m_ee->m_gs->GetRawStateSize(false) + sizeof(VM_TIMING_STATE);
+	m_rewindState.resize(stateSize);
+	try
+	{
+		CRawStateWriter writer(m_rewindState.data(), m_rewindState.size());
+		m_ee->SaveRawState(writer, false);
+		m_iop->SaveRawState(writer, false);
+		m_ee->m_gs->SaveRawState(writer, false);
+		writer.Write(GetVmTimingState());
+		assert(writer.GetSize() == stateSize);
+	}
+	catch(...)
+	{
+		//Something didn't fit in its raw state record, skip this snapshot
+		return;
+	}
+
+	//Order must match REWIND_REGION
+	CRewindBuffer::MemoryRegionList regions =
+	    {
+	        {m_ee->m_ram, m_eeRamSize},
+	        {m_iop->m_ram, PS2::IOP_RAM_SIZE},
+	        {m_iop->m_spuRam, PS2::SPU_RAM_SIZE},
+	        {m_ee->m_gs->GetRam(), CGSHandler::RAMSIZE},
+	    };
+	m_rewindBuffer.SetMemoryRegions(std::move(regions));
+	m_rewindBuffer.PushSnapshot(m_rewindState.data(), m_rewindState.size());
+	m_rewindStats = m_rewindBuffer.GetStats();
+}
+
+bool CPS2VM::RewindVMState(uint32 frameCount)
+{
+	if(m_ee->m_gs == NULL) return false;
+	if(frameCount >= m_rewindBuffer.GetSnapshotCount()) return false;
+
+	//SPU RAM is about to be overwritten, SPU thread must be done with it
+	m_iop->m_spuRenderThread.Sync();
+
+	//Make sure EE RAM isn't write protected before the rewind buffer writes to it
+	m_ee->m_EE.m_executor->ClearActiveBlocksInRange(0, PS2::EE_RAM_SIZE, false);
+
+	CRewindBuffer::StateBlob state;
+	bool restored = m_rewindBuffer.Restore(frameCount, state,
+	                                       [this](uint32 regionIndex, uint32 offset) {
+		                                       if(regionIndex == REWIND_REGION_IOP_RAM)
+		                                       {
+			                                       m_iop->m_cpu.m_executor->ClearActiveBlocksInRange(offset, offset + CRewindBuffer::PAGE_SIZE, false);
+		                                       }
+	                                       });
+	if(!restored) return false;
+
+	try
+	{
+		CRawStateReader reader(state.data(), state.size());
+
+		try
+		{
+			m_ee->LoadRawState(reader, false);
+			m_iop->LoadRawState(reader, false);
+			m_ee->m_gs->LoadRawState(reader, false);
+			SetVmTimingState(reader.Read<VM_TIMING_STATE>());
+		}
+		catch(...)
+		{
+			//Any error that occurs in the previous block is critical
+			PauseImpl();
+			throw;
+		}
+	}
+	catch(...)
+	{
+		return false;
+	}
+
+	m_rewindStats = m_rewindBuffer.GetStats();
+	OnMachineStateChange();
+
+	return true;
+}
+
+size_t CPS2VM::GetRawStateSize()
+{
+	if(m_ee->m_gs == NULL) return 0;
+
+	return sizeof(RAW_STATE_HEADER) + m_ee->GetRawStateSize() + m_iop->GetRawStateSize() +
+	       m_ee->m_gs->GetRawStateSize() + sizeof(VM_TIMING_STATE);
+}
+
+bool CPS2VM::SaveRawState(void* data, size_t size)
+{
+	if(m_ee->m_gs == NULL) return false;
+
+	try
+	{
+		CRawStateWriter writer(data, size);
+
+		RAW_STATE_HEADER header;
+		header.magic = RAW_STATE_MAGIC;
+		header.version = RAW_STATE_VERSION;
+		writer.Write(header);
+		m_ee->SaveRawState(writer);
+		m_iop->SaveRawState(writer);
+		m_ee->m_gs->SaveRawState(writer);
+		writer.Write(GetVmTimingState());
+		assert(writer.GetSize() == GetRawStateSize());
+	}
+	catch(...)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool CPS2VM::LoadRawState(const void* data, size_t size)
+{
+	if(m_ee->m_gs == NULL) return false;
+	if(size < sizeof(RAW_STATE_HEADER)) return false;
+
+	RAW_STATE_HEADER header;
+	memcpy(&header, data, sizeof(RAW_STATE_HEADER));
+	if((header.magic != RAW_STATE_MAGIC) || (header.version != RAW_STATE_VERSION)) return false;
+	if(size < GetRawStateSize()) return false;
+
+	try
+	{
+		auto stateBytes = reinterpret_cast<const uint8*>(data);
+		CRawStateReader reader(stateBytes + sizeof(RAW_STATE_HEADER), size - sizeof(RAW_STATE_HEADER));
+
+		try
+		{
+			m_ee->LoadRawState(reader);
+			m_iop->LoadRawState(reader);
+			m_ee->m_gs->LoadRawState(reader);
+			SetVmTimingState(reader.Read<VM_TIMING_STATE>());
+
+			ReloadFrameRateLimit();
+		}
+		catch(...)
+		{
+			//Any error that occurs in the previous block is critical
+			PauseImpl();
+			throw;
+		}
+	}
+	catch(...)
+	{
+		return false;
+	}
+
+	m_rewindBuffer.Clear();
+	OnMachineStateChange();
+
+	return true;
+}
+
+CPS2VM::VM_TIMING_STATE CPS2VM::GetVmTimingState()
+{
+	VM_TIMING_STATE state;
+	state.vblankTicks = static_cast<int32>(m_scheduler.GetTicksUntil(m_vblankEvent));
+	state.inVblank = m_inVblank;
+	state.eeExecutionTicks = m_eeExecutionTicks;
+	state.iopExecutionTicks = m_iopExecutionTicks;
+	state.spuUpdateTicks = (m_scheduler.GetTicksUntil(m_spuUpdateEvent) << SPU_UPDATE_TICKS_PRECISION) + m_spuUpdateTicksFraction;
+	state.unitUpdateTicks = 0;
+	state.unitElapsedTicks = 0;
+	if(m_scheduler.IsScheduled(m_unitUpdateEvent))
+	{
+		state.unitUpdateTicks = static_cast<uint32>(m_scheduler.GetTicksUntil(m_unitUpdateEvent));
+		state.unitElapsedTicks = static_cast<uint32>(m_scheduler.GetCurrentTime() - m_unitUpdateTime);
+	}
+	return state;
+}
+
+void CPS2VM::SetVmTimingState(const VM_TIMING_STATE& state)
+{
+	//Older states could hold slightly negative tick counts, meaning the event was already due
+	m_scheduler.Schedule(m_vblankEvent, std::max<int32>(state.vblankTicks, 0));
+	m_scheduler.Schedule(m_spuUpdateEvent, SplitSpuUpdateTicks(std::max<int64>(state.spuUpdateTicks, 0)));
+	//Units go back to idle in the update if they don't have anything left to do
+	m_scheduler.Schedule(m_unitUpdateEvent, state.unitUpdateTicks);
+	m_unitUpdateTime = m_scheduler.GetCurrentTime() - std::min<uint64>(state.unitElapsedTicks, m_scheduler.GetCurrentTime());
+	m_inVblank = state.inVblank != 0;
+	m_eeExecutionTicks = state.eeExecutionTicks;
+	m_iopExecutionTicks = state.iopExecutionTicks;
+}
+
 void CPS2VM::SaveVmTimingState(Framework::CZipArchiveWriter& archive)
 {
+	auto state = GetVmTimingState();
 	auto registerFile = std::make_unique<CRegisterStateFile>(STATE_VM_TIMING_XML);
-	registerFile->SetRegister32(STATE_VM_TIMING_VBLANK_TICKS, m_vblankTicks);
-	registerFile->SetRegister32(STATE_VM_TIMING_IN_VBLANK, m_inVblank);
-	registerFile->SetRegister32(STATE_VM_TIMING_EE_EXECUTION_TICKS, m_eeExecutionTicks);
-	registerFile->SetRegister32(STATE_VM_TIMING_IOP_EXECUTION_TICKS, m_iopExecutionTicks);
-	registerFile->SetRegister64(STATE_VM_TIMING_SPU_UPDATE_TICKS, m_spuUpdateTicks);
+	registerFile->SetRegister32(STATE_VM_TIMING_VBLANK_TICKS, state.vblankTicks);
+	registerFile->SetRegister32(STATE_VM_TIMING_IN_VBLANK, state.inVblank);
+	registerFile->SetRegister32(STATE_VM_TIMING_EE_EXECUTION_TICKS, state.eeExecutionTicks);
+	registerFile->SetRegister32(STATE_VM_TIMING_IOP_EXECUTION_TICKS, state.iopExecutionTicks);
+	registerFile->SetRegister64(STATE_VM_TIMING_SPU_UPDATE_TICKS, state.spuUpdateTicks);
+	registerFile->SetRegister32(STATE_VM_TIMING_UNIT_UPDATE_TICKS, state.unitUpdateTicks);
+	registerFile->SetRegister32(STATE_VM_TIMING_UNIT_ELAPSED_TICKS, state.unitElapsedTicks);
 	archive.InsertFile(std::move(registerFile));
 }
 
 void CPS2VM::LoadVmTimingState(Framework::CZipArchiveReader& archive)
 {
 	CRegisterStateFile registerFile(*archive.BeginReadFile(STATE_VM_TIMING_XML));
-	m_vblankTicks = registerFile.GetRegister32(STATE_VM_TIMING_VBLANK_TICKS);
-	m_inVblank = registerFile.GetRegister32(STATE_VM_TIMING_IN_VBLANK) != 0;
-	m_eeExecutionTicks = registerFile.GetRegister32(STATE_VM_TIMING_EE_EXECUTION_TICKS);
-	m_iopExecutionTicks = registerFile.GetRegister32(STATE_VM_TIMING_IOP_EXECUTION_TICKS);
-	m_spuUpdateTicks = registerFile.GetRegister64(STATE_VM_TIMING_SPU_UPDATE_TICKS);
+	VM_TIMING_STATE state;
+	state.vblankTicks = registerFile.GetRegister32(STATE_VM_TIMING_VBLANK_TICKS);
+	state.inVblank = registerFile.GetRegister32(STATE_VM_TIMING_IN_VBLANK);
+	state.eeExecutionTicks = registerFile.GetRegister32(STATE_VM_TIMING_EE_EXECUTION_TICKS);
+	state.iopExecutionTicks = registerFile.GetRegister32(STATE_VM_TIMING_IOP_EXECUTION_TICKS);
+	state.spuUpdateTicks = registerFile.GetRegister64(STATE_VM_TIMING_SPU_UPDATE_TICKS);
+	//Older states don't have these, units are then updated right away
+	state.unitUpdateTicks = registerFile.GetRegister32(STATE_VM_TIMING_UNIT_UPDATE_TICKS);
+	state.unitElapsedTicks = registerFile.GetRegister32(STATE_VM_TIMING_UNIT_ELAPSED_TICKS);
+	SetVmTimingState(state);
 }
 
 void CPS2VM::PauseImpl()
 {
+	m_iop->m_spuRenderThread.Sync();
+	m_blockCodeCache.Flush();
 	m_nStatus = PAUSED;
 }
 
@@ -650,6 +943,8 @@ void CPS2VM::DestroyImpl()
 	DestroyGsHandlerImpl();
 	DestroyPadHandlerImpl();
 	DestroySoundHandlerImpl();
+	CBasicBlock::SetCodeCache(nullptr);
+	m_blockCodeCache.Close();
 	m_nEnd = true;
 }
 
@@ -722,6 +1017,8 @@ void CPS2VM::UpdateEe()
 	while(m_eeExecutionTicks > 0)
 	{
 		int executed = m_ee->ExecuteCpu(m_singleStepEe ? 1 : m_eeExecutionTicks);
+		//Out of generated code, IOP can have its EE calls done
+		m_iopThread->ProcessEeCalls();
 		if(m_ee->IsCpuIdle())
 		{
 			m_cpuUtilisation.eeIdleTicks += (m_eeExecutionTicks - executed);
@@ -730,13 +1027,14 @@ void CPS2VM::UpdateEe()
 		m_cpuUtilisation.eeTotalTicks += executed;
 
 		m_ee->m_vpu0->Execute(m_singleStepVu0 ? 1 : executed);
-		m_ee->m_vpu1->Execute(m_singleStepVu1 ? 1 : executed);
+		if(!m_ee->m_vu1Thread)
+		{
+			m_ee->m_vpu1->Execute(m_singleStepVu1 ? 1 : executed);
+		}
 
 		m_eeExecutionTicks -= executed;
-		m_spuUpdateTicks -= (static_cast<int64>(executed) << SPU_UPDATE_TICKS_PRECISION);
 		m_ee->CountTicks(executed);
-		m_hblankTicks -= executed;
-		m_vblankTicks -= executed;
+		m_scheduler.Advance(executed);
 
 #ifdef DEBUGGER_INCLUDED
 		if(m_singleStepEe || m_singleStepVu0 || m_singleStepVu1) break;
@@ -777,26 +1075,26 @@ void CPS2VM::UpdateSpu()
 	CProfilerZone profilerZone(m_spuProfilerZone);
 #endif
 
-	unsigned int blockOffset = (BLOCK_SIZE * m_currentSpuBlock);
-	int16* samplesSpu0 = m_samples + blockOffset;
-
-	m_iop->m_spuCore0.Render(samplesSpu0, BLOCK_SIZE);
-
-	if(m_iop->m_spuCore1.IsEnabled())
+	if(m_spuThreadEnabled)
 	{
-		int16 samplesSpu1[BLOCK_SIZE];
-		m_iop->m_spuCore1.Render(samplesSpu1, BLOCK_SIZE);
-
-		for(unsigned int i = 0; i < BLOCK_SIZE; i++)
+		//Collect what the SPU thread rendered so far and have it start on the next block.
+		//Output is delayed by a block or so, but the emulation thread doesn't wait on rendering.
+		auto& renderThread = m_iop->m_spuRenderThread;
+		while(renderThread.PopBlock(m_samples + (BLOCK_SIZE * m_currentSpuBlock), BLOCK_SIZE))
 		{
-			// Core0 output should be mixed with Core1 at volume
-			// corresponding to Core1's AVOL register values
-			int32 volume = (i % 2) ? m_iop->m_spuCore1.m_extInputVolR : m_iop->m_spuCore1.m_extInputVolL;
-			Iop::CSpuBase::MixSamples(samplesSpu0[i], volume, &samplesSpu1[i]);
-			samplesSpu0[i] = samplesSpu1[i];
+			FlushSpuBlock();
 		}
+		renderThread.QueueBlock(BLOCK_SIZE);
+	}
+	else
+	{
+		Iop::CSpuRenderThread::RenderBlock(m_iop->m_spuCore0, m_iop->m_spuCore1, m_samples + (BLOCK_SIZE * m_currentSpuBlock), BLOCK_SIZE);
+		FlushSpuBlock();
 	}
+}
 
+void CPS2VM::FlushSpuBlock()
+{
 	m_currentSpuBlock++;
 	if(m_currentSpuBlock == m_spuBlockCount)
 	{
@@ -887,6 +1185,27 @@ void CPS2VM::ReloadExecutable(const char* executablePath, const CPS2OS::Argument
 void CPS2VM::OnExecutableChange()
 {
 	CGameConfig::ApplyGameConfig(*this);
+
+	{
+		CEeExecutor::NativeFunctionMap nativeFunctions;
+		if(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_EE_NATIVEFUNCTIONS_ENABLED) && m_ee->m_os->GetELF())
+		{
+			auto executableRange = m_ee->m_os->GetExecutableRange();
+			nativeFunctions = Ee::NativeFunctions::FindFunctions(m_ee->m_ram, executableRange.first, executableRange.second & ~0x03);
+		}
+		auto eeExecutor = static_cast<CEeExecutor*>(m_ee->m_EE.m_executor.get());
+		eeExecutor->SetNativeFunctions(std::move(nativeFunctions));
+	}
+
+	if(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_CODECACHE_ENABLED))
+	{
+		auto codeCacheFileName = string_format("%s.jitcache", m_ee->m_os->GetExecutableName());
+		m_blockCodeCache.Open(GetCodeCacheDirectoryPath() / fs::path(codeCacheFileName));
+	}
+	else
+	{
+		m_blockCodeCache.Close();
+	}
 }
 
 void CPS2VM::OnCrtModeChange()
@@ -894,11 +1213,112 @@ void CPS2VM::OnCrtModeChange()
 	ReloadFrameRateLimit();
 }
 
+void CPS2VM::HandleHBlank()
+{
+	m_scheduler.ScheduleNext(m_hblankEvent, m_hblankTicksTotal);
+	if(m_ee->m_gs)
+	{
+		m_ee->m_gs->SetHBlank();
+	}
+}
+
+void CPS2VM::HandleVBlank()
+{
+	m_inVblank = !m_inVblank;
+	if(m_inVblank)
+	{
+		m_scheduler.ScheduleNext(m_vblankEvent, m_vblankTicksTotal);
+		m_ee->NotifyVBlankStart();
+		m_iop->NotifyVBlankStart();
+
+		if(m_ee->m_gs != NULL)
+		{
+#ifdef PROFILE
+			CProfilerZone profilerZone(m_gsSyncProfilerZone);
+#endif
+			m_ee->m_gs->SetVBlank();
+		}
+
+		if(m_pad != NULL)
+		{
+			m_pad->Update(m_ee->m_ram);
+		}
+#ifdef PROFILE
+		//Finish up profile
+		CProfiler::GetInstance().CountCurrentZone();
+#endif
+		OnNewFrame();
+		if(m_rewindEnabled)
+		{
+			SaveRewindSnapshot();
+		}
+#ifdef PROFILE
+		CProfiler::GetInstance().Reset();
+#endif
+		m_cpuUtilisation = CPU_UTILISATION_INFO();
+	}
+	else
+	{
+		m_scheduler.ScheduleNext(m_vblankEvent, m_onScreenTicksTotal);
+		m_ee->NotifyVBlankEnd();
+		m_iop->NotifyVBlankEnd();
+		if(m_ee->m_gs != NULL)
+		{
+			m_ee->m_gs->ResetVBlank();
+		}
+		m_frameLimiter.EndFrame();
+		m_frameLimiter.BeginFrame();
+	}
+}
+
+void CPS2VM::HandleSpuUpdate()
+{
+	uint64 spuUpdateTicks = static_cast<uint64>(m_spuUpdateTicksTotal) + m_spuUpdateTicksFraction;
+	m_scheduler.ScheduleNext(m_spuUpdateEvent, SplitSpuUpdateTicks(spuUpdateTicks));
+	UpdateSpu();
+}
+
+void CPS2VM::HandleUnitUpdate()
+{
+	uint64 currentTime = m_scheduler.GetCurrentTime();
+	int ticks = static_cast<int>(currentTime - m_unitUpdateTime);
+	m_unitUpdateTime = currentTime;
+	m_ee->UpdateUnits(ticks);
+	if(auto delay = m_ee->GetUnitUpdateDelay(m_unitRetryTicks))
+	{
+		m_scheduler.Schedule(m_unitUpdateEvent, delay.value());
+	}
+}
+
+void CPS2VM::ScheduleUnitUpdate()
+{
+	//Transfers and delays started during the last step or by events have their completion scheduled here
+	auto delay = m_ee->GetUnitUpdateDelay(m_unitRetryTicks);
+	if(!delay) return;
+	if(!m_scheduler.IsScheduled(m_unitUpdateEvent))
+	{
+		//Units were idle, ticks before this point don't count
+		m_unitUpdateTime = m_scheduler.GetCurrentTime();
+	}
+	else if(m_scheduler.GetTicksUntil(m_unitUpdateEvent) <= delay.value())
+	{
+		return;
+	}
+	m_scheduler.Schedule(m_unitUpdateEvent, delay.value());
+}
+
+uint64 CPS2VM::SplitSpuUpdateTicks(uint64 spuUpdateTicks)
+{
+	//Period isn't a whole number of ticks. The scheduler gets the whole part, the fraction
+	//left behind is carried over and added to the next period.
+	m_spuUpdateTicksFraction = static_cast<uint32>(spuUpdateTicks & ((1ULL << SPU_UPDATE_TICKS_PRECISION) - 1));
+	return spuUpdateTicks >> SPU_UPDATE_TICKS_PRECISION;
+}
+
 void CPS2VM::EmuThread()
 {
 	CreateVM();
-	fesetround(FE_TOWARDZERO);
-	FpUtils::SetDenormalHandlingMode();
+	FpUtils::SetEmulationFpEnvironment();
 	CProfiler::GetInstance().SetWorkThread();
 #ifdef __ANDROID__
 	JNIEnv* env = nullptr;
@@ -922,73 +1342,30 @@ void CPS2VM::EmuThread()
 		}
 		if(m_nStatus == RUNNING)
 		{
-			if(m_spuUpdateTicks <= 0)
-			{
-				UpdateSpu();
-				m_spuUpdateTicks += m_spuUpdateTicksTotal;
-			}
+			m_scheduler.ProcessEvents();
+			ScheduleUnitUpdate();
 
 			{
-				if(m_hblankTicks <= 0)
+				//Run until something is due, but not for too long to keep EE and IOP close to each other
+				uint32 eeTickStep = static_cast<uint32>(m_scheduler.GetTicksUntilNextEvent(m_eeTickStep));
+				eeTickStep = std::min(eeTickStep, m_ee->m_timer.GetTicksUntilNextInterrupt());
+				if(m_iopThread->IsThreaded())
 				{
-					m_hblankTicks += m_hblankTicksTotal;
-					if(m_ee->m_gs)
-					{
-						m_ee->m_gs->SetHBlank();
-					}
+					//IOP only syncs with the EE at the end of a step or when they interact
+					eeTickStep = std::min(eeTickStep, m_iopThreadMaxSkew);
 				}
+				eeTickStep = std::max<uint32>(eeTickStep, m_eeMinTickStep);
 
-				//Check vblank stuff
-				if(m_vblankTicks <= 0)
-				{
-					m_inVblank = !m_inVblank;
-					if(m_inVblank)
-					{
-						m_vblankTicks += m_vblankTicksTotal;
-						m_ee->NotifyVBlankStart();
-						m_iop->NotifyVBlankStart();
-
-						if(m_ee->m_gs != NULL)
-						{
-#ifdef PROFILE
-							CProfilerZone profilerZone(m_gsSyncProfilerZone);
-#endif
-							m_ee->m_gs->SetVBlank();
-						}
-
-						if(m_pad != NULL)
-						{
-							m_pad->Update(m_ee->m_ram);
-						}
-#ifdef PROFILE
-						//Finish up profile
-						CProfiler::GetInstance().CountCurrentZone();
-#endif
-						OnNewFrame();
-#ifdef PROFILE
-						CProfiler::GetInstance().Reset();
-#endif
-						m_cpuUtilisation = CPU_UTILISATION_INFO();
-					}
-					else
-					{
-						m_vblankTicks += m_onScreenTicksTotal;
-						m_ee->NotifyVBlankEnd();
-						m_iop->NotifyVBlankEnd();
-						if(m_ee->m_gs != NULL)
-						{
-							m_ee->m_gs->ResetVBlank();
-						}
-						m_frameLimiter.EndFrame();
-						m_frameLimiter.BeginFrame();
-					}
-				}
+				int iopTicks = (static_cast<int>(eeTickStep) * m_iopTickStep) + m_iopExecutionTicksRemain;
+				m_iopExecutionTicksRemain = iopTicks % m_eeTickStep;
 
-				m_eeExecutionTicks += m_eeTickStep;
-				m_iopExecutionTicks += m_iopTickStep;
+				m_eeExecutionTicks += eeTickStep;
+				m_iopExecutionTicks += iopTicks / m_eeTickStep;
 
+				//When threaded, IOP runs alongside the EE, otherwise it runs in EndStep
+				m_iopThread->BeginStep();
 				UpdateEe();
-				UpdateIop();
+				m_iopThread->EndStep();
 			}
 #ifdef DEBUGGER_INCLUDED
 			if(
@@ -15,6 +15,10 @@
 #include "sound/SoundHandler.h"
 #include "FrameLimiter.h"
 #include "Profiler.h"
+#include "BlockCodeCache.h"
+#include "IopThread.h"
+#include "RewindBuffer.h"
+#include "Scheduler.h"
 
 class CPS2VM : public CVirtualMachine
 {
@@ -74,9 +78,21 @@ public:
 	static fs::path GetStateDirectoryPath();
 	fs::path GenerateStatePath(unsigned int) const;
 
+	static fs::path GetCodeCacheDirectoryPath();
+
 	std::future<bool> SaveState(const fs::path&);
 	std::future<bool> LoadState(const fs::path&);
 
+	//Goes back to the state the machine was in at the start of a recent frame (0 being the current one)
+	std::future<bool> Rewind(uint32);
+	CRewindBuffer::STATS GetRewindStats() const;
+
+	//Fixed layout states meant for frontends that save states very often (ie.: libretro).
+	//These must be called while the VM isn't running.
+	size_t GetRawStateSize();
+	bool SaveRawState(void*, size_t);
+	bool LoadRawState(const void*, size_t);
+
 	CPU_UTILISATION_INFO GetCpuUtilisationInfo() const;
 
 #ifdef DEBUGGER_INCLUDED
@@ -119,6 +135,22 @@ private:
 	bool SaveVMState(const fs::path&);
 	bool LoadVMState(const fs::path&);
 
+	void SaveRewindSnapshot();
+	bool RewindVMState(uint32);
+
+	struct VM_TIMING_STATE
+	{
+		int32 vblankTicks;
+		uint32 inVblank;
+		int32 eeExecutionTicks;
+		int32 iopExecutionTicks;
+		int64 spuUpdateTicks;
+		uint32 unitUpdateTicks;
+		uint32 unitElapsedTicks;
+	};
+
+	VM_TIMING_STATE GetVmTimingState();
+	void SetVmTimingState(const VM_TIMING_STATE&);
 	void SaveVmTimingState(Framework::CZipArchiveWriter&);
 	void LoadVmTimingState(Framework::CZipArchiveReader&);
 
@@ -143,6 +175,15 @@ private:
 	void UpdateEe();
 	void UpdateIop();
 	void UpdateSpu();
+	void FlushSpuBlock();
+
+	void HandleHBlank();
+	void HandleVBlank();
+	void HandleSpuUpdate();
+	void HandleUnitUpdate();
+	void ScheduleUnitUpdate();
+
+	uint64 SplitSpuUpdateTicks(uint64);
 
 	void SetIopOpticalMedia(COpticalMedia*);
 
@@ -161,16 +202,55 @@ private:
 	uint32 m_hblankTicksTotal = 0;
 	uint32 m_onScreenTicksTotal = 0;
 	uint32 m_vblankTicksTotal = 0;
-	int m_hblankTicks = 0;
-	int m_vblankTicks = 0;
 	bool m_inVblank = false;
-	int64 m_spuUpdateTicks = 0;
 	int64 m_spuUpdateTicksTotal = 0;
+	uint32 m_spuUpdateTicksFraction = 0;
 	int m_eeExecutionTicks = 0;
 	int m_iopExecutionTicks = 0;
+	int m_iopExecutionTicksRemain = 0;
 	static const int m_eeTickStep = 4800;
+	static const int m_eeMinTickStep = 256;
+	//EE side DMA, GIF, VIF, SIF and IPU are only updated when they have work to complete.
+	//Work that waits on something else (ie.: DMA stalled on a busy VU) is retried this often.
+	static const int m_unitRetryTicks = m_eeTickStep;
 	int m_iopTickStep = 0;
+	CScheduler m_scheduler;
+	CScheduler::EventId m_hblankEvent = 0;
+	CScheduler::EventId m_vblankEvent = 0;
+	CScheduler::EventId m_spuUpdateEvent = 0;
+	CScheduler::EventId m_unitUpdateEvent = 0;
+	uint64 m_unitUpdateTime = 0;
 	CFrameLimiter m_frameLimiter;
+	CBlockCodeCache m_blockCodeCache;
+	std::unique_ptr<CIopThread> m_iopThread;
+	uint32 m_iopThreadMaxSkew = m_eeTickStep;
+
+	enum
+	{
+		RAW_STATE_MAGIC = 0x57415250, //'PRAW'
+		RAW_STATE_VERSION = 2,
+	};
+
+	struct RAW_STATE_HEADER
+	{
+		uint32 magic;
+		uint32 version;
+	};
+
+	//Memory regions tracked by the rewind buffer
+	enum REWIND_REGION
+	{
+		REWIND_REGION_EE_RAM,
+		REWIND_REGION_IOP_RAM,
+		REWIND_REGION_SPU_RAM,
+		REWIND_REGION_GS_RAM,
+	};
+
+	bool m_rewindEnabled = false;
+	CRewindBuffer m_rewindBuffer;
+	//Reused for every snapshot to avoid allocating on each vblank
+	CRewindBuffer::StateBlob m_rewindState;
+	CRewindBuffer::STATS m_rewindStats;
 
 	CPU_UTILISATION_INFO m_cpuUtilisation;
 
@@ -191,6 +271,7 @@ private:
 
 	int16 m_samples[BLOCK_SIZE * MAX_BLOCK_COUNT];
 	int m_currentSpuBlock = 0;
+	bool m_spuThreadEnabled = false;
 	int m_spuBlockCount = 0;
 	CSoundHandler* m_soundHandler = nullptr;
 
@@ -14,6 +14,20 @@
 
 #define PREF_PS2_LIMIT_FRAMERATE ("ps2.limitframerate")
 
+#define PREF_PS2_CODECACHE_ENABLED ("ps2.codecache.enabled")
+#define PREF_PS2_EE_SUPERBLOCKS_ENABLED ("ps2.ee.superblocks.enabled")
+#define PREF_PS2_IOP_SUPERBLOCKS_ENABLED ("ps2.iop.superblocks.enabled")
+#define PREF_PS2_EE_FASTMEM_ENABLED ("ps2.ee.fastmem.enabled")
+#define PREF_PS2_EE_NATIVEFUNCTIONS_ENABLED ("ps2.ee.nativefunctions.enabled")
+
+#define PREF_PS2_IOP_THREAD_ENABLED ("ps2.iop.thread.enabled")
+#define PREF_PS2_IOP_THREAD_MAXSKEW ("ps2.iop.thread.maxskew")
+#define PREF_PS2_VU1_THREAD_ENABLED ("ps2.vu1.thread.enabled")
+
+#define PREF_PS2_REWIND_ENABLED ("ps2.rewind.enabled")
+#define PREF_PS2_REWIND_BUFFERSIZE ("ps2.rewind.buffersize")
+
 #define PREF_AUDIO_SPUBLOCKCOUNT ("audio.spublockcount")
+#define PREF_AUDIO_SPUTHREAD_ENABLED ("audio.sputhread.enabled")
 
 #define PREF_SYSTEM_LANGUAGE ("system.language")
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include "RewindBuffer.h"
+#include "xxhash.h"
+
+bool CRewindBuffer::MEMORY_REGION::operator==(const MEMORY_REGION& rhs) const
+{
+	return (memory == rhs.memory) && (size == rhs.size);
+}
+
+void CRewindBuffer::SetMemoryRegions(MemoryRegionList regions)
+{
+	if(regions == m_regions) return;
+
+	Clear();
+
+	m_regions = std::move(regions);
+	m_regionFirstPages.clear();
+	m_pageCount = 0;
+	for(const auto& region : m_regions)
+	{
+		assert((region.size % PAGE_SIZE) == 0);
+		m_regionFirstPages.push_back(m_pageCount);
+		m_pageCount += region.size / PAGE_SIZE;
+	}
+	m_pageHashes.resize(m_pageCount);
+}
+
+void CRewindBuffer::SetMaxMemoryUsage(uint64 maxMemoryUsage)
+{
+	m_maxMemoryUsage = maxMemoryUsage;
+	while((m_memoryUsage > m_maxMemoryUsage) && (m_snapshots.size() > 1))
+	{
+		DropOldestSnapshot();
+	}
+}
+
+void CRewindBuffer::Clear()
+{
+	m_snapshots.clear();
+	m_spareSnapshots.clear();
+	m_base.clear();
+	m_base.shrink_to_fit();
+	m_memoryUsage = 0;
+	m_lastDirtyPageCount = 0;
+}
+
+uint32 CRewindBuffer::GetSnapshotCount() const
+{
+	return static_cast<uint32>(m_snapshots.size());
+}
+
+CRewindBuffer::STATS CRewindBuffer::GetStats() const
+{
+	STATS stats;
+	stats.snapshotCount = GetSnapshotCount();
+	stats.memoryUsage = m_memoryUsage;
+	stats.lastDirtyPageCount = m_lastDirtyPageCount;
+	return stats;
+}
+
+void CRewindBuffer::PushSnapshot(const void* state, size_t stateSize)
+{
+	auto snapshot = AllocateSnapshot();
+	auto stateBytes = reinterpret_cast<const uint8*>(state);
+	snapshot.state.assign(stateBytes, stateBytes + stateSize);
+
+	bool isFirstSnapshot = m_snapshots.empty();
+	if(isFirstSnapshot)
+	{
+		m_base.resize(static_cast<size_t>(m_pageCount) * PAGE_SIZE);
+		m_memoryUsage += m_base.size();
+	}
+
+	uint32 dirtyPageCount = 0;
+	for(uint32 regionIndex = 0; regionIndex < m_regions.size(); regionIndex++)
+	{
+		const auto& region = m_regions[regionIndex];
+		uint32 firstPage = m_regionFirstPages[regionIndex];
+		uint32 regionPageCount = region.size / PAGE_SIZE;
+		for(uint32 i = 0; i < regionPageCount; i++)
+		{
+			uint32 pageIndex = firstPage + i;
+			const uint8* page = region.memory + (i * PAGE_SIZE);
+			uint64 pageHash = XXH3_64bits(page, PAGE_SIZE);
+			if(isFirstSnapshot)
+			{
+				memcpy(m_base.data() + (static_cast<size_t>(pageIndex) * PAGE_SIZE), page, PAGE_SIZE);
+			}
+			else if(pageHash != m_pageHashes[pageIndex])
+			{
+				snapshot.pages.push_back(pageIndex);
+				snapshot.pageData.insert(std::end(snapshot.pageData), page, page + PAGE_SIZE);
+				dirtyPageCount++;
+			}
+			m_pageHashes[pageIndex] = pageHash;
+		}
+	}
+	m_lastDirtyPageCount = dirtyPageCount;
+
+	m_memoryUsage += GetSnapshotMemoryUsage(snapshot);
+	m_snapshots.push_back(std::move(snapshot));
+
+	while((m_memoryUsage > m_maxMemoryUsage) && (m_snapshots.size() > 1))
+	{
+		DropOldestSnapshot();
+	}
+}
+
+bool CRewindBuffer::Restore(uint32 stepsBack, StateBlob& state, const PageRestoredHandler& pageRestoredHandler)
+{
+	if(stepsBack >= m_snapshots.size()) return false;
+	uint32 targetIndex = static_cast<uint32>(m_snapshots.size()) - stepsBack - 1;
+
+	//Pages to restore are those changed by newer snapshots and those changed since the last snapshot
+	std::vector<bool> restorePages(m_pageCount, false);
+	for(uint32 snapshotIndex = targetIndex + 1; snapshotIndex < m_snapshots.size(); snapshotIndex++)
+	{
+		for(auto pageIndex : m_snapshots[snapshotIndex].pages)
+		{
+			restorePages[pageIndex] = true;
+		}
+	}
+	for(uint32 pageIndex = 0; pageIndex < m_pageCount; pageIndex++)
+	{
+		if(restorePages[pageIndex]) continue;
+		uint32 regionIndex = 0;
+		uint32 regionOffset = 0;
+		const uint8* page = GetPagePointer(pageIndex, regionIndex, regionOffset);
+		if(XXH3_64bits(page, PAGE_SIZE) != m_pageHashes[pageIndex])
+		{
+			restorePages[pageIndex] = true;
+		}
+	}
+
+	for(uint32 pageIndex = 0; pageIndex < m_pageCount; pageIndex++)
+	{
+		if(!restorePages[pageIndex]) continue;
+		uint32 regionIndex = 0;
+		uint32 regionOffset = 0;
+		uint8* page = GetPagePointer(pageIndex, regionIndex, regionOffset);
+		const uint8* pageData = FindPageData(targetIndex, pageIndex);
+		memcpy(page, pageData, PAGE_SIZE);
+		m_pageHashes[pageIndex] = XXH3_64bits(pageData, PAGE_SIZE);
+		if(pageRestoredHandler)
+		{
+			pageRestoredHandler(regionIndex, regionOffset);
+		}
+	}
+
+	state = m_snapshots[targetIndex].state;
+
+	//Target snapshot becomes the newest one
+	while(m_snapshots.size() > (targetIndex + 1))
+	{
+		m_memoryUsage -= GetSnapshotMemoryUsage(m_snapshots.back());
+		RecycleSnapshot(std::move(m_snapshots.back()));
+		m_snapshots.pop_back();
+	}
+
+	return true;
+}
+
+uint64 CRewindBuffer::GetSnapshotMemoryUsage(const SNAPSHOT& snapshot)
+{
+	return snapshot.state.size() + (snapshot.pages.size() * sizeof(uint32)) + snapshot.pageData.size();
+}
+
+uint8* CRewindBuffer::GetPagePointer(uint32 pageIndex, uint32& regionIndex, uint32& regionOffset) const
+{
+	assert(pageIndex < m_pageCount);
+	auto regionIterator = std::upper_bound(std::begin(m_regionFirstPages), std::end(m_regionFirstPages), pageIndex);
+	assert(regionIterator != std::begin(m_regionFirstPages));
+	regionIndex = static_cast<uint32>(std::distance(std::begin(m_regionFirstPages), regionIterator) - 1);
+	regionOffset = (pageIndex - m_regionFirstPages[regionIndex]) * PAGE_SIZE;
+	return m_regions[regionIndex].memory + regionOffset;
+}
+
+const uint8* CRewindBuffer::FindPageData(uint32 snapshotIndex, uint32 pageIndex) const
+{
+	//Look for the most recent version of the page at or before the snapshot.
+	//The oldest snapshot has no pages, its memory contents are in the base image.
+	for(uint32 i = snapshotIndex; i != 0; i--)
+	{
+		const auto& snapshot = m_snapshots[i];
+		auto pageIterator = std::lower_bound(std::begin(snapshot.pages), std::end(snapshot.pages), pageIndex);
+		if((pageIterator != std::end(snapshot.pages)) && (*pageIterator == pageIndex))
+		{
+			size_t pagePosition = std::distance(std::begin(snapshot.pages), pageIterator);
+			return snapshot.pageData.data() + (pagePosition * PAGE_SIZE);
+		}
+	}
+	return m_base.data() + (static_cast<size_t>(pageIndex) * PAGE_SIZE);
+}
+
+CRewindBuffer::SNAPSHOT CRewindBuffer::AllocateSnapshot()
+{
+	if(m_spareSnapshots.empty())
+	{
+		return SNAPSHOT();
+	}
+	auto snapshot = std::move(m_spareSnapshots.back());
+	m_spareSnapshots.pop_back();
+	return snapshot;
+}
+
+void CRewindBuffer::RecycleSnapshot(SNAPSHOT&& snapshot)
+{
+	//Keep a few around to reuse their buffers instead of allocating new ones for every snapshot
+	if(m_spareSnapshots.size() >= MAX_SPARE_SNAPSHOTS) return;
+	snapshot.state.clear();
+	snapshot.pages.clear();
+	snapshot.pageData.clear();
+	m_spareSnapshots.push_back(std::move(snapshot));
+}
+
+void CRewindBuffer::DropOldestSnapshot()
+{
+	assert(m_snapshots.size() > 1);
+
+	//Fold the pages of the second oldest snapshot into the base image, it then becomes the oldest one
+	auto& nextSnapshot = m_snapshots[1];
+	for(uint32 i = 0; i < nextSnapshot.pages.size(); i++)
+	{
+		uint32 pageIndex = nextSnapshot.pages[i];
+		memcpy(m_base.data() + (static_cast<size_t>(pageIndex) * PAGE_SIZE), nextSnapshot.pageData.data() + (i * PAGE_SIZE), PAGE_SIZE);
+	}
+	m_memoryUsage -= GetSnapshotMemoryUsage(nextSnapshot);
+	nextSnapshot.pages.clear();
+	nextSnapshot.pages.shrink_to_fit();
+	nextSnapshot.pageData.clear();
+	nextSnapshot.pageData.shrink_to_fit();
+	m_memoryUsage += GetSnapshotMemoryUsage(nextSnapshot);
+
+	m_memoryUsage -= GetSnapshotMemoryUsage(m_snapshots.front());
+	RecycleSnapshot(std::move(m_snapshots.front()));
+	m_snapshots.pop_front();
+}
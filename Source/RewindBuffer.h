@@ -0,0 +1,95 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <vector>
+#include "Types.h"
+
+//Keeps a history of recent machine states in memory. Large memory regions are tracked
+//page by page and a snapshot only stores the pages that changed since the previous one.
+//Everything else is stored in an opaque blob supplied by the caller.
+class CRewindBuffer
+{
+public:
+	enum
+	{
+		PAGE_SIZE = 0x1000,
+	};
+
+	enum : uint64
+	{
+		DEFAULT_MAX_MEMORY_USAGE = 256 * 1024 * 1024,
+	};
+
+	struct MEMORY_REGION
+	{
+		uint8* memory = nullptr;
+		uint32 size = 0;
+
+		bool operator==(const MEMORY_REGION&) const;
+	};
+	typedef std::vector<MEMORY_REGION> MemoryRegionList;
+	typedef std::vector<uint8> StateBlob;
+
+	//Called with region index and offset in region for every page written by Restore
+	typedef std::function<void(uint32, uint32)> PageRestoredHandler;
+
+	struct STATS
+	{
+		uint32 snapshotCount = 0;
+		uint64 memoryUsage = 0;
+		uint32 lastDirtyPageCount = 0;
+	};
+
+	CRewindBuffer() = default;
+	CRewindBuffer(const CRewindBuffer&) = delete;
+
+	CRewindBuffer& operator=(const CRewindBuffer&) = delete;
+
+	void SetMemoryRegions(MemoryRegionList);
+	void SetMaxMemoryUsage(uint64);
+	void Clear();
+
+	uint32 GetSnapshotCount() const;
+	STATS GetStats() const;
+
+	void PushSnapshot(const void*, size_t);
+	bool Restore(uint32, StateBlob&, const PageRestoredHandler&);
+
+private:
+	enum
+	{
+		MAX_SPARE_SNAPSHOTS = 2,
+	};
+
+	struct SNAPSHOT
+	{
+		StateBlob state;
+		std::vector<uint32> pages;
+		std::vector<uint8> pageData;
+	};
+
+	static uint64 GetSnapshotMemoryUsage(const SNAPSHOT&);
+
+	uint8* GetPagePointer(uint32, uint32&, uint32&) const;
+	const uint8* FindPageData(uint32, uint32) const;
+
+	SNAPSHOT AllocateSnapshot();
+	void RecycleSnapshot(SNAPSHOT&&);
+	void DropOldestSnapshot();
+
+	MemoryRegionList m_regions;
+	std::vector<uint32> m_regionFirstPages;
+	uint32 m_pageCount = 0;
+	std::vector<uint64> m_pageHashes;
+
+	//Contents of the memory regions at the time of the oldest snapshot
+	std::vector<uint8> m_base;
+
+	std::deque<SNAPSHOT> m_snapshots;
+	std::vector<SNAPSHOT> m_spareSnapshots;
+	uint64 m_maxMemoryUsage = DEFAULT_MAX_MEMORY_USAGE;
+	//Base image and snapshots, checked against the maximum memory usage
+	uint64 m_memoryUsage = 0;
+	uint32 m_lastDirtyPageCount = 0;
+};
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cassert>
+#include "Scheduler.h"
+
+CScheduler::EventId CScheduler::RegisterEvent(EventHandler handler)
+{
+	EVENT event;
+	event.handler = std::move(handler);
+	m_events.push_back(std::move(event));
+	return static_cast<EventId>(m_events.size() - 1);
+}
+
+void CScheduler::Reset()
+{
+	for(auto& event : m_events)
+	{
+		event.dueTime = 0;
+		event.generation++;
+		event.scheduled = false;
+	}
+	m_pendingEvents.clear();
+	m_currentTime = 0;
+	m_sequence = 0;
+}
+
+void CScheduler::Schedule(EventId id, uint64 delay)
+{
+	ScheduleAt(id, m_currentTime + delay);
+}
+
+void CScheduler::ScheduleNext(EventId id, uint64 period)
+{
+	assert(id < m_events.size());
+	ScheduleAt(id, m_events[id].dueTime + period);
+}
+
+void CScheduler::Cancel(EventId id)
+{
+	assert(id < m_events.size());
+	auto& event = m_events[id];
+	event.generation++;
+	event.scheduled = false;
+	DiscardStaleEvents();
+}
+
+bool CScheduler::IsScheduled(EventId id) const
+{
+	assert(id < m_events.size());
+	return m_events[id].scheduled;
+}
+
+uint64 CScheduler::GetTicksUntil(EventId id) const
+{
+	assert(id < m_events.size());
+	const auto& event = m_events[id];
+	assert(event.scheduled);
+	return (event.dueTime > m_currentTime) ? (event.dueTime - m_currentTime) : 0;
+}
+
+uint64 CScheduler::GetTicksUntilNextEvent(uint64 maxTicks) const
+{
+	if(m_pendingEvents.empty()) return maxTicks;
+	uint64 dueTime = m_pendingEvents.front().dueTime;
+	uint64 ticks = (dueTime > m_currentTime) ? (dueTime - m_currentTime) : 0;
+	return std::min(ticks, maxTicks);
+}
+
+uint64 CScheduler::GetCurrentTime() const
+{
+	return m_currentTime;
+}
+
+void CScheduler::Advance(uint64 ticks)
+{
+	m_currentTime += ticks;
+}
+
+void CScheduler::ProcessEvents()
+{
+	while(!m_pendingEvents.empty())
+	{
+		const auto& pendingEvent = m_pendingEvents.front();
+		if(pendingEvent.dueTime > m_currentTime) break;
+
+		EventId id = pendingEvent.id;
+		std::pop_heap(m_pendingEvents.begin(), m_pendingEvents.end(), std::greater<PENDING_EVENT>());
+		m_pendingEvents.pop_back();
+
+		//Handler can schedule events, including the one being handled
+		auto& event = m_events[id];
+		event.scheduled = false;
+		event.handler();
+
+		DiscardStaleEvents();
+	}
+}
+
+void CScheduler::ScheduleAt(EventId id, uint64 dueTime)
+{
+	assert(id < m_events.size());
+	auto& event = m_events[id];
+	event.generation++;
+	event.dueTime = dueTime;
+	event.scheduled = true;
+
+	PENDING_EVENT pendingEvent;
+	pendingEvent.dueTime = dueTime;
+	pendingEvent.sequence = m_sequence++;
+	pendingEvent.id = id;
+	pendingEvent.generation = event.generation;
+	m_pendingEvents.push_back(pendingEvent);
+	std::push_heap(m_pendingEvents.begin(), m_pendingEvents.end(), std::greater<PENDING_EVENT>());
+
+	DiscardStaleEvents();
+}
+
+void CScheduler::DiscardStaleEvents()
+{
+	//Rescheduled or cancelled events leave entries behind, only the top one matters
+	while(!m_pendingEvents.empty())
+	{
+		const auto& pendingEvent = m_pendingEvents.front();
+		if(pendingEvent.generation == m_events[pendingEvent.id].generation) break;
+		std::pop_heap(m_pendingEvents.begin(), m_pendingEvents.end(), std::greater<PENDING_EVENT>());
+		m_pendingEvents.pop_back();
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include "Types.h"
+
+//Keeps track of events that need to happen at a specific time (in EE ticks). Lets the
+//emulation loop size CPU execution slices to the next due event instead of polling.
+class CScheduler
+{
+public:
+	typedef uint32 EventId;
+	typedef std::function<void()> EventHandler;
+
+	EventId RegisterEvent(EventHandler);
+
+	//Removes all pending events and sets current time back to 0
+	void Reset();
+
+	//Schedules an event relative to current time
+	void Schedule(EventId, uint64);
+
+	//Schedules an event relative to its previous due time, prevents drift of periodic events
+	void ScheduleNext(EventId, uint64);
+
+	void Cancel(EventId);
+
+	bool IsScheduled(EventId) const;
+	uint64 GetTicksUntil(EventId) const;
+	uint64 GetTicksUntilNextEvent(uint64) const;
+	uint64 GetCurrentTime() const;
+
+	void Advance(uint64);
+
+	//Runs handlers of all events that are due, in due time order
+	void ProcessEvents();
+
+private:
+	struct EVENT
+	{
+		EventHandler handler;
+		uint64 dueTime = 0;
+		uint32 generation = 0;
+		bool scheduled = false;
+	};
+
+	struct PENDING_EVENT
+	{
+		uint64 dueTime = 0;
+		uint64 sequence = 0;
+		EventId id = 0;
+		uint32 generation = 0;
+
+		bool operator>(const PENDING_EVENT& rhs) const
+		{
+			return (dueTime != rhs.dueTime) ? (dueTime > rhs.dueTime) : (sequence > rhs.sequence);
+		}
+	};
+
+	void ScheduleAt(EventId, uint64);
+	void DiscardStaleEvents();
+
+	std::vector<EVENT> m_events;
+	std::vector<PENDING_EVENT> m_pendingEvents;
+	uint64 m_currentTime = 0;
+	uint64 m_sequence = 0;
+};
@@ -165,6 +165,28 @@ void CDMAC::SetChannelTransferFunction(unsigned int channel, const DmaReceiveHan
 	}
 }
 
+void CDMAC::SetChannelDrainedFunction(unsigned int channel, const DmaDrainedHandler& handler)
+{
+	switch(channel)
+	{
+	case 0:
+		m_D0.SetDrainedHandler(handler);
+		break;
+	case 1:
+		m_D1.SetDrainedHandler(handler);
+		break;
+	case 2:
+		m_D2.SetDrainedHandler(handler);
+		break;
+	case 4:
+		m_D4.SetDrainedHandler(handler);
+		break;
+	default:
+		throw std::runtime_error("Unsupported channel.");
+		break;
+	}
+}
+
 bool CDMAC::IsInterruptPending() const
 {
 	uint16 mask = static_cast<uint16>((m_D_STAT & 0x63FF0000) >> 16);
@@ -249,6 +271,12 @@ bool CDMAC::IsDMA4Started() const
 	return (m_D4.m_CHCR.nSTR != 0) && ((m_D_ENABLE & CDMAC::ENABLE_CPND) == 0);
 }
 
+bool CDMAC::IsResumePending() const
+{
+	return (m_D0.m_CHCR.nSTR != 0) || (m_D1.m_CHCR.nSTR != 0) || (m_D2.m_CHCR.nSTR != 0) ||
+	       (m_D8.m_CHCR.nSTR != 0) || (m_D9.m_CHCR.nSTR != 0) || IsDMA4Started();
+}
+
 uint64 CDMAC::FetchDMATag(uint32 address)
 {
 	if(address & 0x80000000)
@@ -1061,6 +1089,80 @@ void CDMAC::SaveState(Framework::CZipArchiveWriter& archive)
 	m_D9.SaveState(archive);
 }
 
+size_t CDMAC::GetRawStateSize() const
+{
+	return sizeof(m_D_CTRL) + sizeof(m_D_STAT) + sizeof(m_D_ENABLE) + sizeof(m_D_PCR) +
+	       sizeof(m_D_SQWC) + sizeof(m_D_RBSR) + sizeof(m_D_RBOR) + sizeof(m_D_STADR) +
+	       sizeof(m_D3_CHCR) + sizeof(m_D3_MADR) + sizeof(m_D3_QWC) +
+	       sizeof(m_D5_CHCR) + sizeof(m_D5_MADR) + sizeof(m_D5_QWC) +
+	       sizeof(m_D6_CHCR) + sizeof(m_D6_MADR) + sizeof(m_D6_QWC) + sizeof(m_D6_TADR) +
+	       sizeof(m_D8_SADR) + sizeof(m_D9_SADR) +
+	       m_D0.GetRawStateSize() + m_D1.GetRawStateSize() + m_D2.GetRawStateSize() +
+	       m_D4.GetRawStateSize() + m_D8.GetRawStateSize() + m_D9.GetRawStateSize();
+}
+
+void CDMAC::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_D_CTRL);
+	reader.Read(m_D_STAT);
+	reader.Read(m_D_ENABLE);
+	reader.Read(m_D_PCR);
+	reader.Read(m_D_SQWC);
+	reader.Read(m_D_RBSR);
+	reader.Read(m_D_RBOR);
+	reader.Read(m_D_STADR);
+	reader.Read(m_D3_CHCR);
+	reader.Read(m_D3_MADR);
+	reader.Read(m_D3_QWC);
+	reader.Read(m_D5_CHCR);
+	reader.Read(m_D5_MADR);
+	reader.Read(m_D5_QWC);
+	reader.Read(m_D6_CHCR);
+	reader.Read(m_D6_MADR);
+	reader.Read(m_D6_QWC);
+	reader.Read(m_D6_TADR);
+	reader.Read(m_D8_SADR);
+	reader.Read(m_D9_SADR);
+
+	m_D0.LoadRawState(reader);
+	m_D1.LoadRawState(reader);
+	m_D2.LoadRawState(reader);
+	m_D4.LoadRawState(reader);
+	m_D8.LoadRawState(reader);
+	m_D9.LoadRawState(reader);
+}
+
+void CDMAC::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_D_CTRL);
+	writer.Write(m_D_STAT);
+	writer.Write(m_D_ENABLE);
+	writer.Write(m_D_PCR);
+	writer.Write(m_D_SQWC);
+	writer.Write(m_D_RBSR);
+	writer.Write(m_D_RBOR);
+	writer.Write(m_D_STADR);
+	writer.Write(m_D3_CHCR);
+	writer.Write(m_D3_MADR);
+	writer.Write(m_D3_QWC);
+	writer.Write(m_D5_CHCR);
+	writer.Write(m_D5_MADR);
+	writer.Write(m_D5_QWC);
+	writer.Write(m_D6_CHCR);
+	writer.Write(m_D6_MADR);
+	writer.Write(m_D6_QWC);
+	writer.Write(m_D6_TADR);
+	writer.Write(m_D8_SADR);
+	writer.Write(m_D9_SADR);
+
+	m_D0.SaveRawState(writer);
+	m_D1.SaveRawState(writer);
+	m_D2.SaveRawState(writer);
+	m_D4.SaveRawState(writer);
+	m_D8.SaveRawState(writer);
+	m_D9.SaveRawState(writer);
+}
+
 void CDMAC::UpdateCpCond()
 {
 	static const uint32 mask = 0x3FF;
@@ -3,6 +3,7 @@
 #include "Types.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 #include "Dmac_Channel.h"
 
 class CMIPS;
@@ -113,6 +114,7 @@ public:
 	void Reset();
 
 	void SetChannelTransferFunction(unsigned int, const Dmac::DmaReceiveHandler&);
+	void SetChannelDrainedFunction(unsigned int, const Dmac::DmaDrainedHandler&);
 
 	uint32 GetRegister(uint32);
 	void SetRegister(uint32, uint32);
@@ -120,6 +122,10 @@ public:
 	void LoadState(Framework::CZipArchiveReader&);
 	void SaveState(Framework::CZipArchiveWriter&);
 
+	size_t GetRawStateSize() const;
+	void LoadRawState(CRawStateReader&);
+	void SaveRawState(CRawStateWriter&);
+
 	void DisassembleGet(uint32);
 	void DisassembleSet(uint32, uint32);
 
@@ -132,6 +138,8 @@ public:
 	void ResumeDMA8();
 	void ResumeDMA9();
 	bool IsDMA4Started() const;
+	//Started channels that need to be resumed once their destination can take more data
+	bool IsResumePending() const;
 	static bool IsEndSrcTagId(uint32);
 	static bool IsEndDstTagId(uint32);
 
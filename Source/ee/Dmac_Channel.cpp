@@ -67,6 +67,31 @@ void CChannel::LoadState(Framework::CZipArchiveReader& archive)
 	m_nASR[1] = registerFile.GetRegister32(STATE_REGS_ASR1);
 }
 
+size_t CChannel::GetRawStateSize() const
+{
+	return sizeof(m_CHCR) + sizeof(m_nMADR) + sizeof(m_nQWC) + sizeof(m_nTADR) + sizeof(m_nSCCTRL) + sizeof(m_nASR);
+}
+
+void CChannel::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_CHCR);
+	writer.Write(m_nMADR);
+	writer.Write(m_nQWC);
+	writer.Write(m_nTADR);
+	writer.Write(m_nSCCTRL);
+	writer.Write(m_nASR);
+}
+
+void CChannel::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_CHCR);
+	reader.Read(m_nMADR);
+	reader.Read(m_nQWC);
+	reader.Read(m_nTADR);
+	reader.Read(m_nSCCTRL);
+	reader.Read(m_nASR);
+}
+
 uint32 CChannel::ReadCHCR()
 {
 	return m_CHCR;
@@ -91,6 +116,11 @@ void CChannel::WriteCHCR(uint32 nValue)
 		m_CHCR = *(CHCR*)&nValue;
 	}
 
+	if(m_CHCR.nSTR == 0)
+	{
+		m_nSCCTRL &= ~SCCTRL_COMPLETEPENDING;
+	}
+
 	if(m_CHCR.nSTR != 0)
 	{
 		if(m_nQWC == 0)
@@ -110,6 +140,12 @@ void CChannel::Execute()
 		{
 			return;
 		}
+		if(m_nSCCTRL & SCCTRL_COMPLETEPENDING)
+		{
+			//Everything was transferred, waiting for the receiver to be done with it
+			ClearSTR();
+			return;
+		}
 		switch(m_CHCR.nMOD)
 		{
 		case 0x00:
@@ -294,7 +330,7 @@ void CChannel::ExecuteSourceChain()
 		}
 	}
 
-	while(m_CHCR.nSTR == 1)
+	while((m_CHCR.nSTR == 1) && !(m_nSCCTRL & SCCTRL_COMPLETEPENDING))
 	{
 		//Check if MFIFO is enabled with this channel
 		if(isMfifo)
@@ -461,7 +497,7 @@ void CChannel::ExecuteDestinationChain()
 {
 	assert(m_number == CDMAC::CHANNEL_ID_FROM_SPR);
 
-	while(m_CHCR.nSTR == 1)
+	while((m_CHCR.nSTR == 1) && !(m_nSCCTRL & SCCTRL_COMPLETEPENDING))
 	{
 		//QWC is 0, fetch a new tag
 		//Some games don't reset the TAG value in CHCR and start a transfer that looks like a normal transfer
@@ -561,8 +597,20 @@ void CChannel::ExecuteSourceChainTransfer(bool isMfifo)
 	}
 }
 
+void CChannel::SetDrainedHandler(const DmaDrainedHandler& handler)
+{
+	m_drained = handler;
+}
+
 void CChannel::ClearSTR()
 {
+	if(m_drained && !m_drained())
+	{
+		m_nSCCTRL |= SCCTRL_COMPLETEPENDING;
+		return;
+	}
+	m_nSCCTRL &= ~SCCTRL_COMPLETEPENDING;
+
 	m_CHCR.nSTR = ~m_CHCR.nSTR;
 
 	//Set interrupt
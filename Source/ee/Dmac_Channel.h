@@ -5,12 +5,15 @@
 #include "Convertible.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 
 class CDMAC;
 
 namespace Dmac
 {
 	typedef std::function<uint32(uint32, uint32, uint32, bool)> DmaReceiveHandler;
+	//Returns true once the receiver is done with everything it accepted
+	typedef std::function<bool()> DmaDrainedHandler;
 
 	class CChannel
 	{
@@ -70,6 +73,10 @@ namespace Dmac
 		void SaveState(Framework::CZipArchiveWriter&);
 		void LoadState(Framework::CZipArchiveReader&);
 
+		size_t GetRawStateSize() const;
+		void SaveRawState(CRawStateWriter&);
+		void LoadRawState(CRawStateReader&);
+
 		void Reset();
 		uint32 ReadCHCR();
 		void WriteCHCR(uint32);
@@ -79,6 +86,7 @@ namespace Dmac
 		void ExecuteSourceChain();
 		void ExecuteDestinationChain();
 		void SetReceiveHandler(const DmaReceiveHandler&);
+		void SetDrainedHandler(const DmaDrainedHandler&);
 
 		CHCR m_CHCR;
 		uint32 m_nMADR;
@@ -91,6 +99,7 @@ namespace Dmac
 		{
 			SCCTRL_RETTOP = 0x001,
 			SCCTRL_INITXFER = 0x200,
+			SCCTRL_COMPLETEPENDING = 0x400,
 		};
 
 		void ExecuteSourceChainTransfer(bool);
@@ -99,6 +108,7 @@ namespace Dmac
 		CDMAC& m_dmac;
 		unsigned int m_number = 0;
 		DmaReceiveHandler m_receive;
+		DmaDrainedHandler m_drained;
 		uint32 m_nSCCTRL;
 	};
 };
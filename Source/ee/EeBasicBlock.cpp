@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include "EeBasicBlock.h"
+#include "EeExecutor.h"
 #include "offsetof_def.h"
 
 void CEeBasicBlock::SetFpRoundingMode(Jitter::CJitter::ROUNDINGMODE fpRoundingMode)
@@ -11,8 +15,64 @@ void CEeBasicBlock::SetIsIdleLoopBlock()
 	m_isIdleLoopBlock = true;
 }
 
+void CEeBasicBlock::SetNativeFunction(NativeFunction nativeFunction)
+{
+	m_nativeFunction = nativeFunction;
+}
+
+void CEeBasicBlock::SetSourceCheck(const uint8* source)
+{
+	uint32 blockSize = (m_end - m_begin) + 4;
+	m_source = source;
+	m_sourceSnapshot.assign(source, source + blockSize);
+}
+
+bool CEeBasicBlock::GetModifiedSourceRange(uint32& start, uint32& end) const
+{
+	assert(m_source);
+	if(memcmp(m_source, m_sourceSnapshot.data(), m_sourceSnapshot.size()) == 0) return false;
+
+	//Report modified lines only, blocks in the other lines of the page are still good
+	bool modified = false;
+	uint32 lineStart = m_begin & ~(SOURCE_CHECK_LINE_SIZE - 1);
+	for(uint32 lineAddress = lineStart; lineAddress <= m_end; lineAddress += SOURCE_CHECK_LINE_SIZE)
+	{
+		uint32 compareStart = std::max(lineAddress, m_begin);
+		uint32 compareEnd = std::min(lineAddress + SOURCE_CHECK_LINE_SIZE, m_end + 4);
+		uint32 offset = compareStart - m_begin;
+		if(memcmp(m_source + offset, m_sourceSnapshot.data() + offset, compareEnd - compareStart) == 0) continue;
+		if(!modified)
+		{
+			start = lineAddress;
+			modified = true;
+		}
+		end = lineAddress + SOURCE_CHECK_LINE_SIZE;
+	}
+	assert(modified);
+	return modified;
+}
+
 void CEeBasicBlock::CompileProlog(CMipsJitter* jitter)
 {
+	if(m_source)
+	{
+		CompileSourceCheck(jitter);
+	}
+
+	if(m_nativeFunction)
+	{
+		//Leave the block right away if the native function could handle the call
+		jitter->PushCtx();
+		jitter->Call(reinterpret_cast<void*>(m_nativeFunction), 1, Jitter::CJitter::RETURN_VALUE_32);
+
+		jitter->PushCst(0);
+		jitter->BeginIf(Jitter::CONDITION_NE);
+		{
+			jitter->JumpTo(reinterpret_cast<void*>(&NativeFunctionHandled));
+		}
+		jitter->EndIf();
+	}
+
 	if(m_fpRoundingMode != DEFAULT_FP_ROUNDING_MODE)
 	{
 		jitter->FP_SetRoundingMode(m_fpRoundingMode);
@@ -27,7 +87,8 @@ void CEeBasicBlock::CompileEpilog(CMipsJitter* jitter, bool loopsOnItself)
 		jitter->FP_SetRoundingMode(DEFAULT_FP_ROUNDING_MODE);
 	}
 
-	if(m_isIdleLoopBlock || IsCodeIdleLoopBlock())
+	//Blocks found by the idle loop analysis are already handled by the base class
+	if(m_isIdleLoopBlock && !IsIdleLoop())
 	{
 		jitter->PushCst(MIPS_EXCEPTION_IDLE);
 		jitter->PullRel(offsetof(CMIPS, m_State.nHasException));
@@ -36,137 +97,63 @@ void CEeBasicBlock::CompileEpilog(CMipsJitter* jitter, bool loopsOnItself)
 	CBasicBlock::CompileEpilog(jitter, loopsOnItself);
 }
 
-bool CEeBasicBlock::IsCodeIdleLoopBlock() const
+//Compares each word of our code with the opcode it was compiled from, any difference leaves bits
+//set in the accumulated value. Executor is only involved when something changed.
+void CEeBasicBlock::CompileSourceCheck(CMipsJitter* jitter)
 {
-	enum OP
+	for(uint32 offset = 0; offset < m_sourceSnapshot.size(); offset += 4)
 	{
-		OP_BEQ = 0x04,
-		OP_BNE = 0x05,
-		OP_ADDIU = 0x09,
-		OP_SLTIU = 0x0B,
-		OP_ANDI = 0x0C,
-		OP_XORI = 0x0E,
-		OP_LUI = 0x0F,
-		OP_LQ = 0x1E,
-		OP_LW = 0x23,
-		OP_LBU = 0x24,
-	};
-
-	enum
-	{
-		OP_SPECIAL_SLL = 0x00,
-		OP_SPECIAL_ADDU = 0x21,
-		OP_SPECIAL_SLT = 0x2A,
-		OP_SPECIAL_SLTU = 0x2B,
-		OP_SPECIAL_DSLL32 = 0x3C,
-		OP_SPECIAL_DSRL32 = 0x3E,
-	};
-
-	uint32 endInstructionAddress = m_end - 4;
-	uint32 endInstruction = m_context.m_pMemoryMap->GetWord(endInstructionAddress);
-
-	//We need a branch at the end of the block
-	auto branchType = m_context.m_pArch->IsInstructionBranch(&m_context, endInstructionAddress, endInstruction);
-	if(branchType != MIPS_BRANCH_NORMAL) return false;
-
-	//Check that the branch target is ourself
-	uint32 branchTarget = m_context.m_pArch->GetInstructionEffectiveAddress(&m_context, endInstructionAddress, endInstruction);
-	if(branchTarget == MIPS_INVALID_PC) return false;
-	if(branchTarget != m_begin) return false;
-
-	uint32 compareRs = 0;
-	uint32 compareRt = 0;
-
-	//Check what kind of branching instruction we have.
-	{
-		uint32 op = (endInstruction >> 26) & 0x3F;
-		uint32 rt = (endInstruction >> 16) & 0x1F;
-		uint32 rs = (endInstruction >> 21) & 0x1F;
-
-		//We want a BEQ or BNE
-		if((op != OP_BEQ) && (op != OP_BNE)) return false;
-
-		compareRs = rs;
-		compareRt = rt;
-	}
-
-	uint32 defState = 0; //Set of completely new definitions of registers within this block
-	uint32 useState = 0; //Set of previous state usage within this block
-
-	//Check all instructions inside to see if we can prove it's waiting for some kind of flag
-	for(uint32 address = m_begin; address <= m_end; address += 4)
-	{
-		//Don't check branch instruction as we've checked it already
-		if(address == endInstructionAddress) continue;
-
-		uint32 inst = m_context.m_pMemoryMap->GetWord(address);
-		if(inst == 0) continue;
-		uint32 special = inst & 0x3F;
-		uint32 rd = (inst >> 11) & 0x1F;
-		uint32 rt = (inst >> 16) & 0x1F;
-		uint32 rs = (inst >> 21) & 0x1F;
-		uint32 op = (inst >> 26) & 0x3F;
-
-		uint32 newDef = 0;
-		uint32 newUse = 0;
-
-		switch(op)
+		uint32 opcode = 0;
+		memcpy(&opcode, m_sourceSnapshot.data() + offset, sizeof(uint32));
+
+		jitter->PushCstPtr(reinterpret_cast<uintptr_t>(m_source + offset));
+		jitter->LoadFromRef();
+		jitter->PushCst(opcode);
+		jitter->Xor();
+		if(offset != 0)
 		{
-		case 0x00:
-			switch(special)
-			{
-			case OP_SPECIAL_SLL:
-			case OP_SPECIAL_DSLL32:
-			case OP_SPECIAL_DSRL32:
-				newUse = (1 << rt);
-				newDef = (1 << rd);
-				break;
-			case OP_SPECIAL_ADDU:
-			case OP_SPECIAL_SLT:
-			case OP_SPECIAL_SLTU:
-				newUse = (1 << rs) | (1 << rt);
-				newDef = (1 << rd);
-				break;
-			default:
-				//We don't know what this does, let's not take a chance
-				return false;
-			}
-			break;
-		case OP_LUI:
-			newDef = (1 << rt);
-			break;
-		case OP_LW:
-		case OP_LQ:
-		case OP_LBU:
-		case OP_ADDIU:
-		case OP_SLTIU:
-		case OP_XORI:
-			newUse = (1 << rs);
-			newDef = (1 << rt);
-			break;
-		default:
-			//We don't know what this does, let's not take a chance
-			return false;
+			jitter->Or();
 		}
+	}
 
-		//Remove uses from defs within this block
-		newUse &= ~defState;
-		useState |= newUse;
+	jitter->PushCst(0);
+	jitter->BeginIf(Jitter::CONDITION_NE);
+	{
+		//Leave the block right away if its code changed, executor will throw it away
+		jitter->PushCtx();
+		jitter->Call(reinterpret_cast<void*>(&CheckSource), 1, Jitter::CJitter::RETURN_VALUE_32);
 
-		//Bail if this defines any state that we previously used
-		if(useState & newDef)
+		jitter->PushCst(0);
+		jitter->BeginIf(Jitter::CONDITION_NE);
 		{
-			return false;
+			jitter->JumpTo(reinterpret_cast<void*>(&SourceModified));
 		}
-
-		defState |= newDef;
+		jitter->EndIf();
 	}
+	jitter->EndIf();
+}
 
-	//Just make sure that we've at least defined our comparision register
-	FRAMEWORK_MAYBE_UNUSED bool compareRsDefined = defState & (1 << compareRs);
-	FRAMEWORK_MAYBE_UNUSED bool compareRtDefined = defState & (1 << compareRt);
+bool CEeBasicBlock::IsCodeCacheable() const
+{
+	//Per-block overrides come from the game config and aren't part of the cache key
+	return CBasicBlock::IsCodeCacheable() &&
+	       (m_fpRoundingMode == DEFAULT_FP_ROUNDING_MODE) &&
+	       !m_isIdleLoopBlock &&
+	       !m_nativeFunction &&
+	       !m_source;
+}
 
-	assert(compareRsDefined || compareRtDefined);
+void CEeBasicBlock::NativeFunctionHandled(CMIPS*)
+{
+	//Native function already updated the context, nothing else to do
+}
 
-	return true;
+uint32 CEeBasicBlock::CheckSource(CMIPS* context)
+{
+	return static_cast<CEeExecutor*>(context->m_executor.get())->CheckBlockSource();
+}
+
+void CEeBasicBlock::SourceModified(CMIPS*)
+{
+	//PC still points to the beginning of the block, it will be compiled again
 }
@@ -1,24 +1,44 @@
 #pragma once
 
+#include <vector>
 #include "BasicBlock.h"
 
 class CEeBasicBlock : public CBasicBlock
 {
 public:
+	//Returns 0 if guest code needs to run, otherwise, function took care of returning to the caller
+	typedef uint32 (*NativeFunction)(CMIPS*);
+
 	using CBasicBlock::CBasicBlock;
 
 	void SetFpRoundingMode(Jitter::CJitter::ROUNDINGMODE);
 	void SetIsIdleLoopBlock();
+	void SetNativeFunction(NativeFunction);
+
+	//Block compares its code with a snapshot when entered instead of relying on memory protection
+	void SetSourceCheck(const uint8*);
+	bool GetModifiedSourceRange(uint32&, uint32&) const;
+
+	static constexpr uint32 SOURCE_CHECK_LINE_SIZE = 0x40;
 
 protected:
 	void CompileProlog(CMipsJitter*) override;
 	void CompileEpilog(CMipsJitter*, bool) override;
+	bool IsCodeCacheable() const override;
 
 private:
-	bool IsCodeIdleLoopBlock() const;
+	void CompileSourceCheck(CMipsJitter*);
+
+	static void NativeFunctionHandled(CMIPS*);
+	static uint32 CheckSource(CMIPS*);
+	static void SourceModified(CMIPS*);
 
 	static constexpr auto DEFAULT_FP_ROUNDING_MODE = Jitter::CJitter::ROUND_TRUNCATE;
 	Jitter::CJitter::ROUNDINGMODE m_fpRoundingMode = DEFAULT_FP_ROUNDING_MODE;
 
 	bool m_isIdleLoopBlock = false;
+	NativeFunction m_nativeFunction = nullptr;
+
+	const uint8* m_source = nullptr;
+	std::vector<uint8> m_sourceSnapshot;
 };
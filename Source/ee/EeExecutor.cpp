@@ -3,12 +3,18 @@
 #include "AlignedAlloc.h"
 #include "EeBasicBlock.h"
 #include "MA_EE.h"
+#include "Log.h"
 #include "xxhash.h"
 
 #if defined(__unix__) || defined(__ANDROID__) || defined(__APPLE__)
 #include <sys/mman.h>
 #endif
 
+#ifdef FASTMEMORY_SUPPORTED
+#include <ucontext.h>
+#include "../MemoryUtils.h"
+#endif
+
 #if defined(__APPLE__)
 
 #include <TargetConditionals.h>
@@ -36,13 +42,135 @@
 
 #endif
 
+#define LOG_NAME ("ee_executor")
+
 static CEeExecutor* g_eeExecutor = nullptr;
 
-CEeExecutor::CEeExecutor(CMIPS& context, uint8* ram)
+#ifdef FASTMEMORY_SUPPORTED
+
+//Executor running generated code on this thread, fast memory faults are handled by it
+static __attribute__((tls_model("initial-exec"))) __thread CEeExecutor* g_fastMemoryEeExecutor = nullptr;
+
+extern "C"
+{
+	__attribute__((visibility("hidden"), tls_model("initial-exec"))) __thread uint64 EeExecutor_FastMemoryStubReturn = 0;
+	__attribute__((visibility("hidden"))) void EeExecutor_FastMemoryStub();
+
+	__attribute__((visibility("hidden"))) void EeExecutor_CompleteFastMemoryAccess(uint64* registers)
+	{
+		g_fastMemoryEeExecutor->CompleteFastMemoryAccess(registers);
+	}
+}
+
+//The fault handler resumes execution here instead of the faulting instruction. Everything the
+//generated code could be using is saved (red zone included), registers are handed to the slow
+//path and execution continues after the faulting instruction once it's done. The return address
+//is per thread since each VM runs its EE on its own thread. Flags are saved before anything
+//that could modify them runs.
+asm(
+    ".text\n"
+    ".p2align 4\n"
+    ".hidden EeExecutor_FastMemoryStub\n"
+    ".type EeExecutor_FastMemoryStub, @function\n"
+    "EeExecutor_FastMemoryStub:\n"
+    "\tleaq -128(%rsp), %rsp\n"
+    "\tleaq -8(%rsp), %rsp\n"
+    "\tpushq %rax\n"
+    "\tmovq EeExecutor_FastMemoryStubReturn@gottpoff(%rip), %rax\n"
+    "\tmovq %fs:(%rax), %rax\n"
+    "\tmovq %rax, 8(%rsp)\n"
+    "\tpopq %rax\n"
+    "\tpushfq\n"
+    "\tpushq %r15\n"
+    "\tpushq %r14\n"
+    "\tpushq %r13\n"
+    "\tpushq %r12\n"
+    "\tpushq %r11\n"
+    "\tpushq %r10\n"
+    "\tpushq %r9\n"
+    "\tpushq %r8\n"
+    "\tpushq %rdi\n"
+    "\tpushq %rsi\n"
+    "\tpushq %rbp\n"
+    "\tpushq %rbx\n"
+    "\tpushq %rdx\n"
+    "\tpushq %rcx\n"
+    "\tpushq %rax\n"
+    "\tmovq %rsp, %rbx\n"
+    "\tandq $-16, %rsp\n"
+    "\tsubq $256, %rsp\n"
+    "\tmovdqu %xmm0, 0(%rsp)\n"
+    "\tmovdqu %xmm1, 16(%rsp)\n"
+    "\tmovdqu %xmm2, 32(%rsp)\n"
+    "\tmovdqu %xmm3, 48(%rsp)\n"
+    "\tmovdqu %xmm4, 64(%rsp)\n"
+    "\tmovdqu %xmm5, 80(%rsp)\n"
+    "\tmovdqu %xmm6, 96(%rsp)\n"
+    "\tmovdqu %xmm7, 112(%rsp)\n"
+    "\tmovdqu %xmm8, 128(%rsp)\n"
+    "\tmovdqu %xmm9, 144(%rsp)\n"
+    "\tmovdqu %xmm10, 160(%rsp)\n"
+    "\tmovdqu %xmm11, 176(%rsp)\n"
+    "\tmovdqu %xmm12, 192(%rsp)\n"
+    "\tmovdqu %xmm13, 208(%rsp)\n"
+    "\tmovdqu %xmm14, 224(%rsp)\n"
+    "\tmovdqu %xmm15, 240(%rsp)\n"
+    "\tmovq %rbx, %rdi\n"
+    "\tcall EeExecutor_CompleteFastMemoryAccess\n"
+    "\tmovdqu 0(%rsp), %xmm0\n"
+    "\tmovdqu 16(%rsp), %xmm1\n"
+    "\tmovdqu 32(%rsp), %xmm2\n"
+    "\tmovdqu 48(%rsp), %xmm3\n"
+    "\tmovdqu 64(%rsp), %xmm4\n"
+    "\tmovdqu 80(%rsp), %xmm5\n"
+    "\tmovdqu 96(%rsp), %xmm6\n"
+    "\tmovdqu 112(%rsp), %xmm7\n"
+    "\tmovdqu 128(%rsp), %xmm8\n"
+    "\tmovdqu 144(%rsp), %xmm9\n"
+    "\tmovdqu 160(%rsp), %xmm10\n"
+    "\tmovdqu 176(%rsp), %xmm11\n"
+    "\tmovdqu 192(%rsp), %xmm12\n"
+    "\tmovdqu 208(%rsp), %xmm13\n"
+    "\tmovdqu 224(%rsp), %xmm14\n"
+    "\tmovdqu 240(%rsp), %xmm15\n"
+    "\tmovq %rbx, %rsp\n"
+    "\tpopq %rax\n"
+    "\tpopq %rcx\n"
+    "\tpopq %rdx\n"
+    "\tpopq %rbx\n"
+    "\tpopq %rbp\n"
+    "\tpopq %rsi\n"
+    "\tpopq %rdi\n"
+    "\tpopq %r8\n"
+    "\tpopq %r9\n"
+    "\tpopq %r10\n"
+    "\tpopq %r11\n"
+    "\tpopq %r12\n"
+    "\tpopq %r13\n"
+    "\tpopq %r14\n"
+    "\tpopq %r15\n"
+    "\tpopfq\n"
+    "\tret $128\n"
+    ".size EeExecutor_FastMemoryStub, .-EeExecutor_FastMemoryStub\n");
+
+//Registers saved by the stub, in encoding order without RSP
+static uint64& GetStubRegister(uint64* registers, int reg)
+{
+	assert(reg != 4);
+	return registers[(reg < 4) ? reg : (reg - 1)];
+}
+
+#endif
+
+CEeExecutor::CEeExecutor(CMIPS& context, uint8* ram, CFastMemory* fastMemory)
     : CGenericMipsExecutor(context, 0x20000000, BLOCK_CATEGORY_PS2_EE)
     , m_ram(ram)
+    , m_fastMemory(fastMemory)
+    , m_fastMemoryEnabled(fastMemory != nullptr)
 {
 	m_pageSize = framework_getpagesize();
+	m_pageFaultCounts.resize((PS2::EE_RAM_SIZE + (m_pageSize - 1)) / m_pageSize);
+	m_protectedPages.resize(m_pageFaultCounts.size());
 }
 
 void CEeExecutor::SetBlockFpRoundingModes(BlockFpRoundingModeMap blockFpRoundingModes)
@@ -60,6 +188,30 @@ void CEeExecutor::SetIdleLoopBlocks(IdleLoopBlockMap idleLoopBlocks)
 	m_idleLoopBlocks = std::move(idleLoopBlocks);
 }
 
+void CEeExecutor::SetNativeFunctions(NativeFunctionMap nativeFunctions)
+{
+	m_nativeFunctions = std::move(nativeFunctions);
+}
+
+CEeExecutor::CachedBlockKey CEeExecutor::ComputeCodeKey(const uint32* code, uint32 size)
+{
+	auto xxHash = XXH3_128bits(code, size);
+	uint128 hash;
+	memcpy(&hash, &xxHash, sizeof(xxHash));
+	static_assert(sizeof(hash) == sizeof(xxHash));
+	return std::make_pair(hash, size);
+}
+
+CEeExecutor::CachedBlockKey CEeExecutor::ComputeGuestCodeKey(uint32 start, uint32 size)
+{
+	std::vector<uint32> code(size / 4);
+	for(uint32 index = 0; index < code.size(); index++)
+	{
+		code[index] = m_context.m_pMemoryMap->GetInstruction(start + (index * 4));
+	}
+	return ComputeCodeKey(code.data(), size);
+}
+
 void CEeExecutor::AddExceptionHandler()
 {
 	assert(g_eeExecutor == nullptr);
@@ -127,12 +279,76 @@ void CEeExecutor::AttachExceptionHandlerToThread()
 #endif
 }
 
+int CEeExecutor::Execute(int cycles)
+{
+	m_executionThreadId = std::this_thread::get_id();
+#ifdef FASTMEMORY_SUPPORTED
+	g_fastMemoryEeExecutor = this;
+#endif
+	if(bool fastMemoryEnabled = IsFastMemoryUsable(); fastMemoryEnabled != m_fastMemoryEnabled)
+	{
+		if(fastMemoryEnabled)
+		{
+			CLog::GetInstance().Print(LOG_NAME, "TLB exception checks were turned off, going back to fast memory.\r\n");
+		}
+		else
+		{
+			CLog::GetInstance().Warn(LOG_NAME, "TLB exception checks were turned on, falling back to regular memory accesses.\r\n");
+		}
+		//Blocks were compiled for the other translation mode, start over
+		m_fastMemoryEnabled = fastMemoryEnabled;
+		SetMemoryProtected(m_ram, PS2::EE_RAM_SIZE, false);
+		m_cachedBlocks.clear();
+		CGenericMipsExecutor::Reset();
+	}
+	int result = CGenericMipsExecutor::Execute(cycles);
+	if(!m_pendingNoFastMemoryBlocks.empty())
+	{
+		//Blocks can't be cleared while they're executing, wait until we're out of generated code
+		for(uint32 blockAddress : m_pendingNoFastMemoryBlocks)
+		{
+			ClearActiveBlocksInRangeInternal(blockAddress, blockAddress + 4, nullptr);
+		}
+		m_pendingNoFastMemoryBlocks.clear();
+	}
+	m_retiredBlocks.clear();
+#ifdef FASTMEMORY_SUPPORTED
+	g_fastMemoryEeExecutor = nullptr;
+#endif
+	if(m_hasForeignWrites.load(std::memory_order_acquire))
+	{
+		ClearForeignWriteRanges();
+	}
+	//Pages that stopped being written will eventually be protected again
+	m_pageFaultDecayCycles += (cycles - result);
+	if(m_pageFaultDecayCycles >= PAGE_FAULT_DECAY_CYCLES)
+	{
+		m_pageFaultDecayCycles = 0;
+		for(auto& faultCount : m_pageFaultCounts)
+		{
+			if(faultCount != 0) faultCount--;
+		}
+	}
+	return result;
+}
+
 void CEeExecutor::Reset()
 {
 	SetMemoryProtected(m_ram, PS2::EE_RAM_SIZE, false);
 	m_cachedBlocks.clear();
 	m_blockFpRoundingModes.clear();
 	m_idleLoopBlocks.clear();
+	m_nativeFunctions.clear();
+	m_blockNoFastMemory.clear();
+	m_pendingNoFastMemoryBlocks.clear();
+	std::fill(std::begin(m_pageFaultCounts), std::end(m_pageFaultCounts), 0);
+	m_pageFaultDecayCycles = 0;
+	m_retiredBlocks.clear();
+	{
+		std::lock_guard<std::mutex> foreignWriteLock(m_foreignWriteMutex);
+		m_foreignWriteRanges.clear();
+		m_hasForeignWrites.store(false, std::memory_order_release);
+	}
 	CGenericMipsExecutor::Reset();
 }
 
@@ -150,9 +366,14 @@ BasicBlockPtr CEeExecutor::BlockFactory(CMIPS& context, uint32 start, uint32 end
 	//Kernel area is below 0x100000 and isn't protected. Some games will write code in there
 	//but it is safe to assume that it won't change (code writes some data just besides itself
 	//so it keeps generating exceptions, making the game slower)
+	bool sourceCheck = false;
 	if(start >= 0x100000 && start < PS2::EE_RAM_SIZE)
 	{
-		SetMemoryProtected(m_ram + start, blockSize, true);
+		sourceCheck = IsSourceCheckedRange(start, end);
+		if(!sourceCheck)
+		{
+			SetMemoryProtected(m_ram + start, blockSize, true);
+		}
 	}
 
 	auto blockMemory = reinterpret_cast<uint32*>(alloca(blockSize));
@@ -163,11 +384,7 @@ BasicBlockPtr CEeExecutor::BlockFactory(CMIPS& context, uint32 start, uint32 end
 		blockMemory[index] = opcode;
 	}
 
-	auto xxHash = XXH3_128bits(blockMemory, blockSize);
-	uint128 hash;
-	memcpy(&hash, &xxHash, sizeof(xxHash));
-	static_assert(sizeof(hash) == sizeof(xxHash));
-	auto blockKey = std::make_pair(hash, blockSize);
+	auto blockKey = ComputeCodeKey(blockMemory, blockSize);
 
 	bool hasBreakpoint = m_context.HasBreakpointInRange(start, end);
 
@@ -189,9 +406,27 @@ BasicBlockPtr CEeExecutor::BlockFactory(CMIPS& context, uint32 start, uint32 end
 		}
 	}
 
+	//Breakpoints at the start of a replaced function need the guest code to be executed.
+	//Code at that address might also have been replaced since the function was matched.
+	NativeFunction nativeFunction = nullptr;
+	if(auto nativeFunctionIterator = m_nativeFunctions.find(start);
+	   (nativeFunctionIterator != std::end(m_nativeFunctions)) && !hasBreakpoint)
+	{
+		const auto& nativeFunctionEntry = nativeFunctionIterator->second;
+		const auto& codeKey = nativeFunctionEntry.codeKey;
+		if(ComputeGuestCodeKey(start, codeKey.second) == codeKey)
+		{
+			nativeFunction = nativeFunctionEntry.function;
+		}
+	}
+
 	bool fpUseAccurateAddSub = (m_blockFpUseAccurateAddSub.count(start) != 0);
+	bool noFastMemory = (m_blockNoFastMemory.count(start) != 0);
 
-	bool isCacheableBlock = !hasBreakpoint && !blockFpRoundingModeOverride.has_value() && !isIdleLoopBlockOverride && !fpUseAccurateAddSub;
+	bool hasOverride = hasBreakpoint || blockFpRoundingModeOverride.has_value() || isIdleLoopBlockOverride || nativeFunction || fpUseAccurateAddSub || noFastMemory || sourceCheck;
+	//Profiled blocks have their own counters and can't be shared
+	bool profileBlock = ShouldProfileBlock(start, end);
+	bool isCacheableBlock = !hasOverride && !profileBlock;
 	if(isCacheableBlock)
 	{
 		auto blockIterator = m_cachedBlocks.find(blockKey);
@@ -206,14 +441,26 @@ BasicBlockPtr CEeExecutor::BlockFactory(CMIPS& context, uint32 start, uint32 end
 			}
 			else
 			{
-				auto result = std::make_shared<CEeBasicBlock>(context, start, end, m_blockCategory);
+				auto result = MakeBlock<CEeBasicBlock>(context, start, end, m_blockCategory);
 				result->CopyFunctionFrom(basicBlock);
 				return result;
 			}
 		}
 	}
 
-	auto result = std::make_shared<CEeBasicBlock>(context, start, end, m_blockCategory);
+	if(!hasOverride)
+	{
+		if(auto result = m_compileWorker.Take(start, end, context.GetCodeGenState(start, end)))
+		{
+			if(isCacheableBlock)
+			{
+				m_cachedBlocks.insert(std::make_pair(blockKey, result));
+			}
+			return result;
+		}
+	}
+
+	auto result = MakeBlock<CEeBasicBlock>(context, start, end, m_blockCategory);
 	if(blockFpRoundingModeOverride.has_value())
 	{
 		result->SetFpRoundingMode(blockFpRoundingModeOverride.value());
@@ -222,10 +469,27 @@ BasicBlockPtr CEeExecutor::BlockFactory(CMIPS& context, uint32 start, uint32 end
 	{
 		result->SetIsIdleLoopBlock();
 	}
+	if(nativeFunction)
+	{
+		result->SetNativeFunction(nativeFunction);
+	}
 	if(fpUseAccurateAddSub)
 	{
 		result->AddBlockCompileHints(CMA_EE::COMPILEHINT_FPU_USE_ACCURATE_ADD_SUB);
 	}
+	if(m_fastMemoryEnabled && !noFastMemory)
+	{
+		result->AddBlockCompileHints(MIPS_COMPILEHINT_FASTMEM);
+	}
+	if(sourceCheck)
+	{
+		result->SetSourceCheck(m_ram + start);
+	}
+	result->AddBlockCompileHints(MIPS_COMPILEHINT_IDLELOOPDETECTION);
+	if(profileBlock)
+	{
+		result->EnableProfiling();
+	}
 
 	result->Compile();
 	if(isCacheableBlock)
@@ -235,20 +499,281 @@ BasicBlockPtr CEeExecutor::BlockFactory(CMIPS& context, uint32 start, uint32 end
 	return result;
 }
 
+BasicBlockPtr CEeExecutor::PrefetchBlockFactory(CMIPS& context, uint32 start, uint32 end)
+{
+	//Blocks with game specific overrides are only compiled on demand
+	bool hasOverride =
+	    (m_blockFpRoundingModes.count(start) != 0) ||
+	    (m_idleLoopBlocks.count(start) != 0) ||
+	    (m_nativeFunctions.count(start) != 0) ||
+	    (m_blockFpUseAccurateAddSub.count(start) != 0) ||
+	    (m_blockNoFastMemory.count(start) != 0);
+	if(hasOverride || context.HasBreakpointInRange(start, end) || IsSourceCheckedRange(start, end))
+	{
+		return BasicBlockPtr();
+	}
+	auto result = MakeBlock<CEeBasicBlock>(context, start, end, m_blockCategory);
+	if(m_fastMemoryEnabled)
+	{
+		result->AddBlockCompileHints(MIPS_COMPILEHINT_FASTMEM);
+	}
+	result->AddBlockCompileHints(MIPS_COMPILEHINT_IDLELOOPDETECTION);
+	if(ShouldProfileBlock(start, end))
+	{
+		result->EnableProfiling();
+	}
+	return result;
+}
+
+bool CEeExecutor::IsSuperblockCandidate(uint32 start, uint32 end)
+{
+	//Overrides are applied per block, merging would lose those that don't apply at the start
+	{
+		auto overrideIterator = m_blockFpRoundingModes.lower_bound(start);
+		if((overrideIterator != std::end(m_blockFpRoundingModes)) && (overrideIterator->first <= end)) return false;
+	}
+	{
+		auto overrideIterator = m_idleLoopBlocks.lower_bound(start);
+		if((overrideIterator != std::end(m_idleLoopBlocks)) && (overrideIterator->first <= end)) return false;
+	}
+	{
+		auto overrideIterator = m_nativeFunctions.lower_bound(start);
+		if((overrideIterator != std::end(m_nativeFunctions)) && (overrideIterator->first <= end)) return false;
+	}
+	{
+		auto overrideIterator = m_blockFpUseAccurateAddSub.lower_bound(start);
+		if((overrideIterator != std::end(m_blockFpUseAccurateAddSub)) && (*overrideIterator <= end)) return false;
+	}
+	{
+		auto overrideIterator = m_blockNoFastMemory.lower_bound(start);
+		if((overrideIterator != std::end(m_blockNoFastMemory)) && (*overrideIterator <= end)) return false;
+	}
+	return CGenericMipsExecutor::IsSuperblockCandidate(start, end);
+}
+
+uint32 CEeExecutor::CheckBlockSource()
+{
+	uint32 address = m_context.m_State.nPC & m_addressMask;
+	auto block = static_cast<CEeBasicBlock*>(FindBlockStartingAt(address));
+	assert(!block->IsEmpty());
+
+	uint32 modifiedStart = 0;
+	uint32 modifiedEnd = 0;
+	if(!block->GetModifiedSourceRange(modifiedStart, modifiedEnd)) return 0;
+
+	//Block is still running, keep it alive until we're out of generated code. It's not reachable
+	//anymore once cleared, dispatcher will compile the new code when the block leaves.
+	m_retiredBlocks.push_back(block->shared_from_this());
+	ClearActiveBlocksInRangeInternal(modifiedStart, modifiedEnd, nullptr);
+	return 1;
+}
+
+void CEeExecutor::ClearBlocksWrittenByHost(const uint8* ptr, uint32 size)
+{
+	if((size == 0) || (ptr < m_ram) || (ptr >= (m_ram + PS2::EE_RAM_SIZE))) return;
+	uint32 start = static_cast<uint32>(ptr - m_ram);
+	uint32 end = std::min<uint32>(start + size, PS2::EE_RAM_SIZE);
+	//Only pages holding code matter, others are either free of blocks or checked by their blocks on entry
+	for(uint32 page = start / m_pageSize; page <= ((end - 1) / m_pageSize); page++)
+	{
+		if(!m_protectedPages[page]) continue;
+		uint32 pageStart = page * m_pageSize;
+		ClearActiveBlocksInRange(pageStart, pageStart + m_pageSize, true);
+	}
+}
+
+bool CEeExecutor::IsSourceCheckedRange(uint32 start, uint32 end) const
+{
+	uint32 firstPage = start / m_pageSize;
+	uint32 lastPage = std::min<uint32>(end, PS2::EE_RAM_SIZE - 1) / m_pageSize;
+	for(uint32 page = firstPage; page <= lastPage; page++)
+	{
+		if(m_pageFaultCounts[page] >= SOURCE_CHECK_PAGE_FAULT_THRESHOLD) return true;
+	}
+	return false;
+}
+
 bool CEeExecutor::HandleAccessFault(intptr_t ptr)
 {
 	ptrdiff_t addr = reinterpret_cast<uint8*>(ptr) - m_ram;
 	if(addr >= 0 && addr < PS2::EE_RAM_SIZE)
 	{
 		addr &= ~(m_pageSize - 1);
+		if((m_executionThreadId != std::thread::id()) && (m_executionThreadId != std::this_thread::get_id()))
+		{
+			//Blocks can't be touched from another thread, let the write go through and have
+			//the EE thread clear them. This is DMA, not code modifying itself, don't count it.
+			SetMemoryProtected(m_ram + addr, m_pageSize, false);
+			std::lock_guard<std::mutex> foreignWriteLock(m_foreignWriteMutex);
+			m_foreignWriteRanges.push_back(std::make_pair(static_cast<uint32>(addr), static_cast<uint32>(addr + m_pageSize)));
+			m_hasForeignWrites.store(true, std::memory_order_release);
+			return true;
+		}
+		//After this, blocks compiled from the page won't protect it anymore
+		auto& faultCount = m_pageFaultCounts[addr / m_pageSize];
+		if(faultCount < SOURCE_CHECK_PAGE_FAULT_THRESHOLD)
+		{
+			faultCount++;
+		}
 		ClearActiveBlocksInRange(addr, addr + m_pageSize, true);
 		return true;
 	}
 	return false;
 }
 
+bool CEeExecutor::IsFastMemoryUsable() const
+{
+	//Fast memory maps guest addresses directly, it can't be used once the TLB translator is set
+	//(PS2OS sets the TLB exception checker along with it)
+	return m_fastMemory && !m_context.m_TLBExceptionChecker;
+}
+
+void CEeExecutor::ClearForeignWriteRanges()
+{
+	std::vector<AddressRange> ranges;
+	{
+		std::lock_guard<std::mutex> foreignWriteLock(m_foreignWriteMutex);
+		ranges.swap(m_foreignWriteRanges);
+		m_hasForeignWrites.store(false, std::memory_order_release);
+	}
+	for(const auto& range : ranges)
+	{
+		ClearActiveBlocksInRangeInternal(range.first, range.second, nullptr);
+	}
+}
+
+#ifdef FASTMEMORY_SUPPORTED
+
+bool CEeExecutor::HandleFastMemoryFault(intptr_t ptr, void* baseContext)
+{
+	if(!m_fastMemory) return false;
+
+	uint32 address = 0;
+	if(!m_fastMemory->GetGuestAddress(ptr, address)) return false;
+
+	//Write to a RAM mirror that was protected because code was compiled from it
+	auto page = reinterpret_cast<uint8*>(m_context.m_pageLookup[address / MIPS_PAGE_SIZE]);
+	if((page >= m_ram) && (page < (m_ram + PS2::EE_RAM_SIZE)))
+	{
+		return HandleAccessFault(reinterpret_cast<intptr_t>(page + (address & (MIPS_PAGE_SIZE - 1))));
+	}
+
+	//Access to something that isn't mapped (IO registers, BIOS, etc.). Handlers for those can
+	//do pretty much anything, leave the signal handler and have the stub call them instead.
+	auto context = reinterpret_cast<ucontext_t*>(baseContext);
+	auto& registers = context->uc_mcontext.gregs;
+	HOST_MEMORY_ACCESS access;
+	if(!HostMemoryAccess_Decode(reinterpret_cast<const uint8*>(registers[REG_RIP]), access))
+	{
+		//Not something the code generator emits for memory accesses, let the fault through
+		return false;
+	}
+	//Stub doesn't keep RSP with the other registers
+	if((access.reg == 4) && !access.isHighByteReg) return false;
+
+	m_fastMemoryAccess = access;
+	m_fastMemoryAccessAddress = address & ~(access.size - 1);
+	EeExecutor_FastMemoryStubReturn = registers[REG_RIP] + access.length;
+	registers[REG_RIP] = reinterpret_cast<greg_t>(&EeExecutor_FastMemoryStub);
+
+	return true;
+}
+
+void CEeExecutor::CompleteFastMemoryAccess(uint64* registers)
+{
+	const auto& access = m_fastMemoryAccess;
+	uint32 address = m_fastMemoryAccessAddress;
+	if(access.isStore)
+	{
+		uint64 value = access.immediate;
+		if(access.reg != -1)
+		{
+			value = GetStubRegister(registers, access.reg) >> (access.isHighByteReg ? 8 : 0);
+		}
+		switch(access.size)
+		{
+		case 1:
+			MemoryUtils_SetByteProxy(&m_context, static_cast<uint8>(value), address);
+			break;
+		case 2:
+			MemoryUtils_SetHalfProxy(&m_context, static_cast<uint16>(value), address);
+			break;
+		case 4:
+			MemoryUtils_SetWordProxy(&m_context, static_cast<uint32>(value), address);
+			break;
+		case 8:
+			MemoryUtils_SetDoubleProxy(&m_context, value, address);
+			break;
+		}
+	}
+	else
+	{
+		uint64 value = 0;
+		switch(access.size)
+		{
+		case 1:
+			value = static_cast<uint8>(MemoryUtils_GetByteProxy(&m_context, address));
+			break;
+		case 2:
+			value = static_cast<uint16>(MemoryUtils_GetHalfProxy(&m_context, address));
+			break;
+		case 4:
+			value = MemoryUtils_GetWordProxy(&m_context, address);
+			break;
+		case 8:
+			value = MemoryUtils_GetDoubleProxy(&m_context, address);
+			break;
+		}
+		if(access.extend == HOST_MEMORY_ACCESS::EXTEND_SIGN)
+		{
+			value = HostMemoryAccess_SignExtend(value, access.size);
+		}
+
+		//Follow x86 rules: 32-bit writes clear the upper part, 8 and 16-bit writes preserve it
+		auto& regValue = GetStubRegister(registers, access.reg);
+		switch(access.registerSize)
+		{
+		case 1:
+		{
+			uint32 shift = access.isHighByteReg ? 8 : 0;
+			regValue = (regValue & ~(0xFFULL << shift)) | ((value & 0xFF) << shift);
+		}
+		break;
+		case 2:
+			regValue = (regValue & ~0xFFFFULL) | (value & 0xFFFF);
+			break;
+		case 4:
+			regValue = value & 0xFFFFFFFF;
+			break;
+		case 8:
+			regValue = value;
+			break;
+		}
+	}
+
+	//Have the block recompiled without fast memory once we're out of it
+	uint32 blockAddress = m_context.m_State.nPC & m_addressMask;
+	m_blockNoFastMemory.insert(blockAddress);
+	m_pendingNoFastMemoryBlocks.insert(blockAddress);
+}
+
+#endif
+
 void CEeExecutor::SetMemoryProtected(void* addr, size_t size, bool protect)
 {
+	auto bytePtr = reinterpret_cast<uint8*>(addr);
+	if((size != 0) && (bytePtr >= m_ram) && (bytePtr < (m_ram + PS2::EE_RAM_SIZE)))
+	{
+		size_t start = bytePtr - m_ram;
+		size_t end = std::min<size_t>(start + size, PS2::EE_RAM_SIZE);
+		std::fill(m_protectedPages.begin() + (start / m_pageSize), m_protectedPages.begin() + ((end - 1) / m_pageSize) + 1, protect);
+	}
+
+	if(m_fastMemory)
+	{
+		m_fastMemory->SetProtected(reinterpret_cast<uint8*>(addr), static_cast<uint32>(size), protect);
+	}
+
 #ifdef DISABLE_PROTECTION
 	return;
 #endif
@@ -294,6 +819,16 @@ LONG CEeExecutor::HandleExceptionInternal(_EXCEPTION_POINTERS* exceptionInfo)
 
 void CEeExecutor::HandleException(int sigId, siginfo_t* sigInfo, void* baseContext)
 {
+#ifdef FASTMEMORY_SUPPORTED
+	//Fast memory faults come from generated code, the executor running on this thread handles them
+	if(auto executor = g_fastMemoryEeExecutor; executor && (sigId == SIGSEGV))
+	{
+		if(executor->HandleFastMemoryFault(reinterpret_cast<intptr_t>(sigInfo->si_addr), baseContext))
+		{
+			return;
+		}
+	}
+#endif
 	g_eeExecutor->HandleExceptionInternal(sigId, sigInfo, baseContext);
 }
 
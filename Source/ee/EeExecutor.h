@@ -6,14 +6,19 @@
 #elif defined(__APPLE__)
 #include <TargetConditionals.h>
 #include <mach/mach.h>
-#include <thread>
 #elif defined(__unix__)
 #include <signal.h>
 #endif
 
+#include <atomic>
+#include <mutex>
 #include <optional>
+#include <thread>
 
 #include "../GenericMipsExecutor.h"
+#include "../FastMemory.h"
+#include "../HostMemoryAccess.h"
+#include "EeBasicBlock.h"
 
 class CEeExecutor : public CGenericMipsExecutor<BlockLookupTwoWay>
 {
@@ -22,37 +27,109 @@ public:
 	using IdleLoopBlockMap = std::map<uint32, std::optional<CachedBlockKey>>;
 	using BlockFpUseAccurateAddSubSet = std::set<uint32>;
 	using BlockFpRoundingModeMap = std::map<uint32, Jitter::CJitter::ROUNDINGMODE>;
-
-	CEeExecutor(CMIPS&, uint8*);
+	using BlockNoFastMemorySet = std::set<uint32>;
+	using NativeFunction = CEeBasicBlock::NativeFunction;
+	struct NATIVE_FUNCTION_ENTRY
+	{
+		NativeFunction function = nullptr;
+		//Key of the guest code that was matched, the function is only used while that code is unchanged
+		CachedBlockKey codeKey;
+	};
+	using NativeFunctionMap = std::map<uint32, NATIVE_FUNCTION_ENTRY>;
+
+	CEeExecutor(CMIPS&, uint8*, CFastMemory* = nullptr);
 	virtual ~CEeExecutor() = default;
 
 	void SetBlockFpRoundingModes(BlockFpRoundingModeMap);
 	void SetBlockFpUseAccurateAddSub(BlockFpUseAccurateAddSubSet);
 	void SetIdleLoopBlocks(IdleLoopBlockMap);
+	void SetNativeFunctions(NativeFunctionMap);
+
+	static CachedBlockKey ComputeCodeKey(const uint32*, uint32);
 
 	void AddExceptionHandler();
 	void RemoveExceptionHandler();
 
 	void AttachExceptionHandlerToThread();
 
+	int Execute(int) override;
 	void Reset() override;
 	void ClearActiveBlocksInRange(uint32, uint32, bool) override;
 
 	BasicBlockPtr BlockFactory(CMIPS&, uint32, uint32) override;
+	BasicBlockPtr PrefetchBlockFactory(CMIPS&, uint32, uint32) override;
+
+	//Called by blocks that check their code on entry, returns 1 if the block must not run
+	uint32 CheckBlockSource();
+
+	//Called before RAM is written by host code running on the EE thread (ie.: native functions)
+	void ClearBlocksWrittenByHost(const uint8*, uint32);
+
+#ifdef FASTMEMORY_SUPPORTED
+	//Called by the fast memory stub to complete an access that faulted, out of the signal handler
+	void CompleteFastMemoryAccess(uint64*);
+#endif
+
+protected:
+	bool IsSuperblockCandidate(uint32, uint32) override;
 
 private:
+	CachedBlockKey ComputeGuestCodeKey(uint32, uint32);
+
+	enum
+	{
+		//Pages that fault this many times are left unprotected and their blocks check their code instead
+		SOURCE_CHECK_PAGE_FAULT_THRESHOLD = 8,
+		//Fault counts go down by one every time this many cycles are executed
+		PAGE_FAULT_DECAY_CYCLES = 0x2000000,
+	};
+
+	typedef std::pair<uint32, uint32> AddressRange;
 	typedef std::map<CachedBlockKey, BasicBlockPtr> CachedBlockMap;
 	CachedBlockMap m_cachedBlocks;
 
 	IdleLoopBlockMap m_idleLoopBlocks;
 	BlockFpUseAccurateAddSubSet m_blockFpUseAccurateAddSub;
 	BlockFpRoundingModeMap m_blockFpRoundingModes;
+	NativeFunctionMap m_nativeFunctions;
+
+	//Blocks that accessed something else than memory through fast memory
+	BlockNoFastMemorySet m_blockNoFastMemory;
+	BlockNoFastMemorySet m_pendingNoFastMemoryBlocks;
+
+	//Write fault count for each host page of RAM
+	std::vector<uint8> m_pageFaultCounts;
+	int m_pageFaultDecayCycles = 0;
+	//Host pages of RAM protected because blocks were compiled from them
+	std::vector<bool> m_protectedPages;
+	//Blocks that found their code modified, freed once we're out of generated code
+	std::vector<BasicBlockPtr> m_retiredBlocks;
+
+	//Pages written by other threads (ie.: IOP running on its own thread), blocks are cleared
+	//once this thread is out of generated code
+	std::thread::id m_executionThreadId;
+	std::mutex m_foreignWriteMutex;
+	std::vector<AddressRange> m_foreignWriteRanges;
+	std::atomic<bool> m_hasForeignWrites = false;
 
 	uint8* m_ram = nullptr;
 	size_t m_pageSize = 0;
+	CFastMemory* m_fastMemory = nullptr;
+	bool m_fastMemoryEnabled = false;
 
+	bool IsFastMemoryUsable() const;
 	bool HandleAccessFault(intptr_t);
+	void ClearForeignWriteRanges();
 	void SetMemoryProtected(void*, size_t, bool);
+	bool IsSourceCheckedRange(uint32, uint32) const;
+
+#ifdef FASTMEMORY_SUPPORTED
+	bool HandleFastMemoryFault(intptr_t, void*);
+
+	//Access being completed by the stub
+	HOST_MEMORY_ACCESS m_fastMemoryAccess;
+	uint32 m_fastMemoryAccessAddress = 0;
+#endif
 
 #if defined(_WIN32)
 	static LONG CALLBACK HandleException(_EXCEPTION_POINTERS*);
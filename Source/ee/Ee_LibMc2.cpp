@@ -32,13 +32,15 @@ using namespace Ee;
 #define MC2_RESULT_ERROR_NOT_FOUND 0x81010002
 #define MC2_RESULT_ERROR_ALREADY_EXISTS 0x81010011
 
-CLibMc2::CLibMc2(uint8* ram, CPS2OS& eeBios, CIopBios& iopBios)
+CLibMc2::CLibMc2(uint8* ram, CPS2OS& eeBios, CIopBios& iopBios, CSIF& sif)
     : m_ram(ram)
     , m_eeBios(eeBios)
     , m_iopBios(iopBios)
+    , m_sif(sif)
 {
+	//Modules are loaded by the IOP, but hooking patches EE code
 	m_moduleLoadedConnection = m_iopBios.OnModuleLoaded.Connect(
-	    [this](const char* moduleName) { OnIopModuleLoaded(moduleName); });
+	    [this](const char* moduleName) { m_sif.CallOnEe([&]() { OnIopModuleLoaded(moduleName); }); });
 }
 
 void CLibMc2::Reset()
@@ -70,6 +72,29 @@ void CLibMc2::LoadState(Framework::CZipArchiveReader& archive)
 	m_commandDelayVBlankCount = registerFile.GetRegister32(STATE_COMMAND_DELAY_VBLANK_COUNT);
 }
 
+size_t CLibMc2::GetRawStateSize() const
+{
+	return sizeof(m_lastCmd) + sizeof(m_lastResult) + sizeof(m_waitThreadId) + sizeof(m_waitVBlankCount) + sizeof(m_commandDelayVBlankCount);
+}
+
+void CLibMc2::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_lastCmd);
+	writer.Write(m_lastResult);
+	writer.Write(m_waitThreadId);
+	writer.Write(m_waitVBlankCount);
+	writer.Write(m_commandDelayVBlankCount);
+}
+
+void CLibMc2::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_lastCmd);
+	reader.Read(m_lastResult);
+	reader.Read(m_waitThreadId);
+	reader.Read(m_waitVBlankCount);
+	reader.Read(m_commandDelayVBlankCount);
+}
+
 uint32 CLibMc2::AnalyzeFunction(MODULE_FUNCTIONS& moduleFunctions, uint32 startAddress, int16 stackAlloc)
 {
 	static const uint32 maxFunctionSize = 0x200;
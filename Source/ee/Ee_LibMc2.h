@@ -3,8 +3,10 @@
 #include "Types.h"
 #include "MIPS.h"
 #include "iop/IopBios.h"
+#include "states/RawState.h"
 
 class CPS2OS;
+class CSIF;
 namespace Framework
 {
 	class CZipArchiveReader;
@@ -59,13 +61,17 @@ namespace Ee
 			SYSCALL_RANGE_END,
 		};
 
-		CLibMc2(uint8*, CPS2OS&, CIopBios&);
+		CLibMc2(uint8*, CPS2OS&, CIopBios&, CSIF&);
 
 		void Reset();
 
 		void SaveState(Framework::CZipArchiveWriter&);
 		void LoadState(Framework::CZipArchiveReader&);
 
+		size_t GetRawStateSize() const;
+		void SaveRawState(CRawStateWriter&);
+		void LoadRawState(CRawStateReader&);
+
 		void HandleSyscall(CMIPS&);
 		void NotifyVBlankStart();
 		void HookLibMc2Functions();
@@ -127,6 +133,7 @@ namespace Ee
 		uint8* m_ram = nullptr;
 		CPS2OS& m_eeBios;
 		CIopBios& m_iopBios;
+		CSIF& m_sif;
 		CIopBios::ModuleLoadedEvent::Connection m_moduleLoadedConnection;
 		uint32 m_lastCmd = 0;
 		uint32 m_lastResult = 0;
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include "Ee_NativeFunctions.h"
+#include "MIPS.h"
+#include "MipsFunctionPatternDb.h"
+#include "xml/Node.h"
+#include "xml/Parser.h"
+#include "PathUtils.h"
+#include "PtrStream.h"
+#include "StdStreamUtils.h"
+#ifdef __ANDROID__
+#include "android/AssetStream.h"
+#endif
+#include "Log.h"
+
+#define LOG_NAME "ee_nativefunctions"
+
+#define FUNCTIONS_FILENAME "ee_functions.xml"
+
+//Guest implementations move around 4 bytes per cycle when data is aligned,
+//keep charging something close to that to avoid disturbing game timing
+#define CALL_CYCLES (16)
+#define BYTES_PER_CYCLE (4)
+
+using namespace Ee;
+
+struct NATIVE_FUNCTION
+{
+	const char* name;
+	CEeExecutor::NativeFunction function;
+};
+
+static const void* g_functionsFileData = nullptr;
+static size_t g_functionsFileSize = 0;
+
+static const NATIVE_FUNCTION g_nativeFunctions[] =
+    {
+        {"memcpy", &NativeFunctions::Memcpy},
+        {"memset", &NativeFunctions::Memset},
+        {"strcpy", &NativeFunctions::Strcpy},
+};
+
+static const CMemoryMap::MEMORYMAPELEMENT* GetMemoryMap(CMIPS* context, uint32 physAddress, bool isWrite)
+{
+	auto map = isWrite ? context->m_pMemoryMap->GetWriteMap(physAddress) : context->m_pMemoryMap->GetReadMap(physAddress);
+	if(!map || (map->nType != CMemoryMap::MEMORYMAP_TYPE_MEMORY)) return nullptr;
+	return map;
+}
+
+//Returns a host pointer to a guest range if it can be accessed directly, nullptr otherwise
+static uint8* GetMemoryPointer(CMIPS* context, uint32 address, uint32 size, bool isWrite)
+{
+	assert(size != 0);
+
+	//TLB translation can raise exceptions, let the guest code deal with those
+	if(context->m_TLBExceptionChecker) return nullptr;
+
+	uint32 endAddress = address + size - 1;
+	if(endAddress < address) return nullptr;
+
+	uint32 physAddress = context->m_pAddrTranslator(context, address);
+	uint32 physEndAddress = context->m_pAddrTranslator(context, endAddress);
+	if((physEndAddress - physAddress) != (size - 1)) return nullptr;
+
+	auto map = GetMemoryMap(context, physAddress, isWrite);
+	if(!map || (physEndAddress > map->nEnd)) return nullptr;
+
+	return reinterpret_cast<uint8*>(map->pPointer) + (physAddress - map->nStart);
+}
+
+static bool RangesOverlap(const uint8* first, const uint8* second, uint32 size)
+{
+	return (first < (second + size)) && (second < (first + size));
+}
+
+//Blocks compiled from the destination need to go, just like when guest code writes there
+static void ClearWrittenBlocks(CMIPS* context, const uint8* dst, uint32 size)
+{
+	auto executor = static_cast<CEeExecutor*>(context->m_executor.get());
+	executor->ClearBlocksWrittenByHost(dst, size);
+}
+
+static uint32 ReturnToCaller(CMIPS* context, uint32 size)
+{
+	auto& state = context->m_State;
+
+	//All supported functions return their first argument
+	state.nGPR[CMIPS::V0].nD0 = state.nGPR[CMIPS::A0].nD0;
+	state.nPC = state.nGPR[CMIPS::RA].nV0;
+
+	state.cycleQuota -= static_cast<int32>(CALL_CYCLES + (size / BYTES_PER_CYCLE));
+	if(state.cycleQuota <= 0)
+	{
+		state.nHasException |= MIPS_EXCEPTION_STATUS_QUOTADONE;
+	}
+
+	return 1;
+}
+
+CEeExecutor::NativeFunctionMap NativeFunctions::FindFunctions(uint8* ram, uint32 minAddr, uint32 maxAddr)
+{
+	CEeExecutor::NativeFunctionMap result;
+
+	std::unique_ptr<Framework::Xml::CNode> document;
+	try
+	{
+		if(g_functionsFileData)
+		{
+			Framework::CPtrStream inputStream(g_functionsFileData, g_functionsFileSize);
+			document = Framework::Xml::CParser::ParseDocument(inputStream);
+		}
+		else
+		{
+#ifdef __ANDROID__
+			Framework::Android::CAssetStream inputStream(FUNCTIONS_FILENAME);
+#else
+			auto functionsPath = Framework::PathUtils::GetAppResourcesPath() / FUNCTIONS_FILENAME;
+			Framework::CStdStream inputStream(Framework::CreateInputStdStream(functionsPath.native()));
+#endif
+			document = Framework::Xml::CParser::ParseDocument(inputStream);
+		}
+		if(!document) return result;
+	}
+	catch(const std::exception& exception)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to open functions file: %s.\r\n", exception.what());
+		return result;
+	}
+
+	auto functionsNode = document->Select("Functions");
+	if(!functionsNode) return result;
+
+	CMipsFunctionPatternDb patternDb(functionsNode);
+	for(const auto& pattern : patternDb.GetPatterns())
+	{
+		auto nativeFunctionIterator = std::find_if(std::begin(g_nativeFunctions), std::end(g_nativeFunctions),
+		                                           [&](const NATIVE_FUNCTION& nativeFunction) { return pattern.name == nativeFunction.name; });
+		if(nativeFunctionIterator == std::end(g_nativeFunctions)) continue;
+
+		for(uint32 address = minAddr; address <= maxAddr; address += 4)
+		{
+			uint32* text = reinterpret_cast<uint32*>(ram + address);
+			uint32 textSize = (maxAddr - address);
+			uint32 matchSize = 0;
+			if(pattern.Matches(text, textSize, &matchSize))
+			{
+				CLog::GetInstance().Print(LOG_NAME, "Using native implementation for '%s' at 0x%08X.\r\n",
+				                          pattern.name.c_str(), address);
+				CEeExecutor::NATIVE_FUNCTION_ENTRY entry;
+				entry.function = nativeFunctionIterator->function;
+				entry.codeKey = CEeExecutor::ComputeCodeKey(text, matchSize);
+				result.insert(std::make_pair(address, entry));
+			}
+		}
+	}
+
+	return result;
+}
+
+void NativeFunctions::SetFunctionsFileData(const void* data, size_t size)
+{
+	g_functionsFileData = data;
+	g_functionsFileSize = size;
+}
+
+uint32 NativeFunctions::Memcpy(CMIPS* context)
+{
+	const auto& state = context->m_State;
+	uint32 dstAddress = state.nGPR[CMIPS::A0].nV0;
+	uint32 srcAddress = state.nGPR[CMIPS::A1].nV0;
+	uint32 size = state.nGPR[CMIPS::A2].nV0;
+
+	if(size != 0)
+	{
+		auto dst = GetMemoryPointer(context, dstAddress, size, true);
+		auto src = GetMemoryPointer(context, srcAddress, size, false);
+		if(!dst || !src) return 0;
+
+		//Guest copies forward in chunks, results of overlapping copies depend on alignment
+		if(RangesOverlap(dst, src, size)) return 0;
+
+		ClearWrittenBlocks(context, dst, size);
+		memcpy(dst, src, size);
+	}
+
+	return ReturnToCaller(context, size);
+}
+
+uint32 NativeFunctions::Memset(CMIPS* context)
+{
+	const auto& state = context->m_State;
+	uint32 dstAddress = state.nGPR[CMIPS::A0].nV0;
+	uint8 value = static_cast<uint8>(state.nGPR[CMIPS::A1].nV0);
+	uint32 size = state.nGPR[CMIPS::A2].nV0;
+
+	if(size != 0)
+	{
+		auto dst = GetMemoryPointer(context, dstAddress, size, true);
+		if(!dst) return 0;
+
+		ClearWrittenBlocks(context, dst, size);
+		memset(dst, value, size);
+	}
+
+	return ReturnToCaller(context, size);
+}
+
+uint32 NativeFunctions::Strcpy(CMIPS* context)
+{
+	const auto& state = context->m_State;
+	uint32 dstAddress = state.nGPR[CMIPS::A0].nV0;
+	uint32 srcAddress = state.nGPR[CMIPS::A1].nV0;
+
+	if(context->m_TLBExceptionChecker) return 0;
+
+	//Look for the terminator in the memory block that contains the string
+	uint32 srcPhysAddress = context->m_pAddrTranslator(context, srcAddress);
+	auto srcMap = GetMemoryMap(context, srcPhysAddress, false);
+	if(!srcMap) return 0;
+
+	auto srcBlock = reinterpret_cast<const uint8*>(srcMap->pPointer) + (srcPhysAddress - srcMap->nStart);
+	auto terminator = reinterpret_cast<const uint8*>(memchr(srcBlock, 0, srcMap->nEnd - srcPhysAddress + 1));
+	if(!terminator) return 0;
+
+	uint32 size = static_cast<uint32>(terminator - srcBlock) + 1;
+	auto dst = GetMemoryPointer(context, dstAddress, size, true);
+	auto src = GetMemoryPointer(context, srcAddress, size, false);
+	if(!dst || (src != srcBlock)) return 0;
+	if(RangesOverlap(dst, src, size)) return 0;
+
+	ClearWrittenBlocks(context, dst, size);
+	memcpy(dst, src, size);
+
+	return ReturnToCaller(context, size);
+}
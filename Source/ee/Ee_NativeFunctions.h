@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Types.h"
+#include "EeExecutor.h"
+
+namespace Ee
+{
+	//Host implementations of common libc routines found in EE executables. They follow the
+	//MIPS calling convention: arguments in A0-A2, result in V0 and return to RA.
+	//Functions return 0 when they can't handle the call, guest code is then executed instead.
+	namespace NativeFunctions
+	{
+		//Scans the executable's code with the patterns from ee_functions.xml
+		CEeExecutor::NativeFunctionMap FindFunctions(uint8*, uint32, uint32);
+
+		//For frontends that don't ship resource files, provides the contents of ee_functions.xml
+		void SetFunctionsFileData(const void*, size_t);
+
+		uint32 Memcpy(CMIPS*);
+		uint32 Memset(CMIPS*);
+		uint32 Strcpy(CMIPS*);
+	}
+}
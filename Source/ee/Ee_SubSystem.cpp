@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "Ee_SubSystem.h"
 #include "EeExecutor.h"
 #include "VuExecutor.h"
@@ -26,10 +27,20 @@ using namespace Ee;
 
 #define FAKE_IOP_RAM_SIZE (0x1000)
 
-CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
-    : m_ram(reinterpret_cast<uint8*>(framework_aligned_alloc(PS2::EE_RAM_SIZE, framework_getpagesize())))
+static uint8* AllocateMemory(CFastMemory* fastMemory, uint32 size, uint32 alignment)
+{
+	if(fastMemory)
+	{
+		return fastMemory->Allocate(size);
+	}
+	return reinterpret_cast<uint8*>(framework_aligned_alloc(size, alignment));
+}
+
+CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios, bool fastMemoryEnabled, bool vu1ThreadEnabled)
+    : m_fastMemory(fastMemoryEnabled ? std::make_unique<CFastMemory>() : std::unique_ptr<CFastMemory>())
+    , m_ram(AllocateMemory(m_fastMemory.get(), PS2::EE_RAM_SIZE, framework_getpagesize()))
     , m_bios(new uint8[PS2::EE_BIOS_SIZE])
-    , m_spr(reinterpret_cast<uint8*>(framework_aligned_alloc(PS2::EE_SPR_SIZE, 0x10)))
+    , m_spr(AllocateMemory(m_fastMemory.get(), PS2::EE_SPR_SIZE, 0x10))
     , m_fakeIopRam(new uint8[FAKE_IOP_RAM_SIZE])
     , m_vuMem0(reinterpret_cast<uint8*>(framework_aligned_alloc(PS2::VUMEM0SIZE, 0x10)))
     , m_microMem0(new uint8[PS2::MICROMEM0SIZE])
@@ -61,19 +72,37 @@ CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
 	m_vpu0 = std::make_shared<CVpu>(0, CVpu::VPUINIT(m_microMem0, m_vuMem0, &m_VU0), m_gif, m_intc, m_ram, m_spr);
 	m_vpu1 = std::make_shared<CVpu>(1, CVpu::VPUINIT(m_microMem1, m_vuMem1, &m_VU1), m_gif, m_intc, m_ram, m_spr);
 
+	if(vu1ThreadEnabled)
+	{
+		m_vu1Thread = std::make_unique<CVu1Thread>(*m_vpu1, m_gif, m_ram, m_spr);
+		m_vpu1->SetVu1Thread(m_vu1Thread.get());
+	}
+
 	//Setup link between EE's VU context and VU0's VU context
 	m_vu0StateChangedConnection = m_vpu0->VuStateChanged.Connect([this](CVpu::VU_STATE newState) { Vu0StateChanged(newState); });
 
 	m_vu1InterruptTriggeredConnection = m_vpu1->VuInterruptTriggered.Connect(
 	    [this]() {
-		    uint32 currentState = m_intc.GetRegister(CINTC::INTC_STAT);
-		    assert((currentState & (1 << CINTC::INTC_LINE_VU1)) == 0);
-		    m_intc.AssertLine(CINTC::INTC_LINE_VU1);
+		    auto assertInterrupt =
+		        [this]() {
+			        uint32 currentState = m_intc.GetRegister(CINTC::INTC_STAT);
+			        assert((currentState & (1 << CINTC::INTC_LINE_VU1)) == 0);
+			        m_intc.AssertLine(CINTC::INTC_LINE_VU1);
+		        };
+		    //INTC belongs to the EE, VU1 might be running on its own thread
+		    if(m_vu1Thread)
+		    {
+			    m_vu1Thread->RunOnEe(assertInterrupt);
+		    }
+		    else
+		    {
+			    assertInterrupt();
+		    }
 	    });
 
 	//EmotionEngine context setup
 	{
-		m_EE.m_executor = std::make_unique<CEeExecutor>(m_EE, m_ram);
+		m_EE.m_executor = std::make_unique<CEeExecutor>(m_EE, m_ram, m_fastMemory.get());
 
 		//Read map
 		m_EE.m_pMemoryMap->InsertReadMap(0x00000000, PS2::EE_RAM_SIZE - 1, m_ram, 0x00);
@@ -152,7 +181,16 @@ CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
 	m_VU1.m_vuMem = m_vuMem1;
 
 	m_dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_VIF0, std::bind(&CVif::ReceiveDMA, &m_vpu0->GetVif(), PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
-	m_dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_VIF1, std::bind(&CVif::ReceiveDMA, &m_vpu1->GetVif(), PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
+	if(m_vu1Thread)
+	{
+		m_dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_VIF1, std::bind(&CVu1Thread::ReceiveDMA, m_vu1Thread.get(), PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
+		//Transfer is only over once the VIF took everything out of the worker's ring
+		m_dmac.SetChannelDrainedFunction(CDMAC::CHANNEL_ID_VIF1, std::bind(&CVu1Thread::IsRingEmpty, m_vu1Thread.get()));
+	}
+	else
+	{
+		m_dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_VIF1, std::bind(&CVif::ReceiveDMA, &m_vpu1->GetVif(), PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
+	}
 	m_dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_GIF, std::bind(&CGIF::ReceiveDMA, &m_gif, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
 	m_dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_TO_IPU, std::bind(&CIPU::ReceiveDMA4, &m_ipu, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_4, m_ram, m_spr));
 	m_dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_SIF0, std::bind(&CSIF::ReceiveDMA5, &m_sif, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
@@ -168,11 +206,15 @@ CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
 
 CSubSystem::~CSubSystem()
 {
+	m_vu1Thread.reset();
 	m_EE.m_executor->Reset();
 	delete m_os;
-	framework_aligned_free(m_ram);
 	delete[] m_bios;
-	framework_aligned_free(m_spr);
+	if(!m_fastMemory)
+	{
+		framework_aligned_free(m_ram);
+		framework_aligned_free(m_spr);
+	}
 	delete[] m_fakeIopRam;
 	framework_aligned_free(m_vuMem0);
 	delete[] m_microMem0;
@@ -192,6 +234,11 @@ void CSubSystem::SetVpu1(std::shared_ptr<CVpu> newVpu1)
 
 void CSubSystem::Reset(uint32 ramSize)
 {
+	if(m_vu1Thread)
+	{
+		m_vu1Thread->Reset();
+	}
+
 	m_os->Release();
 	m_EE.m_executor->Reset();
 
@@ -305,12 +352,38 @@ bool CSubSystem::IsCpuIdle() const
 }
 
 void CSubSystem::CountTicks(int ticks)
+{
+	m_EE.m_State.nCOP0[CCOP_SCU::COUNT] += ticks;
+	m_timer.Count(ticks);
+	if(m_EE.m_State.cop0_pccr & 0x80000000)
+	{
+		auto pccr = make_convertible<CCOP_SCU::PCCR>(m_EE.m_State.cop0_pccr);
+		bool event0Enabled = (pccr.u0 | pccr.s0 | pccr.k0 | pccr.exl0) != 0;
+		bool event1Enabled = (pccr.u1 | pccr.s1 | pccr.k1 | pccr.exl1) != 0;
+		if(event0Enabled && (pccr.event0 == 1))
+		{
+			m_EE.m_State.cop0_pcr[0] += ticks;
+		}
+		if(event1Enabled && (pccr.event1 == 1))
+		{
+			m_EE.m_State.cop0_pcr[1] += ticks;
+		}
+	}
+	CheckPendingInterrupts();
+}
+
+void CSubSystem::UpdateUnits(int ticks)
 {
 	if(m_vpu0->IsVuReady() || (m_vpu0->IsVuRunning() && !m_vpu0->GetVif().IsWaitingForProgramEnd()))
 	{
 		m_dmac.ResumeDMA0();
 	}
-	if(m_vpu1->IsVuReady() || (m_vpu1->IsVuRunning() && !m_vpu1->GetVif().IsWaitingForProgramEnd()))
+	if(m_vu1Thread)
+	{
+		//Worker's ring takes what it can, VU1 state doesn't matter here
+		m_dmac.ResumeDMA1();
+	}
+	else if(m_vpu1->IsVuReady() || (m_vpu1->IsVuRunning() && !m_vpu1->GetVif().IsWaitingForProgramEnd()))
 	{
 		m_dmac.ResumeDMA1();
 	}
@@ -320,7 +393,14 @@ void CSubSystem::CountTicks(int ticks)
 	m_gif.CountTicks(ticks);
 	m_ipu.CountTicks(ticks);
 	m_vpu0->GetVif().CountTicks(ticks);
-	m_vpu1->GetVif().CountTicks(ticks);
+	if(m_vu1Thread)
+	{
+		m_vu1Thread->CountTicks(ticks);
+	}
+	else
+	{
+		m_vpu1->GetVif().CountTicks(ticks);
+	}
 	ExecuteIpu();
 	if(!m_EE.m_State.nHasException)
 	{
@@ -329,23 +409,40 @@ void CSubSystem::CountTicks(int ticks)
 			m_sif.CountTicks(ticks);
 		}
 	}
-	m_EE.m_State.nCOP0[CCOP_SCU::COUNT] += ticks;
-	m_timer.Count(ticks);
-	if(m_EE.m_State.cop0_pccr & 0x80000000)
+	CheckPendingInterrupts();
+}
+
+std::optional<uint32> CSubSystem::GetUnitUpdateDelay(uint32 retryTicks)
+{
+	std::optional<uint32> result;
+	auto addDeadline = [&](uint32 ticks) { result = std::min(result.value_or(ticks), ticks); };
+
+	if(m_dmac.IsResumePending() || m_ipu.HasPendingOUTFIFOData() || m_sif.HasPendingPackets())
 	{
-		auto pccr = make_convertible<CCOP_SCU::PCCR>(m_EE.m_State.cop0_pccr);
-		bool event0Enabled = (pccr.u0 | pccr.s0 | pccr.k0 | pccr.exl0) != 0;
-		bool event1Enabled = (pccr.u1 | pccr.s1 | pccr.k1 | pccr.exl1) != 0;
-		if(event0Enabled && (pccr.event0 == 1))
-		{
-			m_EE.m_State.cop0_pcr[0] += ticks;
-		}
-		if(event1Enabled && (pccr.event1 == 1))
-		{
-			m_EE.m_State.cop0_pcr[1] += ticks;
-		}
+		addDeadline(retryTicks);
 	}
-	CheckPendingInterrupts();
+	if(m_ipu.IsCommandDelayed())
+	{
+		addDeadline(m_ipu.GetCommandDelayTicks());
+	}
+	if(uint32 ticks = m_gif.GetPath3XferActiveTicks(); ticks != 0)
+	{
+		addDeadline(ticks);
+	}
+	if(uint32 ticks = m_vpu0->GetVif().GetInterruptDelayTicks(); ticks != 0)
+	{
+		addDeadline(ticks);
+	}
+	if(m_vu1Thread && m_vu1Thread->HasPendingUpdate())
+	{
+		//VIF1 belongs to the worker while it's busy
+		addDeadline(retryTicks);
+	}
+	else if(uint32 ticks = m_vpu1->GetVif().GetInterruptDelayTicks(); ticks != 0)
+	{
+		addDeadline(ticks);
+	}
+	return result;
 }
 
 void CSubSystem::NotifyVBlankStart()
@@ -367,12 +464,17 @@ void CSubSystem::NotifyVBlankEnd()
 	m_intc.AssertLine(CINTC::INTC_LINE_VBLANK_END);
 }
 
-void CSubSystem::SaveState(Framework::CZipArchiveWriter& archive)
+void CSubSystem::SaveState(Framework::CZipArchiveWriter& archive, bool includeRam)
 {
+	SyncVu1();
+
 	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_EE, &m_EE.m_State, sizeof(MIPSSTATE)));
 	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_VU0, &m_VU0.m_State, sizeof(MIPSSTATE)));
 	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_VU1, &m_VU1.m_State, sizeof(MIPSSTATE)));
-	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_RAM, m_ram, PS2::EE_RAM_SIZE));
+	if(includeRam)
+	{
+		archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_RAM, m_ram, PS2::EE_RAM_SIZE));
+	}
 	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_SPR, m_spr, PS2::EE_SPR_SIZE));
 	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_VUMEM0, m_vuMem0, PS2::VUMEM0SIZE));
 	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_MICROMEM0, m_microMem0, PS2::MICROMEM0SIZE));
@@ -388,10 +490,19 @@ void CSubSystem::SaveState(Framework::CZipArchiveWriter& archive)
 	m_gif.SaveState(archive);
 	m_ipu.SaveState(archive);
 	m_os->GetLibMc2().SaveState(archive);
+	if(m_vu1Thread)
+	{
+		m_vu1Thread->SaveState(archive);
+	}
 }
 
-void CSubSystem::LoadState(Framework::CZipArchiveReader& archive)
+void CSubSystem::LoadState(Framework::CZipArchiveReader& archive, bool includeRam)
 {
+	if(m_vu1Thread)
+	{
+		m_vu1Thread->Reset();
+	}
+
 	m_EE.m_executor->ClearActiveBlocksInRange(0, PS2::EE_RAM_SIZE, false);
 	m_vpu0->GetContext().m_executor->ClearActiveBlocksInRange(0, PS2::MICROMEM0SIZE, false);
 	m_vpu1->GetContext().m_executor->ClearActiveBlocksInRange(0, PS2::MICROMEM1SIZE, false);
@@ -399,7 +510,10 @@ void CSubSystem::LoadState(Framework::CZipArchiveReader& archive)
 	archive.BeginReadFile(STATE_EE)->Read(&m_EE.m_State, sizeof(MIPSSTATE));
 	archive.BeginReadFile(STATE_VU0)->Read(&m_VU0.m_State, sizeof(MIPSSTATE));
 	archive.BeginReadFile(STATE_VU1)->Read(&m_VU1.m_State, sizeof(MIPSSTATE));
-	archive.BeginReadFile(STATE_RAM)->Read(m_ram, PS2::EE_RAM_SIZE);
+	if(includeRam)
+	{
+		archive.BeginReadFile(STATE_RAM)->Read(m_ram, PS2::EE_RAM_SIZE);
+	}
 	archive.BeginReadFile(STATE_SPR)->Read(m_spr, PS2::EE_SPR_SIZE);
 	archive.BeginReadFile(STATE_VUMEM0)->Read(m_vuMem0, PS2::VUMEM0SIZE);
 	archive.BeginReadFile(STATE_MICROMEM0)->Read(m_microMem0, PS2::MICROMEM0SIZE);
@@ -415,15 +529,125 @@ void CSubSystem::LoadState(Framework::CZipArchiveReader& archive)
 	m_gif.LoadState(archive);
 	m_ipu.LoadState(archive);
 	m_os->GetLibMc2().LoadState(archive);
+	if(m_vu1Thread)
+	{
+		m_vu1Thread->LoadState(archive);
+	}
+
+	KickVu1();
+}
+
+size_t CSubSystem::GetRawStateSize(bool includeRam) const
+{
+	return sizeof(m_EE.m_State) + sizeof(m_VU0.m_State) + sizeof(m_VU1.m_State) +
+	       (includeRam ? PS2::EE_RAM_SIZE : 0) + PS2::EE_SPR_SIZE + PS2::VUMEM0SIZE + PS2::MICROMEM0SIZE + PS2::VUMEM1SIZE + PS2::MICROMEM1SIZE +
+	       m_dmac.GetRawStateSize() + m_sif.GetRawStateSize() + m_vpu0->GetRawStateSize() + m_vpu1->GetRawStateSize() +
+	       m_ipu.GetRawStateSize() + m_intc.GetRawStateSize() + m_timer.GetRawStateSize() + m_gif.GetRawStateSize() +
+	       m_os->GetLibMc2().GetRawStateSize() + CVu1Thread::GetRawStateSize();
+}
+
+void CSubSystem::SaveRawState(CRawStateWriter& writer, bool includeRam)
+{
+	SyncVu1();
+
+	writer.Write(m_EE.m_State);
+	writer.Write(m_VU0.m_State);
+	writer.Write(m_VU1.m_State);
+	if(includeRam)
+	{
+		writer.Write(m_ram, PS2::EE_RAM_SIZE);
+	}
+	writer.Write(m_spr, PS2::EE_SPR_SIZE);
+	writer.Write(m_vuMem0, PS2::VUMEM0SIZE);
+	writer.Write(m_microMem0, PS2::MICROMEM0SIZE);
+	writer.Write(m_vuMem1, PS2::VUMEM1SIZE);
+	writer.Write(m_microMem1, PS2::MICROMEM1SIZE);
+
+	m_dmac.SaveRawState(writer);
+	m_sif.SaveRawState(writer);
+	m_vpu0->SaveRawState(writer);
+	m_vpu1->SaveRawState(writer);
+	m_ipu.SaveRawState(writer);
+	m_intc.SaveRawState(writer);
+	m_timer.SaveRawState(writer);
+	m_gif.SaveRawState(writer);
+	m_os->GetLibMc2().SaveRawState(writer);
+	if(m_vu1Thread)
+	{
+		m_vu1Thread->SaveRawState(writer);
+	}
+	else
+	{
+		writer.Skip(CVu1Thread::GetRawStateSize());
+	}
+}
+
+void CSubSystem::LoadRawState(CRawStateReader& reader, bool includeRam)
+{
+	if(m_vu1Thread)
+	{
+		m_vu1Thread->Reset();
+	}
+
+	m_EE.m_executor->ClearActiveBlocksInRange(0, PS2::EE_RAM_SIZE, false);
+	m_vpu0->GetContext().m_executor->ClearActiveBlocksInRange(0, PS2::MICROMEM0SIZE, false);
+	m_vpu1->GetContext().m_executor->ClearActiveBlocksInRange(0, PS2::MICROMEM1SIZE, false);
+
+	reader.Read(m_EE.m_State);
+	reader.Read(m_VU0.m_State);
+	reader.Read(m_VU1.m_State);
+	if(includeRam)
+	{
+		reader.Read(m_ram, PS2::EE_RAM_SIZE);
+	}
+	reader.Read(m_spr, PS2::EE_SPR_SIZE);
+	reader.Read(m_vuMem0, PS2::VUMEM0SIZE);
+	reader.Read(m_microMem0, PS2::MICROMEM0SIZE);
+	reader.Read(m_vuMem1, PS2::VUMEM1SIZE);
+	reader.Read(m_microMem1, PS2::MICROMEM1SIZE);
+
+	m_dmac.LoadRawState(reader);
+	m_sif.LoadRawState(reader);
+	m_vpu0->LoadRawState(reader);
+	m_vpu1->LoadRawState(reader);
+	m_ipu.LoadRawState(reader);
+	m_intc.LoadRawState(reader);
+	m_timer.LoadRawState(reader);
+	m_gif.LoadRawState(reader);
+	m_os->GetLibMc2().LoadRawState(reader);
+	if(m_vu1Thread)
+	{
+		m_vu1Thread->LoadRawState(reader);
+	}
+	else
+	{
+		reader.Skip(CVu1Thread::GetRawStateSize());
+	}
+
+	KickVu1();
 }
 
 void CSubSystem::SetupEePageTable()
 {
-	m_EE.MapPages(0x00000000, PS2::EE_RAM_SIZE, m_ram);
-	m_EE.MapPages(0x20000000, PS2::EE_RAM_SIZE, m_ram); //Uncached
-	m_EE.MapPages(0x30000000, PS2::EE_RAM_SIZE, m_ram); //Uncached + Accelerated
-	m_EE.MapPages(0x70000000, PS2::EE_SPR_SIZE, m_spr);
-	m_EE.MapPages(0x80000000, PS2::EE_RAM_SIZE, m_ram);
+	auto mapPages =
+	    [&](uint32 address, uint32 size, uint8* memory) {
+		    m_EE.MapPages(address, size, memory);
+		    if(m_fastMemory)
+		    {
+			    m_fastMemory->Map(address, memory, size);
+		    }
+	    };
+
+	mapPages(0x00000000, PS2::EE_RAM_SIZE, m_ram);
+	mapPages(0x20000000, PS2::EE_RAM_SIZE, m_ram); //Uncached
+	mapPages(0x30000000, PS2::EE_RAM_SIZE, m_ram); //Uncached + Accelerated
+	mapPages(0x70000000, PS2::EE_SPR_SIZE, m_spr);
+	mapPages(0x80000000, PS2::EE_RAM_SIZE, m_ram);
+
+	if(m_fastMemory)
+	{
+		m_EE.m_fastMemoryBase = m_fastMemory->GetBase();
+	}
 }
 
 uint32 CSubSystem::IOPortReadHandler(uint32 nAddress)
@@ -447,6 +671,7 @@ uint32 CSubSystem::IOPortReadHandler(uint32 nAddress)
 	}
 	else if(nAddress >= CVif::REGS1_START && nAddress < CVif::REGS1_END)
 	{
+		SyncVu1();
 		nReturn = m_vpu1->GetVif().GetRegister(nAddress);
 	}
 	else if(nAddress >= 0x10008000 && nAddress <= 0x1000EFFC)
@@ -528,7 +753,9 @@ uint32 CSubSystem::IOPortWriteHandler(uint32 nAddress, uint32 nData)
 	}
 	else if(nAddress >= CVif::REGS1_START && nAddress < CVif::REGS1_END)
 	{
+		SyncVu1();
 		m_vpu1->GetVif().SetRegister(nAddress, nData);
+		KickVu1();
 	}
 	else if(nAddress >= CVif::VIF0_FIFO_START && nAddress < CVif::VIF0_FIFO_END)
 	{
@@ -536,7 +763,9 @@ uint32 CSubSystem::IOPortWriteHandler(uint32 nAddress, uint32 nData)
 	}
 	else if(nAddress >= CVif::VIF1_FIFO_START && nAddress < CVif::VIF1_FIFO_END)
 	{
+		SyncVu1();
 		m_vpu1->GetVif().SetRegister(nAddress, nData);
+		KickVu1();
 	}
 	else if(nAddress >= CGIF::GIF_FIFO_START && nAddress < CGIF::GIF_FIFO_END)
 	{
@@ -559,6 +788,7 @@ uint32 CSubSystem::IOPortWriteHandler(uint32 nAddress, uint32 nData)
 	else if(nAddress == 0x1000F180)
 	{
 		//stdout data
+		m_sif.SyncIop();
 		m_iopBios.GetIoman()->Write(Iop::CIoman::FID_STDOUT, 1, &nData);
 	}
 	else if(nAddress >= 0x1000F520 && nAddress <= 0x1000F59C)
@@ -572,6 +802,7 @@ uint32 CSubSystem::IOPortWriteHandler(uint32 nAddress, uint32 nData)
 	}
 	else if(nAddress == CVpu::EE_ADDR_VU_FBRST)
 	{
+		SyncVu1();
 		m_vpu1->SetFbrst((nData >> 8) & 0xF);
 	}
 	else if(nAddress == CVpu::EE_ADDR_VU_CMSAR1)
@@ -579,7 +810,9 @@ uint32 CSubSystem::IOPortWriteHandler(uint32 nAddress, uint32 nData)
 		bool validAddress = (nData & 0x7) == 0;
 		if(validAddress)
 		{
+			SyncVu1();
 			m_vpu1->ExecuteMicroProgram(nData);
+			KickVu1();
 		}
 	}
 	else if(nAddress >= 0x12000000 && nAddress <= 0x1200108C)
@@ -669,6 +902,7 @@ void CSubSystem::Vu0StateChanged(CVpu::VU_STATE newState)
 
 uint32 CSubSystem::Vu1MicroMemWriteHandler(uint32 address, uint32 value)
 {
+	SyncVu1();
 	uint32 baseAddress = (address - PS2::MICROMEM1ADDR) & ~0x03;
 	*reinterpret_cast<uint32*>(m_microMem1 + baseAddress) = value;
 	m_vpu1->InvalidateMicroProgram(baseAddress, baseAddress + 4);
@@ -708,6 +942,19 @@ uint32 CSubSystem::Vu1IoPortWriteHandler(uint32 address, uint32 value)
 	return 0;
 }
 
+void CSubSystem::SyncVu1()
+{
+	if(!m_vu1Thread) return;
+	m_vu1Thread->Sync();
+}
+
+void CSubSystem::KickVu1()
+{
+	//Lets the worker go on with whatever the EE might have unblocked
+	if(!m_vu1Thread) return;
+	m_vu1Thread->Kick();
+}
+
 void CSubSystem::CopyVuState(CMIPS& dst, const CMIPS& src)
 {
 	memcpy(&dst.m_State.nCOP2, &src.m_State.nCOP2, sizeof(dst.m_State.nCOP2));
@@ -731,6 +978,7 @@ void CSubSystem::CopyVuState(CMIPS& dst, const CMIPS& src)
 
 uint32 CSubSystem::HandleVu1AreaRead(uint32 offset)
 {
+	SyncVu1();
 	assert(!m_vpu1->IsVuRunning());
 	assert(offset < 0x400);
 	uint32 result = 0;
@@ -752,6 +1000,7 @@ uint32 CSubSystem::HandleVu1AreaRead(uint32 offset)
 
 void CSubSystem::HandleVu1AreaWrite(uint32 offset, uint32 value)
 {
+	SyncVu1();
 	assert(!m_vpu1->IsVuRunning());
 	assert(offset < 0x400);
 	if(offset >= 0 && offset <= 0x1FF)
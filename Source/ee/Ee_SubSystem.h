@@ -1,5 +1,6 @@
 #pragma once
 
+#include <optional>
 #include "AlignedAlloc.h"
 #include "../COP_SCU.h"
 #include "../COP_FPU.h"
@@ -7,6 +8,7 @@
 #include "GIF.h"
 #include "SIF.h"
 #include "Vpu.h"
+#include "Vu1Thread.h"
 #include "IPU.h"
 #include "INTC.h"
 #include "Timer.h"
@@ -16,6 +18,7 @@
 #include "COP_VU.h"
 #include "PS2OS.h"
 #include "../gs/GSHandler.h"
+#include "../FastMemory.h"
 
 #include "signal/Signal.h"
 
@@ -24,23 +27,34 @@ namespace Ee
 	class CSubSystem
 	{
 	public:
-		CSubSystem(uint8*, CIopBios&);
+		CSubSystem(uint8*, CIopBios&, bool = false, bool = false);
 		virtual ~CSubSystem();
 
 		void Reset(uint32);
 		int ExecuteCpu(int);
 		bool IsCpuIdle() const;
 		void CountTicks(int);
+		void UpdateUnits(int);
+		//Ticks until units have something to complete, nothing if they're all idle.
+		//Units waiting on something else (ie.: DMA stalled on a busy VU) are retried after the given delay.
+		std::optional<uint32> GetUnitUpdateDelay(uint32);
 
 		void NotifyVBlankStart();
 		void NotifyVBlankEnd();
 
-		void SaveState(Framework::CZipArchiveWriter&);
-		void LoadState(Framework::CZipArchiveReader&);
+		void SaveState(Framework::CZipArchiveWriter&, bool = true);
+		void LoadState(Framework::CZipArchiveReader&, bool = true);
+
+		size_t GetRawStateSize(bool = true) const;
+		void SaveRawState(CRawStateWriter&, bool = true);
+		void LoadRawState(CRawStateReader&, bool = true);
 
 		void SetVpu0(std::shared_ptr<CVpu>);
 		void SetVpu1(std::shared_ptr<CVpu>);
 
+		//Needs to be created before the memory blocks it holds
+		std::unique_ptr<CFastMemory> m_fastMemory;
+
 		uint8* m_ram = nullptr;
 		uint8* m_bios = nullptr;
 		uint8* m_spr = nullptr;
@@ -62,6 +76,7 @@ namespace Ee
 		CSIF m_sif;
 		std::shared_ptr<CVpu> m_vpu0;
 		std::shared_ptr<CVpu> m_vpu1;
+		std::unique_ptr<CVu1Thread> m_vu1Thread;
 		CINTC m_intc;
 		CIPU m_ipu;
 		CTimer m_timer;
@@ -97,6 +112,9 @@ namespace Ee
 		uint32 Vu1IoPortReadHandler(uint32);
 		uint32 Vu1IoPortWriteHandler(uint32, uint32);
 
+		void SyncVu1();
+		void KickVu1();
+
 		void CopyVuState(CMIPS&, const CMIPS&);
 		uint32 HandleVu1AreaRead(uint32);
 		void HandleVu1AreaWrite(uint32, uint32);
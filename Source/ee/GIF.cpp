@@ -102,6 +102,47 @@ void CGIF::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_FIFO_BUFFER, m_fifoBuffer, FIFO_SIZE));
 }
 
+size_t CGIF::GetRawStateSize() const
+{
+	return sizeof(m_path3Masked) + sizeof(m_activePath) + sizeof(m_MODE) + sizeof(m_loops) +
+	       sizeof(m_cmd) + sizeof(m_regs) + sizeof(m_regsTemp) + sizeof(m_regList) + sizeof(m_eop) +
+	       sizeof(m_qtemp) + sizeof(m_path3XferActiveTicks) + sizeof(m_fifoIndex) + sizeof(m_fifoBuffer);
+}
+
+void CGIF::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_path3Masked);
+	reader.Read(m_activePath);
+	reader.Read(m_MODE);
+	reader.Read(m_loops);
+	reader.Read(m_cmd);
+	reader.Read(m_regs);
+	reader.Read(m_regsTemp);
+	reader.Read(m_regList);
+	reader.Read(m_eop);
+	reader.Read(m_qtemp);
+	reader.Read(m_path3XferActiveTicks);
+	reader.Read(m_fifoIndex);
+	reader.Read(m_fifoBuffer);
+}
+
+void CGIF::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_path3Masked);
+	writer.Write(m_activePath);
+	writer.Write(m_MODE);
+	writer.Write(m_loops);
+	writer.Write(m_cmd);
+	writer.Write(m_regs);
+	writer.Write(m_regsTemp);
+	writer.Write(m_regList);
+	writer.Write(m_eop);
+	writer.Write(m_qtemp);
+	writer.Write(m_path3XferActiveTicks);
+	writer.Write(m_fifoIndex);
+	writer.Write(m_fifoBuffer);
+}
+
 uint32 CGIF::ProcessPacked(const uint8* memory, uint32 address, uint32 end)
 {
 	uint32 start = address;
@@ -539,6 +580,11 @@ void CGIF::CountTicks(uint32 cycles)
 	m_path3XferActiveTicks = std::max<int32>(m_path3XferActiveTicks - cycles, 0);
 }
 
+uint32 CGIF::GetPath3XferActiveTicks() const
+{
+	return m_path3XferActiveTicks;
+}
+
 uint32 CGIF::GetRegister(uint32 address)
 {
 	uint32 result = 0;
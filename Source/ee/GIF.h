@@ -3,6 +3,7 @@
 #include "Types.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 #include "../gs/GSHandler.h"
 #include "../Profiler.h"
 
@@ -57,6 +58,7 @@ public:
 	uint32 ProcessMultiplePackets(const uint8*, uint32, uint32, uint32, const CGsPacketMetadata&);
 
 	void CountTicks(uint32);
+	uint32 GetPath3XferActiveTicks() const;
 
 	uint32 GetRegister(uint32);
 	void SetRegister(uint32, uint32);
@@ -69,6 +71,10 @@ public:
 	void LoadState(Framework::CZipArchiveReader&);
 	void SaveState(Framework::CZipArchiveWriter&);
 
+	size_t GetRawStateSize() const;
+	void LoadRawState(CRawStateReader&);
+	void SaveRawState(CRawStateWriter&);
+
 private:
 	enum
 	{
@@ -76,3 +76,20 @@ void CINTC::SaveState(Framework::CZipArchiveWriter& archive)
 	registerFile->SetRegister32("INTC_MASK", m_INTC_MASK);
 	archive.InsertFile(std::move(registerFile));
 }
+
+size_t CINTC::GetRawStateSize() const
+{
+	return sizeof(m_INTC_STAT) + sizeof(m_INTC_MASK);
+}
+
+void CINTC::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_INTC_STAT);
+	reader.Read(m_INTC_MASK);
+}
+
+void CINTC::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_INTC_STAT);
+	writer.Write(m_INTC_MASK);
+}
@@ -4,6 +4,7 @@
 #include "DMAC.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 
 class CINTC
 {
@@ -45,6 +46,10 @@ public:
 	void LoadState(Framework::CZipArchiveReader&);
 	void SaveState(Framework::CZipArchiveWriter&);
 
+	size_t GetRawStateSize() const;
+	void LoadRawState(CRawStateReader&);
+	void SaveRawState(CRawStateWriter&);
+
 private:
 	uint32 m_INTC_STAT;
 	uint32 m_INTC_MASK;
@@ -13,6 +13,7 @@
 #include "IPU_MacroblockTypeBTable.h"
 #include "IPU_MotionCodeTable.h"
 #include "IPU_DmVectorTable.h"
+#include "IPU_Kernels.h"
 #include "mpeg2/DcSizeLuminanceTable.h"
 #include "mpeg2/DcSizeChrominanceTable.h"
 #include "mpeg2/DctCoefficientTable0.h"
@@ -20,8 +21,6 @@
 #include "mpeg2/CodedBlockPatternTable.h"
 #include "mpeg2/QuantiserScaleTable.h"
 #include "mpeg2/InverseScanTable.h"
-#include "idct/TrivialC.h"
-#include "idct/IEEE1180.h"
 #include "Log.h"
 #include "DMAC.h"
 #include "INTC.h"
@@ -237,6 +236,11 @@ void CIPU::SetRegister(uint32 nAddress, uint32 nValue)
 	DisassembleSet(nAddress, nValue);
 #endif
 
+	if(m_captureStream)
+	{
+		CaptureRecord(CAPTURE_RECORD_REGISTER, nAddress, nValue);
+	}
+
 	switch(nAddress)
 	{
 	case IPU_CMD + 0x0:
@@ -349,6 +353,54 @@ void CIPU::LoadState(Framework::CZipArchiveReader& archive)
 	assert(m_currentCmdId == IPU_INVALID_CMDID);
 }
 
+size_t CIPU::GetRawStateSize() const
+{
+	return sizeof(m_IPU_CTRL) + sizeof(m_IPU_CMD) + sizeof(m_nTH0) + sizeof(m_nTH1) +
+	       sizeof(m_currentCmdId) + sizeof(m_lastCmdId) + sizeof(m_isBusy) + sizeof(m_nDcPredictor) +
+	       m_IN_FIFO.GetRawStateSize() +
+	       sizeof(m_nIntraIQ) + sizeof(m_nNonIntraIQ) + sizeof(m_nVQCLUT);
+}
+
+void CIPU::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_IPU_CTRL);
+	writer.Write(m_IPU_CMD);
+	writer.Write(m_nTH0);
+	writer.Write(m_nTH1);
+	writer.Write(m_currentCmdId);
+	writer.Write(m_lastCmdId);
+	writer.Write(m_isBusy);
+	writer.Write(m_nDcPredictor);
+
+	m_IN_FIFO.SaveRawState(writer);
+
+	writer.Write(m_nIntraIQ);
+	writer.Write(m_nNonIntraIQ);
+	writer.Write(m_nVQCLUT);
+
+	assert(m_currentCmdId == IPU_INVALID_CMDID);
+}
+
+void CIPU::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_IPU_CTRL);
+	reader.Read(m_IPU_CMD);
+	reader.Read(m_nTH0);
+	reader.Read(m_nTH1);
+	reader.Read(m_currentCmdId);
+	reader.Read(m_lastCmdId);
+	reader.Read(m_isBusy);
+	reader.Read(m_nDcPredictor);
+
+	m_IN_FIFO.LoadRawState(reader);
+
+	reader.Read(m_nIntraIQ);
+	reader.Read(m_nNonIntraIQ);
+	reader.Read(m_nVQCLUT);
+
+	assert(m_currentCmdId == IPU_INVALID_CMDID);
+}
+
 void CIPU::CountTicks(uint32 ticks)
 {
 	if(m_currentCmdId != IPU_INVALID_CMDID)
@@ -366,6 +418,15 @@ bool CIPU::IsCommandDelayed() const
 	return false;
 }
 
+uint32 CIPU::GetCommandDelayTicks() const
+{
+	if(m_currentCmdId != IPU_INVALID_CMDID)
+	{
+		return m_commands[m_currentCmdId]->GetDelayTicks();
+	}
+	return 0;
+}
+
 void CIPU::ExecuteCommand()
 {
 	assert(WillExecuteCommand());
@@ -488,11 +549,28 @@ uint32 CIPU::ReceiveDMA4(uint32 address, uint32 nQWC, bool nTagIncluded, uint8*
 	if(size != 0)
 	{
 		m_IN_FIFO.Write(memory + address, size);
+		if(m_captureStream)
+		{
+			CaptureRecord(CAPTURE_RECORD_INFIFO, size, 0);
+			m_captureStream->Write(memory + address, size);
+		}
 	}
 
 	return size / 0x10;
 }
 
+void CIPU::SetCaptureStream(Framework::CStream* stream)
+{
+	m_captureStream = stream;
+}
+
+void CIPU::CaptureRecord(uint32 type, uint32 param0, uint32 param1)
+{
+	m_captureStream->Write32(type);
+	m_captureStream->Write32(param0);
+	m_captureStream->Write32(param1);
+}
+
 CIPU::DECODER_CONTEXT CIPU::GetDecoderContext()
 {
 	DECODER_CONTEXT context;
@@ -996,6 +1074,26 @@ void CIPU::CINFIFO::LoadState(const char* regsFileName, Framework::CZipArchiveRe
 	m_lookupBitsDirty = true;
 }
 
+size_t CIPU::CINFIFO::GetRawStateSize() const
+{
+	return sizeof(m_size) + sizeof(m_bitPosition) + sizeof(m_buffer);
+}
+
+void CIPU::CINFIFO::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_size);
+	writer.Write(m_bitPosition);
+	writer.Write(m_buffer);
+}
+
+void CIPU::CINFIFO::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_size);
+	reader.Read(m_bitPosition);
+	reader.Read(m_buffer);
+	m_lookupBitsDirty = true;
+}
+
 void CIPU::CINFIFO::SyncLookupBits()
 {
 	unsigned int lookupPosition = (m_bitPosition & ~0x1F) / 8;
@@ -1256,6 +1354,11 @@ bool CIPU::CIDECCommand::IsDelayed() const
 	return (m_state == STATE_DELAY);
 }
 
+uint32 CIPU::CIDECCommand::GetDelayTicks() const
+{
+	return std::max<int32>(m_delayTicks, 0);
+}
+
 void CIPU::CIDECCommand::ConvertRawBlock()
 {
 	//Convert block from RAW16 to RAW8
@@ -1400,15 +1503,12 @@ bool CIPU::CBDECCommand::Execute()
 			}
 
 			BLOCKENTRY& blockInfo(m_blocks[m_currentBlockIndex]);
-			int16 blockTemp[0x40];
 
 			DequantiseBlock(blockInfo.block, (m_command.mbi != 0), m_command.qsc,
 			                m_context.isLinearQScale, m_context.dcPrecision, m_context.intraIq, m_context.nonIntraIq);
 			InverseScan(blockInfo.block, m_context.isZigZag);
 
-			memcpy(blockTemp, blockInfo.block, sizeof(int16) * 0x40);
-
-			IDCT::CIEEE1180::GetInstance()->Transform(blockTemp, blockInfo.block);
+			Kernels::Idct(blockInfo.block, blockInfo.block);
 
 			m_state = STATE_DECODEBLOCK_GOTONEXT;
 		}
@@ -1893,11 +1993,6 @@ bool CIPU::CSETVQCommand::Execute()
 //CSC command implementation
 /////////////////////////////////////////////
 
-CIPU::CCSCCommand::CCSCCommand()
-{
-	GenerateCbCrMap();
-}
-
 void CIPU::CCSCCommand::Initialize(CINFIFO* input, COUTFIFO* output, uint32 commandCode, uint16 TH0, uint16 TH1)
 {
 	m_command <<= commandCode;
@@ -1953,80 +2048,24 @@ bool CIPU::CCSCCommand::Execute()
 		break;
 		case STATE_CONVERTBLOCK:
 		{
-			uint32 nPixel[0x100];
-
-			uint8* pY = m_block;
-			uint8* nBlockCb = m_block + 0x100;
-			uint8* nBlockCr = m_block + 0x140;
-
-			uint32* pPixel = nPixel;
-			unsigned int* pCbCrMap = m_nCbCrMap;
+			uint32 nPixel[Kernels::MACROBLOCK_PIXEL_COUNT];
 
 			uint16 alphaTh0 = (m_TH0 & 0x1FF);
 			uint16 alphaTh1 = (m_TH1 & 0x1FF);
 
-			for(unsigned int i = 0; i < 16; i++)
-			{
-				for(unsigned int j = 0; j < 16; j++)
-				{
-					float nY = pY[j];
-					float nCb = nBlockCb[pCbCrMap[j]];
-					float nCr = nBlockCr[pCbCrMap[j]];
-
-					float nR = nY + 1.402f * (nCr - 128);
-					float nG = nY - 0.34414f * (nCb - 128) - 0.71414f * (nCr - 128);
-					float nB = nY + 1.772f * (nCb - 128);
-
-					nR = std::clamp(nR, 0.f, 255.f);
-					nG = std::clamp(nG, 0.f, 255.f);
-					nB = std::clamp(nB, 0.f, 255.f);
-
-					uint8 a = 0;
-					uint8 r = static_cast<uint8>(nR);
-					uint8 g = static_cast<uint8>(nG);
-					uint8 b = static_cast<uint8>(nB);
-
-					if(r < alphaTh0 && g < alphaTh0 && b < alphaTh0)
-					{
-						a = 0;
-					}
-					else if(r < alphaTh1 && g < alphaTh1 && b < alphaTh1)
-					{
-						a = 0x40;
-					}
-					else
-					{
-						a = 0x80;
-					}
-
-					pPixel[j] = (a << 24) | (b << 16) | (g << 8) | (r << 0);
-				}
-
-				pY += 0x10;
-				pCbCrMap += 0x10;
-				pPixel += 0x10;
-			}
+			Kernels::ConvertYCbCrToRgba32(m_block, nPixel, alphaTh0, alphaTh1);
 
 			if(m_command.ofm == 1)
 			{
 				//RGBA16 output
-				uint16 cvtPixels[0x100];
-				for(uint32 i = 0; i < 0x100; i++)
-				{
-					uint32 pixel = nPixel[i];
-					uint16 result = 0;
-					result |= ((pixel & 0x000000F8) >> (0 + 3)) << 0;
-					result |= ((pixel & 0x0000F800) >> (8 + 3)) << 5;
-					result |= ((pixel & 0x00F80000) >> (16 + 3)) << 10;
-					result |= ((pixel & 0x80000000) >> 31) << 15;
-					cvtPixels[i] = result;
-				}
-				m_OUT_FIFO->Write(cvtPixels, sizeof(uint16) * 0x100);
+				uint16 cvtPixels[Kernels::MACROBLOCK_PIXEL_COUNT];
+				Kernels::ConvertRgba32ToRgba16(nPixel, cvtPixels, Kernels::MACROBLOCK_PIXEL_COUNT);
+				m_OUT_FIFO->Write(cvtPixels, sizeof(cvtPixels));
 			}
 			else
 			{
 				//RGBA32 output
-				m_OUT_FIFO->Write(nPixel, sizeof(uint32) * 0x100);
+				m_OUT_FIFO->Write(nPixel, sizeof(nPixel));
 			}
 
 			m_mbCount--;
@@ -2050,24 +2089,6 @@ bool CIPU::CCSCCommand::Execute()
 	}
 }
 
-void CIPU::CCSCCommand::GenerateCbCrMap()
-{
-	unsigned int* pCbCrMap = m_nCbCrMap;
-	for(unsigned int i = 0; i < 0x40; i += 0x8)
-	{
-		for(unsigned int j = 0; j < 0x10; j += 2)
-		{
-			pCbCrMap[j + 0x00] = (j / 2) + i;
-			pCbCrMap[j + 0x01] = (j / 2) + i;
-
-			pCbCrMap[j + 0x10] = (j / 2) + i;
-			pCbCrMap[j + 0x11] = (j / 2) + i;
-		}
-
-		pCbCrMap += 0x20;
-	}
-}
-
 /////////////////////////////////////////////
 //SETTH command implementation
 /////////////////////////////////////////////
@@ -6,12 +6,14 @@
 #include "Types.h"
 #include "BitStream.h"
 #include "MemStream.h"
+#include "Stream.h"
 #include "mpeg2/VLCTable.h"
 #include "mpeg2/DctCoefficientTable.h"
 #include "../MailBox.h"
 #include "Convertible.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 
 class CINTC;
 
@@ -33,6 +35,15 @@ public:
 		IPU_IN_FIFO = 0x10007010,
 	};
 
+	//Capture streams are a sequence of records made of a type and two parameters:
+	//- CAPTURE_RECORD_REGISTER: register address and value
+	//- CAPTURE_RECORD_INFIFO: data size in bytes (followed by the data) and 0
+	enum CAPTURE_RECORD_TYPE
+	{
+		CAPTURE_RECORD_REGISTER,
+		CAPTURE_RECORD_INFIFO,
+	};
+
 	void Reset();
 	uint32 GetRegister(uint32);
 	void SetRegister(uint32, uint32);
@@ -40,13 +51,21 @@ public:
 	void SaveState(Framework::CZipArchiveWriter&);
 	void LoadState(Framework::CZipArchiveReader&);
 
+	size_t GetRawStateSize() const;
+	void SaveRawState(CRawStateWriter&);
+	void LoadRawState(CRawStateReader&);
+
 	void SetDMA3ReceiveHandler(const Dma3ReceiveHandler&);
 	uint32 ReceiveDMA4(uint32, uint32, bool, uint8*, uint8*);
 
+	//Records everything written to the IPU, used to replay FMVs in benchmarks
+	void SetCaptureStream(Framework::CStream*);
+
 	void CountTicks(uint32);
 	void ExecuteCommand();
 	bool WillExecuteCommand() const;
 	bool IsCommandDelayed() const;
+	uint32 GetCommandDelayTicks() const;
 	bool HasPendingOUTFIFOData() const;
 	void FlushOUTFIFOData();
 
@@ -178,6 +197,10 @@ private:
 		void SaveState(const char*, Framework::CZipArchiveWriter&);
 		void LoadState(const char*, Framework::CZipArchiveReader&);
 
+		size_t GetRawStateSize() const;
+		void SaveRawState(CRawStateWriter&);
+		void LoadRawState(CRawStateReader&);
+
 		enum BUFFERSIZE
 		{
 			BUFFERSIZE = 0xF0,
@@ -209,6 +232,10 @@ private:
 		{
 			return false;
 		}
+		virtual uint32 GetDelayTicks() const
+		{
+			return 0;
+		}
 
 	private:
 	};
@@ -239,6 +266,7 @@ private:
 		bool Execute() override;
 		void CountTicks(uint32) override;
 		bool IsDelayed() const override;
+		uint32 GetDelayTicks() const override;
 
 	private:
 		enum STATE
@@ -464,8 +492,6 @@ private:
 			BLOCK_SIZE = 0x180,
 		};
 
-		CCSCCommand();
-
 		void Initialize(CINFIFO*, COUTFIFO*, uint32, uint16, uint16);
 		bool Execute() override;
 
@@ -479,8 +505,6 @@ private:
 			STATE_DONE,
 		};
 
-		void GenerateCbCrMap();
-
 		STATE m_state = STATE_DONE;
 		CMD_CSC m_command = make_convertible<CMD_CSC>(0);
 
@@ -492,8 +516,6 @@ private:
 		unsigned int m_currentIndex = 0;
 		unsigned int m_mbCount = 0;
 
-		unsigned int m_nCbCrMap[0x100];
-
 		uint8 m_block[BLOCK_SIZE];
 	};
 
@@ -532,7 +554,10 @@ private:
 	void DisassembleSet(uint32, uint32);
 	void DisassembleCommand(uint32);
 
+	void CaptureRecord(uint32, uint32, uint32);
+
 	CINTC& m_intc;
+	Framework::CStream* m_captureStream = nullptr;
 
 	uint8 m_nIntraIQ[0x40];
 	uint8 m_nNonIntraIQ[0x40];
@@ -0,0 +1,402 @@
+#include <cassert>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "SimdDefs.h"
+#include "idct/IEEE1180.h"
+#include "IPU_Kernels.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(FRAMEWORK_SIMD_USE_SSE) || (defined(FRAMEWORK_SIMD_USE_NEON) && defined(__aarch64__))
+#define HAS_SIMD_IDCT
+#endif
+
+using namespace IPU;
+
+static const float g_crToR = 1.402f;
+static const float g_cbToG = 0.34414f;
+static const float g_crToG = 0.71414f;
+static const float g_cbToB = 1.772f;
+
+#ifdef HAS_SIMD_IDCT
+
+static const double g_pi = 3.14159265358979323846;
+
+//Same coefficients as the IEEE1180 reference transform. Computations are done in double
+//precision and each output is accumulated in the same order as the reference, which
+//guarantees identical results.
+struct IDCT_COEFFICIENTS
+{
+	IDCT_COEFFICIENTS()
+	{
+		for(unsigned int freq = 0; freq < 8; freq++)
+		{
+			double scale = (freq == 0) ? sqrt(0.125) : 0.5;
+			for(unsigned int time = 0; time < 8; time++)
+			{
+				c[freq][time] = scale * cos((g_pi / 8.0) * freq * (time + 0.5));
+			}
+		}
+	}
+
+	double c[8][8];
+};
+
+static const IDCT_COEFFICIENTS g_idctCoefficients;
+
+#endif
+
+void Kernels::Idct(const int16* input, int16* output)
+{
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	const auto& c = g_idctCoefficients.c;
+	alignas(16) double tmp[64];
+
+	//Rows: tmp[i][j] = sum(c[k][j] * input[i][k])
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		__m128d acc[4] = {_mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd()};
+		for(unsigned int k = 0; k < 8; k++)
+		{
+			__m128d value = _mm_set1_pd(input[(8 * i) + k]);
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				acc[j] = _mm_add_pd(acc[j], _mm_mul_pd(_mm_loadu_pd(&c[k][j * 2]), value));
+			}
+		}
+		for(unsigned int j = 0; j < 4; j++)
+		{
+			_mm_store_pd(tmp + (8 * i) + (j * 2), acc[j]);
+		}
+	}
+
+	//Columns: output[i][j] = round(sum(c[k][i] * tmp[k][j]))
+	const __m128d half = _mm_set1_pd(0.5);
+	const __m128d one = _mm_set1_pd(1.0);
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		__m128d acc[4] = {_mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd()};
+		for(unsigned int k = 0; k < 8; k++)
+		{
+			__m128d coef = _mm_set1_pd(c[k][i]);
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				acc[j] = _mm_add_pd(acc[j], _mm_mul_pd(coef, _mm_load_pd(tmp + (8 * k) + (j * 2))));
+			}
+		}
+
+		__m128i result[4];
+		for(unsigned int j = 0; j < 4; j++)
+		{
+			//floor(x + 0.5), values are small enough to go through int32 without loss
+			__m128d value = _mm_add_pd(acc[j], half);
+			__m128d truncated = _mm_cvtepi32_pd(_mm_cvttpd_epi32(value));
+			__m128d adjust = _mm_and_pd(_mm_cmpgt_pd(truncated, value), one);
+			result[j] = _mm_cvttpd_epi32(_mm_sub_pd(truncated, adjust));
+		}
+
+		__m128i row = _mm_packs_epi32(
+		    _mm_unpacklo_epi64(result[0], result[1]),
+		    _mm_unpacklo_epi64(result[2], result[3]));
+		row = _mm_max_epi16(row, _mm_set1_epi16(-256));
+		row = _mm_min_epi16(row, _mm_set1_epi16(255));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + (8 * i)), row);
+	}
+#elif defined(HAS_SIMD_IDCT)
+	const auto& c = g_idctCoefficients.c;
+	double tmp[64];
+
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		float64x2_t acc[4] = {vdupq_n_f64(0), vdupq_n_f64(0), vdupq_n_f64(0), vdupq_n_f64(0)};
+		for(unsigned int k = 0; k < 8; k++)
+		{
+			float64x2_t value = vdupq_n_f64(input[(8 * i) + k]);
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				//Multiply and add are kept separate to match the reference's rounding
+				acc[j] = vaddq_f64(acc[j], vmulq_f64(vld1q_f64(&c[k][j * 2]), value));
+			}
+		}
+		for(unsigned int j = 0; j < 4; j++)
+		{
+			vst1q_f64(tmp + (8 * i) + (j * 2), acc[j]);
+		}
+	}
+
+	const float64x2_t half = vdupq_n_f64(0.5);
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		float64x2_t acc[4] = {vdupq_n_f64(0), vdupq_n_f64(0), vdupq_n_f64(0), vdupq_n_f64(0)};
+		for(unsigned int k = 0; k < 8; k++)
+		{
+			float64x2_t coef = vdupq_n_f64(c[k][i]);
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				acc[j] = vaddq_f64(acc[j], vmulq_f64(coef, vld1q_f64(tmp + (8 * k) + (j * 2))));
+			}
+		}
+
+		int32x4_t result[2];
+		for(unsigned int j = 0; j < 2; j++)
+		{
+			int64x2_t lo = vcvtq_s64_f64(vrndmq_f64(vaddq_f64(acc[(j * 2) + 0], half)));
+			int64x2_t hi = vcvtq_s64_f64(vrndmq_f64(vaddq_f64(acc[(j * 2) + 1], half)));
+			result[j] = vcombine_s32(vmovn_s64(lo), vmovn_s64(hi));
+		}
+
+		int16x8_t row = vcombine_s16(vqmovn_s32(result[0]), vqmovn_s32(result[1]));
+		row = vmaxq_s16(row, vdupq_n_s16(-256));
+		row = vminq_s16(row, vdupq_n_s16(255));
+		vst1q_s16(output + (8 * i), row);
+	}
+#else
+	IdctScalar(input, output);
+#endif
+}
+
+void Kernels::IdctScalar(const int16* input, int16* output)
+{
+	int16 block[0x40];
+	memcpy(block, input, sizeof(block));
+	IDCT::CIEEE1180::GetInstance()->Transform(block, output);
+}
+
+void Kernels::ConvertYCbCrToRgba32(const uint8* block, uint32* pixels, uint16 alphaTh0, uint16 alphaTh1)
+{
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	const uint8* blockY = block;
+	const uint8* blockCb = block + 0x100;
+	const uint8* blockCr = block + 0x140;
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 bias = _mm_set1_ps(128.f);
+	const __m128 minValue = _mm_setzero_ps();
+	const __m128 maxValue = _mm_set1_ps(255.f);
+	const __m128 crToR = _mm_set1_ps(g_crToR);
+	const __m128 cbToG = _mm_set1_ps(g_cbToG);
+	const __m128 crToG = _mm_set1_ps(g_crToG);
+	const __m128 cbToB = _mm_set1_ps(g_cbToB);
+	const __m128i th0 = _mm_set1_epi32(alphaTh0);
+	const __m128i th1 = _mm_set1_epi32(alphaTh1);
+	const __m128i alphaHigh = _mm_set1_epi32(0x80);
+	const __m128i alphaStep = _mm_set1_epi32(0x40);
+
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		//Each chroma sample covers 2x2 pixels
+		__m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blockY + (i * 16)));
+		__m128i cb8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(blockCb + ((i / 2) * 8)));
+		__m128i cr8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(blockCr + ((i / 2) * 8)));
+		cb8 = _mm_unpacklo_epi8(cb8, cb8);
+		cr8 = _mm_unpacklo_epi8(cr8, cr8);
+
+		__m128i y16[2] = {_mm_unpacklo_epi8(y8, zero), _mm_unpackhi_epi8(y8, zero)};
+		__m128i cb16[2] = {_mm_unpacklo_epi8(cb8, zero), _mm_unpackhi_epi8(cb8, zero)};
+		__m128i cr16[2] = {_mm_unpacklo_epi8(cr8, zero), _mm_unpackhi_epi8(cr8, zero)};
+
+		for(unsigned int j = 0; j < 4; j++)
+		{
+			auto widen = [&](const __m128i* values) {
+				__m128i value16 = values[j / 2];
+				__m128i value32 = (j & 1) ? _mm_unpackhi_epi16(value16, zero) : _mm_unpacklo_epi16(value16, zero);
+				return _mm_cvtepi32_ps(value32);
+			};
+
+			__m128 y = widen(y16);
+			__m128 cb = _mm_sub_ps(widen(cb16), bias);
+			__m128 cr = _mm_sub_ps(widen(cr16), bias);
+
+			__m128 r = _mm_add_ps(y, _mm_mul_ps(crToR, cr));
+			__m128 g = _mm_sub_ps(_mm_sub_ps(y, _mm_mul_ps(cbToG, cb)), _mm_mul_ps(crToG, cr));
+			__m128 b = _mm_add_ps(y, _mm_mul_ps(cbToB, cb));
+
+			__m128i ri = _mm_cvttps_epi32(_mm_max_ps(_mm_min_ps(r, maxValue), minValue));
+			__m128i gi = _mm_cvttps_epi32(_mm_max_ps(_mm_min_ps(g, maxValue), minValue));
+			__m128i bi = _mm_cvttps_epi32(_mm_max_ps(_mm_min_ps(b, maxValue), minValue));
+
+			__m128i belowTh0 = _mm_and_si128(_mm_and_si128(_mm_cmplt_epi32(ri, th0), _mm_cmplt_epi32(gi, th0)), _mm_cmplt_epi32(bi, th0));
+			__m128i belowTh1 = _mm_and_si128(_mm_and_si128(_mm_cmplt_epi32(ri, th1), _mm_cmplt_epi32(gi, th1)), _mm_cmplt_epi32(bi, th1));
+			__m128i a = _mm_andnot_si128(belowTh0, _mm_sub_epi32(alphaHigh, _mm_and_si128(belowTh1, alphaStep)));
+
+			__m128i pixel = _mm_or_si128(
+			    _mm_or_si128(ri, _mm_slli_epi32(gi, 8)),
+			    _mm_or_si128(_mm_slli_epi32(bi, 16), _mm_slli_epi32(a, 24)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + (i * 16) + (j * 4)), pixel);
+		}
+	}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	const uint8* blockY = block;
+	const uint8* blockCb = block + 0x100;
+	const uint8* blockCr = block + 0x140;
+
+	const float32x4_t bias = vdupq_n_f32(128.f);
+	const float32x4_t minValue = vdupq_n_f32(0.f);
+	const float32x4_t maxValue = vdupq_n_f32(255.f);
+	const float32x4_t crToR = vdupq_n_f32(g_crToR);
+	const float32x4_t cbToG = vdupq_n_f32(g_cbToG);
+	const float32x4_t crToG = vdupq_n_f32(g_crToG);
+	const float32x4_t cbToB = vdupq_n_f32(g_cbToB);
+	const uint32x4_t th0 = vdupq_n_u32(alphaTh0);
+	const uint32x4_t th1 = vdupq_n_u32(alphaTh1);
+	const uint32x4_t alphaHigh = vdupq_n_u32(0x80);
+	const uint32x4_t alphaStep = vdupq_n_u32(0x40);
+
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		//Each chroma sample covers 2x2 pixels
+		uint8x16_t y8 = vld1q_u8(blockY + (i * 16));
+		uint8x8_t cbRow = vld1_u8(blockCb + ((i / 2) * 8));
+		uint8x8_t crRow = vld1_u8(blockCr + ((i / 2) * 8));
+		uint8x8x2_t cb8 = vzip_u8(cbRow, cbRow);
+		uint8x8x2_t cr8 = vzip_u8(crRow, crRow);
+
+		uint16x8_t y16[2] = {vmovl_u8(vget_low_u8(y8)), vmovl_u8(vget_high_u8(y8))};
+		uint16x8_t cb16[2] = {vmovl_u8(cb8.val[0]), vmovl_u8(cb8.val[1])};
+		uint16x8_t cr16[2] = {vmovl_u8(cr8.val[0]), vmovl_u8(cr8.val[1])};
+
+		for(unsigned int j = 0; j < 4; j++)
+		{
+			auto widen = [&](const uint16x8_t* values) {
+				uint16x8_t value16 = values[j / 2];
+				uint32x4_t value32 = (j & 1) ? vmovl_u16(vget_high_u16(value16)) : vmovl_u16(vget_low_u16(value16));
+				return vcvtq_f32_u32(value32);
+			};
+
+			float32x4_t y = widen(y16);
+			float32x4_t cb = vsubq_f32(widen(cb16), bias);
+			float32x4_t cr = vsubq_f32(widen(cr16), bias);
+
+			float32x4_t r = vaddq_f32(y, vmulq_f32(crToR, cr));
+			float32x4_t g = vsubq_f32(vsubq_f32(y, vmulq_f32(cbToG, cb)), vmulq_f32(crToG, cr));
+			float32x4_t b = vaddq_f32(y, vmulq_f32(cbToB, cb));
+
+			uint32x4_t ri = vcvtq_u32_f32(vmaxq_f32(vminq_f32(r, maxValue), minValue));
+			uint32x4_t gi = vcvtq_u32_f32(vmaxq_f32(vminq_f32(g, maxValue), minValue));
+			uint32x4_t bi = vcvtq_u32_f32(vmaxq_f32(vminq_f32(b, maxValue), minValue));
+
+			uint32x4_t belowTh0 = vandq_u32(vandq_u32(vcltq_u32(ri, th0), vcltq_u32(gi, th0)), vcltq_u32(bi, th0));
+			uint32x4_t belowTh1 = vandq_u32(vandq_u32(vcltq_u32(ri, th1), vcltq_u32(gi, th1)), vcltq_u32(bi, th1));
+			uint32x4_t a = vbicq_u32(vsubq_u32(alphaHigh, vandq_u32(belowTh1, alphaStep)), belowTh0);
+
+			uint32x4_t pixel = vorrq_u32(
+			    vorrq_u32(ri, vshlq_n_u32(gi, 8)),
+			    vorrq_u32(vshlq_n_u32(bi, 16), vshlq_n_u32(a, 24)));
+			vst1q_u32(pixels + (i * 16) + (j * 4), pixel);
+		}
+	}
+#else
+	ConvertYCbCrToRgba32Scalar(block, pixels, alphaTh0, alphaTh1);
+#endif
+}
+
+void Kernels::ConvertYCbCrToRgba32Scalar(const uint8* block, uint32* pixels, uint16 alphaTh0, uint16 alphaTh1)
+{
+	const uint8* pY = block;
+	const uint8* nBlockCb = block + 0x100;
+	const uint8* nBlockCr = block + 0x140;
+
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		for(unsigned int j = 0; j < 16; j++)
+		{
+			unsigned int cbCrIndex = ((i / 2) * 8) + (j / 2);
+
+			float nY = pY[j];
+			float nCb = nBlockCb[cbCrIndex];
+			float nCr = nBlockCr[cbCrIndex];
+
+			float nR = nY + g_crToR * (nCr - 128);
+			float nG = nY - g_cbToG * (nCb - 128) - g_crToG * (nCr - 128);
+			float nB = nY + g_cbToB * (nCb - 128);
+
+			nR = std::clamp(nR, 0.f, 255.f);
+			nG = std::clamp(nG, 0.f, 255.f);
+			nB = std::clamp(nB, 0.f, 255.f);
+
+			uint8 a = 0;
+			uint8 r = static_cast<uint8>(nR);
+			uint8 g = static_cast<uint8>(nG);
+			uint8 b = static_cast<uint8>(nB);
+
+			if(r < alphaTh0 && g < alphaTh0 && b < alphaTh0)
+			{
+				a = 0;
+			}
+			else if(r < alphaTh1 && g < alphaTh1 && b < alphaTh1)
+			{
+				a = 0x40;
+			}
+			else
+			{
+				a = 0x80;
+			}
+
+			pixels[j] = (a << 24) | (b << 16) | (g << 8) | (r << 0);
+		}
+
+		pY += 0x10;
+		pixels += 0x10;
+	}
+}
+
+void Kernels::ConvertRgba32ToRgba16(const uint32* input, uint16* output, unsigned int count)
+{
+	unsigned int i = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	const __m128i maskR = _mm_set1_epi32(0x000000F8);
+	const __m128i maskG = _mm_set1_epi32(0x0000F800);
+	const __m128i maskB = _mm_set1_epi32(0x00F80000);
+	const __m128i maskA = _mm_set1_epi32(0x80000000);
+	auto convert = [&](__m128i pixel) {
+		__m128i result = _mm_or_si128(
+		    _mm_or_si128(_mm_srli_epi32(_mm_and_si128(pixel, maskR), 3), _mm_srli_epi32(_mm_and_si128(pixel, maskG), 6)),
+		    _mm_or_si128(_mm_srli_epi32(_mm_and_si128(pixel, maskB), 9), _mm_srli_epi32(_mm_and_si128(pixel, maskA), 16)));
+		//Sign extend so that the saturating pack keeps the value intact
+		return _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+	};
+	for(; (i + 8) <= count; i += 8)
+	{
+		__m128i pixel0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 0));
+		__m128i pixel1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 4));
+		__m128i result = _mm_packs_epi32(convert(pixel0), convert(pixel1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), result);
+	}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	const uint32x4_t maskR = vdupq_n_u32(0x000000F8);
+	const uint32x4_t maskG = vdupq_n_u32(0x0000F800);
+	const uint32x4_t maskB = vdupq_n_u32(0x00F80000);
+	const uint32x4_t maskA = vdupq_n_u32(0x80000000);
+	auto convert = [&](uint32x4_t pixel) {
+		uint32x4_t result = vorrq_u32(
+		    vorrq_u32(vshrq_n_u32(vandq_u32(pixel, maskR), 3), vshrq_n_u32(vandq_u32(pixel, maskG), 6)),
+		    vorrq_u32(vshrq_n_u32(vandq_u32(pixel, maskB), 9), vshrq_n_u32(vandq_u32(pixel, maskA), 16)));
+		return vmovn_u32(result);
+	};
+	for(; (i + 8) <= count; i += 8)
+	{
+		uint16x8_t result = vcombine_u16(convert(vld1q_u32(input + i + 0)), convert(vld1q_u32(input + i + 4)));
+		vst1q_u16(output + i, result);
+	}
+#endif
+	ConvertRgba32ToRgba16Scalar(input + i, output + i, count - i);
+}
+
+void Kernels::ConvertRgba32ToRgba16Scalar(const uint32* input, uint16* output, unsigned int count)
+{
+	for(unsigned int i = 0; i < count; i++)
+	{
+		uint32 pixel = input[i];
+		uint16 result = 0;
+		result |= ((pixel & 0x000000F8) >> (0 + 3)) << 0;
+		result |= ((pixel & 0x0000F800) >> (8 + 3)) << 5;
+		result |= ((pixel & 0x00F80000) >> (16 + 3)) << 10;
+		result |= ((pixel & 0x80000000) >> 31) << 15;
+		output[i] = result;
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Types.h"
+
+namespace IPU
+{
+	//Data parallel parts of the IPU's decoding pipeline.
+	//Vectorized versions produce the same output as the scalar ones.
+	namespace Kernels
+	{
+		enum
+		{
+			MACROBLOCK_PIXEL_COUNT = 0x100,
+		};
+
+		//Input and output can point to the same block
+		void Idct(const int16*, int16*);
+		void IdctScalar(const int16*, int16*);
+
+		//Converts a 16x16 macroblock (Y, followed by 8x8 Cb and Cr) to RGBA32 with alpha thresholds applied
+		void ConvertYCbCrToRgba32(const uint8*, uint32*, uint16, uint16);
+		void ConvertYCbCrToRgba32Scalar(const uint8*, uint32*, uint16, uint16);
+
+		void ConvertRgba32ToRgba16(const uint32*, uint16*, unsigned int);
+		void ConvertRgba32ToRgba16Scalar(const uint32*, uint16*, unsigned int);
+	}
+}
@@ -214,7 +214,7 @@ CPS2OS::CPS2OS(CMIPS& ee, uint8* ram, uint8* bios, uint8* spr, CGSHandler*& gs,
     , m_bios(bios)
     , m_spr(spr)
     , m_sif(sif)
-    , m_libMc2(ram, *this, iopBios)
+    , m_libMc2(ram, *this, iopBios, sif)
     , m_iopBios(iopBios)
     , m_deci2Handlers(reinterpret_cast<DECI2HANDLER*>(m_ram + BIOS_ADDRESS_DECI2HANDLER_BASE), BIOS_ID_BASE, MAX_DECI2HANDLER)
     , m_threads(reinterpret_cast<THREAD*>(m_ram + BIOS_ADDRESS_THREAD_BASE), BIOS_ID_BASE, MAX_THREAD)
@@ -3106,6 +3106,7 @@ void CPS2OS::sc_Deci2Call()
 					assert(sendInfo->size >= 0x0C);
 					if(sendInfo->size >= 0x0C)
 					{
+						m_sif.SyncIop();
 						m_iopBios.GetIoman()->Write(Iop::CIoman::FID_STDOUT, sendInfo->size - 0xC, sendInfo->data);
 					}
 					buffer->status0 = 0;
@@ -3141,6 +3142,7 @@ void CPS2OS::sc_Deci2Call()
 		{
 			uint32 stringAddr = *reinterpret_cast<uint32*>(GetStructPtr(param));
 			uint8* string = &m_ram[stringAddr];
+			m_sif.SyncIop();
 			m_iopBios.GetIoman()->Write(1, static_cast<uint32>(strlen(reinterpret_cast<char*>(string))), string);
 		}
 		break;
@@ -3204,6 +3206,7 @@ void CPS2OS::HandleSyscall()
 	}
 	else if((func >= Ee::CLibMc2::SYSCALL_RANGE_START) && (func < Ee::CLibMc2::SYSCALL_RANGE_END))
 	{
+		m_sif.SyncIop();
 		m_libMc2.HandleSyscall(m_ee);
 	}
 	else
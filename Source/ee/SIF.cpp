@@ -1,4 +1,5 @@
 #include <cstring>
+#include <stdexcept>
 #include <stdio.h>
 #include "Log.h"
 #include "../Ps2Const.h"
@@ -106,11 +107,12 @@ void CSIF::RegisterModule(uint32 moduleId, CSifModule* module)
 {
 	m_modules[moduleId] = module;
 
+	std::lock_guard<std::mutex> packetLock(m_packetMutex);
 	auto replyIterator(m_bindReplies.find(moduleId));
 	if(replyIterator != m_bindReplies.end())
 	{
 		const auto& requestInfo(replyIterator->second);
-		SendPacket(&requestInfo.reply, sizeof(SIFRPCREQUESTEND));
+		QueuePacket(&requestInfo.reply, sizeof(SIFRPCREQUESTEND), m_nEERecvAddr);
 		m_bindReplies.erase(replyIterator);
 	}
 }
@@ -125,7 +127,7 @@ void CSIF::CheckPendingBindRequests(uint32 ticks)
 		{
 			CLog::GetInstance().Warn(LOG_NAME, "Timed out waiting to bind server 0x%08X.\r\n", bindReplyIterator->first);
 			requestInfo.reply.serverDataAddr = 0;
-			SendPacket(&requestInfo.reply, sizeof(SIFRPCREQUESTEND));
+			QueuePacket(&requestInfo.reply, sizeof(SIFRPCREQUESTEND), m_nEERecvAddr);
 			bindReplyIterator = m_bindReplies.erase(bindReplyIterator);
 		}
 		else
@@ -160,6 +162,9 @@ uint32 CSIF::ReceiveDMA6(uint32 nSrcAddr, uint32 nSize, uint32 nDstAddr, bool is
 {
 	assert(!isTagIncluded);
 
+	//Commands below end up in IOP modules and IOP RAM
+	SyncIop();
+
 	//Humm, this is kinda odd, but it ors the address with 0x20000000
 	nSrcAddr &= (PS2::EE_RAM_SIZE - 1);
 
@@ -248,6 +253,12 @@ void CSIF::SendPacket(const void* packet, uint32 size)
 }
 
 void CSIF::SendPacketToAddress(const void* packet, uint32 size, uint32 dstAddr)
+{
+	std::lock_guard<std::mutex> packetLock(m_packetMutex);
+	QueuePacket(packet, size, dstAddr);
+}
+
+void CSIF::QueuePacket(const void* packet, uint32 size, uint32 dstAddr)
 {
 	m_packetQueue.insert(m_packetQueue.end(),
 	                     reinterpret_cast<const uint8*>(&size),
@@ -262,6 +273,8 @@ void CSIF::SendPacketToAddress(const void* packet, uint32 size, uint32 dstAddr)
 
 void CSIF::CountTicks(uint32 ticks)
 {
+	std::lock_guard<std::mutex> packetLock(m_packetMutex);
+
 	CheckPendingBindRequests(ticks);
 
 	if(m_packetProcessed && !m_packetQueue.empty())
@@ -275,8 +288,15 @@ void CSIF::CountTicks(uint32 ticks)
 	}
 }
 
+bool CSIF::HasPendingPackets()
+{
+	std::lock_guard<std::mutex> packetLock(m_packetMutex);
+	return !m_bindReplies.empty() || !m_packetQueue.empty();
+}
+
 void CSIF::MarkPacketProcessed()
 {
+	SyncIop();
 	assert(m_packetProcessed == false);
 	m_packetProcessed = true;
 }
@@ -330,6 +350,99 @@ void CSIF::SaveState(Framework::CZipArchiveWriter& archive)
 	SaveBindReplies(archive);
 }
 
+size_t CSIF::GetRawStateSize() const
+{
+	return sizeof(m_nMAINADDR) + sizeof(m_nSUBADDR) + sizeof(m_nMSFLAG) + sizeof(m_nSMFLAG) +
+	       sizeof(m_nEERecvAddr) + sizeof(m_nDataAddr) + sizeof(m_packetProcessed) +
+	       sizeof(uint32) + RAW_STATE_PACKET_QUEUE_SIZE +
+	       sizeof(uint32) + (RAW_STATE_MAX_CALL_REPLIES * (sizeof(uint32) + sizeof(CALLREQUESTINFO))) +
+	       sizeof(uint32) + (RAW_STATE_MAX_BIND_REPLIES * (sizeof(uint32) + sizeof(BINDREQUESTINFO)));
+}
+
+void CSIF::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_nMAINADDR);
+	reader.Read(m_nSUBADDR);
+	reader.Read(m_nMSFLAG);
+	reader.Read(m_nSMFLAG);
+	reader.Read(m_nEERecvAddr);
+	reader.Read(m_nDataAddr);
+	reader.Read(m_packetProcessed);
+
+	uint32 packetQueueSize = reader.Read<uint32>();
+	if(packetQueueSize > RAW_STATE_PACKET_QUEUE_SIZE)
+	{
+		throw std::runtime_error("Invalid SIF packet queue size.");
+	}
+	m_packetQueue.resize(packetQueueSize);
+	reader.Read(m_packetQueue.data(), packetQueueSize);
+	reader.Skip(RAW_STATE_PACKET_QUEUE_SIZE - packetQueueSize);
+
+	m_callReplies.clear();
+	uint32 callReplyCount = reader.Read<uint32>();
+	if(callReplyCount > RAW_STATE_MAX_CALL_REPLIES)
+	{
+		throw std::runtime_error("Invalid SIF call reply count.");
+	}
+	for(uint32 i = 0; i < callReplyCount; i++)
+	{
+		uint32 replyId = reader.Read<uint32>();
+		m_callReplies[replyId] = reader.Read<CALLREQUESTINFO>();
+	}
+	reader.Skip((RAW_STATE_MAX_CALL_REPLIES - callReplyCount) * (sizeof(uint32) + sizeof(CALLREQUESTINFO)));
+
+	m_bindReplies.clear();
+	uint32 bindReplyCount = reader.Read<uint32>();
+	if(bindReplyCount > RAW_STATE_MAX_BIND_REPLIES)
+	{
+		throw std::runtime_error("Invalid SIF bind reply count.");
+	}
+	for(uint32 i = 0; i < bindReplyCount; i++)
+	{
+		uint32 replyId = reader.Read<uint32>();
+		m_bindReplies[replyId] = reader.Read<BINDREQUESTINFO>();
+	}
+	reader.Skip((RAW_STATE_MAX_BIND_REPLIES - bindReplyCount) * (sizeof(uint32) + sizeof(BINDREQUESTINFO)));
+}
+
+void CSIF::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_nMAINADDR);
+	writer.Write(m_nSUBADDR);
+	writer.Write(m_nMSFLAG);
+	writer.Write(m_nSMFLAG);
+	writer.Write(m_nEERecvAddr);
+	writer.Write(m_nDataAddr);
+	writer.Write(m_packetProcessed);
+
+	if((m_packetQueue.size() > RAW_STATE_PACKET_QUEUE_SIZE) ||
+	   (m_callReplies.size() > RAW_STATE_MAX_CALL_REPLIES) ||
+	   (m_bindReplies.size() > RAW_STATE_MAX_BIND_REPLIES))
+	{
+		throw std::runtime_error("SIF state doesn't fit in raw state records.");
+	}
+
+	writer.Write(static_cast<uint32>(m_packetQueue.size()));
+	writer.Write(m_packetQueue.data(), m_packetQueue.size());
+	writer.Skip(RAW_STATE_PACKET_QUEUE_SIZE - m_packetQueue.size());
+
+	writer.Write(static_cast<uint32>(m_callReplies.size()));
+	for(const auto& callReplyPair : m_callReplies)
+	{
+		writer.Write(callReplyPair.first);
+		writer.Write(callReplyPair.second);
+	}
+	writer.Skip((RAW_STATE_MAX_CALL_REPLIES - m_callReplies.size()) * (sizeof(uint32) + sizeof(CALLREQUESTINFO)));
+
+	writer.Write(static_cast<uint32>(m_bindReplies.size()));
+	for(const auto& bindReplyPair : m_bindReplies)
+	{
+		writer.Write(bindReplyPair.first);
+		writer.Write(bindReplyPair.second);
+	}
+	writer.Skip((RAW_STATE_MAX_BIND_REPLIES - m_bindReplies.size()) * (sizeof(uint32) + sizeof(BINDREQUESTINFO)));
+}
+
 void CSIF::SaveCallReplies(Framework::CZipArchiveWriter& archive)
 {
 	auto callRepliesFile = std::make_unique<CRegisterStateCollectionFile>(STATE_CALL_REPLIES_XML);
@@ -685,12 +798,43 @@ void CSIF::SetCustomCommandHandler(const CustomCommandHandler& customCommandHand
 	m_customCommandHandler = customCommandHandler;
 }
 
+void CSIF::SetIopSyncHandler(const IopSyncHandler& iopSyncHandler)
+{
+	m_iopSyncHandler = iopSyncHandler;
+}
+
+void CSIF::SetEeCallHandler(const EeCallHandler& eeCallHandler)
+{
+	m_eeCallHandler = eeCallHandler;
+}
+
+void CSIF::SyncIop()
+{
+	if(m_iopSyncHandler)
+	{
+		m_iopSyncHandler();
+	}
+}
+
+void CSIF::CallOnEe(const EeFunction& function)
+{
+	if(m_eeCallHandler)
+	{
+		m_eeCallHandler(function);
+	}
+	else
+	{
+		function();
+	}
+}
+
 /////////////////////////////////////////////////////////
 //Get/Set Register
 /////////////////////////////////////////////////////////
 
 uint32 CSIF::GetRegister(uint32 nRegister)
 {
+	SyncIop();
 	switch(nRegister)
 	{
 	case 0x00000001:
@@ -720,6 +864,7 @@ uint32 CSIF::GetRegister(uint32 nRegister)
 
 void CSIF::SetRegister(uint32 nRegister, uint32 nValue)
 {
+	SyncIop();
 	switch(nRegister)
 	{
 	case 0x00000001:
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <mutex>
 #include <vector>
 #include "../SifDefs.h"
 #include "../SifModule.h"
@@ -8,12 +9,16 @@
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 
 class CSIF
 {
 public:
 	typedef std::function<void(const std::string&)> ModuleResetHandler;
 	typedef std::function<void(uint32)> CustomCommandHandler;
+	typedef std::function<void()> IopSyncHandler;
+	typedef std::function<void()> EeFunction;
+	typedef std::function<void(const EeFunction&)> EeCallHandler;
 
 	CSIF(CDMAC&, uint8*, uint8*);
 	virtual ~CSIF() = default;
@@ -21,6 +26,8 @@ public:
 	void Reset();
 
 	void CountTicks(uint32);
+	//Bind replies or packets are waiting to be sent to the EE
+	bool HasPendingPackets();
 	void MarkPacketProcessed();
 
 	void RegisterModule(uint32, CSifModule*);
@@ -32,6 +39,14 @@ public:
 	void SetModuleResetHandler(const ModuleResetHandler&);
 	void SetCustomCommandHandler(const CustomCommandHandler&);
 
+	//Used when the IOP runs on its own thread. EE side code must sync before touching
+	//IOP state, IOP side code must go through CallOnEe to touch EE state.
+	void SetIopSyncHandler(const IopSyncHandler&);
+	void SetEeCallHandler(const EeCallHandler&);
+
+	void SyncIop();
+	void CallOnEe(const EeFunction&);
+
 	uint32 ReceiveDMA5(uint32, uint32, uint32, bool);
 	uint32 ReceiveDMA6(uint32, uint32, uint32, bool);
 
@@ -46,7 +61,19 @@ public:
 	void LoadState(Framework::CZipArchiveReader&);
 	void SaveState(Framework::CZipArchiveWriter&);
 
+	size_t GetRawStateSize() const;
+	void LoadRawState(CRawStateReader&);
+	void SaveRawState(CRawStateWriter&);
+
 private:
+	//Capacities of the raw state records
+	enum
+	{
+		RAW_STATE_PACKET_QUEUE_SIZE = 0x4000,
+		RAW_STATE_MAX_CALL_REPLIES = 0x40,
+		RAW_STATE_MAX_BIND_REPLIES = 0x40,
+	};
+
 	struct CALLREQUESTINFO
 	{
 		SIFRPCCALL call;
@@ -65,6 +92,7 @@ private:
 	typedef std::map<uint32, BINDREQUESTINFO> BindReplyMap;
 
 	void CheckPendingBindRequests(uint32);
+	void QueuePacket(const void*, uint32, uint32);
 
 	void DeleteModules();
 
@@ -107,6 +135,8 @@ private:
 
 	ModuleMap m_modules;
 
+	//Protects what the EE side accesses without syncing with the IOP (packet queue and bind replies)
+	std::mutex m_packetMutex;
 	PacketQueue m_packetQueue;
 	bool m_packetProcessed;
 
@@ -115,4 +145,6 @@ private:
 
 	ModuleResetHandler m_moduleResetHandler;
 	CustomCommandHandler m_customCommandHandler;
+	IopSyncHandler m_iopSyncHandler;
+	EeCallHandler m_eeCallHandler;
 };
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 #include <stdio.h>
 #include "Log.h"
@@ -33,27 +34,7 @@ void CTimer::Count(unsigned int ticks)
 		uint32 previousCount = timer.nCOUNT;
 		uint32 nextCount = timer.nCOUNT;
 
-		uint32 divider = 1;
-		//BUSCLOCK runs at half EE frequency
-		switch(timer.nMODE & MODE_CLOCK_SELECT)
-		{
-		case MODE_CLOCK_SELECT_BUSCLOCK:
-			divider = 1 * 2;
-			break;
-		case MODE_CLOCK_SELECT_BUSCLOCK16:
-			divider = 16 * 2;
-			break;
-		case MODE_CLOCK_SELECT_BUSCLOCK256:
-			divider = 256 * 2;
-			break;
-		case MODE_CLOCK_SELECT_EXTERNAL:
-		{
-			assert(m_gs);
-			uint32 hSyncFreq = m_gs->GetCrtHSyncFrequency();
-			divider = PS2::EE_CLOCK_FREQ / hSyncFreq;
-		}
-		break;
-		}
+		uint32 divider = GetDivider(timer.nMODE);
 
 		//Compute increment
 		uint32 totalTicks = timer.clockRemain + ticks;
@@ -98,6 +79,56 @@ void CTimer::Count(unsigned int ticks)
 	}
 }
 
+uint32 CTimer::GetTicksUntilNextInterrupt() const
+{
+	uint32 result = ~0U;
+	for(unsigned int i = 0; i < MAX_TIMER; i++)
+	{
+		const auto& timer = m_timer[i];
+
+		if(!(timer.nMODE & MODE_COUNT_ENABLE)) continue;
+
+		//Gating can only delay or reset the count, so this stays a lower bound
+		uint32 compare = (timer.nCOMP == 0) ? 0x10000 : timer.nCOMP;
+		uint32 countsLeft = ~0U;
+		if((timer.nMODE & MODE_EQUAL_INT_ENABLE) && (timer.nCOUNT < compare))
+		{
+			countsLeft = compare - timer.nCOUNT;
+		}
+		if(timer.nMODE & MODE_OVERFLOW_INT_ENABLE)
+		{
+			countsLeft = std::min<uint32>(countsLeft, 0x10000 - timer.nCOUNT);
+		}
+		if(countsLeft == ~0U) continue;
+
+		uint64 ticks = static_cast<uint64>(countsLeft) * GetDivider(timer.nMODE);
+		ticks -= std::min<uint64>(ticks, timer.clockRemain);
+		result = static_cast<uint32>(std::min<uint64>(result, ticks));
+	}
+	return result;
+}
+
+uint32 CTimer::GetDivider(uint32 mode) const
+{
+	//BUSCLOCK runs at half EE frequency
+	switch(mode & MODE_CLOCK_SELECT)
+	{
+	default:
+	case MODE_CLOCK_SELECT_BUSCLOCK:
+		return 1 * 2;
+	case MODE_CLOCK_SELECT_BUSCLOCK16:
+		return 16 * 2;
+	case MODE_CLOCK_SELECT_BUSCLOCK256:
+		return 256 * 2;
+	case MODE_CLOCK_SELECT_EXTERNAL:
+	{
+		assert(m_gs);
+		uint32 hSyncFreq = m_gs->GetCrtHSyncFrequency();
+		return PS2::EE_CLOCK_FREQ / hSyncFreq;
+	}
+	}
+}
+
 uint32 CTimer::GetRegister(uint32 nAddress)
 {
 	DisassembleGet(nAddress);
@@ -273,6 +304,21 @@ void CTimer::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(std::move(registerFile));
 }
 
+size_t CTimer::GetRawStateSize() const
+{
+	return sizeof(m_timer);
+}
+
+void CTimer::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_timer);
+}
+
+void CTimer::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_timer);
+}
+
 void CTimer::NotifyVBlankStart()
 {
 	ProcessGateEdgeChange(MODE_GATE_SELECT_VBLANK, MODE_GATE_MODE_HIGHEDGE);
@@ -4,6 +4,7 @@
 #include "INTC.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 
 class CGSHandler;
 
@@ -57,12 +58,19 @@ public:
 
 	void Count(unsigned int);
 
+	//Lower bound of ticks before a timer raises an interrupt, ~0 if none will
+	uint32 GetTicksUntilNextInterrupt() const;
+
 	uint32 GetRegister(uint32);
 	void SetRegister(uint32, uint32);
 
 	void LoadState(Framework::CZipArchiveReader&);
 	void SaveState(Framework::CZipArchiveWriter&);
 
+	size_t GetRawStateSize() const;
+	void LoadRawState(CRawStateReader&);
+	void SaveRawState(CRawStateWriter&);
+
 	void NotifyVBlankStart();
 	void NotifyVBlankEnd();
 
@@ -76,6 +84,7 @@ private:
 	void DisassembleSet(uint32, uint32);
 
 	void ProcessGateEdgeChange(uint32, uint32);
+	uint32 GetDivider(uint32) const;
 
 	struct TIMER
 	{
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <stdexcept>
@@ -264,6 +265,11 @@ void CVif::CountTicks(uint32 ticks)
 	}
 }
 
+uint32 CVif::GetInterruptDelayTicks() const
+{
+	return std::max<int32>(m_interruptDelayTicks, 0);
+}
+
 void CVif::SaveState(Framework::CZipArchiveWriter& archive)
 {
 	{
@@ -341,6 +347,65 @@ void CVif::LoadState(Framework::CZipArchiveReader& archive)
 	}
 }
 
+size_t CVif::GetRawStateSize() const
+{
+	return sizeof(m_STAT) + sizeof(m_ERR) + sizeof(m_CODE) + sizeof(m_CYCLE) + sizeof(m_NUM) +
+	       sizeof(m_MODE) + sizeof(m_MASK) + sizeof(m_MARK) + sizeof(m_R) + sizeof(m_C) +
+	       sizeof(m_ITOP) + sizeof(m_ITOPS) + sizeof(m_readTick) + sizeof(m_writeTick) +
+	       sizeof(m_pendingMicroProgram) + sizeof(m_fifoIndex) + sizeof(m_incomingFifoDelay) +
+	       sizeof(m_interruptDelayTicks) + sizeof(uint128) + sizeof(uint32) + sizeof(m_fifoBuffer);
+}
+
+void CVif::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_STAT);
+	writer.Write(m_ERR);
+	writer.Write(m_CODE);
+	writer.Write(m_CYCLE);
+	writer.Write(m_NUM);
+	writer.Write(m_MODE);
+	writer.Write(m_MASK);
+	writer.Write(m_MARK);
+	writer.Write(m_R);
+	writer.Write(m_C);
+	writer.Write(m_ITOP);
+	writer.Write(m_ITOPS);
+	writer.Write(m_readTick);
+	writer.Write(m_writeTick);
+	writer.Write(m_pendingMicroProgram);
+	writer.Write(m_fifoIndex);
+	writer.Write(m_incomingFifoDelay);
+	writer.Write(m_interruptDelayTicks);
+	writer.Write(m_stream.GetBuffer());
+	writer.Write(m_stream.GetBufferPosition());
+	writer.Write(m_fifoBuffer);
+}
+
+void CVif::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_STAT);
+	reader.Read(m_ERR);
+	reader.Read(m_CODE);
+	reader.Read(m_CYCLE);
+	reader.Read(m_NUM);
+	reader.Read(m_MODE);
+	reader.Read(m_MASK);
+	reader.Read(m_MARK);
+	reader.Read(m_R);
+	reader.Read(m_C);
+	reader.Read(m_ITOP);
+	reader.Read(m_ITOPS);
+	reader.Read(m_readTick);
+	reader.Read(m_writeTick);
+	reader.Read(m_pendingMicroProgram);
+	reader.Read(m_fifoIndex);
+	reader.Read(m_incomingFifoDelay);
+	reader.Read(m_interruptDelayTicks);
+	m_stream.SetBuffer(reader.Read<uint128>());
+	m_stream.SetBufferPosition(reader.Read<uint32>());
+	reader.Read(m_fifoBuffer);
+}
+
 uint32 CVif::GetTOP() const
 {
 	throw std::exception();
@@ -379,6 +444,29 @@ uint32 CVif::ReceiveDMA(uint32 address, uint32 qwc, uint32 unused, bool tagInclu
 	return qwc - remainingSize;
 }
 
+uint32 CVif::ReceiveBuffer(uint8* buffer, uint32 qwc, bool tagIncluded)
+{
+	//Same as ReceiveDMA, but data comes from a copy of what was transfered
+	if(m_STAT.nVEW && !m_vpu.IsVuReady())
+	{
+		return 0;
+	}
+
+#ifdef PROFILE
+	CProfilerZone profilerZone(m_vifProfilerZone);
+#endif
+
+	m_stream.SetFifoParams(buffer, qwc * 0x10, tagIncluded);
+
+	ProcessPacket(m_stream);
+
+	uint32 remainingSize = m_stream.GetRemainingDmaTransferSize();
+	assert((remainingSize & 0x0F) == 0);
+	remainingSize /= 0x10;
+
+	return qwc - remainingSize;
+}
+
 bool CVif::IsWaitingForProgramEnd() const
 {
 	return (m_STAT.nVEW != 0);
@@ -997,13 +1085,13 @@ void CVif::CFifoStream::SetDmaParams(uint32 address, uint32 size, bool tagInclud
 	SyncBuffer();
 }
 
-void CVif::CFifoStream::SetFifoParams(uint8* source, uint32 size)
+void CVif::CFifoStream::SetFifoParams(uint8* source, uint32 size, bool tagIncluded)
 {
 	m_source = source;
 	m_startAddress = 0;
 	m_nextAddress = 0;
 	m_endAddress = size;
-	m_tagIncluded = false;
+	m_tagIncluded = tagIncluded;
 	SyncBuffer();
 }
 
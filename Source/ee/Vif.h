@@ -5,10 +5,12 @@
 #include "Types.h"
 #include "Convertible.h"
 #include "Vpu.h"
+#include "Vif_Kernels.h"
 #include "../uint128.h"
 #include "../Profiler.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 #include "SimdDefs.h"
 
 #ifdef FRAMEWORK_SIMD_USE_SSE
@@ -73,13 +75,19 @@ public:
 	uint32 GetRegister(uint32);
 	void SetRegister(uint32, uint32);
 	void CountTicks(uint32);
+	uint32 GetInterruptDelayTicks() const;
 	virtual void SaveState(Framework::CZipArchiveWriter&);
 	virtual void LoadState(Framework::CZipArchiveReader&);
 
+	virtual size_t GetRawStateSize() const;
+	virtual void SaveRawState(CRawStateWriter&);
+	virtual void LoadRawState(CRawStateReader&);
+
 	virtual uint32 GetTOP() const;
 	virtual uint32 GetITOP() const;
 
 	virtual uint32 ReceiveDMA(uint32, uint32, uint32, bool);
+	uint32 ReceiveBuffer(uint8*, uint32, bool);
 
 	bool IsWaitingForProgramEnd() const;
 
@@ -203,10 +211,44 @@ protected:
 			}
 		}
 
+		//Bytes that can be read straight from the source. The buffer might be left over from a
+		//previous transfer, in which case everything needs to go through Read.
+		inline uint32 GetAvailableDirectReadBytes() const
+		{
+			if(m_tagIncluded) return 0;
+			if((m_bufferPosition != BUFFERSIZE) && ((m_nextAddress - m_startAddress) < BUFFERSIZE)) return 0;
+			return GetAvailableReadBytes();
+		}
+
+		inline const uint8* GetDirectReadPointer() const
+		{
+			assert(m_source != nullptr);
+			return m_source + m_nextAddress - (BUFFERSIZE - m_bufferPosition);
+		}
+
+		inline void AdvanceDirect(uint32 size)
+		{
+			assert(size <= GetAvailableDirectReadBytes());
+			uint32 position = m_nextAddress - (BUFFERSIZE - m_bufferPosition) + size;
+			uint32 offset = (position - m_startAddress) & (BUFFERSIZE - 1);
+			if(offset == 0)
+			{
+				m_nextAddress = position;
+				m_bufferPosition = BUFFERSIZE;
+			}
+			else
+			{
+				//Keep the buffer in sync with the source, as if we read through it
+				m_nextAddress = position - offset + BUFFERSIZE;
+				m_buffer = *reinterpret_cast<uint128*>(&m_source[m_nextAddress - BUFFERSIZE]);
+				m_bufferPosition = offset;
+			}
+		}
+
 		void Flush();
 		inline void Align32();
 		void SetDmaParams(uint32, uint32, bool);
-		void SetFifoParams(uint8*, uint32);
+		void SetFifoParams(uint8*, uint32, bool = false);
 
 		uint8* GetDirectPointer() const;
 		void Advance(uint32);
@@ -521,6 +563,40 @@ protected:
 		return success;
 	}
 
+	//Expands as many elements as possible straight from the source. Only valid when there's no
+	//mask and writes are contiguous in the current cycle (CL >= WL).
+	template <uint8 dataType, uint8 mode, bool usn>
+	uint32 Unpack_Bulk(StreamType& stream, uint8* vuMem, uint32 vuMemSize, uint32 dstAddr, uint32 currentNum, uint32 cl, uint32 wl)
+	{
+		if(m_readTick >= wl) return 0;
+
+		constexpr uint32 elementSize = Vif::Kernels::GetUnpackElementSize(dataType);
+		uint32 count = currentNum;
+		if(cl != wl)
+		{
+			count = std::min<uint32>(count, wl - m_readTick);
+		}
+		count = std::min<uint32>(count, (vuMemSize - dstAddr) / 0x10);
+		count = std::min<uint32>(count, stream.GetAvailableDirectReadBytes() / elementSize);
+		if(count == 0) return 0;
+
+		Vif::Kernels::Unpack(dataType, usn, stream.GetDirectReadPointer(), reinterpret_cast<uint128*>(vuMem + dstAddr), count, (mode == MODE_OFFSET) ? m_R : nullptr);
+		stream.AdvanceDirect(count * elementSize);
+
+		if(cl == wl)
+		{
+			m_readTick = (m_readTick + count) % cl;
+			m_writeTick = m_readTick;
+		}
+		else
+		{
+			m_readTick += count;
+			m_writeTick = std::min<uint32>(m_writeTick + count, wl);
+		}
+
+		return count;
+	}
+
 	template <uint8 dataType, bool clGreaterEqualWl, bool useMask, uint8 mode, bool usn>
 	void Unpack(StreamType& stream, CODE nCommand, uint32 nDstAddr)
 	{
@@ -561,6 +637,19 @@ protected:
 
 		while(currentNum != 0)
 		{
+			if(clGreaterEqualWl && !useMask && (mode != MODE_DIFFERENCE))
+			{
+				//Take the fast path whenever possible, element by element only happens at boundaries
+				uint32 bulkCount = Unpack_Bulk<dataType, mode, usn>(stream, vuMem, vuMemSize, nDstAddr, currentNum, cl, wl);
+				if(bulkCount != 0)
+				{
+					currentNum -= bulkCount;
+					nDstAddr += bulkCount * 0x10;
+					nDstAddr &= (vuMemSize - 1);
+					continue;
+				}
+			}
+
 			bool mustWrite = false;
 			uint128 writeValue;
 			memset(&writeValue, 0, sizeof(writeValue));
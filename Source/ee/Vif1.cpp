@@ -7,6 +7,7 @@
 #include "Dmac_Channel.h"
 #include "Vpu.h"
 #include "Vif1.h"
+#include "Vu1Thread.h"
 
 #define STATE_PATH_FORMAT ("vpu/vif1_%d.xml")
 #define STATE_REGS_BASE ("BASE")
@@ -62,6 +63,36 @@ void CVif1::LoadState(Framework::CZipArchiveReader& archive)
 	m_directQwordBufferIndex = registerFile.GetRegister32(STATE_REGS_DIRECTQWORDBUFFER_INDEX);
 }
 
+size_t CVif1::GetRawStateSize() const
+{
+	return CVif::GetRawStateSize() + sizeof(m_BASE) + sizeof(m_TOP) + sizeof(m_TOPS) + sizeof(m_OFST) +
+	       sizeof(m_directQwordBuffer) + sizeof(m_directQwordBufferIndex);
+}
+
+void CVif1::SaveRawState(CRawStateWriter& writer)
+{
+	CVif::SaveRawState(writer);
+
+	writer.Write(m_BASE);
+	writer.Write(m_TOP);
+	writer.Write(m_TOPS);
+	writer.Write(m_OFST);
+	writer.Write(m_directQwordBuffer);
+	writer.Write(m_directQwordBufferIndex);
+}
+
+void CVif1::LoadRawState(CRawStateReader& reader)
+{
+	CVif::LoadRawState(reader);
+
+	reader.Read(m_BASE);
+	reader.Read(m_TOP);
+	reader.Read(m_TOPS);
+	reader.Read(m_OFST);
+	reader.Read(m_directQwordBuffer);
+	reader.Read(m_directQwordBufferIndex);
+}
+
 uint32 CVif1::GetTOP() const
 {
 	return m_TOP;
@@ -111,9 +142,21 @@ void CVif1::ExecuteCommand(StreamType& stream, CODE nCommand)
 		m_BASE = nCommand.nIMM;
 		break;
 	case CODE_CMD_MSKPATH3:
-		m_gif.SetPath3Masked((nCommand.nIMM & 0x8000) != 0);
+		if(auto vu1Thread = m_vpu.GetVu1Thread())
+		{
+			vu1Thread->QueueMaskPath3((nCommand.nIMM & 0x8000) != 0);
+		}
+		else
+		{
+			m_gif.SetPath3Masked((nCommand.nIMM & 0x8000) != 0);
+		}
 		break;
 	case CODE_CMD_FLUSH:
+		if(auto vu1Thread = m_vpu.GetVu1Thread())
+		{
+			//Wait for PATH1 and PATH2 transfers we've queued to go through
+			vu1Thread->FlushGif();
+		}
 		if(!m_vpu.IsVuReady())
 		{
 			m_STAT.nVEW = 1;
@@ -129,6 +172,10 @@ void CVif1::ExecuteCommand(StreamType& stream, CODE nCommand)
 		}
 		break;
 	case CODE_CMD_FLUSHA:
+		if(auto vu1Thread = m_vpu.GetVu1Thread())
+		{
+			vu1Thread->FlushGif();
+		}
 		if(!m_vpu.IsVuReady())
 		{
 			m_STAT.nVEW = 1;
@@ -181,8 +228,7 @@ void CVif1::Cmd_DIRECT(StreamType& stream, CODE nCommand)
 			if(m_directQwordBufferIndex == QWORD_SIZE)
 			{
 				assert(m_CODE.nIMM != 0);
-				uint32 processed = m_gif.ProcessMultiplePackets(m_directQwordBuffer,
-				                                                QWORD_SIZE, 0, QWORD_SIZE, CGsPacketMetadata(2));
+				uint32 processed = SendDirectPacket(m_directQwordBuffer, QWORD_SIZE);
 				if(processed != 0)
 				{
 					assert(processed == QWORD_SIZE);
@@ -198,7 +244,7 @@ void CVif1::Cmd_DIRECT(StreamType& stream, CODE nCommand)
 			nSize = std::min<uint32>(m_CODE.nIMM * 0x10, nSize & ~0xF);
 
 			auto packet = stream.GetDirectPointer();
-			uint32 processed = m_gif.ProcessMultiplePackets(packet, nSize, 0, nSize, CGsPacketMetadata(2));
+			uint32 processed = SendDirectPacket(packet, nSize);
 			assert(processed <= nSize);
 			stream.Advance(processed);
 			//Adjust size in case not everything was processed by GIF
@@ -218,6 +264,17 @@ void CVif1::Cmd_DIRECT(StreamType& stream, CODE nCommand)
 	}
 }
 
+uint32 CVif1::SendDirectPacket(const uint8* packet, uint32 size)
+{
+	if(auto vu1Thread = m_vpu.GetVu1Thread())
+	{
+		//GIF is on the EE side, it'll take everything once we get there
+		vu1Thread->QueueDirect(packet, size);
+		return size;
+	}
+	return m_gif.ProcessMultiplePackets(packet, size, 0, size, CGsPacketMetadata(2));
+}
+
 void CVif1::Cmd_UNPACK(StreamType& stream, CODE nCommand, uint32 nDstAddr)
 {
 	bool nFlg = (m_CODE.nIMM & 0x8000) != 0;
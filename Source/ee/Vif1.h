@@ -15,6 +15,10 @@ public:
 	void SaveState(Framework::CZipArchiveWriter&) override;
 	void LoadState(Framework::CZipArchiveReader&) override;
 
+	size_t GetRawStateSize() const override;
+	void SaveRawState(CRawStateWriter&) override;
+	void LoadRawState(CRawStateReader&) override;
+
 	uint32 GetTOP() const override;
 
 	uint32 ReceiveDMA(uint32, uint32, uint32, bool) override;
@@ -23,6 +27,7 @@ private:
 	void ExecuteCommand(StreamType&, CODE) override;
 
 	void Cmd_DIRECT(StreamType&, CODE);
+	uint32 SendDirectPacket(const uint8*, uint32);
 	void Cmd_UNPACK(StreamType&, CODE, uint32) override;
 
 	void PrepareMicroProgram() override;
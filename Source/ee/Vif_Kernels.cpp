@@ -0,0 +1,299 @@
+#include <cassert>
+#include <cstring>
+#include "SimdDefs.h"
+#include "Vif_Kernels.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace Vif;
+
+enum
+{
+	UNPACK_S32 = 0x00,
+	UNPACK_S16 = 0x01,
+	UNPACK_V2_32 = 0x04,
+	UNPACK_V2_16 = 0x05,
+	UNPACK_V3_32 = 0x08,
+	UNPACK_V4_32 = 0x0C,
+	UNPACK_V4_16 = 0x0D,
+	UNPACK_V4_8 = 0x0E,
+	UNPACK_V4_5 = 0x0F,
+};
+
+static uint32 ReadField(const uint8* src, uint32 index, uint32 bits, bool usn)
+{
+	switch(bits)
+	{
+	case 32:
+	{
+		uint32 value = 0;
+		memcpy(&value, src + (index * 4), 4);
+		return value;
+	}
+	case 16:
+	{
+		uint16 value = 0;
+		memcpy(&value, src + (index * 2), 2);
+		return usn ? value : static_cast<int16>(value);
+	}
+	default:
+	{
+		uint8 value = src[index];
+		return usn ? value : static_cast<int8>(value);
+	}
+	}
+}
+
+void Kernels::UnpackScalar(uint8 dataType, bool usn, const uint8* src, uint128* dst, uint32 count, const uint32* row)
+{
+	assert((dataType & 0x0F) == dataType);
+	uint32 elementSize = GetUnpackElementSize(dataType);
+	uint32 fieldCount = ((dataType >> 2) & 0x03) + 1;
+	uint32 fieldBits = 32 >> (dataType & 0x03);
+	for(uint32 i = 0; i < count; i++)
+	{
+		const uint8* element = src + (i * elementSize);
+		uint32 fields[4] = {};
+		if(dataType == UNPACK_V4_5)
+		{
+			uint16 value = 0;
+			memcpy(&value, element, 2);
+			fields[0] = ((value >> 0) & 0x1F) << 3;
+			fields[1] = ((value >> 5) & 0x1F) << 3;
+			fields[2] = ((value >> 10) & 0x1F) << 3;
+			fields[3] = ((value >> 15) & 0x01) << 7;
+		}
+		else if(fieldCount == 1)
+		{
+			//Scalar formats are broadcast to all fields
+			uint32 value = ReadField(element, 0, fieldBits, usn);
+			for(uint32 f = 0; f < 4; f++)
+			{
+				fields[f] = value;
+			}
+		}
+		else
+		{
+			for(uint32 f = 0; f < fieldCount; f++)
+			{
+				fields[f] = ReadField(element, f, fieldBits, usn);
+			}
+		}
+		for(uint32 f = 0; f < 4; f++)
+		{
+			dst[i].nV[f] = fields[f] + (row ? row[f] : 0);
+		}
+	}
+}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+
+static inline __m128i Widen16Lo(__m128i value, bool usn)
+{
+	return usn ? _mm_unpacklo_epi16(value, _mm_setzero_si128()) : _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16);
+}
+
+static inline __m128i Widen16Hi(__m128i value, bool usn)
+{
+	return usn ? _mm_unpackhi_epi16(value, _mm_setzero_si128()) : _mm_srai_epi32(_mm_unpackhi_epi16(value, value), 16);
+}
+
+static inline __m128i Widen8Lo(__m128i value, bool usn)
+{
+	return usn ? _mm_unpacklo_epi8(value, _mm_setzero_si128()) : _mm_srai_epi16(_mm_unpacklo_epi8(value, value), 8);
+}
+
+static inline __m128i Widen8Hi(__m128i value, bool usn)
+{
+	return usn ? _mm_unpackhi_epi8(value, _mm_setzero_si128()) : _mm_srai_epi16(_mm_unpackhi_epi8(value, value), 8);
+}
+
+static inline void StoreElement(uint128* dst, __m128i value, __m128i row)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_add_epi32(value, row));
+}
+
+static inline void StoreBroadcasts(uint128* dst, __m128i value, __m128i row)
+{
+	StoreElement(dst + 0, _mm_shuffle_epi32(value, _MM_SHUFFLE(0, 0, 0, 0)), row);
+	StoreElement(dst + 1, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 1, 1, 1)), row);
+	StoreElement(dst + 2, _mm_shuffle_epi32(value, _MM_SHUFFLE(2, 2, 2, 2)), row);
+	StoreElement(dst + 3, _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 3, 3, 3)), row);
+}
+
+static inline void StorePairs(uint128* dst, __m128i value, __m128i row)
+{
+	StoreElement(dst + 0, _mm_move_epi64(value), row);
+	StoreElement(dst + 1, _mm_srli_si128(value, 8), row);
+}
+
+//Returns the amount of elements processed, groups are never read past their end
+static uint32 UnpackSimd(uint8 dataType, bool usn, const uint8* src, uint128* dst, uint32 count, const uint32* row)
+{
+	__m128i rowValue = row ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(row)) : _mm_setzero_si128();
+	auto load = [src](uint32 offset) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + offset)); };
+
+	uint32 processed = 0;
+	switch(dataType)
+	{
+	case UNPACK_V4_32:
+		for(; processed < count; processed++)
+		{
+			StoreElement(dst + processed, load(processed * 0x10), rowValue);
+		}
+		break;
+	case UNPACK_V3_32:
+	{
+		//4 elements in 3 qwords
+		const __m128i fieldMask = _mm_set_epi32(0, ~0, ~0, ~0);
+		for(; (processed + 4) <= count; processed += 4)
+		{
+			__m128i a = load(processed * 0x0C);
+			__m128i b = load((processed * 0x0C) + 0x10);
+			__m128i c = load((processed * 0x0C) + 0x20);
+			StoreElement(dst + processed + 0, _mm_and_si128(a, fieldMask), rowValue);
+			StoreElement(dst + processed + 1, _mm_and_si128(_mm_or_si128(_mm_srli_si128(a, 12), _mm_slli_si128(b, 4)), fieldMask), rowValue);
+			StoreElement(dst + processed + 2, _mm_and_si128(_mm_or_si128(_mm_srli_si128(b, 8), _mm_slli_si128(c, 8)), fieldMask), rowValue);
+			StoreElement(dst + processed + 3, _mm_srli_si128(c, 4), rowValue);
+		}
+	}
+	break;
+	case UNPACK_V2_32:
+		for(; (processed + 2) <= count; processed += 2)
+		{
+			StorePairs(dst + processed, load(processed * 0x08), rowValue);
+		}
+		break;
+	case UNPACK_S32:
+		for(; (processed + 4) <= count; processed += 4)
+		{
+			StoreBroadcasts(dst + processed, load(processed * 0x04), rowValue);
+		}
+		break;
+	case UNPACK_V4_16:
+		for(; (processed + 2) <= count; processed += 2)
+		{
+			__m128i value = load(processed * 0x08);
+			StoreElement(dst + processed + 0, Widen16Lo(value, usn), rowValue);
+			StoreElement(dst + processed + 1, Widen16Hi(value, usn), rowValue);
+		}
+		break;
+	case UNPACK_V2_16:
+		for(; (processed + 4) <= count; processed += 4)
+		{
+			__m128i value = load(processed * 0x04);
+			StorePairs(dst + processed + 0, Widen16Lo(value, usn), rowValue);
+			StorePairs(dst + processed + 2, Widen16Hi(value, usn), rowValue);
+		}
+		break;
+	case UNPACK_S16:
+		for(; (processed + 8) <= count; processed += 8)
+		{
+			__m128i value = load(processed * 0x02);
+			StoreBroadcasts(dst + processed + 0, Widen16Lo(value, usn), rowValue);
+			StoreBroadcasts(dst + processed + 4, Widen16Hi(value, usn), rowValue);
+		}
+		break;
+	case UNPACK_V4_8:
+		for(; (processed + 4) <= count; processed += 4)
+		{
+			__m128i value = load(processed * 0x04);
+			__m128i lo = Widen8Lo(value, usn);
+			__m128i hi = Widen8Hi(value, usn);
+			StoreElement(dst + processed + 0, Widen16Lo(lo, usn), rowValue);
+			StoreElement(dst + processed + 1, Widen16Hi(lo, usn), rowValue);
+			StoreElement(dst + processed + 2, Widen16Lo(hi, usn), rowValue);
+			StoreElement(dst + processed + 3, Widen16Hi(hi, usn), rowValue);
+		}
+		break;
+	default:
+		break;
+	}
+	return processed;
+}
+
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+
+static inline void StoreElement(uint128* dst, uint32x4_t value, uint32x4_t row)
+{
+	vst1q_u32(dst->nV, vaddq_u32(value, row));
+}
+
+static uint32 UnpackSimd(uint8 dataType, bool usn, const uint8* src, uint128* dst, uint32 count, const uint32* row)
+{
+	uint32x4_t rowValue = row ? vld1q_u32(row) : vdupq_n_u32(0);
+
+	uint32 processed = 0;
+	switch(dataType)
+	{
+	case UNPACK_V4_32:
+		for(; processed < count; processed++)
+		{
+			StoreElement(dst + processed, vreinterpretq_u32_u8(vld1q_u8(src + (processed * 0x10))), rowValue);
+		}
+		break;
+	case UNPACK_V3_32:
+		//Loading a full qword reads into the next element, last one is left to the scalar version
+		for(; (processed + 1) < count; processed++)
+		{
+			uint32x4_t value = vreinterpretq_u32_u8(vld1q_u8(src + (processed * 0x0C)));
+			StoreElement(dst + processed, vsetq_lane_u32(0, value, 3), rowValue);
+		}
+		break;
+	case UNPACK_V2_32:
+		for(; processed < count; processed++)
+		{
+			uint32x2_t value = vreinterpret_u32_u8(vld1_u8(src + (processed * 0x08)));
+			StoreElement(dst + processed, vcombine_u32(value, vdup_n_u32(0)), rowValue);
+		}
+		break;
+	case UNPACK_V4_16:
+		for(; processed < count; processed++)
+		{
+			uint16x4_t value = vreinterpret_u16_u8(vld1_u8(src + (processed * 0x08)));
+			uint32x4_t result = usn ? vmovl_u16(value) : vreinterpretq_u32_s32(vmovl_s16(vreinterpret_s16_u16(value)));
+			StoreElement(dst + processed, result, rowValue);
+		}
+		break;
+	case UNPACK_V4_8:
+		for(; (processed + 2) <= count; processed += 2)
+		{
+			uint8x8_t value = vld1_u8(src + (processed * 0x04));
+			uint32x4_t lo, hi;
+			if(usn)
+			{
+				uint16x8_t value16 = vmovl_u8(value);
+				lo = vmovl_u16(vget_low_u16(value16));
+				hi = vmovl_u16(vget_high_u16(value16));
+			}
+			else
+			{
+				int16x8_t value16 = vmovl_s8(vreinterpret_s8_u8(value));
+				lo = vreinterpretq_u32_s32(vmovl_s16(vget_low_s16(value16)));
+				hi = vreinterpretq_u32_s32(vmovl_s16(vget_high_s16(value16)));
+			}
+			StoreElement(dst + processed + 0, lo, rowValue);
+			StoreElement(dst + processed + 1, hi, rowValue);
+		}
+		break;
+	default:
+		break;
+	}
+	return processed;
+}
+
+#endif
+
+void Kernels::Unpack(uint8 dataType, bool usn, const uint8* src, uint128* dst, uint32 count, const uint32* row)
+{
+	uint32 processed = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE) || defined(FRAMEWORK_SIMD_USE_NEON)
+	processed = UnpackSimd(dataType, usn, src, dst, count, row);
+#endif
+	if(processed == count) return;
+	UnpackScalar(dataType, usn, src + (processed * GetUnpackElementSize(dataType)), dst + processed, count - processed, row);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Types.h"
+#include "../uint128.h"
+
+namespace Vif
+{
+	//Bulk expansion of UNPACK data, used for runs that don't need masking or the difference mode.
+	//Vectorized versions produce the same output as the scalar ones.
+	namespace Kernels
+	{
+		//Size in bytes of one element of an UNPACK data type (lower 4 bits of the command)
+		constexpr uint32 GetUnpackElementSize(uint8 dataType)
+		{
+			return ((32 >> (dataType & 0x03)) * (((dataType >> 2) & 0x03) + 1)) / 8;
+		}
+
+		//Expands elements to consecutive qwords. If a row is provided, it's added to every field (offset mode).
+		void Unpack(uint8, bool, const uint8*, uint128*, uint32, const uint32*);
+		void UnpackScalar(uint8, bool, const uint8*, uint128*, uint32, const uint32*);
+	}
+}
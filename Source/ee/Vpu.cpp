@@ -8,6 +8,7 @@
 #include "Vif.h"
 #include "Vif1.h"
 #include "GIF.h"
+#include "Vu1Thread.h"
 
 #define LOG_NAME ("ee_vpu")
 
@@ -153,6 +154,27 @@ void CVpu::LoadState(Framework::CZipArchiveReader& archive)
 	m_vif->LoadState(archive);
 }
 
+size_t CVpu::GetRawStateSize() const
+{
+	return sizeof(m_vuState) + sizeof(m_fbrst) + m_vif->GetRawStateSize();
+}
+
+void CVpu::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_vuState);
+	writer.Write(m_fbrst);
+
+	m_vif->SaveRawState(writer);
+}
+
+void CVpu::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_vuState);
+	reader.Read(m_fbrst);
+
+	m_vif->LoadRawState(reader);
+}
+
 CMIPS& CVpu::GetContext() const
 {
 	return *m_ctx;
@@ -183,6 +205,17 @@ CVif& CVpu::GetVif()
 	return *m_vif.get();
 }
 
+CVu1Thread* CVpu::GetVu1Thread() const
+{
+	return m_vu1Thread;
+}
+
+void CVpu::SetVu1Thread(CVu1Thread* vu1Thread)
+{
+	assert(m_number == 1);
+	m_vu1Thread = vu1Thread;
+}
+
 void CVpu::SetFbrst(uint32 fbrst)
 {
 	//Only keep DE and TE bits
@@ -230,6 +263,13 @@ void CVpu::ProcessXgKick(uint32 address)
 	address &= 0x3FF;
 	address *= 0x10;
 
+	if(m_vu1Thread)
+	{
+		//GIF is on the EE side, packet will be delivered from there
+		m_vu1Thread->QueueXgKick(GetVuMemory(), address);
+		return;
+	}
+
 	CGsPacketMetadata metadata;
 	metadata.pathIndex = 1;
 #ifdef DEBUGGER_INCLUDED
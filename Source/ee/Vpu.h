@@ -6,10 +6,12 @@
 #include "Convertible.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 
 class CVif;
 class CGIF;
 class CINTC;
+class CVu1Thread;
 
 class CVpu
 {
@@ -59,6 +61,10 @@ public:
 	void SaveState(Framework::CZipArchiveWriter&);
 	void LoadState(Framework::CZipArchiveReader&);
 
+	size_t GetRawStateSize() const;
+	void SaveRawState(CRawStateWriter&);
+	void LoadRawState(CRawStateReader&);
+
 	CMIPS& GetContext() const;
 	uint8* GetMicroMemory() const;
 	uint32 GetMicroMemorySize() const;
@@ -82,6 +88,9 @@ public:
 
 	CVif& GetVif();
 
+	CVu1Thread* GetVu1Thread() const;
+	void SetVu1Thread(CVu1Thread*);
+
 	void SetFbrst(uint32);
 
 	void ExecuteMicroProgram(uint32);
@@ -121,6 +130,7 @@ protected:
 	uint32 m_vuMemSize = 0;
 	CMIPS* m_ctx = nullptr;
 	CGIF& m_gif;
+	CVu1Thread* m_vu1Thread = nullptr;
 
 #ifdef DEBUGGER_INCLUDED
 	MIPSSTATE m_vuMiniState;
@@ -0,0 +1,528 @@
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include "string_format.h"
+#include "Vu1Thread.h"
+#include "Vpu.h"
+#include "Vif.h"
+#include "GIF.h"
+#include "Dmac_Channel.h"
+#include "../Ps2Const.h"
+#include "../FrameDump.h"
+#include "../states/MemoryStateFile.h"
+#include "../states/RegisterStateFile.h"
+#include "FpUtils.h"
+#include "ThreadUtils.h"
+
+#define STATE_PATH_REGS ("vu1thread/state.xml")
+#define STATE_PATH_RING ("vu1thread/ring")
+
+#define STATE_REGS_RINGUSED ("ringUsed")
+#define STATE_REGS_RINGWRITEPOSITION ("ringWritePosition")
+#define STATE_REGS_PENDINGVIFTICKS ("pendingVifTicks")
+#define STATE_REGS_CHUNKCOUNT ("chunkCount")
+#define STATE_REGS_CHUNK_OFFSET_FORMAT ("chunk%d_offset")
+#define STATE_REGS_CHUNK_SIZE_FORMAT ("chunk%d_size")
+#define STATE_REGS_CHUNK_TAGINCLUDED_FORMAT ("chunk%d_tagIncluded")
+
+CVu1Thread::CVu1Thread(CVpu& vpu, CGIF& gif, uint8* ram, uint8* spr)
+    : m_vpu(vpu)
+    , m_gif(gif)
+    , m_ram(ram)
+    , m_spr(spr)
+    , m_ring(RING_SIZE)
+{
+}
+
+CVu1Thread::~CVu1Thread()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_threadDone = true;
+	}
+	m_workCondition.notify_all();
+	m_gifCondition.notify_all();
+	if(m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+void CVu1Thread::Reset()
+{
+	Sync();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_ringChunks.clear();
+	m_ringUsed = 0;
+	m_ringWritePosition = 0;
+	m_pendingVifTicks = 0;
+	m_gifCommands.clear();
+	m_drainingGifCommands.clear();
+	m_gifCommandCount = 0;
+}
+
+void CVu1Thread::SaveState(Framework::CZipArchiveWriter& archive)
+{
+	assert(!m_busy);
+
+	//Data the VIF didn't take yet (ie.: stalled by an interrupt) still needs to go through after loading
+	{
+		auto registerFile = std::make_unique<CRegisterStateFile>(STATE_PATH_REGS);
+		registerFile->SetRegister32(STATE_REGS_RINGUSED, m_ringUsed);
+		registerFile->SetRegister32(STATE_REGS_RINGWRITEPOSITION, m_ringWritePosition);
+		registerFile->SetRegister32(STATE_REGS_PENDINGVIFTICKS, m_pendingVifTicks);
+		registerFile->SetRegister32(STATE_REGS_CHUNKCOUNT, static_cast<uint32>(m_ringChunks.size()));
+		for(uint32 i = 0; i < m_ringChunks.size(); i++)
+		{
+			const auto& chunk = m_ringChunks[i];
+			registerFile->SetRegister32(string_format(STATE_REGS_CHUNK_OFFSET_FORMAT, i).c_str(), chunk.offset);
+			registerFile->SetRegister32(string_format(STATE_REGS_CHUNK_SIZE_FORMAT, i).c_str(), chunk.size);
+			registerFile->SetRegister32(string_format(STATE_REGS_CHUNK_TAGINCLUDED_FORMAT, i).c_str(), chunk.tagIncluded);
+		}
+		archive.InsertFile(std::move(registerFile));
+	}
+	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_PATH_RING, m_ring.data(), RING_SIZE));
+}
+
+void CVu1Thread::LoadState(Framework::CZipArchiveReader& archive)
+{
+	assert(!m_busy);
+
+	//States saved without the worker don't have anything pending
+	if(!archive.GetFileHeader(STATE_PATH_REGS)) return;
+
+	CRegisterStateFile registerFile(*archive.BeginReadFile(STATE_PATH_REGS));
+	m_ringUsed = registerFile.GetRegister32(STATE_REGS_RINGUSED);
+	m_ringWritePosition = registerFile.GetRegister32(STATE_REGS_RINGWRITEPOSITION);
+	m_pendingVifTicks = registerFile.GetRegister32(STATE_REGS_PENDINGVIFTICKS);
+	m_ringChunks.clear();
+	uint32 chunkCount = registerFile.GetRegister32(STATE_REGS_CHUNKCOUNT);
+	for(uint32 i = 0; i < chunkCount; i++)
+	{
+		RING_CHUNK chunk;
+		chunk.offset = registerFile.GetRegister32(string_format(STATE_REGS_CHUNK_OFFSET_FORMAT, i).c_str());
+		chunk.size = registerFile.GetRegister32(string_format(STATE_REGS_CHUNK_SIZE_FORMAT, i).c_str());
+		chunk.tagIncluded = registerFile.GetRegister32(string_format(STATE_REGS_CHUNK_TAGINCLUDED_FORMAT, i).c_str()) != 0;
+		m_ringChunks.push_back(chunk);
+	}
+	archive.BeginReadFile(STATE_PATH_RING)->Read(m_ring.data(), RING_SIZE);
+}
+
+size_t CVu1Thread::GetRawStateSize()
+{
+	return (sizeof(uint32) * 4) + (MAX_RING_CHUNKS * sizeof(uint32) * 3) + RING_SIZE;
+}
+
+void CVu1Thread::SaveRawState(CRawStateWriter& writer)
+{
+	assert(!m_busy);
+	assert(m_ringChunks.size() <= MAX_RING_CHUNKS);
+
+	writer.Write(m_ringUsed);
+	writer.Write(m_ringWritePosition);
+	writer.Write(m_pendingVifTicks);
+	writer.Write(static_cast<uint32>(m_ringChunks.size()));
+	for(const auto& chunk : m_ringChunks)
+	{
+		writer.Write(chunk.offset);
+		writer.Write(chunk.size);
+		writer.Write<uint32>(chunk.tagIncluded);
+	}
+	writer.Skip((MAX_RING_CHUNKS - m_ringChunks.size()) * sizeof(uint32) * 3);
+	writer.Write(m_ring.data(), RING_SIZE);
+}
+
+void CVu1Thread::LoadRawState(CRawStateReader& reader)
+{
+	assert(!m_busy);
+
+	reader.Read(m_ringUsed);
+	reader.Read(m_ringWritePosition);
+	reader.Read(m_pendingVifTicks);
+	uint32 chunkCount = reader.Read<uint32>();
+	if(chunkCount > MAX_RING_CHUNKS)
+	{
+		throw std::runtime_error("Invalid VU1 thread chunk count.");
+	}
+	m_ringChunks.clear();
+	for(uint32 i = 0; i < chunkCount; i++)
+	{
+		RING_CHUNK chunk;
+		reader.Read(chunk.offset);
+		reader.Read(chunk.size);
+		chunk.tagIncluded = reader.Read<uint32>() != 0;
+		m_ringChunks.push_back(chunk);
+	}
+	reader.Skip((MAX_RING_CHUNKS - chunkCount) * sizeof(uint32) * 3);
+	reader.Read(m_ring.data(), RING_SIZE);
+}
+
+uint32 CVu1Thread::ReceiveDMA(uint32 address, uint32 qwc, uint32 direction, bool tagIncluded)
+{
+	if(direction == Dmac::CChannel::CHCR_DIR_TO)
+	{
+		//Reading back from GS, everything sent before needs to be out
+		Sync();
+		return m_vpu.GetVif().ReceiveDMA(address, qwc, direction, tagIncluded);
+	}
+
+	uint8* source = nullptr;
+	if(address & 0x80000000)
+	{
+		source = m_spr;
+		address &= (PS2::EE_SPR_SIZE - 1);
+		assert((address + (qwc * 0x10)) <= PS2::EE_SPR_SIZE);
+	}
+	else
+	{
+		source = m_ram;
+		address &= (PS2::EE_RAM_SIZE - 1);
+		assert((address + (qwc * 0x10)) <= PS2::EE_RAM_SIZE);
+	}
+
+	RING_CHUNK chunk;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if((m_ringUsed == 0) || (m_ringWritePosition == RING_SIZE))
+		{
+			m_ringWritePosition = 0;
+		}
+		uint32 available = std::min<uint32>(RING_SIZE - m_ringUsed, RING_SIZE - m_ringWritePosition);
+		if(m_ringChunks.size() == MAX_RING_CHUNKS)
+		{
+			available = 0;
+		}
+		chunk.offset = m_ringWritePosition;
+		chunk.size = std::min<uint32>(qwc * 0x10, available);
+		chunk.tagIncluded = tagIncluded;
+	}
+
+	if(chunk.size == 0)
+	{
+		//Ring or chunk list is full, DMA will try again later
+		return 0;
+	}
+
+	//Worker never reads past the chunks it has been given, we can fill this without holding the lock
+	memcpy(m_ring.data() + chunk.offset, source + address, chunk.size);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_ringWritePosition += chunk.size;
+		m_ringUsed += chunk.size;
+		m_ringChunks.push_back(chunk);
+	}
+
+	Kick();
+
+	return chunk.size / 0x10;
+}
+
+bool CVu1Thread::IsRingEmpty()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_ringUsed == 0;
+}
+
+void CVu1Thread::CountTicks(uint32 ticks)
+{
+	if(m_gifCommandCount.load(std::memory_order_acquire) != 0)
+	{
+		DrainGifCommands();
+	}
+
+	//VIF1 can only be touched while the worker is idle, ticks are held until then
+	m_pendingVifTicks += ticks;
+	if(!m_busy.load(std::memory_order_acquire))
+	{
+		m_vpu.GetVif().CountTicks(m_pendingVifTicks);
+		m_pendingVifTicks = 0;
+	}
+}
+
+bool CVu1Thread::HasPendingUpdate() const
+{
+	return m_busy.load(std::memory_order_acquire) || (m_gifCommandCount.load(std::memory_order_acquire) != 0) ||
+	       (m_pendingVifTicks != 0);
+}
+
+void CVu1Thread::Kick()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		bool hasWork = m_busy.load(std::memory_order_relaxed) || !m_ringChunks.empty() || m_vpu.IsVuRunning();
+		if(!hasWork) return;
+
+		m_busy.store(true, std::memory_order_release);
+		m_workRequested = true;
+
+		if(!m_thread.joinable())
+		{
+			m_thread = std::thread([this]() { ThreadProc(); });
+			m_threadId = m_thread.get_id();
+			Framework::ThreadUtils::SetThreadName(m_thread, "VU1 Thread");
+		}
+	}
+	m_workCondition.notify_one();
+}
+
+void CVu1Thread::QueueXgKick(const uint8* vuMem, uint32 address)
+{
+	assert(address < PS2::VUMEM1SIZE);
+	uint32 size = GetXgKickPacketSize(vuMem, address);
+
+	GIF_COMMAND command;
+	command.type = GIF_COMMAND_PACKET;
+	command.pathIndex = 1;
+	command.packet.resize(size);
+
+	//Packet can wrap around VU memory
+	uint32 firstSize = std::min<uint32>(size, PS2::VUMEM1SIZE - address);
+	memcpy(command.packet.data(), vuMem + address, firstSize);
+	memcpy(command.packet.data() + firstSize, vuMem, size - firstSize);
+
+	PushGifCommand(std::move(command));
+}
+
+void CVu1Thread::QueueDirect(const uint8* packet, uint32 size)
+{
+	GIF_COMMAND command;
+	command.type = GIF_COMMAND_PACKET;
+	command.pathIndex = 2;
+	command.packet.assign(packet, packet + size);
+	PushGifCommand(std::move(command));
+}
+
+void CVu1Thread::QueueMaskPath3(bool masked)
+{
+	GIF_COMMAND command;
+	command.type = GIF_COMMAND_MASKPATH3;
+	command.masked = masked;
+	PushGifCommand(std::move(command));
+}
+
+void CVu1Thread::FlushGif()
+{
+	if(!IsWorkerThread())
+	{
+		DrainGifCommands();
+		return;
+	}
+
+	//If the EE is waiting on us, it won't deliver anything more than what it already has
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_gifCondition.wait(lock, [&]() { return (m_gifCommandCount.load(std::memory_order_relaxed) == 0) || m_eeWaiting || m_threadDone; });
+}
+
+void CVu1Thread::RunOnEe(const FunctionType& function)
+{
+	if(!IsWorkerThread())
+	{
+		function();
+		return;
+	}
+
+	GIF_COMMAND command;
+	command.type = GIF_COMMAND_CALL;
+	command.function = function;
+	PushGifCommand(std::move(command));
+}
+
+uint32 CVu1Thread::GetXgKickPacketSize(const uint8* vuMem, uint32 address)
+{
+	//Walk tags until the end of the packet to know how much needs to be copied
+	uint32 size = 0;
+	while(size < PS2::VUMEM1SIZE)
+	{
+		auto tag = *reinterpret_cast<const CGIF::TAG*>(vuMem + ((address + size) & (PS2::VUMEM1SIZE - 1)));
+		size += 0x10;
+		uint32 regCount = (tag.nreg == 0) ? 0x10 : tag.nreg;
+		switch(tag.cmd)
+		{
+		case 0:
+			//PACKED
+			size += tag.loops * regCount * 0x10;
+			break;
+		case 1:
+			//REGLIST
+			size += ((tag.loops * regCount + 1) / 2) * 0x10;
+			break;
+		default:
+			//IMAGE
+			size += tag.loops * 0x10;
+			break;
+		}
+		if(tag.eop) break;
+	}
+	return std::min<uint32>(size, PS2::VUMEM1SIZE);
+}
+
+bool CVu1Thread::IsWorkerThread() const
+{
+	return std::this_thread::get_id() == m_threadId;
+}
+
+void CVu1Thread::PushGifCommand(GIF_COMMAND&& command)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_gifCommands.push_back(std::move(command));
+		m_gifCommandCount++;
+	}
+	//EE might be waiting for us, it can deliver this in the meantime
+	m_idleCondition.notify_all();
+}
+
+void CVu1Thread::DrainGifCommands()
+{
+	assert(!IsWorkerThread());
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::move(m_gifCommands.begin(), m_gifCommands.end(), std::back_inserter(m_drainingGifCommands));
+		m_gifCommands.clear();
+	}
+
+	//Commands are delivered in order, stop at the first one the GIF can't take yet
+	uint32 drainedCount = 0;
+	while(!m_drainingGifCommands.empty())
+	{
+		auto& command = m_drainingGifCommands.front();
+		if(command.type == GIF_COMMAND_PACKET)
+		{
+			uint32 activePath = m_gif.GetActivePath();
+			if((activePath != 0) && (activePath != command.pathIndex)) break;
+
+			uint32 size = static_cast<uint32>(command.packet.size());
+			CGsPacketMetadata metadata(command.pathIndex);
+			if(command.pathIndex == 1)
+			{
+				//Same as XGKICK, only one packet is sent
+				m_gif.ProcessSinglePacket(command.packet.data(), size, 0, size, metadata);
+				command.position = size;
+			}
+			else
+			{
+				command.position += m_gif.ProcessMultiplePackets(command.packet.data(), size, command.position, size, metadata);
+			}
+			if(command.position != size) break;
+		}
+		else if(command.type == GIF_COMMAND_MASKPATH3)
+		{
+			m_gif.SetPath3Masked(command.masked);
+		}
+		else
+		{
+			command.function();
+		}
+		m_drainingGifCommands.pop_front();
+		drainedCount++;
+	}
+
+	if(drainedCount == 0) return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_gifCommandCount -= drainedCount;
+	}
+	m_gifCondition.notify_all();
+}
+
+void CVu1Thread::WaitForIdle()
+{
+	assert(!IsWorkerThread());
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_eeWaiting = true;
+	m_gifCondition.notify_all();
+	while(true)
+	{
+		m_idleCondition.wait(lock, [&]() { return !m_busy.load(std::memory_order_relaxed) || !m_gifCommands.empty(); });
+		bool busy = m_busy.load(std::memory_order_relaxed);
+
+		lock.unlock();
+		DrainGifCommands();
+		lock.lock();
+
+		if(!busy) break;
+	}
+	m_eeWaiting = false;
+}
+
+void CVu1Thread::Execute()
+{
+	auto& vif = m_vpu.GetVif();
+	while(!m_threadDone.load(std::memory_order_relaxed))
+	{
+		if(m_vpu.IsVuRunning())
+		{
+			m_vpu.Execute(VU_EXECUTE_QUOTA);
+			continue;
+		}
+
+		RING_CHUNK chunk;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(m_ringChunks.empty()) break;
+			chunk = m_ringChunks.front();
+		}
+
+		uint32 qwc = chunk.size / 0x10;
+		uint32 received = vif.ReceiveBuffer(m_ring.data() + chunk.offset, qwc, chunk.tagIncluded);
+		assert(received <= qwc);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto& front = m_ringChunks.front();
+			front.offset += received * 0x10;
+			front.size -= received * 0x10;
+			if(received != 0)
+			{
+				front.tagIncluded = false;
+			}
+			m_ringUsed -= received * 0x10;
+			if(front.size == 0)
+			{
+				m_ringChunks.pop_front();
+			}
+		}
+
+		if((received == 0) && !m_vpu.IsVuRunning())
+		{
+			//VIF is stalled (interrupt, stopped VU), EE needs to do something before we can go on
+			break;
+		}
+	}
+}
+
+void CVu1Thread::ThreadProc()
+{
+	FpUtils::SetEmulationFpEnvironment();
+
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workCondition.wait(lock, [&]() { return m_threadDone || m_workRequested; });
+			if(m_threadDone)
+			{
+				break;
+			}
+			m_workRequested = false;
+		}
+
+		Execute();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(!m_workRequested)
+			{
+				m_busy.store(false, std::memory_order_release);
+			}
+		}
+		m_idleCondition.notify_all();
+	}
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Types.h"
+#include "zip/ZipArchiveWriter.h"
+#include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
+
+class CVpu;
+class CGIF;
+
+//Runs VU1 and its VIF on a separate thread.
+//VIF1 DMA transfers are copied into a ring that the worker consumes. While the worker is busy,
+//it owns VIF1, VU1's context and VU1 memory. Anything on the EE side that touches those must call
+//Sync first. Once synced, the worker stays idle until it's kicked again by the EE.
+//VIF1 DMA only completes once the worker consumed everything it was given.
+//GIF stays on the EE side: XGKICK, DIRECT and MSKPATH3 are queued by the worker and delivered
+//in order by the EE, FLUSH/FLUSHA wait for the queue to be delivered.
+class CVu1Thread
+{
+public:
+	typedef std::function<void()> FunctionType;
+
+	CVu1Thread(CVpu&, CGIF&, uint8*, uint8*);
+	CVu1Thread(const CVu1Thread&) = delete;
+	~CVu1Thread();
+
+	CVu1Thread& operator=(const CVu1Thread&) = delete;
+
+	void Reset();
+
+	//Worker needs to be synced before these are used
+	void SaveState(Framework::CZipArchiveWriter&);
+	void LoadState(Framework::CZipArchiveReader&);
+
+	static size_t GetRawStateSize();
+	void SaveRawState(CRawStateWriter&);
+	void LoadRawState(CRawStateReader&);
+
+	//EE side
+	uint32 ReceiveDMA(uint32, uint32, uint32, bool);
+	bool IsRingEmpty();
+	void CountTicks(uint32);
+	//Worker is running or GIF commands and VIF1 ticks are waiting to be handled
+	bool HasPendingUpdate() const;
+	void Kick();
+
+	inline void Sync()
+	{
+		if(!m_busy.load(std::memory_order_acquire) && (m_gifCommandCount.load(std::memory_order_acquire) == 0)) return;
+		WaitForIdle();
+	}
+
+	//VU1 side
+	void QueueXgKick(const uint8*, uint32);
+	void QueueDirect(const uint8*, uint32);
+	void QueueMaskPath3(bool);
+	void FlushGif();
+	void RunOnEe(const FunctionType&);
+
+private:
+	enum
+	{
+		RING_SIZE = 0x40000,
+		//DMA waits for the worker when there are more chunks than this, keeps the state layout fixed
+		MAX_RING_CHUNKS = 0x400,
+		VU_EXECUTE_QUOTA = 5000,
+	};
+
+	enum GIF_COMMAND_TYPE
+	{
+		GIF_COMMAND_PACKET,
+		GIF_COMMAND_MASKPATH3,
+		GIF_COMMAND_CALL,
+	};
+
+	struct RING_CHUNK
+	{
+		uint32 offset = 0;
+		uint32 size = 0;
+		bool tagIncluded = false;
+	};
+
+	struct GIF_COMMAND
+	{
+		GIF_COMMAND_TYPE type = GIF_COMMAND_PACKET;
+		uint32 pathIndex = 0;
+		uint32 position = 0;
+		std::vector<uint8> packet;
+		bool masked = false;
+		FunctionType function;
+	};
+
+	static uint32 GetXgKickPacketSize(const uint8*, uint32);
+
+	bool IsWorkerThread() const;
+	void PushGifCommand(GIF_COMMAND&&);
+	void DrainGifCommands();
+	void WaitForIdle();
+	void Execute();
+	void ThreadProc();
+
+	CVpu& m_vpu;
+	CGIF& m_gif;
+	uint8* m_ram = nullptr;
+	uint8* m_spr = nullptr;
+
+	std::mutex m_mutex;
+	std::condition_variable m_workCondition;
+	std::condition_variable m_idleCondition;
+	std::condition_variable m_gifCondition;
+	std::atomic<bool> m_busy = false;
+	bool m_workRequested = false;
+	bool m_eeWaiting = false;
+	std::atomic<bool> m_threadDone = false;
+	std::thread m_thread;
+	std::thread::id m_threadId;
+
+	std::vector<uint8> m_ring;
+	std::deque<RING_CHUNK> m_ringChunks;
+	uint32 m_ringUsed = 0;
+	uint32 m_ringWritePosition = 0;
+
+	//VIF1 ticks that went by while the worker was busy
+	uint32 m_pendingVifTicks = 0;
+
+	std::deque<GIF_COMMAND> m_gifCommands;
+	std::deque<GIF_COMMAND> m_drainingGifCommands;
+	std::atomic<uint32> m_gifCommandCount = 0;
+};
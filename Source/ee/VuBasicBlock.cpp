@@ -14,6 +14,13 @@ bool CVuBasicBlock::IsLinkable() const
 	return m_isLinkable;
 }
 
+bool CVuBasicBlock::IsCodeCacheable() const
+{
+	//Generated code depends on instructions outside of the block's range
+	//and compilation also updates m_isLinkable
+	return false;
+}
+
 void CVuBasicBlock::CompileRange(CMipsJitter* jitter)
 {
 	CompileProlog(jitter);
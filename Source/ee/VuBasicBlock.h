@@ -12,6 +12,7 @@ public:
 
 protected:
 	void CompileRange(CMipsJitter*) override;
+	bool IsCodeCacheable() const override;
 
 private:
 	struct INTEGER_BRANCH_DELAY_INFO
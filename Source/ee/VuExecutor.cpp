@@ -62,7 +62,7 @@ BasicBlockPtr CVuExecutor::BlockFactory(CMIPS& context, uint32 begin, uint32 end
 		//Check if we have a block that has the same contents but not the same range. Reuse the code of that block if that's the case.
 		if(beginBlockIterator != endBlockIterator)
 		{
-			auto result = std::make_shared<CVuBasicBlock>(context, begin, end, m_blockCategory);
+			auto result = MakeBlock<CVuBasicBlock>(context, begin, end, m_blockCategory);
 			result->CopyFunctionFrom(beginBlockIterator->second);
 			m_cachedBlocks.insert(std::make_pair(blockKey, result));
 			return result;
@@ -70,7 +70,7 @@ BasicBlockPtr CVuExecutor::BlockFactory(CMIPS& context, uint32 begin, uint32 end
 	}
 
 	//Totally new block, build it from scratch
-	auto result = std::make_shared<CVuBasicBlock>(context, begin, end, m_blockCategory);
+	auto result = MakeBlock<CVuBasicBlock>(context, begin, end, m_blockCategory);
 
 	auto blockCompileHintsIterator = std::find_if(std::begin(g_blockCompileHints), std::end(g_blockCompileHints),
 	                                              [&](const auto& item) { return item.blockKey == blockKey; });
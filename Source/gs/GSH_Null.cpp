@@ -1,5 +1,10 @@
 #include "GSH_Null.h"
 
+CGSH_Null::CGSH_Null(bool gsThreaded)
+    : CGSHandler(gsThreaded)
+{
+}
+
 void CGSH_Null::InitializeImpl()
 {
 }
@@ -5,7 +5,7 @@
 class CGSH_Null : public CGSHandler
 {
 public:
-	CGSH_Null() = default;
+	CGSH_Null(bool = true);
 	virtual ~CGSH_Null() = default;
 
 	void ProcessHostToLocalTransfer() override;
@@ -244,9 +244,18 @@ void CGSH_OpenGL::FlipImpl(const DISPLAY_INFO& dispInfo)
 	CGSHandler::FlipImpl(dispInfo);
 }
 
-void CGSH_OpenGL::LoadState(Framework::CZipArchiveReader& archive)
+void CGSH_OpenGL::LoadState(Framework::CZipArchiveReader& archive, bool includeRam)
 {
-	CGSHandler::LoadState(archive);
+	CGSHandler::LoadState(archive, includeRam);
+	SendGSCall(
+	    [this]() {
+		    m_textureCache.InvalidateRange(0, RAMSIZE);
+	    });
+}
+
+void CGSH_OpenGL::LoadRawState(CRawStateReader& reader, bool includeRam)
+{
+	CGSHandler::LoadRawState(reader, includeRam);
 	SendGSCall(
 	    [this]() {
 		    m_textureCache.InvalidateRange(0, RAMSIZE);
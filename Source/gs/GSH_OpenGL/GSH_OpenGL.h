@@ -28,7 +28,8 @@ public:
 
 	static void RegisterPreferences();
 
-	void LoadState(Framework::CZipArchiveReader&) override;
+	void LoadState(Framework::CZipArchiveReader&, bool = true) override;
+	void LoadRawState(CRawStateReader&, bool = true) override;
 
 	void ProcessHostToLocalTransfer() override;
 	void ProcessLocalToHostTransfer() override;
@@ -0,0 +1,1538 @@
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "GSH_Software.h"
+#include "GsPixelFormats.h"
+#include "ThreadUtils.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+template <typename ValueType>
+struct ATTRIBUTE_PLANE
+{
+	ValueType c = 0;
+	ValueType dx = 0;
+	ValueType dy = 0;
+
+	ValueType At(ValueType x, ValueType y) const
+	{
+		return c + (dx * x) + (dy * y);
+	}
+};
+
+struct EDGE_FUNCTION
+{
+	int64 a = 0;
+	int64 b = 0;
+	int64 c = 0;
+	int64 threshold = 0;
+
+	int64 At(int64 x, int64 y) const
+	{
+		return (a * x) + (b * y) + c;
+	}
+};
+
+template <typename ValueType>
+static ATTRIBUTE_PLANE<ValueType> MakePlane(ValueType x0, ValueType y0, ValueType x1, ValueType y1, ValueType x2, ValueType y2,
+                                            ValueType a0, ValueType a1, ValueType a2)
+{
+	ATTRIBUTE_PLANE<ValueType> plane;
+	ValueType det = ((x1 - x0) * (y2 - y0)) - ((x2 - x0) * (y1 - y0));
+	if(det == 0)
+	{
+		plane.c = a0;
+		return plane;
+	}
+	plane.dx = (((a1 - a0) * (y2 - y0)) - ((a2 - a0) * (y1 - y0))) / det;
+	plane.dy = (((a2 - a0) * (x1 - x0)) - ((a1 - a0) * (x2 - x0))) / det;
+	plane.c = a0 - (plane.dx * x0) - (plane.dy * y0);
+	return plane;
+}
+
+static EDGE_FUNCTION MakeEdge(int64 x0, int64 y0, int64 x1, int64 y1)
+{
+	//Triangles are expected to be wound so that the inside of every edge is positive
+	EDGE_FUNCTION edge;
+	edge.a = -(y1 - y0);
+	edge.b = (x1 - x0);
+	edge.c = -((edge.a * x0) + (edge.b * y0));
+	//Top-left fill convention: pixels lying exactly on an edge are only drawn for top or left edges
+	bool isTopLeft = (edge.a > 0) || ((edge.a == 0) && (edge.b > 0));
+	edge.threshold = isTopLeft ? 0 : 1;
+	return edge;
+}
+
+static uint32 ClampColorComponent(float value)
+{
+	return static_cast<uint32>(std::clamp<int32>(static_cast<int32>(value), 0, 0xFF));
+}
+
+static uint32 MakeColor(const float* components)
+{
+	return (ClampColorComponent(components[0]) << 0) |
+	       (ClampColorComponent(components[1]) << 8) |
+	       (ClampColorComponent(components[2]) << 16) |
+	       (ClampColorComponent(components[3]) << 24);
+}
+
+static uint32 Color16To32(uint16 color)
+{
+	return ((color & 0x001F) << 3) | ((color & 0x03E0) << 6) | ((color & 0x7C00) << 9) | ((color & 0x8000) ? 0x80000000 : 0);
+}
+
+static uint16 Color32To16(uint32 color)
+{
+	return static_cast<uint16>(((color >> 3) & 0x001F) | ((color >> 6) & 0x03E0) | ((color >> 9) & 0x7C00) | ((color >> 16) & 0x8000));
+}
+
+static uint32 ExpandAlpha24(uint32 color, const CGSHandler::TEXA& texA)
+{
+	color &= 0x00FFFFFF;
+	uint32 alpha = (texA.nAEM && (color == 0)) ? 0 : texA.nTA0;
+	return color | (alpha << 24);
+}
+
+static uint32 ExpandAlpha16(uint16 color, const CGSHandler::TEXA& texA)
+{
+	uint32 result = Color16To32(color) & 0x00FFFFFF;
+	uint32 alpha = (color & 0x8000) ? texA.nTA1 : ((texA.nAEM && ((color & 0x7FFF) == 0)) ? 0 : texA.nTA0);
+	return result | (alpha << 24);
+}
+
+CGSH_Software::CGSH_Software(bool gsThreaded, bool rasterThreaded)
+    : CGSHandler(gsThreaded)
+    , m_rasterThreaded(rasterThreaded)
+{
+}
+
+CGSH_Software::~CGSH_Software()
+{
+	//Workers are normally stopped in ReleaseImpl
+	StopWorkers();
+}
+
+CGSHandler::FactoryFunction CGSH_Software::GetFactoryFunction()
+{
+	return []() { return new CGSH_Software(); };
+}
+
+void CGSH_Software::InitializeImpl()
+{
+	//Page offset tables are built lazily, make sure they are ready before workers use them concurrently
+	CGsPixelFormats::CPixelIndexorPSMCT32::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexorPSMCT16::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexorPSMCT16S::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexorPSMT8::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexorPSMT4::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexorPSMZ32::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMZ16>::GetPageOffsets();
+	CGsPixelFormats::CPixelIndexorPSMZ16S::GetPageOffsets();
+
+	StartWorkers();
+}
+
+void CGSH_Software::ReleaseImpl()
+{
+	DiscardBatch();
+	StopWorkers();
+}
+
+void CGSH_Software::ResetImpl()
+{
+	DiscardBatch();
+	m_primitiveType = PRIM_INVALID;
+	m_vtxCount = 0;
+}
+
+void CGSH_Software::FlipImpl(const DISPLAY_INFO& displayInfo)
+{
+	FlushBatch();
+	CGSHandler::FlipImpl(displayInfo);
+}
+
+void CGSH_Software::SyncMemoryCache()
+{
+	FlushBatch();
+}
+
+void CGSH_Software::BeginTransferWrite()
+{
+	//Image data is written to RAM as soon as it's received, pending primitives need to land first
+	FlushBatch();
+	CGSHandler::BeginTransferWrite();
+}
+
+void CGSH_Software::SyncCLUT(const TEX0& tex0)
+{
+	if(tex0.nCLD != 0)
+	{
+		auto clutRange = std::make_pair(tex0.GetCLUTPtr(), static_cast<uint32>(CGsPixelFormats::PAGESIZE));
+		for(const auto& writeArea : m_batchWriteAreas)
+		{
+			if(RangesIntersect(clutRange, writeArea.range))
+			{
+				FlushBatch();
+				break;
+			}
+		}
+	}
+	CGSHandler::SyncCLUT(tex0);
+}
+
+void CGSH_Software::ProcessHostToLocalTransfer()
+{
+	//Nothing to do here, transfer was already written to RAM
+}
+
+void CGSH_Software::ProcessLocalToHostTransfer()
+{
+	FlushBatch();
+}
+
+void CGSH_Software::ProcessLocalToLocalTransfer()
+{
+	FlushBatch();
+
+	auto bltBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
+	auto trxReg = make_convertible<TRXREG>(m_nReg[GS_REG_TRXREG]);
+	auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
+
+	if(bltBuf.nSrcPsm != bltBuf.nDstPsm)
+	{
+		//Format conversions are not supported
+		assert(false);
+		return;
+	}
+
+	switch(bltBuf.nDstPsm)
+	{
+	case PSMCT32:
+	case PSMCT24:
+		CopyLocalToLocal<CGsPixelFormats::CPixelIndexorPSMCT32>(bltBuf, trxPos, trxReg);
+		break;
+	case PSMCT16:
+		CopyLocalToLocal<CGsPixelFormats::CPixelIndexorPSMCT16>(bltBuf, trxPos, trxReg);
+		break;
+	case PSMCT16S:
+		CopyLocalToLocal<CGsPixelFormats::CPixelIndexorPSMCT16S>(bltBuf, trxPos, trxReg);
+		break;
+	case PSMT8:
+		CopyLocalToLocal<CGsPixelFormats::CPixelIndexorPSMT8>(bltBuf, trxPos, trxReg);
+		break;
+	case PSMT4:
+		CopyLocalToLocal<CGsPixelFormats::CPixelIndexorPSMT4>(bltBuf, trxPos, trxReg);
+		break;
+	case PSMZ32:
+	case PSMZ24:
+		CopyLocalToLocal<CGsPixelFormats::CPixelIndexorPSMZ32>(bltBuf, trxPos, trxReg);
+		break;
+	case PSMZ16S:
+		CopyLocalToLocal<CGsPixelFormats::CPixelIndexorPSMZ16S>(bltBuf, trxPos, trxReg);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+void CGSH_Software::ProcessClutTransfer(uint32, uint32)
+{
+	m_clutDirty = true;
+}
+
+template <typename Indexor>
+void CGSH_Software::CopyLocalToLocal(const BITBLTBUF& bltBuf, const TRXPOS& trxPos, const TRXREG& trxReg)
+{
+	Indexor srcIndexor(m_pRAM, bltBuf.GetSrcPtr(), bltBuf.nSrcWidth);
+	Indexor dstIndexor(m_pRAM, bltBuf.GetDstPtr(), bltBuf.nDstWidth);
+
+	//DIR tells us in which order pixels need to be copied when source and destination overlap
+	bool reverseY = (trxPos.nDIR & 1) != 0;
+	bool reverseX = (trxPos.nDIR & 2) != 0;
+
+	for(uint32 rowIndex = 0; rowIndex < trxReg.nRRH; rowIndex++)
+	{
+		uint32 y = reverseY ? (trxReg.nRRH - rowIndex - 1) : rowIndex;
+		for(uint32 colIndex = 0; colIndex < trxReg.nRRW; colIndex++)
+		{
+			uint32 x = reverseX ? (trxReg.nRRW - colIndex - 1) : colIndex;
+			auto pixel = srcIndexor.GetPixel((trxPos.nSSAX + x) % 2048, (trxPos.nSSAY + y) % 2048);
+			dstIndexor.SetPixel((trxPos.nDSAX + x) % 2048, (trxPos.nDSAY + y) % 2048, pixel);
+		}
+	}
+}
+
+Framework::CBitmap CGSH_Software::GetScreenshot()
+{
+	SendGSCall([this]() { FlushBatch(); }, true);
+
+	auto displayInfo = GetCurrentDisplayInfo();
+	const auto& layer = displayInfo.layers[0];
+	if(!layer.enabled || (layer.width == 0) || (layer.height == 0))
+	{
+		return Framework::CBitmap();
+	}
+
+	auto bitmap = Framework::CBitmap(layer.width, layer.height, 32);
+	auto bitmapPixels = reinterpret_cast<uint32*>(bitmap.GetPixels());
+	uint32 bufWidth = layer.bufWidth / 64;
+
+	auto readPixels = [&](auto&& readPixel) {
+		for(uint32 y = 0; y < layer.height; y++)
+		{
+			for(uint32 x = 0; x < layer.width; x++)
+			{
+				uint32 pixel = readPixel(x, y);
+				uint32 r = (pixel & 0x000000FF) >> 0;
+				uint32 g = (pixel & 0x0000FF00) >> 8;
+				uint32 b = (pixel & 0x00FF0000) >> 16;
+				uint32 a = (pixel & 0xFF000000) >> 24;
+				(*bitmapPixels) = b | (g << 8) | (r << 16) | (a << 24);
+				bitmapPixels++;
+			}
+		}
+	};
+
+	switch(layer.psm)
+	{
+	case PSMCT32:
+	case PSMCT24:
+	{
+		CGsPixelFormats::CPixelIndexorPSMCT32 indexor(m_pRAM, layer.bufPtr, bufWidth);
+		readPixels([&](uint32 x, uint32 y) { return indexor.GetPixel(x, y) | ((layer.psm == PSMCT24) ? 0xFF000000 : 0); });
+	}
+	break;
+	case PSMCT16:
+	{
+		CGsPixelFormats::CPixelIndexorPSMCT16 indexor(m_pRAM, layer.bufPtr, bufWidth);
+		readPixels([&](uint32 x, uint32 y) { return Color16To32(indexor.GetPixel(x, y)); });
+	}
+	break;
+	case PSMCT16S:
+	{
+		CGsPixelFormats::CPixelIndexorPSMCT16S indexor(m_pRAM, layer.bufPtr, bufWidth);
+		readPixels([&](uint32 x, uint32 y) { return Color16To32(indexor.GetPixel(x, y)); });
+	}
+	break;
+	default:
+		assert(false);
+		break;
+	}
+
+	return bitmap;
+}
+
+/////////////////////////////////////////////////////////////
+// Primitive Setup
+/////////////////////////////////////////////////////////////
+
+void CGSH_Software::WriteRegisterImpl(uint8 registerId, uint64 data)
+{
+	CGSHandler::WriteRegisterImpl(registerId, data);
+
+	switch(registerId)
+	{
+	case GS_REG_PRIM:
+		SetPrimitiveType(static_cast<uint32>(data & 0x07));
+		break;
+
+	case GS_REG_XYZ2:
+	case GS_REG_XYZ3:
+	case GS_REG_XYZF2:
+	case GS_REG_XYZF3:
+		VertexKick(registerId, data);
+		break;
+	}
+}
+
+void CGSH_Software::SetPrimitiveType(uint32 primitiveType)
+{
+	m_primitiveType = primitiveType;
+	switch(m_primitiveType)
+	{
+	case PRIM_POINT:
+		m_vtxCount = 1;
+		break;
+	case PRIM_LINE:
+	case PRIM_LINESTRIP:
+		m_vtxCount = 2;
+		break;
+	case PRIM_TRIANGLE:
+	case PRIM_TRIANGLESTRIP:
+	case PRIM_TRIANGLEFAN:
+		m_vtxCount = 3;
+		break;
+	case PRIM_SPRITE:
+		m_vtxCount = 2;
+		break;
+	default:
+		m_vtxCount = 0;
+		break;
+	}
+}
+
+void CGSH_Software::VertexKick(uint8 registerId, uint64 data)
+{
+	if(m_vtxCount == 0) return;
+
+	bool drawingKick = (registerId == GS_REG_XYZ2) || (registerId == GS_REG_XYZF2);
+	bool fog = (registerId == GS_REG_XYZF2) || (registerId == GS_REG_XYZF3);
+
+	if(!m_drawEnabled) drawingKick = false;
+
+	auto& vertex = m_vtxBuffer[m_vtxCount - 1];
+	vertex.position = fog ? (data & 0x00FFFFFFFFFFFFFFULL) : data;
+	vertex.rgbaq = m_nReg[GS_REG_RGBAQ];
+	vertex.uv = m_nReg[GS_REG_UV];
+	vertex.st = m_nReg[GS_REG_ST];
+	vertex.fog = fog ? static_cast<uint8>(data >> 56) : static_cast<uint8>(m_nReg[GS_REG_FOG] >> 56);
+
+	m_vtxCount--;
+	if(m_vtxCount != 0) return;
+
+	//Vertex buffer is filled backwards, the most recent vertex is at index 0
+	switch(m_primitiveType)
+	{
+	case PRIM_POINT:
+	{
+		if(drawingKick) AddPrimitive(PRIM_POINT, m_vtxBuffer, 1);
+		m_vtxCount = 1;
+	}
+	break;
+	case PRIM_LINE:
+	case PRIM_LINESTRIP:
+	{
+		VERTEX vertices[2] = {m_vtxBuffer[1], m_vtxBuffer[0]};
+		if(drawingKick) AddPrimitive(PRIM_LINE, vertices, 2);
+		if(m_primitiveType == PRIM_LINESTRIP)
+		{
+			m_vtxBuffer[1] = m_vtxBuffer[0];
+			m_vtxCount = 1;
+		}
+		else
+		{
+			m_vtxCount = 2;
+		}
+	}
+	break;
+	case PRIM_TRIANGLE:
+	case PRIM_TRIANGLESTRIP:
+	case PRIM_TRIANGLEFAN:
+	{
+		VERTEX vertices[3] = {m_vtxBuffer[2], m_vtxBuffer[1], m_vtxBuffer[0]};
+		if(drawingKick) AddPrimitive(PRIM_TRIANGLE, vertices, 3);
+		if(m_primitiveType == PRIM_TRIANGLESTRIP)
+		{
+			m_vtxBuffer[2] = m_vtxBuffer[1];
+			m_vtxBuffer[1] = m_vtxBuffer[0];
+			m_vtxCount = 1;
+		}
+		else if(m_primitiveType == PRIM_TRIANGLEFAN)
+		{
+			m_vtxBuffer[1] = m_vtxBuffer[0];
+			m_vtxCount = 1;
+		}
+		else
+		{
+			m_vtxCount = 3;
+		}
+	}
+	break;
+	case PRIM_SPRITE:
+	{
+		VERTEX vertices[2] = {m_vtxBuffer[1], m_vtxBuffer[0]};
+		if(drawingKick) AddPrimitive(PRIM_SPRITE, vertices, 2);
+		m_vtxCount = 2;
+	}
+	break;
+	}
+}
+
+CGSH_Software::RASTER_VERTEX CGSH_Software::MakeRasterVertex(const VERTEX& vertex, const PRMODE& prmode) const
+{
+	auto xyz = make_convertible<XYZ>(vertex.position);
+	auto offset = make_convertible<XYOFFSET>(m_nReg[GS_REG_XYOFFSET_1 + prmode.nContext]);
+	auto rgbaq = make_convertible<RGBAQ>(vertex.rgbaq);
+
+	RASTER_VERTEX result = {};
+	result.x = static_cast<float>(static_cast<int32>(xyz.nX) - static_cast<int32>(offset.nOffsetX)) / 16.0f;
+	result.y = static_cast<float>(static_cast<int32>(xyz.nY) - static_cast<int32>(offset.nOffsetY)) / 16.0f;
+	result.z = static_cast<double>(xyz.nZ);
+	result.r = rgbaq.nR;
+	result.g = rgbaq.nG;
+	result.b = rgbaq.nB;
+	result.a = rgbaq.nA;
+	if(prmode.nUseUV)
+	{
+		auto uv = make_convertible<UV>(vertex.uv);
+		result.s = uv.GetU();
+		result.t = uv.GetV();
+		result.q = 1.0f;
+	}
+	else
+	{
+		auto st = make_convertible<ST>(vertex.st);
+		result.s = st.nS;
+		result.t = st.nT;
+		result.q = rgbaq.nQ;
+	}
+	result.fog = vertex.fog;
+	return result;
+}
+
+CGSH_Software::MemoryRange CGSH_Software::GetBufferRange(uint32 bufPtr, uint32 bufWidth, uint32 height, uint32 psm)
+{
+	auto pageSize = CGsPixelFormats::GetPsmPageSize(psm);
+	uint32 pagePitch = std::max<uint32>((bufWidth + pageSize.first - 1) / pageSize.first, 1);
+	uint32 pageRows = std::max<uint32>((height + pageSize.second - 1) / pageSize.second, 1);
+	return std::make_pair(bufPtr, pagePitch * pageRows * CGsPixelFormats::PAGESIZE);
+}
+
+bool CGSH_Software::RangesIntersect(const MemoryRange& range1, const MemoryRange& range2)
+{
+	uint32 start1 = range1.first;
+	uint32 end1 = range1.first + range1.second;
+	uint32 start2 = range2.first;
+	uint32 end2 = range2.first + range2.second;
+	return (start1 < end2) && (start2 < end1);
+}
+
+//Returns true if the area overlaps with memory written by the batch using a different layout,
+//or wraps around the end of RAM, in which case a pixel can share memory with pixels of other tiles
+bool CGSH_Software::AddBatchWriteArea(const MemoryRange& range, uint32 bufWidth, uint32 psm)
+{
+	bool aliased = (range.first + range.second) > RAMSIZE;
+	for(const auto& writeArea : m_batchWriteAreas)
+	{
+		if(!RangesIntersect(range, writeArea.range)) continue;
+		bool sameLayout = (range.first == writeArea.range.first) && (bufWidth == writeArea.bufWidth) && (psm == writeArea.psm);
+		aliased |= !sameLayout;
+	}
+	m_batchWriteAreas.push_back({range, bufWidth, psm});
+	return aliased;
+}
+
+bool CGSH_Software::CanUseFastSpan(const DRAWSTATE& state)
+{
+	auto prmode = make_convertible<PRMODE>(state.primReg);
+	auto frame = make_convertible<FRAME>(state.frameReg);
+	auto zbuf = make_convertible<ZBUF>(state.zbufReg);
+	auto test = make_convertible<TEST>(state.testReg);
+
+	if(frame.nPsm != PSMCT32) return false;
+	if(frame.nMask != 0) return false;
+	if(prmode.nTexture || prmode.nFog || prmode.nAlpha) return false;
+	if(test.nAlphaEnabled && (test.nAlphaMethod != ALPHA_TEST_ALWAYS)) return false;
+	if(test.nDestAlphaEnabled) return false;
+	if(test.nDepthEnabled && ((test.nDepthMethod != DEPTH_TEST_ALWAYS) || !zbuf.nMask)) return false;
+	if(state.fbaReg & 1) return false;
+	return true;
+}
+
+uint32 CGSH_Software::GetCurrentDrawState(const PRMODE& prmode)
+{
+	uint32 context = prmode.nContext;
+
+	//Check if we're about to sample from an area that pending primitives are rendering to.
+	//This also covers primitives of the current state when its texture aliases its own frame or z buffer.
+	MemoryRange textureRange = std::make_pair(0, 0);
+	if(prmode.nTexture)
+	{
+		auto tex0 = make_convertible<TEX0>(m_nReg[GS_REG_TEX0_1 + context]);
+		textureRange = GetBufferRange(tex0.GetBufPtr(), tex0.GetBufWidth(), tex0.GetHeight(), tex0.nPsm);
+		for(const auto& writeArea : m_batchWriteAreas)
+		{
+			if(RangesIntersect(textureRange, writeArea.range))
+			{
+				FlushBatch();
+				break;
+			}
+		}
+	}
+
+	DRAWSTATE state;
+	state.primReg = prmode;
+	state.frameReg = m_nReg[GS_REG_FRAME_1 + context];
+	state.zbufReg = m_nReg[GS_REG_ZBUF_1 + context];
+	state.testReg = m_nReg[GS_REG_TEST_1 + context];
+	state.alphaReg = m_nReg[GS_REG_ALPHA_1 + context];
+	state.tex0Reg = m_nReg[GS_REG_TEX0_1 + context];
+	state.clampReg = m_nReg[GS_REG_CLAMP_1 + context];
+	state.texaReg = m_nReg[GS_REG_TEXA];
+	state.fogColReg = m_nReg[GS_REG_FOGCOL];
+	state.scissorReg = m_nReg[GS_REG_SCISSOR_1 + context];
+	state.colClampReg = m_nReg[GS_REG_COLCLAMP];
+	state.pabeReg = m_nReg[GS_REG_PABE];
+	state.fbaReg = m_nReg[GS_REG_FBA_1 + context];
+
+	if(!m_drawStates.empty() && !m_clutDirty)
+	{
+		//Registers are laid out contiguously before the CLUT, compare them in one go
+		const auto& lastState = m_drawStates.back();
+		if(memcmp(&lastState, &state, offsetof(DRAWSTATE, clut)) == 0)
+		{
+			return static_cast<uint32>(m_drawStates.size() - 1);
+		}
+	}
+
+	auto tex0 = make_convertible<TEX0>(state.tex0Reg);
+	auto frame = make_convertible<FRAME>(state.frameReg);
+	auto zbuf = make_convertible<ZBUF>(state.zbufReg);
+	auto scissor = make_convertible<SCISSOR>(state.scissorReg);
+
+	if(prmode.nTexture)
+	{
+		if(CGsPixelFormats::IsPsmIDTEX(tex0.nPsm))
+		{
+			MakeLinearCLUT(tex0, state.clut);
+			auto texA = make_convertible<TEXA>(state.texaReg);
+			if((tex0.nCPSM == PSMCT16) || (tex0.nCPSM == PSMCT16S))
+			{
+				//MakeLinearCLUT sets alpha to 0xFF when the 16-bit alpha bit is set
+				for(auto& color : state.clut)
+				{
+					uint32 rgb = color & 0x00FFFFFF;
+					uint32 alpha = (color & 0xFF000000) ? texA.nTA1 : ((texA.nAEM && (rgb == 0)) ? 0 : texA.nTA0);
+					color = rgb | (alpha << 24);
+				}
+			}
+			else if(tex0.nCPSM == PSMCT24)
+			{
+				for(auto& color : state.clut)
+				{
+					color = ExpandAlpha24(color, texA);
+				}
+			}
+		}
+	}
+
+	state.useFastSpan = CanUseFastSpan(state);
+	m_clutDirty = false;
+
+	uint32 frameHeight = scissor.scay1 + 1;
+	auto frameRange = GetBufferRange(frame.GetBasePtr(), frame.GetWidth(), frameHeight, frame.nPsm);
+	bool feedback = prmode.nTexture && RangesIntersect(textureRange, frameRange);
+	//Pixels past the buffer width wrap around to rows that belong to other tiles
+	bool aliased = (scissor.scax1 >= frame.GetWidth());
+	aliased |= AddBatchWriteArea(frameRange, frame.GetWidth(), frame.nPsm);
+	if(!zbuf.nMask)
+	{
+		auto zbufRange = GetBufferRange(zbuf.GetBasePtr(), frame.GetWidth(), frameHeight, zbuf.nPsm | 0x30);
+		feedback |= prmode.nTexture && RangesIntersect(textureRange, zbufRange);
+		aliased |= AddBatchWriteArea(zbufRange, frame.GetWidth(), zbuf.nPsm | 0x30);
+	}
+
+	//A primitive reading what it writes depends on the order pixels are drawn in, and pixels of
+	//different tiles landing on the same memory would be written by different workers at the same
+	//time, keep the batch on this thread in both cases
+	m_batchSerial |= feedback || aliased;
+
+	m_drawStates.push_back(state);
+	m_drawCallCount++;
+	return static_cast<uint32>(m_drawStates.size() - 1);
+}
+
+void CGSH_Software::AddPrimitive(uint32 primitiveType, const VERTEX* vertices, uint32 vertexCount)
+{
+	auto prmode = make_convertible<PRMODE>(((m_nReg[GS_REG_PRMODECONT] & 1) != 0) ? m_nReg[GS_REG_PRIM] : m_nReg[GS_REG_PRMODE]);
+
+	PRIMITIVE primitive;
+	primitive.type = primitiveType;
+	primitive.stateIndex = GetCurrentDrawState(prmode);
+
+	for(uint32 i = 0; i < vertexCount; i++)
+	{
+		primitive.vertices[i] = MakeRasterVertex(vertices[i], prmode);
+	}
+
+	//Flat shading and sprites use the color of the last vertex
+	if(!prmode.nShading || (primitiveType == PRIM_SPRITE))
+	{
+		const auto& lastVertex = primitive.vertices[vertexCount - 1];
+		for(uint32 i = 0; i < vertexCount - 1; i++)
+		{
+			auto& vertex = primitive.vertices[i];
+			vertex.r = lastVertex.r;
+			vertex.g = lastVertex.g;
+			vertex.b = lastVertex.b;
+			vertex.a = lastVertex.a;
+		}
+	}
+
+	float minX = primitive.vertices[0].x;
+	float minY = primitive.vertices[0].y;
+	float maxX = minX;
+	float maxY = minY;
+	for(uint32 i = 1; i < vertexCount; i++)
+	{
+		minX = std::min(minX, primitive.vertices[i].x);
+		minY = std::min(minY, primitive.vertices[i].y);
+		maxX = std::max(maxX, primitive.vertices[i].x);
+		maxY = std::max(maxY, primitive.vertices[i].y);
+	}
+
+	auto scissor = make_convertible<SCISSOR>(m_drawStates[primitive.stateIndex].scissorReg);
+	primitive.minX = std::max<int32>(static_cast<int32>(std::floor(minX)), scissor.scax0);
+	primitive.minY = std::max<int32>(static_cast<int32>(std::floor(minY)), scissor.scay0);
+	primitive.maxX = std::min<int32>(static_cast<int32>(std::ceil(maxX)), scissor.scax1);
+	primitive.maxY = std::min<int32>(static_cast<int32>(std::ceil(maxY)), scissor.scay1);
+	if((primitive.minX > primitive.maxX) || (primitive.minY > primitive.maxY))
+	{
+		return;
+	}
+
+	m_primitives.push_back(primitive);
+	if(m_primitives.size() == MAX_BATCH_PRIMITIVES)
+	{
+		FlushBatch();
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// Batch Processing
+/////////////////////////////////////////////////////////////
+
+void CGSH_Software::StartWorkers()
+{
+	assert(m_workers.empty());
+
+	//The GS thread also processes tiles while waiting for workers
+	uint32 workerCount = std::min<uint32>(std::thread::hardware_concurrency(), MAX_WORKER_COUNT);
+	workerCount = (workerCount > 1) ? (workerCount - 1) : 0;
+	if(!m_rasterThreaded) workerCount = 0;
+
+	m_workersExit = false;
+	for(uint32 i = 0; i < workerCount; i++)
+	{
+		m_workers.emplace_back([this]() { WorkerThreadProc(); });
+		Framework::ThreadUtils::SetThreadName(m_workers.back(), "GS Software Worker Thread");
+	}
+}
+
+void CGSH_Software::StopWorkers()
+{
+	{
+		std::lock_guard workerLock(m_workerMutex);
+		m_workersExit = true;
+	}
+	m_workerStartCondition.notify_all();
+	for(auto& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+}
+
+void CGSH_Software::WorkerThreadProc()
+{
+	uint32 generation = 0;
+	while(1)
+	{
+		{
+			std::unique_lock workerLock(m_workerMutex);
+			m_workerStartCondition.wait(workerLock, [&]() { return m_workersExit || (m_workerGeneration != generation); });
+			if(m_workersExit) break;
+			generation = m_workerGeneration;
+		}
+
+		ProcessTiles();
+
+		{
+			std::lock_guard workerLock(m_workerMutex);
+			assert(m_workersPending != 0);
+			m_workersPending--;
+		}
+		m_workerDoneCondition.notify_one();
+	}
+}
+
+void CGSH_Software::DiscardBatch()
+{
+	for(auto tileIndex : m_activeTiles)
+	{
+		m_tileBins[tileIndex].clear();
+	}
+	m_activeTiles.clear();
+	m_primitives.clear();
+	m_drawStates.clear();
+	m_batchWriteAreas.clear();
+	m_batchSerial = false;
+	m_clutDirty = true;
+}
+
+void CGSH_Software::FlushBatch()
+{
+	if(m_primitives.empty())
+	{
+		DiscardBatch();
+		return;
+	}
+
+	for(uint32 primitiveIndex = 0; primitiveIndex < m_primitives.size(); primitiveIndex++)
+	{
+		const auto& primitive = m_primitives[primitiveIndex];
+		uint32 tileStartX = primitive.minX / TILE_WIDTH;
+		uint32 tileStartY = primitive.minY / TILE_HEIGHT;
+		uint32 tileEndX = primitive.maxX / TILE_WIDTH;
+		uint32 tileEndY = primitive.maxY / TILE_HEIGHT;
+		for(uint32 tileY = tileStartY; tileY <= tileEndY; tileY++)
+		{
+			for(uint32 tileX = tileStartX; tileX <= tileEndX; tileX++)
+			{
+				uint32 tileIndex = tileX + (tileY * TILE_COUNT_X);
+				auto& tileBin = m_tileBins[tileIndex];
+				if(tileBin.empty())
+				{
+					m_activeTiles.push_back(tileIndex);
+				}
+				tileBin.push_back(primitiveIndex);
+			}
+		}
+	}
+
+	m_nextTileIndex = 0;
+
+	if(!m_workers.empty() && (m_activeTiles.size() > 1) && !m_batchSerial)
+	{
+		{
+			std::lock_guard workerLock(m_workerMutex);
+			m_workerGeneration++;
+			m_workersPending = static_cast<uint32>(m_workers.size());
+		}
+		m_workerStartCondition.notify_all();
+
+		ProcessTiles();
+
+		std::unique_lock workerLock(m_workerMutex);
+		m_workerDoneCondition.wait(workerLock, [this]() { return m_workersPending == 0; });
+	}
+	else
+	{
+		ProcessTiles();
+	}
+
+	DiscardBatch();
+}
+
+void CGSH_Software::ProcessTiles()
+{
+	while(1)
+	{
+		uint32 activeTileIndex = m_nextTileIndex++;
+		if(activeTileIndex >= m_activeTiles.size()) break;
+		ProcessTile(m_activeTiles[activeTileIndex]);
+	}
+}
+
+void CGSH_Software::ProcessTile(uint32 tileIndex)
+{
+	int32 tileX = (tileIndex % TILE_COUNT_X) * TILE_WIDTH;
+	int32 tileY = (tileIndex / TILE_COUNT_X) * TILE_HEIGHT;
+
+	//Primitives are processed in submission order. Batches where pixels of different tiles can share
+	//memory are never split across workers, which keeps results identical to serial rendering.
+	for(auto primitiveIndex : m_tileBins[tileIndex])
+	{
+		const auto& primitive = m_primitives[primitiveIndex];
+
+		TILE_RECT rect;
+		rect.minX = std::max<int32>(primitive.minX, tileX);
+		rect.minY = std::max<int32>(primitive.minY, tileY);
+		rect.maxX = std::min<int32>(primitive.maxX, tileX + TILE_WIDTH - 1);
+		rect.maxY = std::min<int32>(primitive.maxY, tileY + TILE_HEIGHT - 1);
+
+		switch(primitive.type)
+		{
+		case PRIM_POINT:
+			RasterizePoint(primitive, rect);
+			break;
+		case PRIM_LINE:
+			RasterizeLine(primitive, rect);
+			break;
+		case PRIM_TRIANGLE:
+			RasterizeTriangle(primitive, rect);
+			break;
+		case PRIM_SPRITE:
+			RasterizeSprite(primitive, rect);
+			break;
+		default:
+			assert(false);
+			break;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// Rasterization
+/////////////////////////////////////////////////////////////
+
+void CGSH_Software::RasterizePoint(const PRIMITIVE& primitive, const TILE_RECT& rect)
+{
+	const auto& state = m_drawStates[primitive.stateIndex];
+	const auto& vertex = primitive.vertices[0];
+
+	int32 x = static_cast<int32>(std::floor(vertex.x + 0.5f));
+	int32 y = static_cast<int32>(std::floor(vertex.y + 0.5f));
+	if((x < rect.minX) || (x > rect.maxX) || (y < rect.minY) || (y > rect.maxY)) return;
+
+	DrawPixel(state, x, y, static_cast<uint32>(vertex.z), ShadeFragment(state, vertex));
+}
+
+void CGSH_Software::RasterizeLine(const PRIMITIVE& primitive, const TILE_RECT& rect)
+{
+	const auto& state = m_drawStates[primitive.stateIndex];
+	const auto& v0 = primitive.vertices[0];
+	const auto& v1 = primitive.vertices[1];
+
+	float deltaX = v1.x - v0.x;
+	float deltaY = v1.y - v0.y;
+	int32 stepCount = static_cast<int32>(std::ceil(std::max(std::fabs(deltaX), std::fabs(deltaY))));
+
+	//The last pixel of a line is not drawn
+	for(int32 step = 0; step < stepCount; step++)
+	{
+		float t = static_cast<float>(step) / static_cast<float>(stepCount);
+		int32 x = static_cast<int32>(std::floor(v0.x + (deltaX * t) + 0.5f));
+		int32 y = static_cast<int32>(std::floor(v0.y + (deltaY * t) + 0.5f));
+		if((x < rect.minX) || (x > rect.maxX) || (y < rect.minY) || (y > rect.maxY)) continue;
+
+		RASTER_VERTEX fragment;
+		fragment.z = v0.z + ((v1.z - v0.z) * t);
+		fragment.r = v0.r + ((v1.r - v0.r) * t);
+		fragment.g = v0.g + ((v1.g - v0.g) * t);
+		fragment.b = v0.b + ((v1.b - v0.b) * t);
+		fragment.a = v0.a + ((v1.a - v0.a) * t);
+		fragment.s = v0.s + ((v1.s - v0.s) * t);
+		fragment.t = v0.t + ((v1.t - v0.t) * t);
+		fragment.q = v0.q + ((v1.q - v0.q) * t);
+		fragment.fog = v0.fog + ((v1.fog - v0.fog) * t);
+
+		DrawPixel(state, x, y, static_cast<uint32>(fragment.z), ShadeFragment(state, fragment));
+	}
+}
+
+void CGSH_Software::RasterizeTriangle(const PRIMITIVE& primitive, const TILE_RECT& rect)
+{
+	const auto& state = m_drawStates[primitive.stateIndex];
+
+	const RASTER_VERTEX* v0 = &primitive.vertices[0];
+	const RASTER_VERTEX* v1 = &primitive.vertices[1];
+	const RASTER_VERTEX* v2 = &primitive.vertices[2];
+
+	//Coverage is computed in 12.4 fixed point to match the precision of the GS
+	auto toFixed = [](float value) { return static_cast<int64>(std::lround(value * 16.0f)); };
+	int64 x0 = toFixed(v0->x), y0 = toFixed(v0->y);
+	int64 x1 = toFixed(v1->x), y1 = toFixed(v1->y);
+	int64 x2 = toFixed(v2->x), y2 = toFixed(v2->y);
+
+	int64 area = ((x1 - x0) * (y2 - y0)) - ((x2 - x0) * (y1 - y0));
+	if(area == 0) return;
+	if(area < 0)
+	{
+		std::swap(v1, v2);
+		std::swap(x1, x2);
+		std::swap(y1, y2);
+	}
+
+	EDGE_FUNCTION edges[3] =
+	    {
+	        MakeEdge(x0, y0, x1, y1),
+	        MakeEdge(x1, y1, x2, y2),
+	        MakeEdge(x2, y2, x0, y0),
+	    };
+
+	auto makePlane = [&](float a0, float a1, float a2) {
+		return MakePlane<float>(v0->x, v0->y, v1->x, v1->y, v2->x, v2->y, a0, a1, a2);
+	};
+
+	auto planeZ = MakePlane<double>(v0->x, v0->y, v1->x, v1->y, v2->x, v2->y, v0->z, v1->z, v2->z);
+	ATTRIBUTE_PLANE<float> planeColor[4] =
+	    {
+	        makePlane(v0->r, v1->r, v2->r),
+	        makePlane(v0->g, v1->g, v2->g),
+	        makePlane(v0->b, v1->b, v2->b),
+	        makePlane(v0->a, v1->a, v2->a),
+	    };
+	auto planeS = makePlane(v0->s, v1->s, v2->s);
+	auto planeT = makePlane(v0->t, v1->t, v2->t);
+	auto planeQ = makePlane(v0->q, v1->q, v2->q);
+	auto planeFog = makePlane(v0->fog, v1->fog, v2->fog);
+
+	for(int32 y = rect.minY; y <= rect.maxY; y++)
+	{
+		int64 sampleY = static_cast<int64>(y) * 16;
+		int64 w[3];
+		for(uint32 i = 0; i < 3; i++)
+		{
+			w[i] = edges[i].At(static_cast<int64>(rect.minX) * 16, sampleY);
+		}
+
+		//Triangles are convex, covered pixels form a single span on every row
+		int32 spanStart = -1;
+		int32 spanEnd = -1;
+		for(int32 x = rect.minX; x <= rect.maxX; x++)
+		{
+			bool inside = (w[0] >= edges[0].threshold) && (w[1] >= edges[1].threshold) && (w[2] >= edges[2].threshold);
+			if(inside)
+			{
+				if(spanStart < 0) spanStart = x;
+				spanEnd = x;
+			}
+			else if(spanStart >= 0)
+			{
+				break;
+			}
+			for(uint32 i = 0; i < 3; i++)
+			{
+				w[i] += edges[i].a * 16;
+			}
+		}
+
+		if(spanStart < 0) continue;
+
+		float fy = static_cast<float>(y);
+		if(state.useFastSpan)
+		{
+			float color[4];
+			float colorStep[4];
+			for(uint32 i = 0; i < 4; i++)
+			{
+				color[i] = planeColor[i].At(static_cast<float>(spanStart), fy);
+				colorStep[i] = planeColor[i].dx;
+			}
+			DrawFastSpan32(state, y, spanStart, spanEnd, color, colorStep);
+			continue;
+		}
+
+		for(int32 x = spanStart; x <= spanEnd; x++)
+		{
+			float fx = static_cast<float>(x);
+			RASTER_VERTEX fragment;
+			fragment.z = planeZ.At(fx, fy);
+			fragment.r = planeColor[0].At(fx, fy);
+			fragment.g = planeColor[1].At(fx, fy);
+			fragment.b = planeColor[2].At(fx, fy);
+			fragment.a = planeColor[3].At(fx, fy);
+			fragment.s = planeS.At(fx, fy);
+			fragment.t = planeT.At(fx, fy);
+			fragment.q = planeQ.At(fx, fy);
+			fragment.fog = planeFog.At(fx, fy);
+
+			uint32 z = static_cast<uint32>(std::clamp<double>(fragment.z, 0, static_cast<double>(UINT32_MAX)));
+			DrawPixel(state, x, y, z, ShadeFragment(state, fragment));
+		}
+	}
+}
+
+void CGSH_Software::RasterizeSprite(const PRIMITIVE& primitive, const TILE_RECT& rect)
+{
+	const auto& state = m_drawStates[primitive.stateIndex];
+	const auto& v0 = primitive.vertices[0];
+	const auto& v1 = primitive.vertices[1];
+
+	const auto& left = (v0.x <= v1.x) ? v0 : v1;
+	const auto& right = (v0.x <= v1.x) ? v1 : v0;
+	const auto& top = (v0.y <= v1.y) ? v0 : v1;
+	const auto& bottom = (v0.y <= v1.y) ? v1 : v0;
+
+	//Pixels whose sampling point lies in [x0, x1) and [y0, y1) are covered
+	int32 startX = std::max<int32>(static_cast<int32>(std::ceil(left.x)), rect.minX);
+	int32 endX = std::min<int32>(static_cast<int32>(std::ceil(right.x)) - 1, rect.maxX);
+	int32 startY = std::max<int32>(static_cast<int32>(std::ceil(top.y)), rect.minY);
+	int32 endY = std::min<int32>(static_cast<int32>(std::ceil(bottom.y)) - 1, rect.maxY);
+	if((startX > endX) || (startY > endY)) return;
+
+	uint32 z = static_cast<uint32>(v1.z);
+
+	if(state.useFastSpan)
+	{
+		float color[4] = {v1.r, v1.g, v1.b, v1.a};
+		static const float colorStep[4] = {0, 0, 0, 0};
+		for(int32 y = startY; y <= endY; y++)
+		{
+			DrawFastSpan32(state, y, startX, endX, color, colorStep);
+		}
+		return;
+	}
+
+	float width = right.x - left.x;
+	float height = bottom.y - top.y;
+	float dsdx = (width != 0) ? (right.s - left.s) / width : 0;
+	float dtdy = (height != 0) ? (bottom.t - top.t) / height : 0;
+
+	RASTER_VERTEX fragment = v1;
+	for(int32 y = startY; y <= endY; y++)
+	{
+		fragment.t = top.t + (dtdy * (static_cast<float>(y) - top.y));
+		for(int32 x = startX; x <= endX; x++)
+		{
+			fragment.s = left.s + (dsdx * (static_cast<float>(x) - left.x));
+			DrawPixel(state, x, y, z, ShadeFragment(state, fragment));
+		}
+	}
+}
+
+void CGSH_Software::DrawFastSpan32(const DRAWSTATE& state, int32 y, int32 startX, int32 endX, const float* color, const float* colorStep)
+{
+	auto frame = make_convertible<FRAME>(state.frameReg);
+	CGsPixelFormats::CPixelIndexorPSMCT32 indexor(m_pRAM, frame.GetBasePtr(), frame.nWidth);
+
+	float currentColor[4] = {color[0], color[1], color[2], color[3]};
+	auto drawScalar = [&](int32 x) {
+		*indexor.GetPixelAddress(x, y) = MakeColor(currentColor);
+		for(uint32 i = 0; i < 4; i++)
+		{
+			currentColor[i] += colorStep[i];
+		}
+	};
+
+	int32 x = startX;
+	for(; (x <= endX) && ((x & 3) != 0); x++)
+	{
+		drawScalar(x);
+	}
+
+	//Within a PSMCT32 column, pixels (x, x + 1) and (x + 2, x + 3) are stored as
+	//pairs 16 bytes apart when x is a multiple of 4
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	__m128 colorVector = _mm_loadu_ps(currentColor);
+	__m128 stepVector = _mm_loadu_ps(colorStep);
+	for(; (x + 3) <= endX; x += 4)
+	{
+		__m128 color0 = colorVector;
+		__m128 color1 = _mm_add_ps(color0, stepVector);
+		__m128 color2 = _mm_add_ps(color1, stepVector);
+		__m128 color3 = _mm_add_ps(color2, stepVector);
+		colorVector = _mm_add_ps(color3, stepVector);
+
+		__m128i pixels01 = _mm_packs_epi32(_mm_cvttps_epi32(color0), _mm_cvttps_epi32(color1));
+		__m128i pixels23 = _mm_packs_epi32(_mm_cvttps_epi32(color2), _mm_cvttps_epi32(color3));
+		__m128i pixels = _mm_packus_epi16(pixels01, pixels23);
+
+		auto pixelAddress = reinterpret_cast<uint8*>(indexor.GetPixelAddress(x, y));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(pixelAddress), pixels);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(pixelAddress + 0x10), _mm_unpackhi_epi64(pixels, pixels));
+	}
+	_mm_storeu_ps(currentColor, colorVector);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	float32x4_t colorVector = vld1q_f32(currentColor);
+	float32x4_t stepVector = vld1q_f32(colorStep);
+	for(; (x + 3) <= endX; x += 4)
+	{
+		float32x4_t color0 = colorVector;
+		float32x4_t color1 = vaddq_f32(color0, stepVector);
+		float32x4_t color2 = vaddq_f32(color1, stepVector);
+		float32x4_t color3 = vaddq_f32(color2, stepVector);
+		colorVector = vaddq_f32(color3, stepVector);
+
+		uint16x8_t pixels01 = vcombine_u16(vqmovn_u32(vcvtq_u32_f32(color0)), vqmovn_u32(vcvtq_u32_f32(color1)));
+		uint16x8_t pixels23 = vcombine_u16(vqmovn_u32(vcvtq_u32_f32(color2)), vqmovn_u32(vcvtq_u32_f32(color3)));
+		uint32x4_t pixels = vreinterpretq_u32_u8(vcombine_u8(vqmovn_u16(pixels01), vqmovn_u16(pixels23)));
+
+		auto pixelAddress = reinterpret_cast<uint32*>(indexor.GetPixelAddress(x, y));
+		vst1_u32(pixelAddress, vget_low_u32(pixels));
+		vst1_u32(pixelAddress + 4, vget_high_u32(pixels));
+	}
+	vst1q_f32(currentColor, colorVector);
+#endif
+
+	for(; x <= endX; x++)
+	{
+		drawScalar(x);
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// Pixel Pipeline
+/////////////////////////////////////////////////////////////
+
+uint32 CGSH_Software::ShadeFragment(const DRAWSTATE& state, const RASTER_VERTEX& fragment) const
+{
+	auto prmode = make_convertible<PRMODE>(state.primReg);
+
+	int32 color[4] =
+	    {
+	        static_cast<int32>(ClampColorComponent(fragment.r)),
+	        static_cast<int32>(ClampColorComponent(fragment.g)),
+	        static_cast<int32>(ClampColorComponent(fragment.b)),
+	        static_cast<int32>(ClampColorComponent(fragment.a)),
+	    };
+
+	if(prmode.nTexture)
+	{
+		auto tex0 = make_convertible<TEX0>(state.tex0Reg);
+		uint32 texel = SampleTexture(state, fragment);
+		int32 texelColor[4] =
+		    {
+		        static_cast<int32>((texel >> 0) & 0xFF),
+		        static_cast<int32>((texel >> 8) & 0xFF),
+		        static_cast<int32>((texel >> 16) & 0xFF),
+		        static_cast<int32>((texel >> 24) & 0xFF),
+		    };
+		int32 vertexAlpha = color[3];
+
+		switch(tex0.nFunction)
+		{
+		case TEX0_FUNCTION_MODULATE:
+			for(uint32 i = 0; i < 3; i++)
+			{
+				color[i] = std::min<int32>((texelColor[i] * color[i]) >> 7, 0xFF);
+			}
+			if(tex0.nColorComp) color[3] = std::min<int32>((texelColor[3] * vertexAlpha) >> 7, 0xFF);
+			break;
+		case TEX0_FUNCTION_DECAL:
+			for(uint32 i = 0; i < 3; i++)
+			{
+				color[i] = texelColor[i];
+			}
+			if(tex0.nColorComp) color[3] = texelColor[3];
+			break;
+		case TEX0_FUNCTION_HIGHLIGHT:
+		case TEX0_FUNCTION_HIGHLIGHT2:
+			for(uint32 i = 0; i < 3; i++)
+			{
+				color[i] = std::min<int32>(((texelColor[i] * color[i]) >> 7) + vertexAlpha, 0xFF);
+			}
+			if(tex0.nColorComp)
+			{
+				color[3] = (tex0.nFunction == TEX0_FUNCTION_HIGHLIGHT) ? std::min<int32>(texelColor[3] + vertexAlpha, 0xFF) : texelColor[3];
+			}
+			break;
+		}
+	}
+
+	if(prmode.nFog)
+	{
+		auto fogCol = make_convertible<FOGCOL>(state.fogColReg);
+		int32 fogColor[3] = {static_cast<int32>(fogCol.nFCR), static_cast<int32>(fogCol.nFCG), static_cast<int32>(fogCol.nFCB)};
+		int32 fog = static_cast<int32>(ClampColorComponent(fragment.fog));
+		for(uint32 i = 0; i < 3; i++)
+		{
+			color[i] = ((fog * color[i]) + ((0xFF - fog) * fogColor[i])) >> 8;
+		}
+	}
+
+	return color[0] | (color[1] << 8) | (color[2] << 16) | (color[3] << 24);
+}
+
+uint32 CGSH_Software::SampleTexture(const DRAWSTATE& state, const RASTER_VERTEX& fragment) const
+{
+	auto prmode = make_convertible<PRMODE>(state.primReg);
+	auto tex0 = make_convertible<TEX0>(state.tex0Reg);
+	auto clamp = make_convertible<CLAMP>(state.clampReg);
+
+	int32 width = tex0.GetWidth();
+	int32 height = tex0.GetHeight();
+
+	float u = fragment.s;
+	float v = fragment.t;
+	if(!prmode.nUseUV)
+	{
+		float q = (fragment.q != 0) ? fragment.q : 1.0f;
+		u = (fragment.s / q) * static_cast<float>(width);
+		v = (fragment.t / q) * static_cast<float>(height);
+	}
+
+	auto wrap = [](int32 coord, uint32 mode, int32 size, int32 minCoord, int32 maxCoord) {
+		switch(mode)
+		{
+		default:
+		case CLAMP_MODE_REPEAT:
+			return coord & (size - 1);
+		case CLAMP_MODE_CLAMP:
+			return std::clamp<int32>(coord, 0, size - 1);
+		case CLAMP_MODE_REGION_CLAMP:
+			return std::clamp<int32>(coord, minCoord, std::max<int32>(minCoord, maxCoord));
+		case CLAMP_MODE_REGION_REPEAT:
+			return (coord & minCoord) | maxCoord;
+		}
+	};
+
+	int32 texelX = wrap(static_cast<int32>(std::floor(u)), clamp.nWMS, width, clamp.GetMinU(), clamp.GetMaxU());
+	int32 texelY = wrap(static_cast<int32>(std::floor(v)), clamp.nWMT, height, clamp.GetMinV(), clamp.GetMaxV());
+
+	return FetchTexel(state, texelX, texelY);
+}
+
+uint32 CGSH_Software::FetchTexel(const DRAWSTATE& state, int32 x, int32 y) const
+{
+	auto tex0 = make_convertible<TEX0>(state.tex0Reg);
+	auto texA = make_convertible<TEXA>(state.texaReg);
+
+	uint32 bufPtr = tex0.GetBufPtr();
+	uint32 bufWidth = tex0.nBufWidth;
+	uint32 texelX = static_cast<uint32>(x) % 2048;
+	uint32 texelY = static_cast<uint32>(y) % 2048;
+
+	switch(tex0.nPsm)
+	{
+	case PSMCT32:
+		return CGsPixelFormats::CPixelIndexorPSMCT32(m_pRAM, bufPtr, bufWidth).GetPixel(texelX, texelY);
+	case PSMCT24:
+		return ExpandAlpha24(CGsPixelFormats::CPixelIndexorPSMCT32(m_pRAM, bufPtr, bufWidth).GetPixel(texelX, texelY), texA);
+	case PSMCT16:
+		return ExpandAlpha16(CGsPixelFormats::CPixelIndexorPSMCT16(m_pRAM, bufPtr, bufWidth).GetPixel(texelX, texelY), texA);
+	case PSMCT16S:
+		return ExpandAlpha16(CGsPixelFormats::CPixelIndexorPSMCT16S(m_pRAM, bufPtr, bufWidth).GetPixel(texelX, texelY), texA);
+	case PSMT8:
+		return state.clut[CGsPixelFormats::CPixelIndexorPSMT8(m_pRAM, bufPtr, bufWidth).GetPixel(texelX, texelY)];
+	case PSMT4:
+		return state.clut[CGsPixelFormats::CPixelIndexorPSMT4(m_pRAM, bufPtr, bufWidth).GetPixel(texelX, texelY)];
+	case PSMT8H:
+		return state.clut[CGsPixelFormats::CPixelIndexorPSMCT32(m_pRAM, bufPtr, bufWidth).GetPixel(texelX, texelY) >> 24];
+	case PSMT4HL:
+		return state.clut[(CGsPixelFormats::CPixelIndexorPSMCT32(m_pRAM, bufPtr, bufWidth).GetPixel(texelX, texelY) >> 24) & 0x0F];
+	case PSMT4HH:
+		return state.clut[CGsPixelFormats::CPixelIndexorPSMCT32(m_pRAM, bufPtr, bufWidth).GetPixel(texelX, texelY) >> 28];
+	case PSMZ32:
+		return CGsPixelFormats::CPixelIndexorPSMZ32(m_pRAM, bufPtr, bufWidth).GetPixel(texelX, texelY);
+	case PSMZ24:
+		return ExpandAlpha24(CGsPixelFormats::CPixelIndexorPSMZ32(m_pRAM, bufPtr, bufWidth).GetPixel(texelX, texelY), texA);
+	case PSMZ16S:
+		return ExpandAlpha16(CGsPixelFormats::CPixelIndexorPSMZ16S(m_pRAM, bufPtr, bufWidth).GetPixel(texelX, texelY), texA);
+	default:
+		return 0;
+	}
+}
+
+void CGSH_Software::DrawPixel(const DRAWSTATE& state, int32 x, int32 y, uint32 z, uint32 color)
+{
+	auto prmode = make_convertible<PRMODE>(state.primReg);
+	auto frame = make_convertible<FRAME>(state.frameReg);
+	auto zbuf = make_convertible<ZBUF>(state.zbufReg);
+	auto test = make_convertible<TEST>(state.testReg);
+
+	bool writeFb = true;
+	bool writeZb = (zbuf.nMask == 0);
+	bool writeAlpha = true;
+	uint32 srcAlpha = color >> 24;
+
+	if(test.nAlphaEnabled)
+	{
+		bool alphaPassed = false;
+		switch(test.nAlphaMethod)
+		{
+		case ALPHA_TEST_NEVER:
+			alphaPassed = false;
+			break;
+		case ALPHA_TEST_ALWAYS:
+			alphaPassed = true;
+			break;
+		case ALPHA_TEST_LESS:
+			alphaPassed = srcAlpha < test.nAlphaRef;
+			break;
+		case ALPHA_TEST_LEQUAL:
+			alphaPassed = srcAlpha <= test.nAlphaRef;
+			break;
+		case ALPHA_TEST_EQUAL:
+			alphaPassed = srcAlpha == test.nAlphaRef;
+			break;
+		case ALPHA_TEST_GEQUAL:
+			alphaPassed = srcAlpha >= test.nAlphaRef;
+			break;
+		case ALPHA_TEST_GREATER:
+			alphaPassed = srcAlpha > test.nAlphaRef;
+			break;
+		case ALPHA_TEST_NOTEQUAL:
+			alphaPassed = srcAlpha != test.nAlphaRef;
+			break;
+		}
+		if(!alphaPassed)
+		{
+			switch(test.nAlphaFail)
+			{
+			case ALPHA_TEST_FAIL_KEEP:
+				return;
+			case ALPHA_TEST_FAIL_FBONLY:
+				writeZb = false;
+				break;
+			case ALPHA_TEST_FAIL_ZBONLY:
+				writeFb = false;
+				break;
+			case ALPHA_TEST_FAIL_RGBONLY:
+				writeZb = false;
+				writeAlpha = false;
+				break;
+			}
+		}
+	}
+
+	uint32 zbufPsm = zbuf.nPsm | 0x30;
+	uint32 zbufPtr = zbuf.GetBasePtr();
+	void* zAddress = nullptr;
+	switch(zbufPsm)
+	{
+	case PSMZ32:
+	case PSMZ24:
+		zAddress = CGsPixelFormats::CPixelIndexorPSMZ32(m_pRAM, zbufPtr, frame.nWidth).GetPixelAddress(x, y);
+		z = (zbufPsm == PSMZ24) ? std::min<uint32>(z, 0xFFFFFF) : z;
+		break;
+	case PSMZ16:
+		zAddress = CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMZ16>(m_pRAM, zbufPtr, frame.nWidth).GetPixelAddress(x, y);
+		z = std::min<uint32>(z, 0xFFFF);
+		break;
+	case PSMZ16S:
+		zAddress = CGsPixelFormats::CPixelIndexorPSMZ16S(m_pRAM, zbufPtr, frame.nWidth).GetPixelAddress(x, y);
+		z = std::min<uint32>(z, 0xFFFF);
+		break;
+	default:
+		writeZb = false;
+		break;
+	}
+
+	if(test.nDepthEnabled && zAddress)
+	{
+		uint32 dstZ = 0;
+		switch(zbufPsm)
+		{
+		case PSMZ32:
+			dstZ = *reinterpret_cast<uint32*>(zAddress);
+			break;
+		case PSMZ24:
+			dstZ = *reinterpret_cast<uint32*>(zAddress) & 0xFFFFFF;
+			break;
+		default:
+			dstZ = *reinterpret_cast<uint16*>(zAddress);
+			break;
+		}
+		switch(test.nDepthMethod)
+		{
+		case DEPTH_TEST_NEVER:
+			return;
+		case DEPTH_TEST_ALWAYS:
+			break;
+		case DEPTH_TEST_GEQUAL:
+			if(z < dstZ) return;
+			break;
+		case DEPTH_TEST_GREATER:
+			if(z <= dstZ) return;
+			break;
+		}
+	}
+	else
+	{
+		//ZTE = 0 isn't supposed to be used, act as if there was no depth buffer
+		writeZb = false;
+	}
+
+	uint32 fbPtr = frame.GetBasePtr();
+	uint32* fbAddress32 = nullptr;
+	uint16* fbAddress16 = nullptr;
+	uint32 dstColor = 0;
+	bool is24Bits = false;
+	switch(frame.nPsm)
+	{
+	case PSMCT32:
+	case PSMCT24:
+		fbAddress32 = CGsPixelFormats::CPixelIndexorPSMCT32(m_pRAM, fbPtr, frame.nWidth).GetPixelAddress(x, y);
+		is24Bits = (frame.nPsm == PSMCT24);
+		break;
+	case PSMZ32:
+	case PSMZ24:
+		fbAddress32 = CGsPixelFormats::CPixelIndexorPSMZ32(m_pRAM, fbPtr, frame.nWidth).GetPixelAddress(x, y);
+		is24Bits = (frame.nPsm == PSMZ24);
+		break;
+	case PSMCT16:
+		fbAddress16 = CGsPixelFormats::CPixelIndexorPSMCT16(m_pRAM, fbPtr, frame.nWidth).GetPixelAddress(x, y);
+		break;
+	case PSMCT16S:
+		fbAddress16 = CGsPixelFormats::CPixelIndexorPSMCT16S(m_pRAM, fbPtr, frame.nWidth).GetPixelAddress(x, y);
+		break;
+	case PSMZ16:
+		fbAddress16 = CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMZ16>(m_pRAM, fbPtr, frame.nWidth).GetPixelAddress(x, y);
+		break;
+	case PSMZ16S:
+		fbAddress16 = CGsPixelFormats::CPixelIndexorPSMZ16S(m_pRAM, fbPtr, frame.nWidth).GetPixelAddress(x, y);
+		break;
+	default:
+		//Unsupported framebuffer format
+		return;
+	}
+
+	if(fbAddress32)
+	{
+		dstColor = is24Bits ? ((*fbAddress32 & 0x00FFFFFF) | 0x80000000) : *fbAddress32;
+	}
+	else
+	{
+		dstColor = Color16To32(*fbAddress16);
+	}
+
+	if(test.nDestAlphaEnabled && !is24Bits)
+	{
+		uint32 dstAlphaBit = (dstColor >> 31) & 1;
+		if(dstAlphaBit != test.nDestAlphaMode) return;
+	}
+
+	uint32 result = color;
+	if(prmode.nAlpha && (!(state.pabeReg & 1) || (srcAlpha & 0x80)))
+	{
+		auto alpha = make_convertible<ALPHA>(state.alphaReg);
+		uint32 dstAlpha = dstColor >> 24;
+		int32 blendFactor = (alpha.nC == ALPHABLEND_C_AS) ? srcAlpha : ((alpha.nC == ALPHABLEND_C_AD) ? dstAlpha : alpha.nFix);
+		bool colClamp = (state.colClampReg & 1) != 0;
+		result = color & 0xFF000000;
+		for(uint32 i = 0; i < 3; i++)
+		{
+			int32 values[3] =
+			    {
+			        static_cast<int32>((color >> (i * 8)) & 0xFF),
+			        static_cast<int32>((dstColor >> (i * 8)) & 0xFF),
+			        0,
+			    };
+			int32 a = values[std::min<uint32>(alpha.nA, 2)];
+			int32 b = values[std::min<uint32>(alpha.nB, 2)];
+			int32 d = values[std::min<uint32>(alpha.nD, 2)];
+			int32 value = (((a - b) * blendFactor) >> 7) + d;
+			value = colClamp ? std::clamp<int32>(value, 0, 0xFF) : (value & 0xFF);
+			result |= static_cast<uint32>(value) << (i * 8);
+		}
+	}
+
+	if(state.fbaReg & 1)
+	{
+		result |= 0x80000000;
+	}
+
+	if(writeFb)
+	{
+		uint32 mask = frame.nMask;
+		if(!writeAlpha || is24Bits) mask |= 0xFF000000;
+		if(fbAddress32)
+		{
+			*fbAddress32 = (result & ~mask) | (*fbAddress32 & mask);
+		}
+		else
+		{
+			uint16 mask16 = Color32To16(mask);
+			*fbAddress16 = (Color32To16(result) & ~mask16) | (*fbAddress16 & mask16);
+		}
+	}
+
+	if(writeZb)
+	{
+		switch(zbufPsm)
+		{
+		case PSMZ32:
+			*reinterpret_cast<uint32*>(zAddress) = z;
+			break;
+		case PSMZ24:
+		{
+			auto zPixel = reinterpret_cast<uint32*>(zAddress);
+			*zPixel = (*zPixel & 0xFF000000) | z;
+		}
+		break;
+		default:
+			*reinterpret_cast<uint16*>(zAddress) = static_cast<uint16>(z);
+			break;
+		}
+	}
+}
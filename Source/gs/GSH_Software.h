@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "GSHandler.h"
+
+class CGSH_Software : public CGSHandler
+{
+public:
+	CGSH_Software(bool = true, bool = true);
+	virtual ~CGSH_Software();
+
+	void ProcessHostToLocalTransfer() override;
+	void ProcessLocalToHostTransfer() override;
+	void ProcessLocalToLocalTransfer() override;
+	void ProcessClutTransfer(uint32, uint32) override;
+
+	Framework::CBitmap GetScreenshot() override;
+
+	static FactoryFunction GetFactoryFunction();
+
+private:
+	enum
+	{
+		TILE_WIDTH = 64,
+		TILE_HEIGHT = 64,
+		TILE_COUNT_X = 2048 / TILE_WIDTH,
+		TILE_COUNT_Y = 2048 / TILE_HEIGHT,
+		TILE_COUNT = TILE_COUNT_X * TILE_COUNT_Y,
+	};
+
+	enum
+	{
+		MAX_WORKER_COUNT = 8,
+		MAX_BATCH_PRIMITIVES = 0x10000,
+	};
+
+	struct DRAWSTATE
+	{
+		uint64 primReg;
+		uint64 frameReg;
+		uint64 zbufReg;
+		uint64 testReg;
+		uint64 alphaReg;
+		uint64 tex0Reg;
+		uint64 clampReg;
+		uint64 texaReg;
+		uint64 fogColReg;
+		uint64 scissorReg;
+		uint64 colClampReg;
+		uint64 pabeReg;
+		uint64 fbaReg;
+		std::array<uint32, 256> clut;
+		bool useFastSpan;
+	};
+
+	struct RASTER_VERTEX
+	{
+		float x;
+		float y;
+		double z;
+		float r;
+		float g;
+		float b;
+		float a;
+		float s;
+		float t;
+		float q;
+		float fog;
+	};
+
+	struct PRIMITIVE
+	{
+		uint32 type;
+		uint32 stateIndex;
+		int32 minX;
+		int32 minY;
+		int32 maxX;
+		int32 maxY;
+		RASTER_VERTEX vertices[3];
+	};
+
+	struct TILE_RECT
+	{
+		int32 minX;
+		int32 minY;
+		int32 maxX;
+		int32 maxY;
+	};
+
+	typedef std::pair<uint32, uint32> MemoryRange;
+
+	struct WRITE_AREA
+	{
+		MemoryRange range;
+		uint32 bufWidth;
+		uint32 psm;
+	};
+
+	void InitializeImpl() override;
+	void ReleaseImpl() override;
+	void ResetImpl() override;
+	void FlipImpl(const DISPLAY_INFO&) override;
+	void WriteRegisterImpl(uint8, uint64) override;
+	void BeginTransferWrite() override;
+	void SyncCLUT(const TEX0&) override;
+	void SyncMemoryCache() override;
+
+	void VertexKick(uint8, uint64);
+	void SetPrimitiveType(uint32);
+	RASTER_VERTEX MakeRasterVertex(const VERTEX&, const PRMODE&) const;
+	uint32 GetCurrentDrawState(const PRMODE&);
+	void AddPrimitive(uint32, const VERTEX*, uint32);
+
+	static MemoryRange GetBufferRange(uint32, uint32, uint32, uint32);
+	static bool RangesIntersect(const MemoryRange&, const MemoryRange&);
+	bool AddBatchWriteArea(const MemoryRange&, uint32, uint32);
+
+	void StartWorkers();
+	void StopWorkers();
+	void DiscardBatch();
+	void FlushBatch();
+	void WorkerThreadProc();
+	void ProcessTiles();
+	void ProcessTile(uint32);
+
+	void RasterizePoint(const PRIMITIVE&, const TILE_RECT&);
+	void RasterizeLine(const PRIMITIVE&, const TILE_RECT&);
+	void RasterizeTriangle(const PRIMITIVE&, const TILE_RECT&);
+	void RasterizeSprite(const PRIMITIVE&, const TILE_RECT&);
+
+	static bool CanUseFastSpan(const DRAWSTATE&);
+	void DrawFastSpan32(const DRAWSTATE&, int32, int32, int32, const float*, const float*);
+
+	uint32 ShadeFragment(const DRAWSTATE&, const RASTER_VERTEX&) const;
+	uint32 SampleTexture(const DRAWSTATE&, const RASTER_VERTEX&) const;
+	uint32 FetchTexel(const DRAWSTATE&, int32, int32) const;
+	void DrawPixel(const DRAWSTATE&, int32, int32, uint32, uint32);
+
+	template <typename Indexor>
+	void CopyLocalToLocal(const BITBLTBUF&, const TRXPOS&, const TRXREG&);
+
+	uint32 m_primitiveType = PRIM_INVALID;
+	uint32 m_vtxCount = 0;
+	VERTEX m_vtxBuffer[3];
+
+	std::vector<DRAWSTATE> m_drawStates;
+	std::vector<PRIMITIVE> m_primitives;
+	std::vector<uint32> m_tileBins[TILE_COUNT];
+	std::vector<uint32> m_activeTiles;
+	std::vector<WRITE_AREA> m_batchWriteAreas;
+	bool m_batchSerial = false;
+	bool m_clutDirty = true;
+
+	bool m_rasterThreaded = true;
+	std::vector<std::thread> m_workers;
+	std::mutex m_workerMutex;
+	std::condition_variable m_workerStartCondition;
+	std::condition_variable m_workerDoneCondition;
+	uint32 m_workerGeneration = 0;
+	uint32 m_workersPending = 0;
+	bool m_workersExit = false;
+	std::atomic<uint32> m_nextTileIndex = 0;
+};
@@ -9,6 +9,7 @@
 #include "../ee/INTC.h"
 #include "GSHandler.h"
 #include "GsPixelFormats.h"
+#include "GsTransfer_Kernels.h"
 #include "string_format.h"
 #include "ThreadUtils.h"
 
@@ -60,7 +61,9 @@
 #define LOG_NAME ("gs")
 
 CGSHandler::CGSHandler(bool gsThreaded)
-    : m_gsThreaded(gsThreaded)
+    : m_imageStaging(MAX_INFLIGHT_FRAMES)
+    , m_gsThreaded(gsThreaded)
+    , m_commandRing(COMMANDRING_SIZE)
 {
 	RegisterPreferences();
 
@@ -179,6 +182,7 @@ void CGSHandler::ResetBase()
 	m_writeBufferSubmitIndex = 0;
 	m_writeBufferIndex = 0;
 	m_currentWriteBuffer = m_writeBuffers[m_writeBufferIndex];
+	m_imageStaging.Reset();
 }
 
 void CGSHandler::ResetImpl()
@@ -254,11 +258,14 @@ CGSHandler::PRESENTATION_VIEWPORT CGSHandler::GetPresentationViewport() const
 	return viewport;
 }
 
-void CGSHandler::SaveState(Framework::CZipArchiveWriter& archive)
+void CGSHandler::SaveState(Framework::CZipArchiveWriter& archive, bool includeRam)
 {
 	SendGSCall([&]() { SyncMemoryCache(); }, true);
 
-	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_RAM, GetRam(), RAMSIZE));
+	if(includeRam)
+	{
+		archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_RAM, GetRam(), RAMSIZE));
+	}
 	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_REGS, m_nReg, sizeof(uint64) * CGSHandler::REGISTER_MAX));
 	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_TRXCTX, &m_trxCtx, sizeof(TRXCONTEXT)));
 
@@ -283,9 +290,12 @@ void CGSHandler::SaveState(Framework::CZipArchiveWriter& archive)
 	}
 }
 
-void CGSHandler::LoadState(Framework::CZipArchiveReader& archive)
+void CGSHandler::LoadState(Framework::CZipArchiveReader& archive, bool includeRam)
 {
-	archive.BeginReadFile(STATE_RAM)->Read(GetRam(), RAMSIZE);
+	if(includeRam)
+	{
+		archive.BeginReadFile(STATE_RAM)->Read(GetRam(), RAMSIZE);
+	}
 	archive.BeginReadFile(STATE_REGS)->Read(m_nReg, sizeof(uint64) * CGSHandler::REGISTER_MAX);
 	archive.BeginReadFile(STATE_TRXCTX)->Read(&m_trxCtx, sizeof(TRXCONTEXT));
 
@@ -309,6 +319,66 @@ void CGSHandler::LoadState(Framework::CZipArchiveReader& archive)
 	SendGSCall([&]() { WriteBackMemoryCache(); });
 }
 
+size_t CGSHandler::GetRawStateSize(bool includeRam) const
+{
+	return (includeRam ? RAMSIZE : 0) + sizeof(m_nReg) + sizeof(m_trxCtx) +
+	       sizeof(m_nPMODE) + sizeof(m_nSMODE2) + sizeof(m_nDISPFB1.value.q) + sizeof(m_nDISPLAY1.value.q) +
+	       sizeof(m_nDISPFB2.value.q) + sizeof(m_nDISPLAY2.value.q) + sizeof(m_nCSR) + sizeof(m_nIMR) +
+	       sizeof(m_nBUSDIR) + sizeof(m_nSIGLBLID) + sizeof(m_crtMode) + sizeof(m_nCBP0) + sizeof(m_nCBP1);
+}
+
+void CGSHandler::SaveRawState(CRawStateWriter& writer, bool includeRam)
+{
+	SendGSCall([&]() { SyncMemoryCache(); }, true);
+
+	if(includeRam)
+	{
+		writer.Write(GetRam(), RAMSIZE);
+	}
+	writer.Write(m_nReg);
+	writer.Write(m_trxCtx);
+
+	writer.Write(m_nPMODE);
+	writer.Write(m_nSMODE2);
+	writer.Write(m_nDISPFB1.value.q);
+	writer.Write(m_nDISPLAY1.value.q);
+	writer.Write(m_nDISPFB2.value.q);
+	writer.Write(m_nDISPLAY2.value.q);
+	writer.Write(m_nCSR);
+	writer.Write(m_nIMR);
+	writer.Write(m_nBUSDIR);
+	writer.Write(m_nSIGLBLID);
+	writer.Write(m_crtMode);
+	writer.Write(m_nCBP0);
+	writer.Write(m_nCBP1);
+}
+
+void CGSHandler::LoadRawState(CRawStateReader& reader, bool includeRam)
+{
+	if(includeRam)
+	{
+		reader.Read(GetRam(), RAMSIZE);
+	}
+	reader.Read(m_nReg);
+	reader.Read(m_trxCtx);
+
+	reader.Read(m_nPMODE);
+	reader.Read(m_nSMODE2);
+	reader.Read(m_nDISPFB1.value.q);
+	reader.Read(m_nDISPLAY1.value.q);
+	reader.Read(m_nDISPFB2.value.q);
+	reader.Read(m_nDISPLAY2.value.q);
+	reader.Read(m_nCSR);
+	reader.Read(m_nIMR);
+	reader.Read(m_nBUSDIR);
+	reader.Read(m_nSIGLBLID);
+	reader.Read(m_crtMode);
+	reader.Read(m_nCBP0);
+	reader.Read(m_nCBP1);
+
+	SendGSCall([&]() { WriteBackMemoryCache(); });
+}
+
 void CGSHandler::Copy(CGSHandler* source)
 {
 	source->SendGSCall([source]() { source->SyncMemoryCache(); }, true);
@@ -339,7 +409,7 @@ void CGSHandler::Copy(CGSHandler* source)
 void CGSHandler::TriggerFrameDump(const FrameDumpCallback& frameDumpCallback)
 {
 #ifdef DEBUGGER_INCLUDED
-	m_mailBox.SendCall(
+	SendGSCall(
 	    [=]() {
 		    if(m_frameDumpCallback) return;
 		    m_frameDumpCallback = frameDumpCallback;
@@ -561,19 +631,23 @@ void CGSHandler::Finish(bool forceWait)
 	    wait, wait);
 }
 
+void CGSHandler::SyncRam()
+{
+	SendGSCall([this]() { SyncMemoryCache(); }, true);
+}
+
 void CGSHandler::Flip(uint32 flags)
 {
 	bool waitForCompletion = (flags & FLIP_FLAG_WAIT) != 0;
 	bool force = (flags & FLIP_FLAG_FORCE) != 0;
-	SendGSCall(
-	    [this, displayInfo = GetCurrentDisplayInfo(), force]() {
-		    if(force || m_regsDirty)
-		    {
-			    FlipImpl(displayInfo);
-		    }
-		    m_regsDirty = false;
+	auto displayInfo = GetCurrentDisplayInfo();
+	PushCommand(
+	    [&](GS_COMMAND& command) {
+		    command.type = GS_COMMAND_FLIP;
+		    command.flipDisplayInfo = displayInfo;
+		    command.flipForce = force;
 	    },
-	    waitForCompletion, waitForCompletion);
+	    waitForCompletion);
 }
 
 void CGSHandler::FlipImpl(const DISPLAY_INFO&)
@@ -626,24 +700,20 @@ void CGSHandler::FeedImageData(const void* data, uint32 length)
 	m_transferCount++;
 #endif
 
-	//Allocate 0x10 more bytes to allow transfer handlers
+	//Staging leaves some room to allow transfer handlers
 	//to read beyond the actual length of the buffer (ie.: PSMCT24)
 
-	uint8* imageData = new uint8[length + 0x10];
+	uint8* imageData = m_imageStaging.Allocate(length);
 	memcpy(imageData, data, length);
-	memset(imageData + length, 0, 0x10);
+	memset(imageData + length, 0, CGsImageStaging::ALLOCATION_PADDING);
 
-	SendGSCall(
-	    [this, imageData, length]() {
-#ifdef DEBUGGER_INCLUDED
-		    if(m_frameDump)
-		    {
-			    m_frameDump->AddImagePacket(imageData, length);
-		    }
-#endif
-		    FeedImageDataImpl(imageData, length);
-		    delete[] imageData;
-	    });
+	PushCommand(
+	    [&](GS_COMMAND& command) {
+		    command.type = GS_COMMAND_IMAGEDATA;
+		    command.imageData = imageData;
+		    command.imageLength = length;
+	    },
+	    false);
 }
 
 void CGSHandler::ReadImageData(void* data, uint32 length)
@@ -724,10 +794,13 @@ void CGSHandler::SubmitWriteBuffer()
 	auto bufferStart = m_currentWriteBuffer + m_writeBufferSubmitIndex;
 	auto bufferEnd = m_currentWriteBuffer + m_writeBufferSize;
 
-	SendGSCall(
-	    [this, bufferStart, bufferEnd]() {
-		    SubmitWriteBufferImpl(bufferStart, bufferEnd);
-	    });
+	PushCommand(
+	    [&](GS_COMMAND& command) {
+		    command.type = GS_COMMAND_WRITEBUFFER;
+		    command.writeStart = bufferStart;
+		    command.writeEnd = bufferEnd;
+	    },
+	    false);
 
 	m_writeBufferSubmitIndex = m_writeBufferSize;
 }
@@ -744,6 +817,8 @@ void CGSHandler::FlushWriteBuffer()
 	m_writeBufferIndex++;
 	m_writeBufferIndex %= MAX_INFLIGHT_FRAMES;
 	m_currentWriteBuffer = m_writeBuffers[m_writeBufferIndex];
+	//Image packets for the frame we're going back to have been consumed, same as the write buffer
+	m_imageStaging.NextFrame();
 	//Nothing should be written to the buffer after that
 }
 
@@ -962,6 +1037,75 @@ void CGSHandler::TransferWrite(const uint8* imageData, uint32 length)
 	m_trxCtx.nDirty |= ((this)->*(m_transferWriteHandlers[bltBuf.nDstPsm]))(imageData, length);
 }
 
+//Transfers rows that are made of complete columns with the column kernels, starting at the beginning of a row.
+//Pixels past the last complete column of a row are handled one by one. Returns the amount of rows transferred.
+template <typename Storage, typename ColumnFunction, typename PixelFunction>
+static uint32 TransferColumnRows(CGsPixelFormats::CPixelIndexor<Storage>& indexor, uint32 x, uint32 y, uint32 width, uint32 rowCount,
+                                 const ColumnFunction& columnFunction, const PixelFunction& pixelFunction)
+{
+	if((x % Storage::COLUMNWIDTH) != 0) return 0;
+	if((y % Storage::COLUMNHEIGHT) != 0) return 0;
+
+	//Stop before wrapping around, pixels after that are not contiguous anymore
+	uint32 columnCount = std::min<uint32>(width, 2048 - x) / Storage::COLUMNWIDTH;
+	uint32 columnRowCount = std::min<uint32>(rowCount, 2048 - y) / Storage::COLUMNHEIGHT;
+	if(columnCount == 0) return 0;
+
+	for(uint32 columnRow = 0; columnRow < columnRowCount; columnRow++)
+	{
+		uint32 rowIndex = columnRow * Storage::COLUMNHEIGHT;
+		uint32 rowY = y + rowIndex;
+		for(uint32 column = 0; column < columnCount; column++)
+		{
+			unsigned int columnX = x + (column * Storage::COLUMNWIDTH);
+			unsigned int columnY = rowY;
+			uint32 columnAddress = indexor.GetColumnAddress(columnX, columnY);
+			columnFunction(columnAddress, (rowIndex * width) + (column * Storage::COLUMNWIDTH), rowY / Storage::COLUMNHEIGHT);
+		}
+		for(uint32 row = 0; row < Storage::COLUMNHEIGHT; row++)
+		{
+			for(uint32 pixelX = columnCount * Storage::COLUMNWIDTH; pixelX < width; pixelX++)
+			{
+				pixelFunction((x + pixelX) % 2048, rowY + row, ((rowIndex + row) * width) + pixelX);
+			}
+		}
+	}
+
+	return columnRowCount * Storage::COLUMNHEIGHT;
+}
+
+//Formats with the same pixel size share the same column layout (PSMT4 has its own handler)
+template <typename Storage>
+static bool WriteColumn(uint8* column, const uint8* src, uint32 srcPitch, uint32 columnNum)
+{
+	switch(sizeof(typename Storage::Unit))
+	{
+	case 4:
+		return GsTransfer::Kernels::WriteColumn32(column, src, srcPitch);
+	case 2:
+		return GsTransfer::Kernels::WriteColumn16(column, src, srcPitch);
+	default:
+		return GsTransfer::Kernels::WriteColumn8(column, src, srcPitch, columnNum);
+	}
+}
+
+template <typename Storage>
+static void ReadColumn(const uint8* column, uint8* dst, uint32 dstPitch, uint32 columnNum)
+{
+	switch(sizeof(typename Storage::Unit))
+	{
+	case 4:
+		GsTransfer::Kernels::ReadColumn32(column, dst, dstPitch);
+		break;
+	case 2:
+		GsTransfer::Kernels::ReadColumn16(column, dst, dstPitch);
+		break;
+	default:
+		GsTransfer::Kernels::ReadColumn8(column, dst, dstPitch, columnNum);
+		break;
+	}
+}
+
 bool CGSHandler::TransferWriteHandlerInvalid(const void* pData, uint32 nLength)
 {
 	assert(0);
@@ -982,19 +1126,43 @@ bool CGSHandler::TransferWriteHandlerGeneric(const void* pData, uint32 nLength)
 
 	auto pSrc = reinterpret_cast<const typename Storage::Unit*>(pData);
 
-	for(unsigned int i = 0; i < nLength; i++)
+	unsigned int i = 0;
+
+	auto writePixel =
+	    [&](uint32 nX, uint32 nY, uint32 index) {
+		    auto pPixel = Indexor.GetPixelAddress(nX, nY);
+		    if((*pPixel) != pSrc[i + index])
+		    {
+			    (*pPixel) = pSrc[i + index];
+			    nDirty = true;
+		    }
+	    };
+
+	auto writeColumn =
+	    [&](uint32 address, uint32 index, uint32 columnNum) {
+		    auto src = reinterpret_cast<const uint8*>(pSrc + i + index);
+		    nDirty |= WriteColumn<Storage>(m_pRAM + address, src, trxReg.nRRW * sizeof(typename Storage::Unit), columnNum);
+	    };
+
+	while(i < nLength)
 	{
 		uint32 nX = (m_trxCtx.nRRX + trxPos.nDSAX) % 2048;
 		uint32 nY = (m_trxCtx.nRRY + trxPos.nDSAY) % 2048;
 
-		auto pPixel = Indexor.GetPixelAddress(nX, nY);
-
-		if((*pPixel) != pSrc[i])
+		if((m_trxCtx.nRRX == 0) && (trxReg.nRRW != 0))
 		{
-			(*pPixel) = pSrc[i];
-			nDirty = true;
+			uint32 rowCount = TransferColumnRows(Indexor, nX, nY, trxReg.nRRW, (nLength - i) / trxReg.nRRW, writeColumn, writePixel);
+			if(rowCount != 0)
+			{
+				m_trxCtx.nRRY += rowCount;
+				i += rowCount * trxReg.nRRW;
+				continue;
+			}
 		}
 
+		writePixel(nX, nY, 0);
+		i++;
+
 		m_trxCtx.nRRX++;
 		if(m_trxCtx.nRRX == trxReg.nRRW)
 		{
@@ -1016,15 +1184,41 @@ bool CGSHandler::TransferWriteHandlerPSMCT24(const void* pData, uint32 nLength)
 
 	auto pSrc = reinterpret_cast<const uint8*>(pData);
 
-	for(unsigned int i = 0; i < nLength; i += 3)
+	//Last pixel might be incomplete
+	uint32 nPixelCount = (nLength + 2) / 3;
+	unsigned int i = 0;
+
+	auto writePixel =
+	    [&](uint32 nX, uint32 nY, uint32 index) {
+		    uint32* pDstPixel = Indexor.GetPixelAddress(nX, nY);
+		    uint32 nSrcPixel = *reinterpret_cast<const uint32*>(&pSrc[(i + index) * 3]) & 0x00FFFFFF;
+		    (*pDstPixel) &= 0xFF000000;
+		    (*pDstPixel) |= nSrcPixel;
+	    };
+
+	auto writeColumn =
+	    [&](uint32 address, uint32 index, uint32) {
+		    GsTransfer::Kernels::WriteColumn24(m_pRAM + address, pSrc + ((i + index) * 3), trxReg.nRRW * 3);
+	    };
+
+	while(i < nPixelCount)
 	{
 		uint32 nX = (m_trxCtx.nRRX + trxPos.nDSAX) % 2048;
 		uint32 nY = (m_trxCtx.nRRY + trxPos.nDSAY) % 2048;
 
-		uint32* pDstPixel = Indexor.GetPixelAddress(nX, nY);
-		uint32 nSrcPixel = *reinterpret_cast<const uint32*>(&pSrc[i]) & 0x00FFFFFF;
-		(*pDstPixel) &= 0xFF000000;
-		(*pDstPixel) |= nSrcPixel;
+		if((m_trxCtx.nRRX == 0) && (trxReg.nRRW != 0))
+		{
+			uint32 rowCount = TransferColumnRows(Indexor, nX, nY, trxReg.nRRW, ((nLength / 3) - i) / trxReg.nRRW, writeColumn, writePixel);
+			if(rowCount != 0)
+			{
+				m_trxCtx.nRRY += rowCount;
+				i += rowCount * trxReg.nRRW;
+				continue;
+			}
+		}
+
+		writePixel(nX, nY, 0);
+		i++;
 
 		m_trxCtx.nRRX++;
 		if(m_trxCtx.nRRX == trxReg.nRRW)
@@ -1048,32 +1242,52 @@ bool CGSHandler::TransferWriteHandlerPSMT4(const void* pData, uint32 nLength)
 
 	auto pSrc = reinterpret_cast<const uint8*>(pData);
 
-	for(unsigned int i = 0; i < nLength; i++)
-	{
-		uint8 nPixel[2];
+	uint32 pixelCount = nLength * 2;
+	unsigned int i = 0;
 
-		nPixel[0] = (pSrc[i] >> 0) & 0x0F;
-		nPixel[1] = (pSrc[i] >> 4) & 0x0F;
+	auto writePixel =
+	    [&](uint32 nX, uint32 nY, uint32 index) {
+		    uint32 pixelIndex = i + index;
+		    uint8 nPixel = (pSrc[pixelIndex / 2] >> ((pixelIndex & 1) * 4)) & 0x0F;
+		    uint8 currentPixel = Indexor.GetPixel(nX, nY);
+		    if(currentPixel != nPixel)
+		    {
+			    Indexor.SetPixel(nX, nY, nPixel);
+			    dirty = true;
+		    }
+	    };
 
-		for(unsigned int j = 0; j < 2; j++)
-		{
-			uint32 nX = (m_trxCtx.nRRX + trxPos.nDSAX) % 2048;
-			uint32 nY = (m_trxCtx.nRRY + trxPos.nDSAY) % 2048;
+	auto writeColumn =
+	    [&](uint32 address, uint32 index, uint32 columnNum) {
+		    dirty |= GsTransfer::Kernels::WriteColumn4(m_pRAM + address, pSrc + ((i + index) / 2), trxReg.nRRW / 2, columnNum);
+	    };
 
-			uint8 currentPixel = Indexor.GetPixel(nX, nY);
-			if(currentPixel != nPixel[j])
-			{
-				Indexor.SetPixel(nX, nY, nPixel[j]);
-				dirty = true;
-			}
+	while(i < pixelCount)
+	{
+		uint32 nX = (m_trxCtx.nRRX + trxPos.nDSAX) % 2048;
+		uint32 nY = (m_trxCtx.nRRY + trxPos.nDSAY) % 2048;
 
-			m_trxCtx.nRRX++;
-			if(m_trxCtx.nRRX == trxReg.nRRW)
+		//Rows need to start on a byte boundary
+		if((m_trxCtx.nRRX == 0) && (trxReg.nRRW != 0) && ((trxReg.nRRW & 1) == 0))
+		{
+			uint32 rowCount = TransferColumnRows(Indexor, nX, nY, trxReg.nRRW, (pixelCount - i) / trxReg.nRRW, writeColumn, writePixel);
+			if(rowCount != 0)
 			{
-				m_trxCtx.nRRX = 0;
-				m_trxCtx.nRRY++;
+				m_trxCtx.nRRY += rowCount;
+				i += rowCount * trxReg.nRRW;
+				continue;
 			}
 		}
+
+		writePixel(nX, nY, 0);
+		i++;
+
+		m_trxCtx.nRRX++;
+		if(m_trxCtx.nRRX == trxReg.nRRW)
+		{
+			m_trxCtx.nRRX = 0;
+			m_trxCtx.nRRY++;
+		}
 	}
 
 	return dirty;
@@ -1177,13 +1391,41 @@ void CGSHandler::TransferReadHandlerGeneric(void* buffer, uint32 length)
 	uint32 typedLength = length / sizeof(typename Storage::Unit);
 	auto typedBuffer = reinterpret_cast<typename Storage::Unit*>(buffer);
 
-	CGsPixelFormats::CPixelIndexor<Storage> indexor(GetRam(), trxBuf.GetSrcPtr(), trxBuf.nSrcWidth);
-	for(uint32 i = 0; i < typedLength; i++)
+	auto ram = GetRam();
+	CGsPixelFormats::CPixelIndexor<Storage> indexor(ram, trxBuf.GetSrcPtr(), trxBuf.nSrcWidth);
+
+	uint32 i = 0;
+
+	auto readPixel =
+	    [&](uint32 x, uint32 y, uint32 index) {
+		    typedBuffer[i + index] = indexor.GetPixel(x, y);
+	    };
+
+	auto readColumn =
+	    [&](uint32 address, uint32 index, uint32 columnNum) {
+		    auto dst = reinterpret_cast<uint8*>(typedBuffer + i + index);
+		    ReadColumn<Storage>(ram + address, dst, trxReg.nRRW * sizeof(typename Storage::Unit), columnNum);
+	    };
+
+	while(i < typedLength)
 	{
 		uint32 x = (m_trxCtx.nRRX + trxPos.nSSAX) % 2048;
 		uint32 y = (m_trxCtx.nRRY + trxPos.nSSAY) % 2048;
-		auto pixel = indexor.GetPixel(x, y);
-		typedBuffer[i] = pixel;
+
+		if((m_trxCtx.nRRX == 0) && (trxReg.nRRW != 0))
+		{
+			uint32 rowCount = TransferColumnRows(indexor, x, y, trxReg.nRRW, (typedLength - i) / trxReg.nRRW, readColumn, readPixel);
+			if(rowCount != 0)
+			{
+				m_trxCtx.nRRY += rowCount;
+				i += rowCount * trxReg.nRRW;
+				continue;
+			}
+		}
+
+		readPixel(x, y, 0);
+		i++;
+
 		m_trxCtx.nRRX++;
 		if(m_trxCtx.nRRX == trxReg.nRRW)
 		{
@@ -2173,46 +2415,141 @@ void CGSHandler::WriteToDelayedRegister(uint32 address, uint32 value, DELAYED_RE
 
 void CGSHandler::ThreadProc()
 {
+	m_consumerThreadId = std::this_thread::get_id();
 	while(!m_threadDone)
 	{
-		m_mailBox.WaitForCall();
-		while(m_mailBox.IsPending())
+		m_commandRing.WaitForCommand();
+		while(m_commandRing.IsPending())
+		{
+			ReceiveCommand();
+		}
+	}
+}
+
+template <typename WriteFunction>
+void CGSHandler::PushCommand(const WriteFunction& writeFunction, bool waitForCompletion)
+{
+	std::atomic<bool> completed = false;
+	auto writeCommand =
+	    [&](GS_COMMAND& command) {
+		    writeFunction(command);
+		    command.completion = waitForCompletion ? &completed : nullptr;
+	    };
+	if(std::this_thread::get_id() == m_consumerThreadId.load())
+	{
+		//Can't wait for ourselves and running commands from here could go past a flip
+		//in ProcessSingleFrame, the ring keeps the command aside if it's full.
+		assert(!waitForCompletion);
+		m_commandRing.PushFromConsumer(writeCommand);
+		return;
+	}
+	while(!m_commandRing.TryPush(writeCommand))
+	{
+		m_commandRing.WaitForSpace();
+	}
+	if(!waitForCompletion) return;
+	std::unique_lock<std::mutex> completionLock(m_completionMutex);
+	m_completionCondition.wait(completionLock, [&]() { return completed.load(); });
+}
+
+void CGSHandler::ReceiveCommand()
+{
+	GS_COMMAND command;
+	if(!m_commandRing.Pop(command)) return;
+	ExecuteCommand(command);
+	if(command.completion)
+	{
 		{
-			m_mailBox.ReceiveCall();
+			std::lock_guard<std::mutex> completionLock(m_completionMutex);
+			command.completion->store(true);
 		}
+		m_completionCondition.notify_all();
 	}
 }
 
-void CGSHandler::SendGSCall(const CMailBox::FunctionType& function, bool waitForCompletion, bool forceWaitForCompletion)
+void CGSHandler::ExecuteCommand(GS_COMMAND& command)
+{
+	switch(command.type)
+	{
+	case GS_COMMAND_CALL:
+		command.function();
+		break;
+	case GS_COMMAND_WRITEBUFFER:
+		SubmitWriteBufferImpl(command.writeStart, command.writeEnd);
+		break;
+	case GS_COMMAND_IMAGEDATA:
+#ifdef DEBUGGER_INCLUDED
+		if(m_frameDump)
+		{
+			m_frameDump->AddImagePacket(command.imageData, command.imageLength);
+		}
+#endif
+		FeedImageDataImpl(command.imageData, command.imageLength);
+		break;
+	case GS_COMMAND_FLIP:
+		if(command.flipForce || m_regsDirty)
+		{
+			FlipImpl(command.flipDisplayInfo);
+		}
+		m_regsDirty = false;
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+void CGSHandler::SendGSCall(const CallFunction& function, bool waitForCompletion, bool forceWaitForCompletion)
 {
 	if(!m_gsThreaded)
 	{
 		waitForCompletion = false;
 	}
 	waitForCompletion |= forceWaitForCompletion;
-	m_mailBox.SendCall(function, waitForCompletion);
+	PushCommand(
+	    [&](GS_COMMAND& command) {
+		    command.type = GS_COMMAND_CALL;
+		    command.function = function;
+	    },
+	    waitForCompletion);
 }
 
-void CGSHandler::SendGSCall(CMailBox::FunctionType&& function)
+void CGSHandler::SendGSCall(CallFunction&& function)
 {
-	m_mailBox.SendCall(std::move(function));
+	PushCommand(
+	    [&](GS_COMMAND& command) {
+		    command.type = GS_COMMAND_CALL;
+		    command.function = std::move(function);
+	    },
+	    false);
 }
 
 void CGSHandler::ProcessSingleFrame()
 {
 	assert(!m_gsThreaded);
 	assert(!m_flipped);
+	m_consumerThreadId = std::this_thread::get_id();
 	while(!m_flipped)
 	{
-		m_mailBox.WaitForCall();
-		while(m_mailBox.IsPending() && !m_flipped)
+		m_commandRing.WaitForCommand();
+		while(m_commandRing.IsPending() && !m_flipped)
 		{
-			m_mailBox.ReceiveCall();
+			ReceiveCommand();
 		}
 	}
 	m_flipped = false;
 }
 
+COMMANDRING_STATS CGSHandler::GetCommandRingStats() const
+{
+	return m_commandRing.GetStats();
+}
+
+CGsImageStaging::STATS CGSHandler::GetImageStagingStats() const
+{
+	return m_imageStaging.GetStats();
+}
+
 Framework::CBitmap CGSHandler::GetScreenshot()
 {
 	throw std::runtime_error("Screenshot feature is not implemented in current backend.");
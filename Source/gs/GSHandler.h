@@ -1,6 +1,8 @@
 #pragma once
 
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <vector>
 #include <functional>
 #include <atomic>
@@ -10,10 +12,12 @@
 #include "bitmap/Bitmap.h"
 #include "Types.h"
 #include "Convertible.h"
-#include "../MailBox.h"
+#include "../CommandRing.h"
+#include "GsImageStaging.h"
 #include "../Integer64.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 
 class CFrameDump;
 class CGsPacketMetadata;
@@ -812,6 +816,7 @@ public:
 	typedef std::pair<uint8, uint64> RegisterWrite;
 	typedef std::vector<RegisterWrite> RegisterWriteList;
 	typedef std::function<CGSHandler*()> FactoryFunction;
+	typedef std::function<void()> CallFunction;
 
 	typedef std::function<void(const CFrameDump&)> FrameDumpCallback;
 
@@ -829,8 +834,11 @@ public:
 	virtual void SetPresentationParams(const PRESENTATION_PARAMS&);
 	PRESENTATION_VIEWPORT GetPresentationViewport() const;
 
-	virtual void SaveState(Framework::CZipArchiveWriter&);
-	virtual void LoadState(Framework::CZipArchiveReader&);
+	virtual void SaveState(Framework::CZipArchiveWriter&, bool = true);
+	virtual void LoadState(Framework::CZipArchiveReader&, bool = true);
+	size_t GetRawStateSize(bool = true) const;
+	void SaveRawState(CRawStateWriter&, bool = true);
+	virtual void LoadRawState(CRawStateReader&, bool = true);
 	void Copy(CGSHandler*);
 
 	void TriggerFrameDump(const FrameDumpCallback&);
@@ -874,6 +882,10 @@ public:
 	void Flip(uint32 = 0);
 	void Finish(bool = false);
 
+	//Brings GS RAM returned by GetRam up to date with the backend's memory.
+	//When not threaded, this only happens on the next call to ProcessSingleFrame.
+	void SyncRam();
+
 	void MakeLinearCLUT(const TEX0&, std::array<uint32, 256>&) const;
 
 	virtual uint8* GetRam() const;
@@ -897,11 +909,14 @@ public:
 
 	virtual Framework::CBitmap GetScreenshot();
 
-	void SendGSCall(CMailBox::FunctionType&&);
-	void SendGSCall(const CMailBox::FunctionType&, bool = false, bool = false);
+	void SendGSCall(CallFunction&&);
+	void SendGSCall(const CallFunction&, bool = false, bool = false);
 
 	void ProcessSingleFrame();
 
+	COMMANDRING_STATS GetCommandRingStats() const;
+	CGsImageStaging::STATS GetImageStagingStats() const;
+
 	FlipCompleteEvent OnFlipComplete;
 	NewFrameEvent OnNewFrame;
 
@@ -1121,6 +1136,8 @@ protected:
 	uint32 m_writeBufferProcessIndex = 0;
 	uint32 m_writeBufferSubmitIndex = 0;
 
+	CGsImageStaging m_imageStaging;
+
 	CRT_MODE m_crtMode;
 	std::thread m_thread;
 	std::recursive_mutex m_registerMutex;
@@ -1138,5 +1155,43 @@ protected:
 	bool m_flipped = false;
 
 private:
-	CMailBox m_mailBox;
+	//Should hold a frame's worth of commands without stalling producers, check the peak
+	//occupancy reported by GetCommandRingStats (GsReplayBenchmark prints it) when changing this.
+	enum
+	{
+		COMMANDRING_SIZE = 0x1000,
+	};
+
+	enum GS_COMMAND_TYPE
+	{
+		GS_COMMAND_CALL,
+		GS_COMMAND_WRITEBUFFER,
+		GS_COMMAND_IMAGEDATA,
+		GS_COMMAND_FLIP,
+	};
+
+	//Common traffic is stored inline, anything else goes through a call.
+	//A producer waiting for completion points to a flag that's set once the command is done.
+	struct GS_COMMAND
+	{
+		GS_COMMAND_TYPE type = GS_COMMAND_CALL;
+		const RegisterWrite* writeStart = nullptr;
+		const RegisterWrite* writeEnd = nullptr;
+		uint8* imageData = nullptr;
+		uint32 imageLength = 0;
+		bool flipForce = false;
+		DISPLAY_INFO flipDisplayInfo;
+		CallFunction function;
+		std::atomic<bool>* completion = nullptr;
+	};
+
+	template <typename WriteFunction>
+	void PushCommand(const WriteFunction&, bool);
+	void ReceiveCommand();
+	void ExecuteCommand(GS_COMMAND&);
+
+	CCommandRing<GS_COMMAND> m_commandRing;
+	std::atomic<std::thread::id> m_consumerThreadId = std::thread::id();
+	std::mutex m_completionMutex;
+	std::condition_variable m_completionCondition;
 };
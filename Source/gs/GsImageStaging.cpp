@@ -0,0 +1,77 @@
+#include <cassert>
+#include <algorithm>
+#include "GsImageStaging.h"
+
+CGsImageStaging::CGsImageStaging(unsigned int frameCount)
+    : m_arenas(frameCount)
+{
+	assert(frameCount != 0);
+}
+
+void CGsImageStaging::Reset()
+{
+	for(auto& arena : m_arenas)
+	{
+		arena.chunkIndex = 0;
+		arena.chunkOffset = 0;
+		arena.transferBytes = 0;
+		arena.stagingBytes = 0;
+	}
+	m_arenaIndex = 0;
+}
+
+uint8* CGsImageStaging::Allocate(uint32 size)
+{
+	auto& arena = m_arenas[m_arenaIndex];
+	uint32 allocationSize = (size + ALLOCATION_PADDING + ALLOCATION_ALIGNMENT - 1) & ~(ALLOCATION_ALIGNMENT - 1);
+
+	//Move on to the next chunk that can hold this, chunks that were skipped stay unused until the next round
+	while(arena.chunkIndex < arena.chunks.size())
+	{
+		const auto& chunk = arena.chunks[arena.chunkIndex];
+		if((arena.chunkOffset + allocationSize) <= chunk.size) break;
+		arena.chunkIndex++;
+		arena.chunkOffset = 0;
+	}
+
+	if(arena.chunkIndex == arena.chunks.size())
+	{
+		CHUNK chunk;
+		chunk.size = std::max<uint32>(CHUNK_SIZE, allocationSize);
+		chunk.data = std::make_unique<uint8[]>(chunk.size);
+		m_stats.stagingCapacity += chunk.size;
+		arena.chunks.push_back(std::move(chunk));
+	}
+
+	auto& chunk = arena.chunks[arena.chunkIndex];
+	uint8* result = chunk.data.get() + arena.chunkOffset;
+	arena.chunkOffset += allocationSize;
+	arena.transferBytes += size;
+	arena.stagingBytes += allocationSize;
+	return result;
+}
+
+void CGsImageStaging::NextFrame()
+{
+	{
+		const auto& arena = m_arenas[m_arenaIndex];
+		m_stats.lastFrameTransferBytes = arena.transferBytes;
+		m_stats.lastFrameStagingBytes = arena.stagingBytes;
+		m_stats.stagingHighWaterMark = std::max(m_stats.stagingHighWaterMark, arena.stagingBytes);
+	}
+
+	m_arenaIndex++;
+	m_arenaIndex %= m_arenas.size();
+
+	//Everything that was carved from this arena has been consumed by now
+	auto& arena = m_arenas[m_arenaIndex];
+	arena.chunkIndex = 0;
+	arena.chunkOffset = 0;
+	arena.transferBytes = 0;
+	arena.stagingBytes = 0;
+}
+
+CGsImageStaging::STATS CGsImageStaging::GetStats() const
+{
+	return m_stats;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Types.h"
+
+//Holds image packets sent to the GS thread. Each in-flight frame has its own arena, packets
+//are carved from it and released all at once when the arena comes back around.
+//Only used by the thread feeding the GS.
+class CGsImageStaging
+{
+public:
+	struct STATS
+	{
+		uint32 lastFrameTransferBytes = 0;
+		uint32 lastFrameStagingBytes = 0;
+		uint32 stagingHighWaterMark = 0;
+		uint32 stagingCapacity = 0;
+	};
+
+	CGsImageStaging(unsigned int);
+	CGsImageStaging(const CGsImageStaging&) = delete;
+
+	CGsImageStaging& operator=(const CGsImageStaging&) = delete;
+
+	void Reset();
+
+	//Returned block has room for the requested size plus some padding (see ALLOCATION_PADDING)
+	uint8* Allocate(uint32);
+	void NextFrame();
+
+	STATS GetStats() const;
+
+	enum
+	{
+		//Transfer handlers are allowed to read a bit past the end of the data (ie.: PSMCT24)
+		ALLOCATION_PADDING = 0x10,
+	};
+
+private:
+	enum
+	{
+		CHUNK_SIZE = 0x100000,
+		ALLOCATION_ALIGNMENT = 0x10,
+	};
+
+	struct CHUNK
+	{
+		std::unique_ptr<uint8[]> data;
+		uint32 size = 0;
+	};
+
+	struct ARENA
+	{
+		std::vector<CHUNK> chunks;
+		uint32 chunkIndex = 0;
+		uint32 chunkOffset = 0;
+		uint32 transferBytes = 0;
+		uint32 stagingBytes = 0;
+	};
+
+	std::vector<ARENA> m_arenas;
+	unsigned int m_arenaIndex = 0;
+	STATS m_stats;
+};
@@ -1,11 +1,18 @@
 #pragma once
 
-#include <list>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
 #include "GSHandler.h"
 #include "GsCachedArea.h"
+#include "GsPixelFormats.h"
 
 #define TEX0_CLUTINFO_MASK (~0xFFFFFFE000000000ULL)
 
+//Textures are looked up by their masked TEX0 value. Each GS page keeps track of the textures
+//that overlap it, so that invalidating a range of memory only visits those textures.
 template <typename TextureHandleType>
 class CGsTextureCache
 {
@@ -26,6 +33,18 @@ public:
 
 		//Platform specific
 		TextureHandleType m_textureHandle;
+
+	private:
+		friend class CGsTextureCache;
+
+		//Position in the cache's LRU list, head is the most recently used texture
+		CTexture* m_prev = nullptr;
+		CTexture* m_next = nullptr;
+
+		uint32 m_index = 0;
+		uint32 m_startPage = 0;
+		uint32 m_endPage = 0;
+		bool m_hasPages = false;
 	};
 
 	enum
@@ -34,35 +53,54 @@ public:
 	};
 
 	CGsTextureCache()
+	    : m_textures(std::make_unique<CTexture[]>(MAX_TEXTURE_CACHE))
 	{
 		for(unsigned int i = 0; i < MAX_TEXTURE_CACHE; i++)
 		{
-			m_textureCache.push_back(std::make_shared<CTexture>());
+			auto texture = &m_textures[i];
+			texture->m_index = i;
+			texture->m_prev = (i == 0) ? nullptr : &m_textures[i - 1];
+			texture->m_next = (i == (MAX_TEXTURE_CACHE - 1)) ? nullptr : &m_textures[i + 1];
 		}
+		m_head = &m_textures[0];
+		m_tail = &m_textures[MAX_TEXTURE_CACHE - 1];
+		m_textureIndex.reserve(MAX_TEXTURE_CACHE);
+		memset(m_pageTextures, 0, sizeof(m_pageTextures));
 	}
 
+	CGsTextureCache(const CGsTextureCache&) = delete;
+	CGsTextureCache& operator=(const CGsTextureCache&) = delete;
+
 	CTexture* Search(const CGSHandler::TEX0& tex0)
 	{
 		uint64 maskedTex0 = static_cast<uint64>(tex0) & TEX0_CLUTINFO_MASK;
 
-		for(auto textureIterator(m_textureCache.begin());
-		    textureIterator != m_textureCache.end(); textureIterator++)
-		{
-			auto texture = *textureIterator;
-			if(!texture->m_live) continue;
-			if(maskedTex0 != texture->m_tex0) continue;
-			m_textureCache.erase(textureIterator);
-			m_textureCache.push_front(texture);
-			return texture.get();
-		}
+		auto textureIterator = m_textureIndex.find(maskedTex0);
+		if(textureIterator == std::end(m_textureIndex)) return nullptr;
 
-		return nullptr;
+		auto texture = textureIterator->second;
+		assert(texture->m_live);
+		MoveToFront(texture);
+		return texture;
 	}
 
 	void Insert(const CGSHandler::TEX0& tex0, TextureHandleType textureHandle)
 	{
-		auto texture = *m_textureCache.rbegin();
-		texture->Reset();
+		uint64 maskedTex0 = static_cast<uint64>(tex0) & TEX0_CLUTINFO_MASK;
+
+		auto texture = m_tail;
+		Evict(texture);
+
+		//An older texture with the same key can't be found anymore, recycle it first
+		{
+			auto textureIterator = m_textureIndex.find(maskedTex0);
+			if(textureIterator != std::end(m_textureIndex))
+			{
+				auto staleTexture = textureIterator->second;
+				Evict(staleTexture);
+				MoveToBack(staleTexture);
+			}
+		}
 
 		// DBZ Budokai Tenkaichi 2 and 3 use invalid (empty) buffer sizes.
 		// Account for that, by assuming image width.
@@ -75,29 +113,156 @@ public:
 
 		texture->m_cachedArea.SetArea(tex0.nPsm, tex0.GetBufPtr(), bufSize, texHeight);
 
-		texture->m_tex0 = static_cast<uint64>(tex0) & TEX0_CLUTINFO_MASK;
+		texture->m_tex0 = maskedTex0;
 		texture->m_textureHandle = std::move(textureHandle);
 		texture->m_live = true;
 
-		m_textureCache.pop_back();
-		m_textureCache.push_front(texture);
+		m_textureIndex[maskedTex0] = texture;
+		AddToPages(texture, tex0.GetBufPtr(), texture->m_cachedArea.GetSize());
+		MoveToFront(texture);
 	}
 
 	void InvalidateRange(uint32 start, uint32 size)
 	{
-		std::for_each(std::begin(m_textureCache), std::end(m_textureCache),
-		              [start, size](TexturePtr& texture) { if(texture->m_live) { texture->m_cachedArea.Invalidate(start, size); } });
+		if(size == 0) return;
+
+		uint32 startPage = GetPageIndex(start);
+		uint32 endPage = GetPageIndex(start + size - 1);
+
+		TextureMaskHolder textureMask[TEXTURE_MASK_SECTIONS] = {};
+		for(uint32 pageIndex = startPage; pageIndex <= endPage; pageIndex++)
+		{
+			for(unsigned int section = 0; section < TEXTURE_MASK_SECTIONS; section++)
+			{
+				textureMask[section] |= m_pageTextures[pageIndex][section];
+			}
+		}
+
+		//Page granularity is coarser than the areas, let them decide if they're really touched
+		for(unsigned int section = 0; section < TEXTURE_MASK_SECTIONS; section++)
+		{
+			auto mask = textureMask[section];
+			for(unsigned int bit = 0; mask != 0; bit++, mask >>= 1)
+			{
+				if((mask & 1) == 0) continue;
+				auto& texture = m_textures[(section * TEXTURE_MASK_BITS) + bit];
+				assert(texture.m_live);
+				texture.m_cachedArea.Invalidate(start, size);
+			}
+		}
 	}
 
 	void Flush()
 	{
-		std::for_each(std::begin(m_textureCache), std::end(m_textureCache),
-		              [](TexturePtr& texture) { texture->Reset(); });
+		for(unsigned int i = 0; i < MAX_TEXTURE_CACHE; i++)
+		{
+			auto& texture = m_textures[i];
+			texture.Reset();
+			texture.m_hasPages = false;
+		}
+		m_textureIndex.clear();
+		memset(m_pageTextures, 0, sizeof(m_pageTextures));
 	}
 
 private:
-	typedef std::shared_ptr<CTexture> TexturePtr;
-	typedef std::list<TexturePtr> TextureList;
+	typedef uint64 TextureMaskHolder;
+
+	enum
+	{
+		TEXTURE_MASK_BITS = sizeof(TextureMaskHolder) * 8,
+		TEXTURE_MASK_SECTIONS = MAX_TEXTURE_CACHE / TEXTURE_MASK_BITS,
+		PAGE_COUNT = CGSHandler::RAMSIZE / CGsPixelFormats::PAGESIZE,
+	};
+	static_assert((MAX_TEXTURE_CACHE % TEXTURE_MASK_BITS) == 0, "Texture count must fill texture masks.");
+
+	//Addresses past the end of RAM all land in the last page, areas do the exact overlap check
+	static uint32 GetPageIndex(uint32 address)
+	{
+		return std::min<uint32>(address / CGsPixelFormats::PAGESIZE, PAGE_COUNT - 1);
+	}
+
+	void Evict(CTexture* texture)
+	{
+		if(texture->m_live)
+		{
+			auto textureIterator = m_textureIndex.find(texture->m_tex0);
+			if((textureIterator != std::end(m_textureIndex)) && (textureIterator->second == texture))
+			{
+				m_textureIndex.erase(textureIterator);
+			}
+		}
+		RemoveFromPages(texture);
+		texture->Reset();
+	}
+
+	void AddToPages(CTexture* texture, uint32 start, uint32 size)
+	{
+		assert(!texture->m_hasPages);
+		if(size == 0) return;
+
+		texture->m_startPage = GetPageIndex(start);
+		texture->m_endPage = GetPageIndex(start + size - 1);
+		texture->m_hasPages = true;
+
+		unsigned int section = texture->m_index / TEXTURE_MASK_BITS;
+		auto bit = 1ULL << (texture->m_index % TEXTURE_MASK_BITS);
+		for(uint32 pageIndex = texture->m_startPage; pageIndex <= texture->m_endPage; pageIndex++)
+		{
+			m_pageTextures[pageIndex][section] |= bit;
+		}
+	}
+
+	void RemoveFromPages(CTexture* texture)
+	{
+		if(!texture->m_hasPages) return;
+
+		unsigned int section = texture->m_index / TEXTURE_MASK_BITS;
+		auto bit = 1ULL << (texture->m_index % TEXTURE_MASK_BITS);
+		for(uint32 pageIndex = texture->m_startPage; pageIndex <= texture->m_endPage; pageIndex++)
+		{
+			m_pageTextures[pageIndex][section] &= ~bit;
+		}
+		texture->m_hasPages = false;
+	}
+
+	void Unlink(CTexture* texture)
+	{
+		if(texture->m_prev)
+			texture->m_prev->m_next = texture->m_next;
+		else
+			m_head = texture->m_next;
+
+		if(texture->m_next)
+			texture->m_next->m_prev = texture->m_prev;
+		else
+			m_tail = texture->m_prev;
+
+		texture->m_prev = nullptr;
+		texture->m_next = nullptr;
+	}
+
+	void MoveToFront(CTexture* texture)
+	{
+		if(texture == m_head) return;
+		Unlink(texture);
+		texture->m_next = m_head;
+		m_head->m_prev = texture;
+		m_head = texture;
+	}
+
+	void MoveToBack(CTexture* texture)
+	{
+		if(texture == m_tail) return;
+		Unlink(texture);
+		texture->m_prev = m_tail;
+		m_tail->m_next = texture;
+		m_tail = texture;
+	}
+
+	std::unique_ptr<CTexture[]> m_textures;
+	CTexture* m_head = nullptr;
+	CTexture* m_tail = nullptr;
 
-	TextureList m_textureCache;
+	std::unordered_map<uint64, CTexture*> m_textureIndex;
+	TextureMaskHolder m_pageTextures[PAGE_COUNT][TEXTURE_MASK_SECTIONS];
 };
@@ -0,0 +1,582 @@
+#include "SimdDefs.h"
+#include "GsTransfer_Kernels.h"
+#include "GsPixelFormats.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace GsTransfer;
+
+#if defined(FRAMEWORK_SIMD_USE_SSE) || defined(FRAMEWORK_SIMD_USE_NEON)
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+
+typedef __m128i Vector;
+
+static inline Vector Load(const void* src)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+}
+
+static inline void Store(void* dst, Vector value)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), value);
+}
+
+static inline Vector Or(Vector a, Vector b)
+{
+	return _mm_or_si128(a, b);
+}
+
+static inline Vector Xor(Vector a, Vector b)
+{
+	return _mm_xor_si128(a, b);
+}
+
+static inline Vector MergeAlpha(Vector dst, Vector color)
+{
+	return _mm_or_si128(_mm_and_si128(dst, _mm_set1_epi32(0xFF000000)), color);
+}
+
+static inline bool IsZero(Vector value)
+{
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(value, _mm_setzero_si128())) == 0xFFFF;
+}
+
+static inline Vector InterleaveLo8(Vector a, Vector b)
+{
+	return _mm_unpacklo_epi8(a, b);
+}
+
+static inline Vector InterleaveHi8(Vector a, Vector b)
+{
+	return _mm_unpackhi_epi8(a, b);
+}
+
+static inline Vector InterleaveLo16(Vector a, Vector b)
+{
+	return _mm_unpacklo_epi16(a, b);
+}
+
+static inline Vector InterleaveHi16(Vector a, Vector b)
+{
+	return _mm_unpackhi_epi16(a, b);
+}
+
+static inline Vector InterleaveLo64(Vector a, Vector b)
+{
+	return _mm_unpacklo_epi64(a, b);
+}
+
+static inline Vector InterleaveHi64(Vector a, Vector b)
+{
+	return _mm_unpackhi_epi64(a, b);
+}
+
+//Elements are sign extended before packing, saturation never kicks in
+static inline Vector Even8(Vector a, Vector b)
+{
+	return _mm_packs_epi16(_mm_srai_epi16(_mm_slli_epi16(a, 8), 8), _mm_srai_epi16(_mm_slli_epi16(b, 8), 8));
+}
+
+static inline Vector Odd8(Vector a, Vector b)
+{
+	return _mm_packs_epi16(_mm_srai_epi16(a, 8), _mm_srai_epi16(b, 8));
+}
+
+static inline Vector Even16(Vector a, Vector b)
+{
+	return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+}
+
+static inline Vector Odd16(Vector a, Vector b)
+{
+	return _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+}
+
+static inline Vector SwapWords(Vector value)
+{
+	return _mm_shuffle_epi32(value, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline Vector LowNibbles(Vector value)
+{
+	return _mm_and_si128(value, _mm_set1_epi8(0x0F));
+}
+
+static inline Vector HighNibbles(Vector value)
+{
+	return _mm_and_si128(_mm_srli_epi16(value, 4), _mm_set1_epi8(0x0F));
+}
+
+//Puts pairs of nibbles back together, lower half comes from a, upper half from b
+static inline Vector PackNibbles(Vector a, Vector b)
+{
+	const __m128i byteMask = _mm_set1_epi16(0x00FF);
+	a = _mm_and_si128(_mm_or_si128(a, _mm_srli_epi16(a, 4)), byteMask);
+	b = _mm_and_si128(_mm_or_si128(b, _mm_srli_epi16(b, 4)), byteMask);
+	return _mm_packus_epi16(a, b);
+}
+
+//Expands a row of 8 packed 24 bits pixels, never reads past the end of the row
+static inline void Expand24(Vector& lo, Vector& hi, const uint8* src)
+{
+	auto expand =
+	    [](__m128i value) {
+		    __m128i p01 = _mm_unpacklo_epi32(value, _mm_srli_si128(value, 3));
+		    __m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(value, 6), _mm_srli_si128(value, 9));
+		    return _mm_and_si128(_mm_unpacklo_epi64(p01, p23), _mm_set1_epi32(0x00FFFFFF));
+	    };
+	lo = expand(Load(src));
+	hi = expand(_mm_srli_si128(Load(src + 8), 4));
+}
+
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+
+typedef uint8x16_t Vector;
+
+static inline Vector Load(const void* src)
+{
+	return vld1q_u8(reinterpret_cast<const uint8*>(src));
+}
+
+static inline void Store(void* dst, Vector value)
+{
+	vst1q_u8(reinterpret_cast<uint8*>(dst), value);
+}
+
+static inline Vector Or(Vector a, Vector b)
+{
+	return vorrq_u8(a, b);
+}
+
+static inline Vector Xor(Vector a, Vector b)
+{
+	return veorq_u8(a, b);
+}
+
+static inline Vector MergeAlpha(Vector dst, Vector color)
+{
+	return vorrq_u8(vandq_u8(dst, vreinterpretq_u8_u32(vdupq_n_u32(0xFF000000))), color);
+}
+
+static inline bool IsZero(Vector value)
+{
+	uint64x2_t value64 = vreinterpretq_u64_u8(value);
+	return (vgetq_lane_u64(value64, 0) | vgetq_lane_u64(value64, 1)) == 0;
+}
+
+static inline Vector InterleaveLo8(Vector a, Vector b)
+{
+	return vzipq_u8(a, b).val[0];
+}
+
+static inline Vector InterleaveHi8(Vector a, Vector b)
+{
+	return vzipq_u8(a, b).val[1];
+}
+
+static inline Vector InterleaveLo16(Vector a, Vector b)
+{
+	return vreinterpretq_u8_u16(vzipq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)).val[0]);
+}
+
+static inline Vector InterleaveHi16(Vector a, Vector b)
+{
+	return vreinterpretq_u8_u16(vzipq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)).val[1]);
+}
+
+static inline Vector InterleaveLo64(Vector a, Vector b)
+{
+	return vcombine_u8(vget_low_u8(a), vget_low_u8(b));
+}
+
+static inline Vector InterleaveHi64(Vector a, Vector b)
+{
+	return vcombine_u8(vget_high_u8(a), vget_high_u8(b));
+}
+
+static inline Vector Even8(Vector a, Vector b)
+{
+	return vuzpq_u8(a, b).val[0];
+}
+
+static inline Vector Odd8(Vector a, Vector b)
+{
+	return vuzpq_u8(a, b).val[1];
+}
+
+static inline Vector Even16(Vector a, Vector b)
+{
+	return vreinterpretq_u8_u16(vuzpq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)).val[0]);
+}
+
+static inline Vector Odd16(Vector a, Vector b)
+{
+	return vreinterpretq_u8_u16(vuzpq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)).val[1]);
+}
+
+static inline Vector SwapWords(Vector value)
+{
+	return vreinterpretq_u8_u32(vrev64q_u32(vreinterpretq_u32_u8(value)));
+}
+
+static inline Vector LowNibbles(Vector value)
+{
+	return vandq_u8(value, vdupq_n_u8(0x0F));
+}
+
+static inline Vector HighNibbles(Vector value)
+{
+	return vshrq_n_u8(value, 4);
+}
+
+//Puts pairs of nibbles back together, lower half comes from a, upper half from b
+static inline Vector PackNibbles(Vector a, Vector b)
+{
+	uint16x8_t a16 = vreinterpretq_u16_u8(a);
+	uint16x8_t b16 = vreinterpretq_u16_u8(b);
+	return vcombine_u8(vmovn_u16(vorrq_u16(a16, vshrq_n_u16(a16, 4))), vmovn_u16(vorrq_u16(b16, vshrq_n_u16(b16, 4))));
+}
+
+//Expands a row of 8 packed 24 bits pixels, never reads past the end of the row
+static inline void Expand24(Vector& lo, Vector& hi, const uint8* src)
+{
+	uint8x8x3_t channels = vld3_u8(src);
+	uint8x8x2_t rg = vzip_u8(channels.val[0], channels.val[1]);
+	uint8x8x2_t bx = vzip_u8(channels.val[2], vdup_n_u8(0));
+	uint8x16_t rgPairs = vcombine_u8(rg.val[0], rg.val[1]);
+	uint8x16_t bxPairs = vcombine_u8(bx.val[0], bx.val[1]);
+	lo = InterleaveLo16(rgPairs, bxPairs);
+	hi = InterleaveHi16(rgPairs, bxPairs);
+}
+
+#endif
+
+static inline bool StoreColumn(uint8* column, Vector q0, Vector q1, Vector q2, Vector q3)
+{
+	Vector difference = Or(
+	    Or(Xor(Load(column + 0x00), q0), Xor(Load(column + 0x10), q1)),
+	    Or(Xor(Load(column + 0x20), q2), Xor(Load(column + 0x30), q3)));
+	Store(column + 0x00, q0);
+	Store(column + 0x10, q1);
+	Store(column + 0x20, q2);
+	Store(column + 0x30, q3);
+	return !IsZero(difference);
+}
+
+//Pixels of both rows are grouped in pairs and alternate in the column
+static inline void Swizzle32(Vector& q0, Vector& q1, Vector& q2, Vector& q3, Vector a0, Vector a1, Vector b0, Vector b1)
+{
+	q0 = InterleaveLo64(a0, b0);
+	q1 = InterleaveHi64(a0, b0);
+	q2 = InterleaveLo64(a1, b1);
+	q3 = InterleaveHi64(a1, b1);
+}
+
+//Each word holds 4 pixels: 2 pixels 8 columns apart in the first row, same for the third row (or second and fourth).
+//The other row pair has its words swapped, which one depends on the column's index.
+static inline void Swizzle8(Vector& q0, Vector& q1, Vector& q2, Vector& q3, Vector r0, Vector r1, Vector r2, Vector r3, uint32 columnNum)
+{
+	if(columnNum & 1)
+	{
+		r0 = SwapWords(r0);
+		r1 = SwapWords(r1);
+	}
+	else
+	{
+		r2 = SwapWords(r2);
+		r3 = SwapWords(r3);
+	}
+
+	Vector evenLo = InterleaveLo8(r0, r2);
+	Vector evenHi = InterleaveHi8(r0, r2);
+	Vector oddLo = InterleaveLo8(r1, r3);
+	Vector oddHi = InterleaveHi8(r1, r3);
+
+	Vector w0 = InterleaveLo16(evenLo, evenHi);
+	Vector w1 = InterleaveHi16(evenLo, evenHi);
+	Vector v0 = InterleaveLo16(oddLo, oddHi);
+	Vector v1 = InterleaveHi16(oddLo, oddHi);
+
+	q0 = InterleaveLo64(w0, v0);
+	q1 = InterleaveHi64(w0, v0);
+	q2 = InterleaveLo64(w1, v1);
+	q3 = InterleaveHi64(w1, v1);
+}
+
+//A 4 bits column looks like two 8 bits columns side by side, those land in the lower and upper halves of words
+static inline Vector MergeNibbles(Vector lo, Vector hi)
+{
+	Vector packed = PackNibbles(lo, hi);
+	return InterleaveLo16(packed, InterleaveHi64(packed, packed));
+}
+
+bool Kernels::WriteColumn32(uint8* column, const uint8* src, uint32 srcPitch)
+{
+	Vector q0, q1, q2, q3;
+	Swizzle32(q0, q1, q2, q3, Load(src), Load(src + 0x10), Load(src + srcPitch), Load(src + srcPitch + 0x10));
+	return StoreColumn(column, q0, q1, q2, q3);
+}
+
+void Kernels::WriteColumn24(uint8* column, const uint8* src, uint32 srcPitch)
+{
+	Vector a0, a1, b0, b1;
+	Expand24(a0, a1, src);
+	Expand24(b0, b1, src + srcPitch);
+
+	Vector q0, q1, q2, q3;
+	Swizzle32(q0, q1, q2, q3, a0, a1, b0, b1);
+	Store(column + 0x00, MergeAlpha(Load(column + 0x00), q0));
+	Store(column + 0x10, MergeAlpha(Load(column + 0x10), q1));
+	Store(column + 0x20, MergeAlpha(Load(column + 0x20), q2));
+	Store(column + 0x30, MergeAlpha(Load(column + 0x30), q3));
+}
+
+bool Kernels::WriteColumn16(uint8* column, const uint8* src, uint32 srcPitch)
+{
+	//Pixels 8 columns apart are next to each other, then grouped in pairs like 32 bits columns
+	Vector a0 = Load(src);
+	Vector a1 = Load(src + 0x10);
+	Vector b0 = Load(src + srcPitch);
+	Vector b1 = Load(src + srcPitch + 0x10);
+
+	Vector q0, q1, q2, q3;
+	Swizzle32(q0, q1, q2, q3, InterleaveLo16(a0, a1), InterleaveHi16(a0, a1), InterleaveLo16(b0, b1), InterleaveHi16(b0, b1));
+	return StoreColumn(column, q0, q1, q2, q3);
+}
+
+bool Kernels::WriteColumn8(uint8* column, const uint8* src, uint32 srcPitch, uint32 columnNum)
+{
+	Vector q0, q1, q2, q3;
+	Swizzle8(q0, q1, q2, q3, Load(src), Load(src + srcPitch), Load(src + (srcPitch * 2)), Load(src + (srcPitch * 3)), columnNum);
+	return StoreColumn(column, q0, q1, q2, q3);
+}
+
+bool Kernels::WriteColumn4(uint8* column, const uint8* src, uint32 srcPitch, uint32 columnNum)
+{
+	Vector lo[4], hi[4];
+	for(uint32 row = 0; row < 4; row++)
+	{
+		Vector value = Load(src + (srcPitch * row));
+		Vector lowNibbles = LowNibbles(value);
+		Vector highNibbles = HighNibbles(value);
+		lo[row] = InterleaveLo8(lowNibbles, highNibbles);
+		hi[row] = InterleaveHi8(lowNibbles, highNibbles);
+	}
+
+	Vector lq0, lq1, lq2, lq3;
+	Vector hq0, hq1, hq2, hq3;
+	Swizzle8(lq0, lq1, lq2, lq3, lo[0], lo[1], lo[2], lo[3], columnNum);
+	Swizzle8(hq0, hq1, hq2, hq3, hi[0], hi[1], hi[2], hi[3], columnNum);
+	return StoreColumn(column, MergeNibbles(lq0, hq0), MergeNibbles(lq1, hq1), MergeNibbles(lq2, hq2), MergeNibbles(lq3, hq3));
+}
+
+void Kernels::ReadColumn32(const uint8* column, uint8* dst, uint32 dstPitch)
+{
+	Vector q0 = Load(column + 0x00);
+	Vector q1 = Load(column + 0x10);
+	Vector q2 = Load(column + 0x20);
+	Vector q3 = Load(column + 0x30);
+	Store(dst, InterleaveLo64(q0, q1));
+	Store(dst + 0x10, InterleaveLo64(q2, q3));
+	Store(dst + dstPitch, InterleaveHi64(q0, q1));
+	Store(dst + dstPitch + 0x10, InterleaveHi64(q2, q3));
+}
+
+void Kernels::ReadColumn16(const uint8* column, uint8* dst, uint32 dstPitch)
+{
+	Vector q0 = Load(column + 0x00);
+	Vector q1 = Load(column + 0x10);
+	Vector q2 = Load(column + 0x20);
+	Vector q3 = Load(column + 0x30);
+	Vector aLo = InterleaveLo64(q0, q1);
+	Vector aHi = InterleaveLo64(q2, q3);
+	Vector bLo = InterleaveHi64(q0, q1);
+	Vector bHi = InterleaveHi64(q2, q3);
+	Store(dst, Even16(aLo, aHi));
+	Store(dst + 0x10, Odd16(aLo, aHi));
+	Store(dst + dstPitch, Even16(bLo, bHi));
+	Store(dst + dstPitch + 0x10, Odd16(bLo, bHi));
+}
+
+void Kernels::ReadColumn8(const uint8* column, uint8* dst, uint32 dstPitch, uint32 columnNum)
+{
+	Vector q0 = Load(column + 0x00);
+	Vector q1 = Load(column + 0x10);
+	Vector q2 = Load(column + 0x20);
+	Vector q3 = Load(column + 0x30);
+
+	Vector w0 = InterleaveLo64(q0, q1);
+	Vector v0 = InterleaveHi64(q0, q1);
+	Vector w1 = InterleaveLo64(q2, q3);
+	Vector v1 = InterleaveHi64(q2, q3);
+
+	Vector evenLo = Even16(w0, w1);
+	Vector evenHi = Odd16(w0, w1);
+	Vector oddLo = Even16(v0, v1);
+	Vector oddHi = Odd16(v0, v1);
+
+	Vector r0 = Even8(evenLo, evenHi);
+	Vector r1 = Even8(oddLo, oddHi);
+	Vector r2 = Odd8(evenLo, evenHi);
+	Vector r3 = Odd8(oddLo, oddHi);
+
+	if(columnNum & 1)
+	{
+		r0 = SwapWords(r0);
+		r1 = SwapWords(r1);
+	}
+	else
+	{
+		r2 = SwapWords(r2);
+		r3 = SwapWords(r3);
+	}
+
+	Store(dst, r0);
+	Store(dst + dstPitch, r1);
+	Store(dst + (dstPitch * 2), r2);
+	Store(dst + (dstPitch * 3), r3);
+}
+
+#else
+
+static uint32 GetColumn8Offset(uint32 x, uint32 y, uint32 columnNum)
+{
+	typedef CGsPixelFormats::STORAGEPSMT8 Storage;
+	uint32 table = ((y & 0x02) >> 1) ^ (columnNum & 1);
+	uint32 byte = ((x & 0x08) >> 2) + ((y & 0x02) >> 1);
+	return (Storage::m_nColumnWordTable[table][y & 0x01][x & 0x07] * 4) + byte;
+}
+
+static uint32 GetColumn4Offset(uint32 x, uint32 y, uint32 columnNum)
+{
+	typedef CGsPixelFormats::STORAGEPSMT4 Storage;
+	uint32 table = ((y & 0x02) >> 1) ^ (columnNum & 1);
+	uint32 nibble = ((x & 0x18) >> 2) + ((y & 0x02) >> 1);
+	return (Storage::m_nColumnWordTable[table][y & 0x01][x & 0x07] * 8) + nibble;
+}
+
+template <typename Storage>
+static bool WriteColumnGeneric(uint8* column, const uint8* src, uint32 srcPitch)
+{
+	typedef typename Storage::Unit Unit;
+	auto columnPixels = reinterpret_cast<Unit*>(column);
+	bool changed = false;
+	for(uint32 y = 0; y < Storage::COLUMNHEIGHT; y++)
+	{
+		auto srcPixels = reinterpret_cast<const Unit*>(src + (y * srcPitch));
+		for(uint32 x = 0; x < Storage::COLUMNWIDTH; x++)
+		{
+			auto& pixel = columnPixels[Storage::m_nColumnSwizzleTable[y][x]];
+			changed |= (pixel != srcPixels[x]);
+			pixel = srcPixels[x];
+		}
+	}
+	return changed;
+}
+
+template <typename Storage>
+static void ReadColumnGeneric(const uint8* column, uint8* dst, uint32 dstPitch)
+{
+	typedef typename Storage::Unit Unit;
+	auto columnPixels = reinterpret_cast<const Unit*>(column);
+	for(uint32 y = 0; y < Storage::COLUMNHEIGHT; y++)
+	{
+		auto dstPixels = reinterpret_cast<Unit*>(dst + (y * dstPitch));
+		for(uint32 x = 0; x < Storage::COLUMNWIDTH; x++)
+		{
+			dstPixels[x] = columnPixels[Storage::m_nColumnSwizzleTable[y][x]];
+		}
+	}
+}
+
+bool Kernels::WriteColumn32(uint8* column, const uint8* src, uint32 srcPitch)
+{
+	return WriteColumnGeneric<CGsPixelFormats::STORAGEPSMCT32>(column, src, srcPitch);
+}
+
+void Kernels::WriteColumn24(uint8* column, const uint8* src, uint32 srcPitch)
+{
+	typedef CGsPixelFormats::STORAGEPSMCT32 Storage;
+	auto columnPixels = reinterpret_cast<uint32*>(column);
+	for(uint32 y = 0; y < Storage::COLUMNHEIGHT; y++)
+	{
+		const uint8* srcPixels = src + (y * srcPitch);
+		for(uint32 x = 0; x < Storage::COLUMNWIDTH; x++)
+		{
+			auto& pixel = columnPixels[Storage::m_nColumnSwizzleTable[y][x]];
+			pixel &= 0xFF000000;
+			pixel |= srcPixels[(x * 3) + 0] | (srcPixels[(x * 3) + 1] << 8) | (srcPixels[(x * 3) + 2] << 16);
+		}
+	}
+}
+
+bool Kernels::WriteColumn16(uint8* column, const uint8* src, uint32 srcPitch)
+{
+	return WriteColumnGeneric<CGsPixelFormats::STORAGEPSMCT16>(column, src, srcPitch);
+}
+
+bool Kernels::WriteColumn8(uint8* column, const uint8* src, uint32 srcPitch, uint32 columnNum)
+{
+	typedef CGsPixelFormats::STORAGEPSMT8 Storage;
+	bool changed = false;
+	for(uint32 y = 0; y < Storage::COLUMNHEIGHT; y++)
+	{
+		for(uint32 x = 0; x < Storage::COLUMNWIDTH; x++)
+		{
+			uint8 srcPixel = src[(y * srcPitch) + x];
+			auto& pixel = column[GetColumn8Offset(x, y, columnNum)];
+			changed |= (pixel != srcPixel);
+			pixel = srcPixel;
+		}
+	}
+	return changed;
+}
+
+bool Kernels::WriteColumn4(uint8* column, const uint8* src, uint32 srcPitch, uint32 columnNum)
+{
+	typedef CGsPixelFormats::STORAGEPSMT4 Storage;
+	bool changed = false;
+	for(uint32 y = 0; y < Storage::COLUMNHEIGHT; y++)
+	{
+		for(uint32 x = 0; x < Storage::COLUMNWIDTH; x++)
+		{
+			uint8 srcPixel = (src[(y * srcPitch) + (x / 2)] >> ((x & 1) * 4)) & 0x0F;
+			uint32 offset = GetColumn4Offset(x, y, columnNum);
+			uint32 shiftAmount = (offset & 1) * 4;
+			auto& pixels = column[offset / 2];
+			changed |= (((pixels >> shiftAmount) & 0x0F) != srcPixel);
+			pixels &= ~(0x0F << shiftAmount);
+			pixels |= (srcPixel << shiftAmount);
+		}
+	}
+	return changed;
+}
+
+void Kernels::ReadColumn32(const uint8* column, uint8* dst, uint32 dstPitch)
+{
+	ReadColumnGeneric<CGsPixelFormats::STORAGEPSMCT32>(column, dst, dstPitch);
+}
+
+void Kernels::ReadColumn16(const uint8* column, uint8* dst, uint32 dstPitch)
+{
+	ReadColumnGeneric<CGsPixelFormats::STORAGEPSMCT16>(column, dst, dstPitch);
+}
+
+void Kernels::ReadColumn8(const uint8* column, uint8* dst, uint32 dstPitch, uint32 columnNum)
+{
+	typedef CGsPixelFormats::STORAGEPSMT8 Storage;
+	for(uint32 y = 0; y < Storage::COLUMNHEIGHT; y++)
+	{
+		for(uint32 x = 0; x < Storage::COLUMNWIDTH; x++)
+		{
+			dst[(y * dstPitch) + x] = column[GetColumn8Offset(x, y, columnNum)];
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Types.h"
+
+namespace GsTransfer
+{
+	//Moves whole columns (64 bytes of GS memory, see CGsPixelFormats) between linear images and GS memory.
+	//Images have one row of pixels per pitch, a column covers 2 rows for 32 and 16 bits formats and
+	//4 rows for 8 and 4 bits formats. Odd columns of 8 and 4 bits formats don't have the same layout
+	//as even ones, those functions need to know the column's index.
+	namespace Kernels
+	{
+		//Write functions return true if the content of the column changed
+		bool WriteColumn32(uint8*, const uint8*, uint32);
+		bool WriteColumn16(uint8*, const uint8*, uint32);
+		bool WriteColumn8(uint8*, const uint8*, uint32, uint32);
+		bool WriteColumn4(uint8*, const uint8*, uint32, uint32);
+
+		//Image is made of packed 24 bits pixels, alpha bits in the column are preserved
+		void WriteColumn24(uint8*, const uint8*, uint32);
+
+		void ReadColumn32(const uint8*, uint8*, uint32);
+		void ReadColumn16(const uint8*, uint8*, uint32);
+		void ReadColumn8(const uint8*, uint8*, uint32, uint32);
+	}
+}
@@ -1,4 +1,5 @@
 #include <vector>
+#include <algorithm>
 #include <cstring>
 
 #include "string_format.h"
@@ -398,6 +399,105 @@ void CIopBios::LoadState(Framework::CZipArchiveReader& archive)
 
 	archive.BeginReadFile(STATE_MODULESTARTREQUESTS)->Read(m_moduleStartRequests, sizeof(m_moduleStartRequests));
 
+	CompleteLoadState();
+}
+
+template <typename VisitFunction>
+void CIopBios::VisitBuiltInModules(const VisitFunction& visit) const
+{
+	//Same modules as GetBuiltInModules, but without allocating and in an order that
+	//doesn't change when HLE modules get registered (raw states rely on this)
+	static const auto containsModule =
+	    [](auto beginIterator, auto endIterator, const Iop::CModule* module) {
+		    return std::any_of(beginIterator, endIterator,
+		                       [module](const auto& modulePair) { return modulePair.second.get() == module; });
+	    };
+
+	for(auto moduleIterator = std::begin(m_hleModules); moduleIterator != std::end(m_hleModules); moduleIterator++)
+	{
+		//Same module can be registered for many paths
+		auto module = moduleIterator->second.get();
+		if(containsModule(std::begin(m_hleModules), moduleIterator, module)) continue;
+		visit(module);
+	}
+	for(const auto& modulePair : m_modules)
+	{
+		auto module = modulePair.second.get();
+		if(dynamic_cast<Iop::CDynamic*>(module)) continue;
+		if(containsModule(std::begin(m_hleModules), std::end(m_hleModules), module)) continue;
+		visit(module);
+	}
+}
+
+size_t CIopBios::GetRawStateSize() const
+{
+	size_t size = sizeof(uint32) + (RAW_STATE_MAX_DYNAMIC_MODULES * sizeof(uint32)) + sizeof(m_moduleStartRequests);
+	VisitBuiltInModules(
+	    [&size](const Iop::CModule* module) {
+		    size += module->GetRawStateSize();
+	    });
+	return size;
+}
+
+void CIopBios::SaveRawState(CRawStateWriter& writer)
+{
+	uint32 dynamicModuleCount = 0;
+	for(const auto& modulePair : m_modules)
+	{
+		if(!dynamic_cast<const Iop::CDynamic*>(modulePair.second.get())) continue;
+		dynamicModuleCount++;
+	}
+	if(dynamicModuleCount > RAW_STATE_MAX_DYNAMIC_MODULES)
+	{
+		throw std::runtime_error("Too many dynamic modules for raw state.");
+	}
+
+	writer.Write(dynamicModuleCount);
+	for(const auto& modulePair : m_modules)
+	{
+		auto dynamicModule = dynamic_cast<const Iop::CDynamic*>(modulePair.second.get());
+		if(!dynamicModule) continue;
+		uint32 importTableAddress = reinterpret_cast<const uint8*>(dynamicModule->GetExportTable()) - m_ram;
+		writer.Write(importTableAddress);
+	}
+	writer.Skip((RAW_STATE_MAX_DYNAMIC_MODULES - dynamicModuleCount) * sizeof(uint32));
+	writer.Write(m_moduleStartRequests);
+
+	VisitBuiltInModules(
+	    [&writer](const Iop::CModule* module) {
+		    FRAMEWORK_MAYBE_UNUSED size_t moduleStart = writer.GetSize();
+		    module->SaveRawState(writer);
+		    assert((writer.GetSize() - moduleStart) == module->GetRawStateSize());
+	    });
+}
+
+void CIopBios::LoadRawState(CRawStateReader& reader)
+{
+	uint32 dynamicModuleCount = reader.Read<uint32>();
+	if(dynamicModuleCount > RAW_STATE_MAX_DYNAMIC_MODULES)
+	{
+		throw std::runtime_error("Invalid dynamic module count.");
+	}
+	for(uint32 i = 0; i < dynamicModuleCount; i++)
+	{
+		uint32 importTableAddress = reader.Read<uint32>();
+		auto module = std::make_shared<Iop::CDynamic>(reinterpret_cast<uint32*>(m_ram + importTableAddress));
+		FRAMEWORK_MAYBE_UNUSED bool result = RegisterModule(module);
+		assert(result);
+	}
+	reader.Skip((RAW_STATE_MAX_DYNAMIC_MODULES - dynamicModuleCount) * sizeof(uint32));
+	reader.Read(m_moduleStartRequests);
+
+	VisitBuiltInModules(
+	    [&reader](Iop::CModule* module) {
+		    module->LoadRawState(reader);
+	    });
+
+	CompleteLoadState();
+}
+
+void CIopBios::CompleteLoadState()
+{
 #ifdef _IOP_EMULATE_MODULES
 	//Make sure HLE modules are properly registered
 	for(const auto& loadedModule : m_loadedModules)
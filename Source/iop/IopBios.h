@@ -204,6 +204,10 @@ public:
 	void SaveState(Framework::CZipArchiveWriter&) override;
 	void LoadState(Framework::CZipArchiveReader&) override;
 
+	size_t GetRawStateSize() const override;
+	void SaveRawState(CRawStateWriter&) override;
+	void LoadRawState(CRawStateReader&) override;
+
 	bool IsIdle() override;
 
 	Iop::CSysmem* GetSysmem();
@@ -362,6 +366,11 @@ private:
 		MAX_LOADEDMODULE = 48,
 	};
 
+	enum
+	{
+		RAW_STATE_MAX_DYNAMIC_MODULES = 0x80,
+	};
+
 	enum WEF_FLAGS
 	{
 		WEF_AND = 0x00,
@@ -634,6 +643,9 @@ private:
 	void RegisterHleModule(const Iop::ModulePtr&);
 
 	ModuleSet GetBuiltInModules() const;
+	template <typename VisitFunction>
+	void VisitBuiltInModules(const VisitFunction&) const;
+	void CompleteLoadState();
 
 	uint32 AssembleThreadFinish(CMIPSAssembler&);
 	uint32 AssembleReturnFromException(CMIPSAssembler&);
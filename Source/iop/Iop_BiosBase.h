@@ -3,6 +3,7 @@
 #include <memory>
 #include "Types.h"
 #include "../BiosDebugInfoProvider.h"
+#include "../states/RawState.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
 #ifdef DEBUGGER_INCLUDED
@@ -28,6 +29,10 @@ namespace Iop
 		virtual void SaveState(Framework::CZipArchiveWriter&) = 0;
 		virtual void LoadState(Framework::CZipArchiveReader&) = 0;
 
+		virtual size_t GetRawStateSize() const = 0;
+		virtual void SaveRawState(CRawStateWriter&) = 0;
+		virtual void LoadRawState(CRawStateReader&) = 0;
+
 #ifdef DEBUGGER_INCLUDED
 		virtual void SaveDebugTags(Framework::Xml::CNode*) = 0;
 		virtual void LoadDebugTags(Framework::Xml::CNode*) = 0;
@@ -178,6 +178,33 @@ void CCdvdfsv::SaveState(Framework::CZipArchiveWriter& archive) const
 	archive.InsertFile(std::move(registerFile));
 }
 
+size_t CCdvdfsv::GetRawStateSize() const
+{
+	return sizeof(m_pendingCommand) + sizeof(m_pendingReadSector) + sizeof(m_pendingReadCount) + sizeof(m_pendingReadAddr) + sizeof(m_streaming) + sizeof(m_streamPos) + sizeof(m_streamBufferSize);
+}
+
+void CCdvdfsv::SaveRawState(CRawStateWriter& writer) const
+{
+	writer.Write(m_pendingCommand);
+	writer.Write(m_pendingReadSector);
+	writer.Write(m_pendingReadCount);
+	writer.Write(m_pendingReadAddr);
+	writer.Write(m_streaming);
+	writer.Write(m_streamPos);
+	writer.Write(m_streamBufferSize);
+}
+
+void CCdvdfsv::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_pendingCommand);
+	reader.Read(m_pendingReadSector);
+	reader.Read(m_pendingReadCount);
+	reader.Read(m_pendingReadAddr);
+	reader.Read(m_streaming);
+	reader.Read(m_streamPos);
+	reader.Read(m_streamBufferSize);
+}
+
 void CCdvdfsv::Invoke(CMIPS& context, unsigned int functionId)
 {
 	throw std::runtime_error("Not implemented.");
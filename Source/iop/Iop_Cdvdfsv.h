@@ -26,6 +26,9 @@ namespace Iop
 
 		void LoadState(Framework::CZipArchiveReader&) override;
 		void SaveState(Framework::CZipArchiveWriter&) const override;
+		size_t GetRawStateSize() const override;
+		void SaveRawState(CRawStateWriter&) const override;
+		void LoadRawState(CRawStateReader&) override;
 
 		enum MODULE_ID
 		{
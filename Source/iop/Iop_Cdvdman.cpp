@@ -79,6 +79,29 @@ void CCdvdman::SaveState(Framework::CZipArchiveWriter& archive) const
 	archive.InsertFile(std::move(registerFile));
 }
 
+size_t CCdvdman::GetRawStateSize() const
+{
+	return sizeof(m_callbackPtr) + sizeof(m_status) + sizeof(m_discChanged) + sizeof(m_pendingCommand) + sizeof(m_pendingCommandDelay);
+}
+
+void CCdvdman::SaveRawState(CRawStateWriter& writer) const
+{
+	writer.Write(m_callbackPtr);
+	writer.Write(m_status);
+	writer.Write(m_discChanged);
+	writer.Write(m_pendingCommand);
+	writer.Write(m_pendingCommandDelay);
+}
+
+void CCdvdman::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_callbackPtr);
+	reader.Read(m_status);
+	reader.Read(m_discChanged);
+	reader.Read(m_pendingCommand);
+	reader.Read(m_pendingCommandDelay);
+}
+
 static uint8 Uint8ToBcd(uint8 input)
 {
 	uint8 digit0 = input % 10;
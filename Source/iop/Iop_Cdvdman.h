@@ -58,6 +58,9 @@ namespace Iop
 
 		void LoadState(Framework::CZipArchiveReader&) override;
 		void SaveState(Framework::CZipArchiveWriter&) const override;
+		size_t GetRawStateSize() const override;
+		void SaveRawState(CRawStateWriter&) const override;
+		void LoadRawState(CRawStateReader&) override;
 
 		uint32 CdStandby();
 		uint32 CdRead(uint32, uint32, uint32, uint32);
@@ -97,6 +97,12 @@ void CDmac::ResumeDma(unsigned int channelIdx)
 	channel->ResumeDma();
 }
 
+bool CDmac::IsDmaActive(unsigned int channelIdx) const
+{
+	auto channel = m_channel[channelIdx];
+	return (channel != nullptr) && channel->IsDmaActive();
+}
+
 void CDmac::AssertLine(unsigned int line)
 {
 	if(line < 7)
@@ -206,6 +212,48 @@ void CDmac::LoadState(Framework::CZipArchiveReader& archive)
 	}
 }
 
+size_t CDmac::GetRawStateSize() const
+{
+	size_t size = sizeof(m_DPCR) + sizeof(m_DPCR2) + sizeof(m_DPCR3) + sizeof(m_DICR);
+	for(unsigned int i = 0; i < MAX_CHANNEL; i++)
+	{
+		auto channel = m_channel[i];
+		if(!channel) continue;
+		size += channel->GetRawStateSize();
+	}
+	return size;
+}
+
+void CDmac::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_DPCR);
+	reader.Read(m_DPCR2);
+	reader.Read(m_DPCR3);
+	reader.Read(m_DICR);
+
+	for(unsigned int i = 0; i < MAX_CHANNEL; i++)
+	{
+		auto channel = m_channel[i];
+		if(!channel) continue;
+		channel->LoadRawState(reader);
+	}
+}
+
+void CDmac::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_DPCR);
+	writer.Write(m_DPCR2);
+	writer.Write(m_DPCR3);
+	writer.Write(m_DICR);
+
+	for(unsigned int i = 0; i < MAX_CHANNEL; i++)
+	{
+		auto channel = m_channel[i];
+		if(!channel) continue;
+		channel->SaveRawState(writer);
+	}
+}
+
 void CDmac::SaveState(Framework::CZipArchiveWriter& archive)
 {
 	{
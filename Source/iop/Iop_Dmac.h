@@ -3,6 +3,7 @@
 #include "Types.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 #include "Iop_DmacChannel.h"
 
 namespace Iop
@@ -58,7 +59,12 @@ namespace Iop
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&);
 
+		size_t GetRawStateSize() const;
+		void LoadRawState(CRawStateReader&);
+		void SaveRawState(CRawStateWriter&);
+
 		void ResumeDma(unsigned int);
+		bool IsDmaActive(unsigned int) const;
 
 		void AssertLine(unsigned int);
 		uint8* GetRam();
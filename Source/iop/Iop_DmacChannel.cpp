@@ -48,6 +48,25 @@ void CChannel::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(std::move(registerFile));
 }
 
+size_t CChannel::GetRawStateSize() const
+{
+	return sizeof(m_CHCR) + sizeof(m_BCR) + sizeof(m_MADR);
+}
+
+void CChannel::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_CHCR);
+	writer.Write(m_BCR);
+	writer.Write(m_MADR);
+}
+
+void CChannel::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_CHCR);
+	reader.Read(m_BCR);
+	reader.Read(m_MADR);
+}
+
 void CChannel::SetReceiveFunction(const ReceiveFunctionType& receiveFunction)
 {
 	m_receiveFunction = receiveFunction;
@@ -72,6 +91,11 @@ void CChannel::ResumeDma()
 	}
 }
 
+bool CChannel::IsDmaActive() const
+{
+	return (m_CHCR.tr != 0);
+}
+
 uint32 CChannel::ReadRegister(uint32 address)
 {
 	switch(address - m_baseAddress)
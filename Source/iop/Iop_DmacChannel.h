@@ -4,6 +4,7 @@
 #include "Types.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 #include <functional>
 
 namespace Iop
@@ -55,9 +56,14 @@ namespace Iop
 			void SaveState(Framework::CZipArchiveWriter&);
 			void LoadState(Framework::CZipArchiveReader&);
 
+			size_t GetRawStateSize() const;
+			void SaveRawState(CRawStateWriter&);
+			void LoadRawState(CRawStateReader&);
+
 			void Reset();
 			void SetReceiveFunction(const ReceiveFunctionType&);
 			void ResumeDma();
+			bool IsDmaActive() const;
 			uint32 ReadRegister(uint32);
 			void WriteRegister(uint32, uint32);
 
@@ -1,4 +1,5 @@
 #include "Iop_FileIo.h"
+#include <cassert>
 #include <cstring>
 #include "make_unique.h"
 #include "Iop_FileIoHandler1000.h"
@@ -109,6 +110,30 @@ void CFileIo::LoadState(Framework::CZipArchiveReader& archive)
 	m_handler->LoadState(archive);
 }
 
+size_t CFileIo::GetRawStateSize() const
+{
+	return sizeof(m_moduleVersion) + RAW_STATE_HANDLER_SIZE;
+}
+
+void CFileIo::SaveRawState(CRawStateWriter& writer) const
+{
+	size_t handlerSize = m_handler->GetRawStateSize();
+	assert(handlerSize <= RAW_STATE_HANDLER_SIZE);
+	writer.Write(m_moduleVersion);
+	m_handler->SaveRawState(writer);
+	writer.Skip(RAW_STATE_HANDLER_SIZE - handlerSize);
+}
+
+void CFileIo::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_moduleVersion);
+	SyncHandler();
+	size_t handlerSize = m_handler->GetRawStateSize();
+	assert(handlerSize <= RAW_STATE_HANDLER_SIZE);
+	m_handler->LoadRawState(reader);
+	reader.Skip(RAW_STATE_HANDLER_SIZE - handlerSize);
+}
+
 void CFileIo::SaveState(Framework::CZipArchiveWriter& archive) const
 {
 	auto registerFile = std::make_unique<CRegisterStateFile>(STATE_VERSION_XML);
@@ -28,6 +28,12 @@ namespace Iop
 
 			virtual void LoadState(Framework::CZipArchiveReader&){};
 			virtual void SaveState(Framework::CZipArchiveWriter&) const {};
+			virtual size_t GetRawStateSize() const
+			{
+				return 0;
+			}
+			virtual void SaveRawState(CRawStateWriter&) const {};
+			virtual void LoadRawState(CRawStateReader&){};
 
 			virtual void ProcessCommands(CSifMan*){};
 
@@ -51,6 +57,9 @@ namespace Iop
 
 		void LoadState(Framework::CZipArchiveReader&) override;
 		void SaveState(Framework::CZipArchiveWriter&) const override;
+		size_t GetRawStateSize() const override;
+		void SaveRawState(CRawStateWriter&) const override;
+		void LoadRawState(CRawStateReader&) override;
 
 		void ProcessCommands(Iop::CSifMan*);
 
@@ -59,6 +68,12 @@ namespace Iop
 	private:
 		typedef std::unique_ptr<CHandler> HandlerPtr;
 
+		enum
+		{
+			//Raw state space reserved for any of the handlers
+			RAW_STATE_HANDLER_SIZE = 0x40,
+		};
+
 		void SyncHandler();
 
 		CIopBios& m_bios;
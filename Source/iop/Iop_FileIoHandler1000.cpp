@@ -41,6 +41,24 @@ void CFileIoHandler1000::LoadState(Framework::CZipArchiveReader& archive)
 	m_trampolineAddr = registerFile.GetRegister32(STATE_TRAMPOLINEADDR);
 }
 
+size_t CFileIoHandler1000::GetRawStateSize() const
+{
+	return sizeof(m_moduleDataAddr) + sizeof(m_trampolineAddr);
+}
+
+void CFileIoHandler1000::SaveRawState(CRawStateWriter& writer) const
+{
+	writer.Write(m_moduleDataAddr);
+	writer.Write(m_trampolineAddr);
+}
+
+void CFileIoHandler1000::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_moduleDataAddr);
+	m_bufferAddr = m_moduleDataAddr + offsetof(MODULEDATA, buffer);
+	reader.Read(m_trampolineAddr);
+}
+
 void CFileIoHandler1000::SaveState(Framework::CZipArchiveWriter& archive) const
 {
 	auto registerFile = std::make_unique<CRegisterStateFile>(STATE_XML);
@@ -18,6 +18,9 @@ namespace Iop
 
 		void LoadState(Framework::CZipArchiveReader&) override;
 		void SaveState(Framework::CZipArchiveWriter&) const override;
+		size_t GetRawStateSize() const override;
+		void SaveRawState(CRawStateWriter&) const override;
+		void LoadRawState(CRawStateReader&) override;
 
 	private:
 		enum
@@ -117,6 +117,23 @@ void CFileIoHandler2200::LoadState(Framework::CZipArchiveReader& archive)
 	archive.BeginReadFile(STATE_PENDINGREPLY)->Read(&m_pendingReply, sizeof(m_pendingReply));
 }
 
+size_t CFileIoHandler2200::GetRawStateSize() const
+{
+	return sizeof(m_resultPtr) + sizeof(m_pendingReply);
+}
+
+void CFileIoHandler2200::SaveRawState(CRawStateWriter& writer) const
+{
+	writer.Write(m_resultPtr);
+	writer.Write(m_pendingReply);
+}
+
+void CFileIoHandler2200::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_resultPtr);
+	reader.Read(m_pendingReply);
+}
+
 void CFileIoHandler2200::SaveState(Framework::CZipArchiveWriter& archive) const
 {
 	{
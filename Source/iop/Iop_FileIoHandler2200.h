@@ -16,6 +16,9 @@ namespace Iop
 
 		void LoadState(Framework::CZipArchiveReader&) override;
 		void SaveState(Framework::CZipArchiveWriter&) const override;
+		size_t GetRawStateSize() const override;
+		void SaveRawState(CRawStateWriter&) const override;
+		void LoadRawState(CRawStateReader&) override;
 
 		void ProcessCommands(CSifMan*) override;
 
@@ -62,6 +62,36 @@ void CIlink::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(std::move(registerFile));
 }
 
+size_t CIlink::GetRawStateSize() const
+{
+	return sizeof(m_ctrl2) + sizeof(m_phyResult) + sizeof(m_intr0) + sizeof(m_intr0Mask) +
+	       sizeof(m_intr1) + sizeof(m_intr1Mask) + sizeof(m_intr2) + sizeof(m_intr2Mask);
+}
+
+void CIlink::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_ctrl2);
+	reader.Read(m_phyResult);
+	reader.Read(m_intr0);
+	reader.Read(m_intr0Mask);
+	reader.Read(m_intr1);
+	reader.Read(m_intr1Mask);
+	reader.Read(m_intr2);
+	reader.Read(m_intr2Mask);
+}
+
+void CIlink::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_ctrl2);
+	writer.Write(m_phyResult);
+	writer.Write(m_intr0);
+	writer.Write(m_intr0Mask);
+	writer.Write(m_intr1);
+	writer.Write(m_intr1Mask);
+	writer.Write(m_intr2);
+	writer.Write(m_intr2Mask);
+}
+
 uint32 CIlink::ReadRegister(uint32 address)
 {
 	uint32 result = 0;
@@ -3,6 +3,7 @@
 #include "Types.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 
 namespace Iop
 {
@@ -47,6 +48,10 @@ namespace Iop
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&);
 
+		size_t GetRawStateSize() const;
+		void LoadRawState(CRawStateReader&);
+		void SaveRawState(CRawStateWriter&);
+
 		uint32 ReadRegister(uint32);
 		void WriteRegister(uint32, uint32);
 
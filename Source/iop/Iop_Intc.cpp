@@ -28,6 +28,23 @@ void CIntc::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(std::move(registerFile));
 }
 
+size_t CIntc::GetRawStateSize() const
+{
+	return sizeof(m_status.f) + sizeof(m_mask.f);
+}
+
+void CIntc::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_status.f);
+	reader.Read(m_mask.f);
+}
+
+void CIntc::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_status.f);
+	writer.Write(m_mask.f);
+}
+
 uint32 CIntc::ReadRegister(uint32 address)
 {
 	switch(address)
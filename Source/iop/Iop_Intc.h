@@ -4,6 +4,7 @@
 #include "BasicUnion.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 
 namespace Iop
 {
@@ -61,6 +62,10 @@ namespace Iop
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&);
 
+		size_t GetRawStateSize() const;
+		void LoadRawState(CRawStateReader&);
+		void SaveRawState(CRawStateWriter&);
+
 		uint32 ReadRegister(uint32);
 		uint32 WriteRegister(uint32, uint32);
 
@@ -1253,3 +1253,165 @@ void CIoman::LoadMountedDevicesState(Framework::CZipArchiveReader& archive)
 		Mount(name.c_str(), path.c_str());
 	}
 }
+
+size_t CIoman::GetRawStateSize() const
+{
+	return (sizeof(uint32) + (RAW_STATE_MAX_MOUNTED_DEVICES * RAW_STATE_MOUNTED_DEVICE_SIZE)) +
+	       (sizeof(uint32) + (RAW_STATE_MAX_FILES * RAW_STATE_FILE_SIZE)) +
+	       (sizeof(uint32) + (RAW_STATE_MAX_USER_DEVICES * RAW_STATE_USER_DEVICE_SIZE));
+}
+
+void CIoman::SaveRawState(CRawStateWriter& writer) const
+{
+	SaveMountedDevicesRawState(writer);
+	SaveFilesRawState(writer);
+	SaveUserDevicesRawState(writer);
+}
+
+void CIoman::LoadRawState(CRawStateReader& reader)
+{
+	LoadMountedDevicesRawState(reader);
+	LoadFilesRawState(reader);
+	LoadUserDevicesRawState(reader);
+}
+
+void CIoman::SaveFilesRawState(CRawStateWriter& writer) const
+{
+	uint32 fileCount = 0;
+	for(const auto& filePair : m_files)
+	{
+		if(filePair.first == FID_STDOUT) continue;
+		if(filePair.first == FID_STDERR) continue;
+		fileCount++;
+	}
+	if(fileCount > RAW_STATE_MAX_FILES)
+	{
+		throw std::runtime_error("Too many open files for raw state.");
+	}
+
+	writer.Write(fileCount);
+	for(const auto& filePair : m_files)
+	{
+		if(filePair.first == FID_STDOUT) continue;
+		if(filePair.first == FID_STDERR) continue;
+
+		const auto& file = filePair.second;
+		writer.Write<int32>(filePair.first);
+		writer.Write(file.flags);
+		writer.Write(file.descPtr);
+		writer.Write<int64>(file.stream ? file.stream->Tell() : 0);
+		writer.WriteString(file.path, RAW_STATE_PATH_SIZE);
+	}
+	writer.Skip((RAW_STATE_MAX_FILES - fileCount) * RAW_STATE_FILE_SIZE);
+}
+
+void CIoman::SaveUserDevicesRawState(CRawStateWriter& writer) const
+{
+	uint32 deviceCount = static_cast<uint32>(m_userDevices.size());
+	if(deviceCount > RAW_STATE_MAX_USER_DEVICES)
+	{
+		throw std::runtime_error("Too many user devices for raw state.");
+	}
+
+	writer.Write(deviceCount);
+	for(const auto& devicePair : m_userDevices)
+	{
+		writer.WriteString(devicePair.first, RAW_STATE_NAME_SIZE);
+		writer.Write(devicePair.second);
+	}
+	writer.Skip((RAW_STATE_MAX_USER_DEVICES - deviceCount) * RAW_STATE_USER_DEVICE_SIZE);
+}
+
+void CIoman::SaveMountedDevicesRawState(CRawStateWriter& writer) const
+{
+	uint32 deviceCount = static_cast<uint32>(m_mountedDevices.size());
+	if(deviceCount > RAW_STATE_MAX_MOUNTED_DEVICES)
+	{
+		throw std::runtime_error("Too many mounted devices for raw state.");
+	}
+
+	writer.Write(deviceCount);
+	for(const auto& devicePair : m_mountedDevices)
+	{
+		writer.WriteString(devicePair.first, RAW_STATE_NAME_SIZE);
+		writer.WriteString(devicePair.second, RAW_STATE_PATH_SIZE);
+	}
+	writer.Skip((RAW_STATE_MAX_MOUNTED_DEVICES - deviceCount) * RAW_STATE_MOUNTED_DEVICE_SIZE);
+}
+
+void CIoman::LoadFilesRawState(CRawStateReader& reader)
+{
+	std::experimental::erase_if(m_files,
+	                            [](const FileMapType::value_type& filePair) {
+		                            return (filePair.first != FID_STDOUT) && (filePair.first != FID_STDERR);
+	                            });
+
+	uint32 fileCount = reader.Read<uint32>();
+	if(fileCount > RAW_STATE_MAX_FILES)
+	{
+		throw std::runtime_error("Invalid open file count.");
+	}
+
+	int32 maxFileId = FID_STDERR;
+	for(uint32 i = 0; i < fileCount; i++)
+	{
+		int32 id = reader.Read<int32>();
+
+		FileInfo fileInfo;
+		reader.Read(fileInfo.flags);
+		reader.Read(fileInfo.descPtr);
+		int64 position = reader.Read<int64>();
+		fileInfo.path = reader.ReadString(RAW_STATE_PATH_SIZE);
+		fileInfo.stream = (fileInfo.descPtr == 0) ? OpenInternal(fileInfo.flags, fileInfo.path.c_str()) : nullptr;
+		if(fileInfo.stream)
+		{
+			fileInfo.stream->Seek(position, Framework::STREAM_SEEK_SET);
+		}
+		m_files[id] = std::move(fileInfo);
+
+		maxFileId = std::max(maxFileId, id);
+	}
+	reader.Skip((RAW_STATE_MAX_FILES - fileCount) * RAW_STATE_FILE_SIZE);
+	m_nextFileHandle = maxFileId + 1;
+}
+
+void CIoman::LoadUserDevicesRawState(CRawStateReader& reader)
+{
+	m_userDevices.clear();
+
+	uint32 deviceCount = reader.Read<uint32>();
+	if(deviceCount > RAW_STATE_MAX_USER_DEVICES)
+	{
+		throw std::runtime_error("Invalid user device count.");
+	}
+
+	for(uint32 i = 0; i < deviceCount; i++)
+	{
+		auto name = reader.ReadString(RAW_STATE_NAME_SIZE);
+		m_userDevices[name] = reader.Read<uint32>();
+	}
+	reader.Skip((RAW_STATE_MAX_USER_DEVICES - deviceCount) * RAW_STATE_USER_DEVICE_SIZE);
+}
+
+void CIoman::LoadMountedDevicesRawState(CRawStateReader& reader)
+{
+	std::experimental::erase_if(m_devices,
+	                            [this](const auto& devicePair) {
+		                            return (m_mountedDevices.find(devicePair.first) != std::end(m_mountedDevices));
+	                            });
+	m_mountedDevices.clear();
+
+	uint32 deviceCount = reader.Read<uint32>();
+	if(deviceCount > RAW_STATE_MAX_MOUNTED_DEVICES)
+	{
+		throw std::runtime_error("Invalid mounted device count.");
+	}
+
+	for(uint32 i = 0; i < deviceCount; i++)
+	{
+		auto name = reader.ReadString(RAW_STATE_NAME_SIZE);
+		auto path = reader.ReadString(RAW_STATE_PATH_SIZE);
+		Mount(name.c_str(), path.c_str());
+	}
+	reader.Skip((RAW_STATE_MAX_MOUNTED_DEVICES - deviceCount) * RAW_STATE_MOUNTED_DEVICE_SIZE);
+}
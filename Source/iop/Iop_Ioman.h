@@ -42,6 +42,9 @@ namespace Iop
 
 		void SaveState(Framework::CZipArchiveWriter&) const override;
 		void LoadState(Framework::CZipArchiveReader&) override;
+		size_t GetRawStateSize() const override;
+		void SaveRawState(CRawStateWriter&) const override;
+		void LoadRawState(CRawStateReader&) override;
 
 		void RegisterDevice(const char*, const Ioman::DevicePtr&);
 
@@ -137,6 +140,22 @@ namespace Iop
 		typedef std::map<std::string, uint32> UserDeviceMapType;
 		typedef std::map<std::string, std::string> MountedDeviceMapType;
 
+		enum
+		{
+			RAW_STATE_MAX_FILES = 0x20,
+			RAW_STATE_MAX_MOUNTED_DEVICES = 8,
+			RAW_STATE_MAX_USER_DEVICES = 8,
+			RAW_STATE_NAME_SIZE = 0x20,
+			RAW_STATE_PATH_SIZE = 0x400,
+		};
+
+		enum
+		{
+			RAW_STATE_FILE_SIZE = sizeof(int32) + sizeof(uint32) + sizeof(uint32) + sizeof(int64) + RAW_STATE_PATH_SIZE,
+			RAW_STATE_MOUNTED_DEVICE_SIZE = RAW_STATE_NAME_SIZE + RAW_STATE_PATH_SIZE,
+			RAW_STATE_USER_DEVICE_SIZE = RAW_STATE_NAME_SIZE + sizeof(uint32),
+		};
+
 		void PrepareOpenThunk();
 		Framework::CStream* OpenInternal(uint32, const char*);
 		int32 AllocateFileHandle();
@@ -158,6 +177,14 @@ namespace Iop
 		void LoadUserDevicesState(Framework::CZipArchiveReader&);
 		void LoadMountedDevicesState(Framework::CZipArchiveReader&);
 
+		void SaveFilesRawState(CRawStateWriter&) const;
+		void SaveUserDevicesRawState(CRawStateWriter&) const;
+		void SaveMountedDevicesRawState(CRawStateWriter&) const;
+
+		void LoadFilesRawState(CRawStateReader&);
+		void LoadUserDevicesRawState(CRawStateReader&);
+		void LoadMountedDevicesRawState(CRawStateReader&);
+
 		FileMapType m_files;
 		DirectoryMapType m_directories;
 		DeviceMapType m_devices;
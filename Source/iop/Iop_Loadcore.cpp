@@ -147,6 +147,21 @@ void CLoadcore::SaveState(Framework::CZipArchiveWriter& archive) const
 	archive.InsertFile(std::move(registerFile));
 }
 
+size_t CLoadcore::GetRawStateSize() const
+{
+	return sizeof(m_moduleVersion);
+}
+
+void CLoadcore::SaveRawState(CRawStateWriter& writer) const
+{
+	writer.Write(m_moduleVersion);
+}
+
+void CLoadcore::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_moduleVersion);
+}
+
 void CLoadcore::SetLoadExecutableHandler(const LoadExecutableHandler& loadExecutableHandler)
 {
 	m_loadExecutableHandler = loadExecutableHandler;
@@ -1175,6 +1175,21 @@ void CMcServ::SaveState(Framework::CZipArchiveWriter& archive) const
 	archive.InsertFile(std::move(stateFile));
 }
 
+size_t CMcServ::GetRawStateSize() const
+{
+	return sizeof(m_knownMemoryCards);
+}
+
+void CMcServ::SaveRawState(CRawStateWriter& writer) const
+{
+	writer.Write(m_knownMemoryCards);
+}
+
+void CMcServ::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_knownMemoryCards);
+}
+
 /////////////////////////////////////////////
 //CPathFinder Implementation
 /////////////////////////////////////////////
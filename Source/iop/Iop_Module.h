@@ -3,6 +3,7 @@
 #include <string>
 #include <memory>
 #include "../MIPS.h"
+#include "../states/RawState.h"
 
 namespace Framework
 {
@@ -23,6 +24,14 @@ namespace Iop
 		virtual void SaveState(Framework::CZipArchiveWriter&) const {};
 		virtual void LoadState(Framework::CZipArchiveReader&){};
 
+		//Raw states have the same size for the lifetime of a module
+		virtual size_t GetRawStateSize() const
+		{
+			return 0;
+		}
+		virtual void SaveRawState(CRawStateWriter&) const {};
+		virtual void LoadRawState(CRawStateReader&){};
+
 		static std::string PrintStringParameter(const uint8*, uint32);
 	};
 
@@ -94,6 +94,23 @@ void CPadMan::LoadState(Framework::CZipArchiveReader& archive)
 	m_padDataType = static_cast<PAD_DATA_TYPE>(registerFile.GetRegister32(STATE_PADDATA_TYPE));
 }
 
+size_t CPadMan::GetRawStateSize() const
+{
+	return sizeof(m_padDataAddress) + sizeof(m_padDataType);
+}
+
+void CPadMan::SaveRawState(CRawStateWriter& writer) const
+{
+	writer.Write(m_padDataAddress);
+	writer.Write(m_padDataType);
+}
+
+void CPadMan::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_padDataAddress);
+	reader.Read(m_padDataType);
+}
+
 void CPadMan::SetButtonState(unsigned int padNumber, CControllerInfo::BUTTON button, bool pressed, uint8* ram)
 {
 	if(padNumber >= MAX_PADS) return;
@@ -26,6 +26,9 @@ namespace Iop
 		bool Invoke(uint32, uint32*, uint32, uint32*, uint32, uint8*) override;
 		void SaveState(Framework::CZipArchiveWriter&) const override;
 		void LoadState(Framework::CZipArchiveReader&) override;
+		size_t GetRawStateSize() const override;
+		void SaveRawState(CRawStateWriter&) const override;
+		void LoadRawState(CRawStateReader&) override;
 		void SetButtonState(unsigned int, PS2::CControllerInfo::BUTTON, bool, uint8*) override;
 		void SetAxisState(unsigned int, PS2::CControllerInfo::BUTTON, uint8, uint8*) override;
 		void GetVibration(unsigned int padId, uint8& largeMotor, uint8& smallMotor) override{};
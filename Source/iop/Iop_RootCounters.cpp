@@ -112,6 +112,21 @@ void CRootCounters::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(std::move(registerFile));
 }
 
+size_t CRootCounters::GetRawStateSize() const
+{
+	return sizeof(m_counter);
+}
+
+void CRootCounters::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_counter);
+}
+
+void CRootCounters::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_counter);
+}
+
 void CRootCounters::Update(unsigned int ticks)
 {
 	for(unsigned int i = 0; i < MAX_COUNTERS; i++)
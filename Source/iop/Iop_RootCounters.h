@@ -4,6 +4,7 @@
 #include "Convertible.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 
 namespace Iop
 {
@@ -35,6 +36,10 @@ namespace Iop
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&);
 
+		size_t GetRawStateSize() const;
+		void LoadRawState(CRawStateReader&);
+		void SaveRawState(CRawStateWriter&);
+
 		void Update(unsigned int);
 
 		uint32 ReadRegister(uint32);
@@ -1,4 +1,5 @@
 #include <cstring>
+#include <stdexcept>
 #include "Iop_SifCmd.h"
 #include "IopBios.h"
 #include "../Ps2Const.h"
@@ -97,6 +98,47 @@ void CSifCmd::LoadState(Framework::CZipArchiveReader& archive)
 	}
 }
 
+size_t CSifCmd::GetRawStateSize() const
+{
+	return sizeof(uint32) + (RAW_STATE_MAX_SERVERS * sizeof(uint32));
+}
+
+void CSifCmd::SaveRawState(CRawStateWriter& writer) const
+{
+	uint32 serverCount = static_cast<uint32>(m_servers.size());
+	if(serverCount > RAW_STATE_MAX_SERVERS)
+	{
+		throw std::runtime_error("Too many SIF servers for raw state.");
+	}
+	writer.Write(serverCount);
+	for(const auto& module : m_servers)
+	{
+		writer.Write(module->GetServerDataAddress());
+	}
+	writer.Skip((RAW_STATE_MAX_SERVERS - serverCount) * sizeof(uint32));
+}
+
+void CSifCmd::LoadRawState(CRawStateReader& reader)
+{
+	//Same as LoadState, servers must have been cleared by CIopBios::PreLoadState
+	assert(m_servers.empty());
+
+	uint32 serverCount = reader.Read<uint32>();
+	if(serverCount > RAW_STATE_MAX_SERVERS)
+	{
+		throw std::runtime_error("Invalid SIF server count.");
+	}
+	for(uint32 i = 0; i < serverCount; i++)
+	{
+		uint32 serverDataAddress = reader.Read<uint32>();
+		auto serverData = reinterpret_cast<SIFRPCSERVERDATA*>(m_ram + serverDataAddress);
+		auto module = std::make_unique<CSifDynamic>(*this, serverDataAddress);
+		m_sifMan.RegisterModule(serverData->serverId, module.get());
+		m_servers.push_back(std::move(module));
+	}
+	reader.Skip((RAW_STATE_MAX_SERVERS - serverCount) * sizeof(uint32));
+}
+
 void CSifCmd::SaveState(Framework::CZipArchiveWriter& archive) const
 {
 	auto modulesFile = std::make_unique<CRegisterStateCollectionFile>(STATE_MODULES);
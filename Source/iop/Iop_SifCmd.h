@@ -61,6 +61,9 @@ namespace Iop
 
 		void LoadState(Framework::CZipArchiveReader&) override;
 		void SaveState(Framework::CZipArchiveWriter&) const override;
+		size_t GetRawStateSize() const override;
+		void SaveRawState(CRawStateWriter&) const override;
+		void LoadRawState(CRawStateReader&) override;
 
 		void SifBindRpc(CMIPS&);
 		void SifCallRpc(CMIPS&);
@@ -85,6 +88,7 @@ namespace Iop
 			MAX_SREG = 0x20,
 			TRAMPOLINE_SIZE = 0x800,
 			PENDING_CMD_BUFFER_SIZE = 0x400,
+			RAW_STATE_MAX_SERVERS = 0x40,
 		};
 
 		struct MODULEDATA
@@ -1,5 +1,6 @@
 #include <cassert>
 #include <cstring>
+#include <stdexcept>
 #include <vector>
 #include "Iop_Sio2.h"
 #include "Log.h"
@@ -119,6 +120,62 @@ void CSio2::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_OUTPUT, outputBuffer.data(), outputBuffer.size()));
 }
 
+size_t CSio2::GetRawStateSize() const
+{
+	return sizeof(m_currentRegIndex) + sizeof(m_stat6C) + sizeof(m_regs) + sizeof(m_ctrl1) + sizeof(m_ctrl2) +
+	       sizeof(m_padState) + (2 * (sizeof(uint32) + RAW_STATE_BUFFER_SIZE));
+}
+
+void CSio2::LoadRawState(CRawStateReader& reader)
+{
+	static const auto readBuffer =
+	    [](ByteBufferType& buffer, CRawStateReader& reader) {
+		    uint32 size = reader.Read<uint32>();
+		    if(size > RAW_STATE_BUFFER_SIZE)
+		    {
+			    throw std::runtime_error("Invalid SIO2 buffer size.");
+		    }
+		    auto data = reader.GetCurrentPointer();
+		    buffer.assign(data, data + size);
+		    reader.Skip(RAW_STATE_BUFFER_SIZE);
+	    };
+
+	reader.Read(m_currentRegIndex);
+	reader.Read(m_stat6C);
+	reader.Read(m_regs);
+	reader.Read(m_ctrl1);
+	reader.Read(m_ctrl2);
+	reader.Read(m_padState);
+	readBuffer(m_inputBuffer, reader);
+	readBuffer(m_outputBuffer, reader);
+}
+
+void CSio2::SaveRawState(CRawStateWriter& writer)
+{
+	static const auto writeBuffer =
+	    [](const ByteBufferType& buffer, CRawStateWriter& writer) {
+		    if(buffer.size() > RAW_STATE_BUFFER_SIZE)
+		    {
+			    throw std::runtime_error("SIO2 buffer doesn't fit in raw state record.");
+		    }
+		    writer.Write(static_cast<uint32>(buffer.size()));
+		    for(auto value : buffer)
+		    {
+			    writer.Write(value);
+		    }
+		    writer.Skip(RAW_STATE_BUFFER_SIZE - buffer.size());
+	    };
+
+	writer.Write(m_currentRegIndex);
+	writer.Write(m_stat6C);
+	writer.Write(m_regs);
+	writer.Write(m_ctrl1);
+	writer.Write(m_ctrl2);
+	writer.Write(m_padState);
+	writeBuffer(m_inputBuffer, writer);
+	writeBuffer(m_outputBuffer, writer);
+}
+
 void CSio2::SetButtonState(unsigned int padNumber, PS2::CControllerInfo::BUTTON button, bool pressed, uint8* ram)
 {
 	if(padNumber >= MAX_PADS) return;
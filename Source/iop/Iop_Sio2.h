@@ -3,6 +3,7 @@
 #include "Types.h"
 #include "Iop_Intc.h"
 #include "../PadInterface.h"
+#include "../states/RawState.h"
 #include <deque>
 #include <array>
 
@@ -25,6 +26,10 @@ namespace Iop
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&);
 
+		size_t GetRawStateSize() const;
+		void LoadRawState(CRawStateReader&);
+		void SaveRawState(CRawStateWriter&);
+
 		uint32 ReadRegister(uint32);
 		void WriteRegister(uint32, uint32);
 
@@ -67,6 +72,11 @@ namespace Iop
 			MAX_PORTS = 4
 		};
 
+		enum
+		{
+			RAW_STATE_BUFFER_SIZE = 0x2000,
+		};
+
 		struct PADSTATE
 		{
 			bool configMode;
@@ -5,11 +5,18 @@
 #include <algorithm>
 #include "string_format.h"
 #include "Log.h"
+#include "SimdDefs.h"
 #include "../states/RegisterStateCollectionFile.h"
 #include "../states/RegisterStateUtils.h"
 #include "../states/RegisterStateFile.h"
 #include "Iop_SpuBase.h"
 
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
 using namespace Iop;
 
 #define INIT_SAMPLE_RATE (44100)
@@ -334,6 +341,71 @@ void CSpuBase::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(std::move(stateCollectionFile));
 }
 
+size_t CSpuBase::GetRawStateSize() const
+{
+	size_t size = sizeof(m_ctrl) + sizeof(m_irqAddr) + sizeof(m_irqPending) + sizeof(m_transferMode) + sizeof(m_transferAddr) +
+	              sizeof(m_core0OutputOffset) + sizeof(m_channelOn) + sizeof(m_channelReverb) + sizeof(m_reverbWorkAddrStart) +
+	              sizeof(m_reverbWorkAddrEnd) + sizeof(m_reverbCurrAddr) + sizeof(m_inputVolL) + sizeof(m_inputVolR) +
+	              sizeof(m_extInputVolL) + sizeof(m_extInputVolR) + sizeof(m_reverb) + sizeof(m_channel);
+	for(const auto& sampleReader : m_reader)
+	{
+		size += sampleReader.GetRawStateSize();
+	}
+	return size;
+}
+
+void CSpuBase::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_ctrl);
+	reader.Read(m_irqAddr);
+	reader.Read(m_irqPending);
+	reader.Read(m_transferMode);
+	reader.Read(m_transferAddr);
+	reader.Read(m_core0OutputOffset);
+	reader.Read(m_channelOn);
+	reader.Read(m_channelReverb);
+	reader.Read(m_reverbWorkAddrStart);
+	reader.Read(m_reverbWorkAddrEnd);
+	reader.Read(m_reverbCurrAddr);
+	reader.Read(m_inputVolL);
+	reader.Read(m_inputVolR);
+	reader.Read(m_extInputVolL);
+	reader.Read(m_extInputVolR);
+	reader.Read(m_reverb);
+	reader.Read(m_channel);
+
+	for(auto& sampleReader : m_reader)
+	{
+		sampleReader.LoadRawState(reader);
+	}
+}
+
+void CSpuBase::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_ctrl);
+	writer.Write(m_irqAddr);
+	writer.Write(m_irqPending);
+	writer.Write(m_transferMode);
+	writer.Write(m_transferAddr);
+	writer.Write(m_core0OutputOffset);
+	writer.Write(m_channelOn);
+	writer.Write(m_channelReverb);
+	writer.Write(m_reverbWorkAddrStart);
+	writer.Write(m_reverbWorkAddrEnd);
+	writer.Write(m_reverbCurrAddr);
+	writer.Write(m_inputVolL);
+	writer.Write(m_inputVolR);
+	writer.Write(m_extInputVolL);
+	writer.Write(m_extInputVolR);
+	writer.Write(m_reverb);
+	writer.Write(m_channel);
+
+	for(const auto& sampleReader : m_reader)
+	{
+		sampleReader.SaveRawState(writer);
+	}
+}
+
 bool CSpuBase::IsEnabled() const
 {
 	return (m_ctrl & 0x8000) != 0;
@@ -714,62 +786,84 @@ void CSpuBase::MixSamples(int32 inputSample, int32 volumeLevel, int16* output)
 	*output = static_cast<int16>(resultSample);
 }
 
+void CSpuBase::MixSampleBlock(int16* dst, const int16* src, unsigned int sampleCount)
+{
+	//Saturating adds, same results as MixSamples given that src values are already scaled by volume
+	unsigned int i = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	for(; (i + 8) <= sampleCount; i += 8)
+	{
+		__m128i dstValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+		__m128i srcValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_adds_epi16(dstValues, srcValues));
+	}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	for(; (i + 8) <= sampleCount; i += 8)
+	{
+		int16x8_t dstValues = vld1q_s16(dst + i);
+		int16x8_t srcValues = vld1q_s16(src + i);
+		vst1q_s16(dst + i, vqaddq_s16(dstValues, srcValues));
+	}
+#endif
+	for(; i < sampleCount; i++)
+	{
+		int32 resultSample = static_cast<int32>(dst[i]) + static_cast<int32>(src[i]);
+		dst[i] = static_cast<int16>(std::clamp<int32>(resultSample, SHRT_MIN, SHRT_MAX));
+	}
+}
+
+void CSpuBase::SetBatchedRenderEnabled(bool enabled)
+{
+	m_batchedRenderEnabled = enabled;
+}
+
 void CSpuBase::Render(int16* samples, unsigned int sampleCount)
 {
 	bool updateReverb = m_reverbEnabled && (m_ctrl & CONTROL_REVERB) && (m_reverbWorkAddrStart < m_reverbWorkAddrEnd);
 	bool irqEnabled = (m_ctrl & CONTROL_IRQ);
 
-	int16* samplesBase = samples;
 	assert((sampleCount & 0x01) == 0);
-	unsigned int ticks = sampleCount / 2;
 	memset(samples, 0, sizeof(int16) * sampleCount);
 
+	if(m_batchedRenderEnabled)
+	{
+		RenderBatched(samples, sampleCount, updateReverb, irqEnabled);
+	}
+	else
+	{
+		RenderScalar(samples, sampleCount, updateReverb, irqEnabled);
+	}
+
+	if(irqEnabled && m_irqWatcher->HasPendingIrq(m_spuNumber))
+	{
+		m_irqPending = true;
+	}
+	m_irqWatcher->ClearIrqPending(m_spuNumber);
+
+	if(m_volumeAdjust != 1.0f)
+	{
+		for(int i = 0; i < sampleCount; i++)
+		{
+			float adjustedSample = static_cast<float>(samples[i]) * m_volumeAdjust;
+			adjustedSample = std::clamp<float>(adjustedSample, SHRT_MIN, SHRT_MAX);
+			samples[i] = static_cast<int16>(adjustedSample);
+		}
+	}
+}
+
+void CSpuBase::RenderScalar(int16* samples, unsigned int sampleCount, bool updateReverb, bool irqEnabled)
+{
+	unsigned int ticks = sampleCount / 2;
 	for(unsigned int j = 0; j < ticks; j++)
 	{
 		int16 reverbSample[2] = {};
 		//Update channels
-		for(unsigned int i = 0; i < 24; i++)
+		for(unsigned int i = 0; i < MAX_CHANNEL; i++)
 		{
-			auto& channel(m_channel[i]);
-			auto& reader(m_reader[i]);
-			if(channel.status == KEY_ON)
-			{
-				reader.SetParamsRead(channel.address, channel.repeat);
-				reader.ClearEndFlag();
-				channel.status = ATTACK;
-				channel.adsrVolume = 0;
-			}
-			else
-			{
-				if(reader.IsDone())
-				{
-					channel.status = STOPPED;
-					channel.adsrVolume = 0;
-					reader.ClearIsDone();
-				}
-				if(reader.DidChangeRepeat() && !channel.repeatSet)
-				{
-					channel.repeat = reader.GetRepeat();
-					reader.ClearDidChangeRepeat();
-				}
-				//Update repeat in case it has been changed externally (needed for FFX)
-				reader.SetRepeat(channel.repeat);
-			}
-
-			int32 readSample = reader.GetSample();
-			channel.current = reader.GetCurrent();
-
-			UpdateAdsr(channel);
-			channel.volumeLeftAbs = ComputeChannelVolume(channel.volumeLeft, channel.volumeLeftAbs);
-			channel.volumeRightAbs = ComputeChannelVolume(channel.volumeRight, channel.volumeRightAbs);
-
-			if(readSample == 0) continue;
-
-			//Mix in adsrVolume
-			int32 inputSample = (readSample * static_cast<int32>(channel.adsrVolume >> 16)) / static_cast<int32>(MAX_ADSR_VOLUME >> 16);
-
+			int32 inputSample = UpdateChannel(i);
 			if(inputSample == 0) continue;
 
+			const auto& channel(m_channel[i]);
 			int32 volumeLeft = channel.volumeLeftAbs >> 16;
 			int32 volumeRight = channel.volumeRightAbs >> 16;
 
@@ -784,78 +878,155 @@ void CSpuBase::Render(int16* samples, unsigned int sampleCount)
 			}
 		}
 
-		if(!m_blockReader.CanReadSamples() && (m_blockWritePtr == SOUND_INPUT_DATA_SIZE))
-		{
-			//We're ready to consume some data
-			m_blockReader.FillBlock(m_ram + m_soundInputDataAddr);
-			m_blockWritePtr = 0;
-		}
+		UpdateTickOutput(samples, reverbSample, updateReverb, irqEnabled);
+		samples += 2;
+	}
+}
 
-		if(m_blockReader.CanReadSamples())
-		{
-			int32 blockSamples[2] = {};
-			m_blockReader.GetSamples(blockSamples);
+void CSpuBase::RenderBatched(int16* samples, unsigned int sampleCount, bool updateReverb, bool irqEnabled)
+{
+	//Channels don't depend on each other, so each channel is run over a whole batch of
+	//samples before moving on to the next one. Channel outputs are then mixed in channel
+	//order with saturating adds, giving the same results as mixing them sample by sample.
+	int16 channelSamples[RENDER_BATCH_SAMPLES];
+	int16 reverbSamples[RENDER_BATCH_SAMPLES];
+
+	for(unsigned int batchStart = 0; batchStart < sampleCount; batchStart += RENDER_BATCH_SAMPLES)
+	{
+		unsigned int batchSize = std::min<unsigned int>(sampleCount - batchStart, RENDER_BATCH_SAMPLES);
+		unsigned int batchTicks = batchSize / 2;
+		int16* batchOutput = samples + batchStart;
 
-			// Audio input data should have volume adjusted to BVOL register values . . .
-			if(m_spuNumber == 0 && m_blockReader.GetSpdifBypass())
+		memset(reverbSamples, 0, sizeof(int16) * batchSize);
+
+		for(unsigned int i = 0; i < MAX_CHANNEL; i++)
+		{
+			const auto& channel(m_channel[i]);
+			bool hasOutput = false;
+			for(unsigned int j = 0; j < batchTicks; j++)
 			{
-				//  . . . unless in bypass mode
-				MixSamples(blockSamples[0], 0x7FFF, samples + 0);
-				MixSamples(blockSamples[1], 0x7FFF, samples + 1);
+				int32 inputSample = UpdateChannel(i);
+				int32 outputLeft = (inputSample * (channel.volumeLeftAbs >> 16)) / 0x7FFF;
+				int32 outputRight = (inputSample * (channel.volumeRightAbs >> 16)) / 0x7FFF;
+				assert((outputLeft >= SHRT_MIN) && (outputLeft <= SHRT_MAX));
+				assert((outputRight >= SHRT_MIN) && (outputRight <= SHRT_MAX));
+				channelSamples[(j * 2) + 0] = static_cast<int16>(outputLeft);
+				channelSamples[(j * 2) + 1] = static_cast<int16>(outputRight);
+				hasOutput |= (inputSample != 0);
 			}
-			else
+
+			if(!hasOutput) continue;
+
+			MixSampleBlock(batchOutput, channelSamples, batchSize);
+			if(updateReverb && (m_channelReverb.f & (1 << i)))
 			{
-				MixSamples(blockSamples[0], m_inputVolL, samples + 0);
-				MixSamples(blockSamples[1], m_inputVolR, samples + 1);
+				MixSampleBlock(reverbSamples, channelSamples, batchSize);
 			}
 		}
 
-		//Simulate SPU CORE0 writing its output in RAM and check for potential interrupts
-		if(m_spuNumber == 0)
+		for(unsigned int j = 0; j < batchTicks; j++)
 		{
-			if(irqEnabled)
-			{
-				//TODO: Check which core is responsible for which area
-				if(m_irqAddr == (CORE0_SIN_LEFT + m_core0OutputOffset))
-				{
-					m_irqPending = true;
-				}
-				else if(m_irqAddr == (CORE1_SIN_LEFT + m_core0OutputOffset))
-				{
-					m_irqPending = true;
-				}
-				else if(m_irqAddr == (CORE1_SIN_RIGHT + m_core0OutputOffset))
-				{
-					m_irqPending = true;
-				}
-			}
-			m_core0OutputOffset += 2;
-			m_core0OutputOffset &= (CORE0_OUTPUT_SIZE - 1);
+			UpdateTickOutput(batchOutput + (j * 2), reverbSamples + (j * 2), updateReverb, irqEnabled);
 		}
+	}
+}
 
-		//Update reverb
-		if(updateReverb)
+int32 CSpuBase::UpdateChannel(unsigned int channelIndex)
+{
+	auto& channel(m_channel[channelIndex]);
+	auto& reader(m_reader[channelIndex]);
+	if(channel.status == KEY_ON)
+	{
+		reader.SetParamsRead(channel.address, channel.repeat);
+		reader.ClearEndFlag();
+		channel.status = ATTACK;
+		channel.adsrVolume = 0;
+	}
+	else
+	{
+		if(reader.IsDone())
+		{
+			channel.status = STOPPED;
+			channel.adsrVolume = 0;
+			reader.ClearIsDone();
+		}
+		if(reader.DidChangeRepeat() && !channel.repeatSet)
 		{
-			UpdateReverb(reverbSample, samples);
+			channel.repeat = reader.GetRepeat();
+			reader.ClearDidChangeRepeat();
 		}
+		//Update repeat in case it has been changed externally (needed for FFX)
+		reader.SetRepeat(channel.repeat);
+	}
 
-		samples += 2;
+	int32 readSample = reader.GetSample();
+	channel.current = reader.GetCurrent();
+
+	UpdateAdsr(channel);
+	channel.volumeLeftAbs = ComputeChannelVolume(channel.volumeLeft, channel.volumeLeftAbs);
+	channel.volumeRightAbs = ComputeChannelVolume(channel.volumeRight, channel.volumeRightAbs);
+
+	if(readSample == 0) return 0;
+
+	//Mix in adsrVolume
+	return (readSample * static_cast<int32>(channel.adsrVolume >> 16)) / static_cast<int32>(MAX_ADSR_VOLUME >> 16);
+}
+
+void CSpuBase::UpdateTickOutput(int16* samples, int16* reverbSample, bool updateReverb, bool irqEnabled)
+{
+	if(!m_blockReader.CanReadSamples() && (m_blockWritePtr == SOUND_INPUT_DATA_SIZE))
+	{
+		//We're ready to consume some data
+		m_blockReader.FillBlock(m_ram + m_soundInputDataAddr);
+		m_blockWritePtr = 0;
 	}
 
-	if(irqEnabled && m_irqWatcher->HasPendingIrq(m_spuNumber))
+	if(m_blockReader.CanReadSamples())
 	{
-		m_irqPending = true;
+		int32 blockSamples[2] = {};
+		m_blockReader.GetSamples(blockSamples);
+
+		// Audio input data should have volume adjusted to BVOL register values . . .
+		if(m_spuNumber == 0 && m_blockReader.GetSpdifBypass())
+		{
+			//  . . . unless in bypass mode
+			MixSamples(blockSamples[0], 0x7FFF, samples + 0);
+			MixSamples(blockSamples[1], 0x7FFF, samples + 1);
+		}
+		else
+		{
+			MixSamples(blockSamples[0], m_inputVolL, samples + 0);
+			MixSamples(blockSamples[1], m_inputVolR, samples + 1);
+		}
 	}
-	m_irqWatcher->ClearIrqPending(m_spuNumber);
 
-	if(m_volumeAdjust != 1.0f)
+	//Simulate SPU CORE0 writing its output in RAM and check for potential interrupts
+	if(m_spuNumber == 0)
 	{
-		for(int i = 0; i < sampleCount; i++)
+		if(irqEnabled)
 		{
-			float adjustedSample = static_cast<float>(samplesBase[i]) * m_volumeAdjust;
-			adjustedSample = std::clamp<float>(adjustedSample, SHRT_MIN, SHRT_MAX);
-			samplesBase[i] = static_cast<int16>(adjustedSample);
+			//TODO: Check which core is responsible for which area
+			if(m_irqAddr == (CORE0_SIN_LEFT + m_core0OutputOffset))
+			{
+				m_irqPending = true;
+			}
+			else if(m_irqAddr == (CORE1_SIN_LEFT + m_core0OutputOffset))
+			{
+				m_irqPending = true;
+			}
+			else if(m_irqAddr == (CORE1_SIN_RIGHT + m_core0OutputOffset))
+			{
+				m_irqPending = true;
+			}
 		}
+		m_core0OutputOffset += 2;
+		m_core0OutputOffset &= (CORE0_OUTPUT_SIZE - 1);
+	}
+
+	//Update reverb
+	if(updateReverb)
+	{
+		UpdateReverb(reverbSample, samples);
 	}
 }
 
@@ -1136,39 +1307,126 @@ void CSpuBase::UpdateReverb(int16 reverbSample[2], int16* samples)
 // CSpuSampleCache
 ///////////////////////////////////////////////////////
 
+CSpuSampleCache::CSpuSampleCache()
+    : m_buckets(BUCKET_COUNT)
+    , m_items(BUCKET_COUNT * BUCKET_WAYS)
+{
+	static_assert(sizeof(BUCKET) == 64, "Bucket must fit in a cache line.");
+	static_assert((BUCKET_COUNT & (BUCKET_COUNT - 1)) == 0, "Bucket count must be a power of 2.");
+	static_assert(BUCKET_WAYS <= 8, "Bucket ways must fit in valid mask.");
+	Clear();
+}
+
+uint32 CSpuSampleCache::GetBlockIndex(uint32 address)
+{
+	return (address & (MAX_RAM_SIZE - 1)) / BLOCK_SIZE;
+}
+
 const CSpuSampleCache::ITEM* CSpuSampleCache::GetItem(const KEY& key) const
 {
-	auto range = m_cache.equal_range(key.address);
-	for(auto itemIterator = range.first; itemIterator != range.second; itemIterator++)
+	uint32 bucketIndex = GetBlockIndex(key.address) & (BUCKET_COUNT - 1);
+	const auto& bucket = m_buckets[bucketIndex];
+	for(unsigned int way = 0; way < BUCKET_WAYS; way++)
 	{
-		const auto& item = itemIterator->second;
-		if((item.inS1 == key.s1) && (item.inS2 == key.s2))
+		if(!(bucket.validMask & (1 << way))) continue;
+		const auto& itemKey = bucket.keys[way];
+		if((itemKey.address == key.address) && (itemKey.s1 == key.s1) && (itemKey.s2 == key.s2))
 		{
-			return &item;
+			m_stats.hits++;
+			return &m_items[(bucketIndex * BUCKET_WAYS) + way];
 		}
 	}
+	m_stats.misses++;
 	return nullptr;
 }
 
 CSpuSampleCache::ITEM& CSpuSampleCache::RegisterItem(const KEY& key)
 {
-	auto result = m_cache.emplace(std::make_pair(key.address, ITEM()));
-	auto& item = result->second;
-	item.inS1 = key.s1;
-	item.inS2 = key.s2;
-	return item;
+	uint32 blockIndex = GetBlockIndex(key.address);
+	uint32 bucketIndex = blockIndex & (BUCKET_COUNT - 1);
+	auto& bucket = m_buckets[bucketIndex];
+
+	unsigned int way = 0;
+	for(; way < BUCKET_WAYS; way++)
+	{
+		if(!(bucket.validMask & (1 << way))) break;
+	}
+
+	if(way == BUCKET_WAYS)
+	{
+		//Bucket is full, replace entries in round robin order.
+		//Bitmap entry of the evicted block is left as is, it will get cleaned up on next invalidation.
+		way = bucket.nextVictim;
+		bucket.nextVictim = (bucket.nextVictim + 1) % BUCKET_WAYS;
+		m_stats.evictions++;
+	}
+
+	bucket.keys[way] = key;
+	bucket.validMask |= (1 << way);
+	m_blockBitmap[blockIndex / BITMAP_WORD_BITS] |= (1ULL << (blockIndex % BITMAP_WORD_BITS));
+	return m_items[(bucketIndex * BUCKET_WAYS) + way];
 }
 
 void CSpuSampleCache::Clear()
 {
-	m_cache.clear();
+	for(auto& bucket : m_buckets)
+	{
+		bucket.validMask = 0;
+		bucket.nextVictim = 0;
+	}
+	memset(m_blockBitmap, 0, sizeof(m_blockBitmap));
 }
 
 void CSpuSampleCache::ClearRange(uint32 address, uint32 size)
 {
-	auto lowerBound = m_cache.lower_bound(address);
-	auto upperBound = m_cache.upper_bound(address + size);
-	m_cache.erase(lowerBound, upperBound);
+	//Invalidate every block that overlaps with [address, address + size]
+	uint32 firstBlock = GetBlockIndex(address);
+	uint32 lastBlock = std::min<uint32>(firstBlock + (((address % BLOCK_SIZE) + size) / BLOCK_SIZE), BLOCK_COUNT - 1);
+	uint32 blockIndex = firstBlock;
+	while(blockIndex <= lastBlock)
+	{
+		uint32 wordIndex = blockIndex / BITMAP_WORD_BITS;
+		uint32 wordBase = wordIndex * BITMAP_WORD_BITS;
+		uint32 wordEnd = std::min<uint32>(wordBase + BITMAP_WORD_BITS - 1, lastBlock);
+		uint64 word = m_blockBitmap[wordIndex];
+		//Skip over chunks that have nothing cached
+		if(word != 0)
+		{
+			for(uint32 i = blockIndex; i <= wordEnd; i++)
+			{
+				uint64 bit = 1ULL << (i - wordBase);
+				if(word & bit)
+				{
+					InvalidateBlock(i);
+					word &= ~bit;
+				}
+			}
+			m_blockBitmap[wordIndex] = word;
+		}
+		blockIndex = wordEnd + 1;
+	}
+}
+
+void CSpuSampleCache::InvalidateBlock(uint32 blockIndex)
+{
+	auto& bucket = m_buckets[blockIndex & (BUCKET_COUNT - 1)];
+	for(unsigned int way = 0; way < BUCKET_WAYS; way++)
+	{
+		if(!(bucket.validMask & (1 << way))) continue;
+		if(GetBlockIndex(bucket.keys[way].address) != blockIndex) continue;
+		bucket.validMask &= ~(1 << way);
+		m_stats.invalidations++;
+	}
+}
+
+const CSpuSampleCache::STATS& CSpuSampleCache::GetStats() const
+{
+	return m_stats;
+}
+
+void CSpuSampleCache::ResetStats()
+{
+	m_stats = STATS();
 }
 
 ///////////////////////////////////////////////////////
@@ -1203,6 +1461,23 @@ void CSpuIrqWatcher::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(std::move(registerFile));
 }
 
+size_t CSpuIrqWatcher::GetRawStateSize() const
+{
+	return sizeof(m_irqAddr) + sizeof(m_irqPending);
+}
+
+void CSpuIrqWatcher::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_irqAddr);
+	reader.Read(m_irqPending);
+}
+
+void CSpuIrqWatcher::SaveRawState(CRawStateWriter& writer)
+{
+	writer.Write(m_irqAddr);
+	writer.Write(m_irqPending);
+}
+
 void CSpuIrqWatcher::SetIrqAddress(int core, uint32 address)
 {
 	m_irqAddr[core] = address;
@@ -1313,6 +1588,47 @@ void CSpuBase::CSampleReader::SaveState(CRegisterState& channelState) const
 	RegisterStateUtils::WriteArray(channelState, m_buffer, STATE_SAMPLEREADER_REGS_BUFFER_FORMAT);
 }
 
+size_t CSpuBase::CSampleReader::GetRawStateSize() const
+{
+	return sizeof(m_srcSampleIdx) + sizeof(m_srcSamplingRate) + sizeof(m_nextSampleAddr) + sizeof(m_repeatAddr) +
+	       sizeof(m_pitch) + sizeof(m_s1) + sizeof(m_s2) + sizeof(m_done) + sizeof(m_nextValid) + sizeof(m_endFlag) +
+	       sizeof(m_didChangeRepeat) + sizeof(m_buffer);
+}
+
+void CSpuBase::CSampleReader::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_srcSampleIdx);
+	reader.Read(m_srcSamplingRate);
+	reader.Read(m_nextSampleAddr);
+	reader.Read(m_repeatAddr);
+	reader.Read(m_pitch);
+	reader.Read(m_s1);
+	reader.Read(m_s2);
+	reader.Read(m_done);
+	reader.Read(m_nextValid);
+	reader.Read(m_endFlag);
+	reader.Read(m_didChangeRepeat);
+	reader.Read(m_buffer);
+
+	UpdateSampleStep();
+}
+
+void CSpuBase::CSampleReader::SaveRawState(CRawStateWriter& writer) const
+{
+	writer.Write(m_srcSampleIdx);
+	writer.Write(m_srcSamplingRate);
+	writer.Write(m_nextSampleAddr);
+	writer.Write(m_repeatAddr);
+	writer.Write(m_pitch);
+	writer.Write(m_s1);
+	writer.Write(m_s2);
+	writer.Write(m_done);
+	writer.Write(m_nextValid);
+	writer.Write(m_endFlag);
+	writer.Write(m_didChangeRepeat);
+	writer.Write(m_buffer);
+}
+
 void CSpuBase::CSampleReader::SetParams(uint32 address, uint32 repeat)
 {
 	m_srcSampleIdx = 0;
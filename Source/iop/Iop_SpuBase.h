@@ -1,21 +1,33 @@
 #pragma once
 
-#include <map>
+#include <vector>
 #include "Types.h"
 #include "BasicUnion.h"
 #include "Convertible.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
+#include "../states/RawState.h"
 
 class CRegisterState;
 
 namespace Iop
 {
+	//Caches decoded ADPCM blocks. Entries live in a fixed-size set associative table
+	//indexed by block address, so all entries for an address share the same bucket.
+	//A bitmap tracks which blocks might have entries to make range invalidation cheap.
 	class CSpuSampleCache
 	{
 	public:
 		static constexpr int BUFFER_SAMPLES = 28;
 
+		enum
+		{
+			BLOCK_SIZE = 0x10,
+			MAX_RAM_SIZE = 0x200000,
+			BUCKET_COUNT = 0x1000,
+			BUCKET_WAYS = 4,
+		};
+
 		struct KEY
 		{
 			uint32 address;
@@ -26,19 +38,51 @@ namespace Iop
 		struct ITEM
 		{
 			int16 samples[BUFFER_SAMPLES];
-			int32 inS1;
-			int32 inS2;
 			int32 outS1;
 			int32 outS2;
 		};
 
+		struct STATS
+		{
+			uint64 hits = 0;
+			uint64 misses = 0;
+			uint64 evictions = 0;
+			uint64 invalidations = 0;
+		};
+
+		CSpuSampleCache();
+
 		const ITEM* GetItem(const KEY&) const;
 		ITEM& RegisterItem(const KEY&);
 		void Clear();
 		void ClearRange(uint32 address, uint32 size);
 
+		const STATS& GetStats() const;
+		void ResetStats();
+
 	private:
-		std::multimap<uint32, ITEM> m_cache;
+		enum
+		{
+			BLOCK_COUNT = MAX_RAM_SIZE / BLOCK_SIZE,
+			BITMAP_WORD_BITS = 64,
+			BITMAP_WORD_COUNT = BLOCK_COUNT / BITMAP_WORD_BITS,
+		};
+
+		//Keys of a bucket fit in a single cache line
+		struct alignas(64) BUCKET
+		{
+			KEY keys[BUCKET_WAYS];
+			uint8 validMask;
+			uint8 nextVictim;
+		};
+
+		static uint32 GetBlockIndex(uint32);
+		void InvalidateBlock(uint32);
+
+		std::vector<BUCKET> m_buckets;
+		std::vector<ITEM> m_items;
+		uint64 m_blockBitmap[BITMAP_WORD_COUNT];
+		mutable STATS m_stats;
 	};
 
 	class CSpuIrqWatcher
@@ -49,6 +93,10 @@ namespace Iop
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&);
 
+		size_t GetRawStateSize() const;
+		void LoadRawState(CRawStateReader&);
+		void SaveRawState(CRawStateWriter&);
+
 		void SetIrqAddress(int core, uint32 address);
 		void CheckIrq(uint32 address);
 		void ClearIrqPending(int);
@@ -214,6 +262,10 @@ namespace Iop
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&);
 
+		size_t GetRawStateSize() const;
+		void LoadRawState(CRawStateReader&);
+		void SaveRawState(CRawStateWriter&);
+
 		bool IsEnabled() const;
 
 		void SetVolumeAdjust(float);
@@ -273,6 +325,9 @@ namespace Iop
 
 		void Render(int16*, unsigned int);
 
+		//Batched rendering is the default, sample by sample rendering is kept as a reference
+		void SetBatchedRenderEnabled(bool);
+
 		static bool g_reverbParamIsAddress[REVERB_PARAM_COUNT];
 
 		uint32 m_inputVolL = 0x7FFF;
@@ -282,6 +337,7 @@ namespace Iop
 		int32 m_extInputVolR = 0x7FFF;
 
 		static void MixSamples(int32, int32, int16*);
+		static void MixSampleBlock(int16*, const int16*, unsigned int);
 
 	private:
 		enum
@@ -312,6 +368,10 @@ namespace Iop
 			void LoadState(const CRegisterState&);
 			void SaveState(CRegisterState&) const;
 
+			size_t GetRawStateSize() const;
+			void LoadRawState(CRawStateReader&);
+			void SaveRawState(CRawStateWriter&) const;
+
 			void SetParamsRead(uint32, uint32);
 			void SetParamsNoRead(uint32, uint32);
 			void SetPitch(uint32, uint16);
@@ -389,6 +449,16 @@ namespace Iop
 			MAX_ADSR_VOLUME = 0x7FFFFFFF,
 		};
 
+		enum
+		{
+			RENDER_BATCH_SAMPLES = 128,
+		};
+
+		void RenderScalar(int16*, unsigned int, bool, bool);
+		void RenderBatched(int16*, unsigned int, bool, bool);
+		int32 UpdateChannel(unsigned int);
+		void UpdateTickOutput(int16*, int16*, bool, bool);
+
 		void UpdateAdsr(CHANNEL&);
 		void UpdateReverb(int16[2], int16*);
 		uint32 GetAdsrDelta(unsigned int) const;
@@ -427,6 +497,7 @@ namespace Iop
 		uint32 m_adsrLogTable[160];
 		bool m_reverbEnabled;
 		float m_volumeAdjust;
+		bool m_batchedRenderEnabled = true;
 
 		CBlockSampleReader m_blockReader;
 		uint32 m_soundInputDataAddr = 0;
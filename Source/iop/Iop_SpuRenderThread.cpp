@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include "Iop_SpuRenderThread.h"
+#include "Iop_SpuBase.h"
+#include "../FpUtils.h"
+#include "ThreadUtils.h"
+
+using namespace Iop;
+
+CSpuRenderThread::CSpuRenderThread(CSpuBase& core0, CSpuBase& core1)
+    : m_core0(core0)
+    , m_core1(core1)
+{
+}
+
+CSpuRenderThread::~CSpuRenderThread()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_threadDone = true;
+	}
+	m_blockCondition.notify_all();
+	if(m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+void CSpuRenderThread::RenderBlock(CSpuBase& core0, CSpuBase& core1, int16* samples, unsigned int sampleCount)
+{
+	core0.Render(samples, sampleCount);
+
+	if(core1.IsEnabled())
+	{
+		int16 samplesSpu1[MAX_BLOCK_SAMPLE_COUNT];
+		assert(sampleCount <= MAX_BLOCK_SAMPLE_COUNT);
+		core1.Render(samplesSpu1, sampleCount);
+
+		for(unsigned int i = 0; i < sampleCount; i++)
+		{
+			// Core0 output should be mixed with Core1 at volume
+			// corresponding to Core1's AVOL register values
+			int32 volume = (i % 2) ? core1.m_extInputVolR : core1.m_extInputVolL;
+			CSpuBase::MixSamples(samples[i], volume, &samplesSpu1[i]);
+			samples[i] = samplesSpu1[i];
+		}
+	}
+}
+
+void CSpuRenderThread::SetRegisterWriteHandler(const RegisterWriteHandler& registerWriteHandler)
+{
+	m_registerWriteHandler = registerWriteHandler;
+}
+
+void CSpuRenderThread::QueueBlock(unsigned int sampleCount)
+{
+	assert(sampleCount <= MAX_BLOCK_SAMPLE_COUNT);
+
+	//Don't let the worker fall too far behind, the ring needs to be able to hold everything
+	if(m_pendingBlockCount.load(std::memory_order_acquire) >= MAX_PENDING_BLOCKS)
+	{
+		WaitForPendingBlocks();
+	}
+
+	if(IsIdle())
+	{
+		//We own the cores at this point, the worker keeps this up to date from here on
+		m_irqState.store(GetIrqState(), std::memory_order_release);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		COMMAND command;
+		command.type = COMMAND_RENDER;
+		command.value = sampleCount;
+		m_commands.push_back(command);
+		m_pendingBlockCount.fetch_add(1, std::memory_order_relaxed);
+
+		if(!m_thread.joinable())
+		{
+			m_thread = std::thread([this]() { ThreadProc(); });
+			Framework::ThreadUtils::SetThreadName(m_thread, "SPU Render Thread");
+		}
+	}
+	m_blockCondition.notify_one();
+}
+
+bool CSpuRenderThread::PopBlock(int16* samples, unsigned int sampleCount)
+{
+	uint32 readIndex = m_ringReadIndex.load(std::memory_order_relaxed);
+	uint32 writeIndex = m_ringWriteIndex.load(std::memory_order_acquire);
+	if(readIndex == writeIndex) return false;
+
+	const auto& block = m_ring[readIndex % RING_BLOCK_COUNT];
+	assert(block.sampleCount == sampleCount);
+	memcpy(samples, block.samples, sizeof(int16) * std::min(sampleCount, block.sampleCount));
+
+	m_ringReadIndex.store(readIndex + 1, std::memory_order_release);
+	return true;
+}
+
+void CSpuRenderThread::WriteRegister(uint32 address, uint32 value, bool changesIrqState)
+{
+	assert(m_registerWriteHandler);
+	if(IsIdle())
+	{
+		m_registerWriteHandler(address, value);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		COMMAND command;
+		command.type = COMMAND_WRITE;
+		command.address = address;
+		command.value = value;
+		command.changesIrqState = changesIrqState;
+		m_commands.push_back(command);
+		m_pendingWriteCount.fetch_add(1, std::memory_order_relaxed);
+		if(changesIrqState)
+		{
+			m_pendingIrqWriteCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	m_blockCondition.notify_one();
+}
+
+bool CSpuRenderThread::GetIrqPending()
+{
+	if(!IsIdle())
+	{
+		//Blocks left to render can only raise an IRQ on a core that has them enabled and
+		//doesn't have one pending already. Logged control writes can change either, let them go through.
+		if(m_pendingIrqWriteCount.load(std::memory_order_acquire) == 0)
+		{
+			uint32 irqState = m_irqState.load(std::memory_order_acquire);
+			bool irqPending = false;
+			bool irqCanChange = false;
+			for(unsigned int i = 0; i < 2; i++)
+			{
+				uint32 coreIrqState = (irqState >> (i * IRQ_STATE_CORE_SHIFT)) & (IRQ_STATE_ENABLED | IRQ_STATE_PENDING);
+				irqPending |= (coreIrqState & IRQ_STATE_PENDING) != 0;
+				irqCanChange |= (coreIrqState == IRQ_STATE_ENABLED);
+			}
+			if(!irqCanChange)
+			{
+				return irqPending;
+			}
+		}
+		WaitForPendingBlocks();
+	}
+	return m_core0.GetIrqPending() || m_core1.GetIrqPending();
+}
+
+bool CSpuRenderThread::IsIrqArmed()
+{
+	uint32 irqState = 0;
+	if(IsIdle())
+	{
+		irqState = GetIrqState();
+	}
+	else
+	{
+		if(m_pendingIrqWriteCount.load(std::memory_order_acquire) != 0) return true;
+		irqState = m_irqState.load(std::memory_order_acquire);
+	}
+	for(unsigned int i = 0; i < 2; i++)
+	{
+		uint32 coreIrqState = (irqState >> (i * IRQ_STATE_CORE_SHIFT)) & (IRQ_STATE_ENABLED | IRQ_STATE_PENDING);
+		if(coreIrqState == IRQ_STATE_ENABLED) return true;
+	}
+	return false;
+}
+
+void CSpuRenderThread::Reset()
+{
+	Sync();
+	//Worker is idle at this point, it's safe to move the read index
+	m_ringReadIndex.store(m_ringWriteIndex.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+uint32 CSpuRenderThread::GetIrqState() const
+{
+	uint32 irqState = 0;
+	const CSpuBase* cores[2] = {&m_core0, &m_core1};
+	for(unsigned int i = 0; i < 2; i++)
+	{
+		const auto& core = *cores[i];
+		uint32 coreIrqState = 0;
+		coreIrqState |= (core.GetControl() & CSpuBase::CONTROL_IRQ) ? IRQ_STATE_ENABLED : 0;
+		coreIrqState |= core.GetIrqPending() ? IRQ_STATE_PENDING : 0;
+		irqState |= coreIrqState << (i * IRQ_STATE_CORE_SHIFT);
+	}
+	return irqState;
+}
+
+void CSpuRenderThread::WaitForPendingBlocks()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_blockDoneCondition.wait(lock, [&]() { return IsIdle(); });
+}
+
+void CSpuRenderThread::ThreadProc()
+{
+	FpUtils::SetEmulationFpEnvironment();
+
+	BLOCK overflowBlock;
+
+	while(true)
+	{
+		COMMAND command;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_blockCondition.wait(lock, [&]() { return m_threadDone || !m_commands.empty(); });
+			if(m_threadDone)
+			{
+				break;
+			}
+			command = m_commands.front();
+			m_commands.pop_front();
+		}
+
+		if(command.type == COMMAND_WRITE)
+		{
+			m_registerWriteHandler(command.address, command.value);
+			m_irqState.store(GetIrqState(), std::memory_order_release);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if(command.changesIrqState)
+				{
+					m_pendingIrqWriteCount.fetch_sub(1, std::memory_order_release);
+				}
+				m_pendingWriteCount.fetch_sub(1, std::memory_order_release);
+			}
+			m_blockDoneCondition.notify_all();
+			continue;
+		}
+
+		unsigned int sampleCount = command.value;
+
+		uint32 writeIndex = m_ringWriteIndex.load(std::memory_order_relaxed);
+		uint32 readIndex = m_ringReadIndex.load(std::memory_order_acquire);
+		bool ringFull = (writeIndex - readIndex) == RING_BLOCK_COUNT;
+
+		//If nobody is reading, the block is still rendered to keep the SPU state going, but is dropped
+		auto& block = ringFull ? overflowBlock : m_ring[writeIndex % RING_BLOCK_COUNT];
+		RenderBlock(m_core0, m_core1, block.samples, sampleCount);
+		block.sampleCount = sampleCount;
+		m_irqState.store(GetIrqState(), std::memory_order_release);
+
+		if(!ringFull)
+		{
+			m_ringWriteIndex.store(writeIndex + 1, std::memory_order_release);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pendingBlockCount.fetch_sub(1, std::memory_order_release);
+		}
+		m_blockDoneCondition.notify_all();
+	}
+}
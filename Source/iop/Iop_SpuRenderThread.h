@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "Types.h"
+
+namespace Iop
+{
+	class CSpuBase;
+
+	//Renders SPU output blocks on a separate thread. Rendered blocks are handed back to the
+	//emulation thread through a single producer/single consumer ring.
+	//While blocks are being rendered, the worker owns the state of both SPU cores and SPU RAM.
+	//Register writes made in the meantime are logged along with the block requests and the
+	//worker applies them between the same blocks they would have landed between on the
+	//emulation thread. Anything else that touches the SPU state from the emulation thread
+	//(register reads, DMA, save states) must call Sync first. Since rendering happens in the
+	//same order and sees the same state as it would have on the emulation thread, output is
+	//deterministic.
+	class CSpuRenderThread
+	{
+	public:
+		enum
+		{
+			MAX_BLOCK_SAMPLE_COUNT = 0x200,
+			RING_BLOCK_COUNT = 16,
+			MAX_PENDING_BLOCKS = RING_BLOCK_COUNT / 2,
+		};
+
+		CSpuRenderThread(CSpuBase&, CSpuBase&);
+		CSpuRenderThread(const CSpuRenderThread&) = delete;
+		~CSpuRenderThread();
+
+		CSpuRenderThread& operator=(const CSpuRenderThread&) = delete;
+
+		typedef std::function<void(uint32, uint32)> RegisterWriteHandler;
+
+		static void RenderBlock(CSpuBase&, CSpuBase&, int16*, unsigned int);
+
+		void SetRegisterWriteHandler(const RegisterWriteHandler&);
+
+		void QueueBlock(unsigned int);
+		bool PopBlock(int16*, unsigned int);
+
+		//Applies the write right away if the worker is idle, logs it otherwise.
+		//Writes that can change the IRQ enable or pending state of a core must be flagged.
+		void WriteRegister(uint32, uint32, bool);
+
+		//Only waits for the worker if the remaining work can change the result
+		bool GetIrqPending();
+
+		//True if a core has its IRQ enabled and not pending, or control writes are yet to be applied
+		bool IsIrqArmed();
+
+		inline void Sync()
+		{
+			if(IsIdle()) return;
+			WaitForPendingBlocks();
+		}
+
+		//Drops rendered blocks that haven't been read yet
+		void Reset();
+
+	private:
+		enum COMMAND_TYPE
+		{
+			COMMAND_RENDER,
+			COMMAND_WRITE,
+		};
+
+		enum IRQ_STATE
+		{
+			IRQ_STATE_ENABLED = 0x01,
+			IRQ_STATE_PENDING = 0x02,
+			IRQ_STATE_CORE_SHIFT = 2,
+		};
+
+		struct COMMAND
+		{
+			COMMAND_TYPE type = COMMAND_RENDER;
+			uint32 address = 0;
+			uint32 value = 0;
+			bool changesIrqState = false;
+		};
+
+		struct BLOCK
+		{
+			int16 samples[MAX_BLOCK_SAMPLE_COUNT];
+			unsigned int sampleCount = 0;
+		};
+
+		inline bool IsIdle() const
+		{
+			return (m_pendingBlockCount.load(std::memory_order_acquire) == 0) &&
+			       (m_pendingWriteCount.load(std::memory_order_acquire) == 0);
+		}
+
+		uint32 GetIrqState() const;
+		void WaitForPendingBlocks();
+		void ThreadProc();
+
+		CSpuBase& m_core0;
+		CSpuBase& m_core1;
+		RegisterWriteHandler m_registerWriteHandler;
+
+		std::mutex m_mutex;
+		std::condition_variable m_blockCondition;
+		std::condition_variable m_blockDoneCondition;
+		std::deque<COMMAND> m_commands;
+		std::atomic<uint32> m_pendingBlockCount = 0;
+		std::atomic<uint32> m_pendingWriteCount = 0;
+		std::atomic<uint32> m_pendingIrqWriteCount = 0;
+		//IRQ enable and pending bits of both cores, as of the last command the worker went through
+		std::atomic<uint32> m_irqState = 0;
+		std::thread m_thread;
+		bool m_threadDone = false;
+
+		BLOCK m_ring[RING_BLOCK_COUNT];
+		std::atomic<uint32> m_ringReadIndex = 0;
+		std::atomic<uint32> m_ringWriteIndex = 0;
+	};
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "Iop_SubSystem.h"
 #include "IopBios.h"
 #include "GenericMipsExecutor.h"
@@ -35,6 +36,7 @@ CSubSystem::CSubSystem(bool ps2Mode)
     , m_spuCore1(m_spuRam, SPU_RAM_SIZE, &m_spuSampleCache, &m_spuIrqWatcher, 1)
     , m_spu(m_spuCore0)
     , m_spu2(m_spuCore0, m_spuCore1)
+    , m_spuRenderThread(m_spuCore0, m_spuCore1)
 #ifdef _IOP_EMULATE_MODULES
     , m_sio2(m_intc)
 #endif
@@ -50,7 +52,11 @@ CSubSystem::CSubSystem(bool ps2Mode)
 		m_bios = std::make_shared<CPsxBios>(m_cpu, m_ram, PS2::IOP_BASE_RAM_SIZE);
 	}
 
-	m_cpu.m_executor = std::make_unique<CGenericMipsExecutor<BlockLookupOneWay>>(m_cpu, (IOP_RAM_SIZE * 4), BLOCK_CATEGORY_PS2_IOP);
+	{
+		auto executor = std::make_unique<CGenericMipsExecutor<BlockLookupOneWay>>(m_cpu, (IOP_RAM_SIZE * 4), BLOCK_CATEGORY_PS2_IOP);
+		executor->AddBlockCompileHints(MIPS_COMPILEHINT_IDLELOOPDETECTION);
+		m_cpu.m_executor = std::move(executor);
+	}
 
 	//Read memory map
 	m_cpu.m_pMemoryMap->InsertReadMap((0 * IOP_RAM_SIZE), (0 * IOP_RAM_SIZE) + IOP_RAM_SIZE - 1, m_ram, 0x01);
@@ -80,17 +86,23 @@ CSubSystem::CSubSystem(bool ps2Mode)
 	m_cpu.m_pCOP[0] = &m_copScu;
 	m_cpu.m_pAddrTranslator = &CMIPS::TranslateAddress64;
 
-	m_dmac.SetReceiveFunction(CDmac::CHANNEL_SPU0, std::bind(&CSpuBase::ReceiveDma, &m_spuCore0, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
-	m_dmac.SetReceiveFunction(CDmac::CHANNEL_SPU1, std::bind(&CSpuBase::ReceiveDma, &m_spuCore1, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
+	m_dmac.SetReceiveFunction(CDmac::CHANNEL_SPU0, std::bind(&CSubSystem::ReceiveSpuDma, this, &m_spuCore0, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
+	m_dmac.SetReceiveFunction(CDmac::CHANNEL_SPU1, std::bind(&CSubSystem::ReceiveSpuDma, this, &m_spuCore1, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
 	m_dmac.SetReceiveFunction(CDmac::CHANNEL_DEV9, std::bind(&CSpeed::ReceiveDma, &m_speed, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
 	m_dmac.SetReceiveFunction(CDmac::CHANNEL_SIO2in, std::bind(&CSio2::ReceiveDmaIn, &m_sio2, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
 	m_dmac.SetReceiveFunction(CDmac::CHANNEL_SIO2out, std::bind(&CSio2::ReceiveDmaOut, &m_sio2, PLACEHOLDER_1, PLACEHOLDER_2, PLACEHOLDER_3, PLACEHOLDER_4));
 
+	m_spuRenderThread.SetRegisterWriteHandler(std::bind(&CSubSystem::WriteSpuRegister, this, PLACEHOLDER_1, PLACEHOLDER_2));
+
+	m_dmaUpdateEvent = m_scheduler.RegisterEvent(std::bind(&CSubSystem::UpdateDma, this));
+	m_spuIrqCheckEvent = m_scheduler.RegisterEvent(std::bind(&CSubSystem::CheckSpuIrq, this));
+
 	SetupPageTable();
 }
 
 CSubSystem::~CSubSystem()
 {
+	m_cpu.m_executor->Reset();
 	m_bios.reset();
 	delete[] m_ram;
 	delete[] m_scratchPad;
@@ -109,12 +121,19 @@ void CSubSystem::NotifyVBlankEnd()
 	m_intc.AssertLine(Iop::CIntc::LINE_EVBLANK);
 }
 
-void CSubSystem::SaveState(Framework::CZipArchiveWriter& archive)
+void CSubSystem::SaveState(Framework::CZipArchiveWriter& archive, bool includeRam)
 {
+	m_spuRenderThread.Sync();
 	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_CPU, &m_cpu.m_State, sizeof(MIPSSTATE)));
-	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_RAM, m_ram, IOP_RAM_SIZE));
+	if(includeRam)
+	{
+		archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_RAM, m_ram, IOP_RAM_SIZE));
+	}
 	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_SCRATCH, m_scratchPad, IOP_SCRATCH_SIZE));
-	archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_SPURAM, m_spuRam, SPU_RAM_SIZE));
+	if(includeRam)
+	{
+		archive.InsertFile(std::make_unique<CMemoryStateFile>(STATE_SPURAM, m_spuRam, SPU_RAM_SIZE));
+	}
 	m_intc.SaveState(archive);
 	m_dmac.SaveState(archive);
 	m_counters.SaveState(archive);
@@ -130,17 +149,19 @@ void CSubSystem::SaveState(Framework::CZipArchiveWriter& archive)
 	//Save timing state
 	{
 		auto registerFile = std::make_unique<CRegisterStateFile>(STATE_TIMING);
-		registerFile->SetRegister32(STATE_TIMING_DMA_UPDATE_TICKS, m_dmaUpdateTicks);
-		registerFile->SetRegister32(STATE_TIMING_SPU_IRQ_UPDATE_TICKS, m_spuIrqUpdateTicks);
+		registerFile->SetRegister32(STATE_TIMING_DMA_UPDATE_TICKS, GetEventElapsedTicks(m_dmaUpdateEvent, DMA_UPDATE_DELAY));
+		registerFile->SetRegister32(STATE_TIMING_SPU_IRQ_UPDATE_TICKS, GetEventElapsedTicks(m_spuIrqCheckEvent, SPU_IRQ_CHECK_DELAY));
 		archive.InsertFile(std::move(registerFile));
 	}
 }
 
-void CSubSystem::LoadState(Framework::CZipArchiveReader& archive)
+void CSubSystem::LoadState(Framework::CZipArchiveReader& archive, bool includeRam)
 {
+	m_spuRenderThread.Sync();
 	m_bios->PreLoadState();
 
 	//Read and check differences in memory to invalidate executor blocks only if necessary
+	if(includeRam)
 	{
 		auto stream = archive.BeginReadFile(STATE_RAM);
 		static const uint32 bufferSize = 0x1000;
@@ -158,7 +179,10 @@ void CSubSystem::LoadState(Framework::CZipArchiveReader& archive)
 
 	archive.BeginReadFile(STATE_CPU)->Read(&m_cpu.m_State, sizeof(MIPSSTATE));
 	archive.BeginReadFile(STATE_SCRATCH)->Read(m_scratchPad, IOP_SCRATCH_SIZE);
-	archive.BeginReadFile(STATE_SPURAM)->Read(m_spuRam, SPU_RAM_SIZE);
+	if(includeRam)
+	{
+		archive.BeginReadFile(STATE_SPURAM)->Read(m_spuRam, SPU_RAM_SIZE);
+	}
 	m_intc.LoadState(archive);
 	m_dmac.LoadState(archive);
 	m_counters.LoadState(archive);
@@ -175,13 +199,115 @@ void CSubSystem::LoadState(Framework::CZipArchiveReader& archive)
 	//Load timing state
 	{
 		CRegisterStateFile registerFile(*archive.BeginReadFile(STATE_TIMING));
-		m_dmaUpdateTicks = registerFile.GetRegister32(STATE_TIMING_DMA_UPDATE_TICKS);
-		m_spuIrqUpdateTicks = registerFile.GetRegister32(STATE_TIMING_SPU_IRQ_UPDATE_TICKS);
+		ScheduleEvent(m_dmaUpdateEvent, DMA_UPDATE_DELAY, registerFile.GetRegister32(STATE_TIMING_DMA_UPDATE_TICKS));
+		ScheduleEvent(m_spuIrqCheckEvent, SPU_IRQ_CHECK_DELAY, registerFile.GetRegister32(STATE_TIMING_SPU_IRQ_UPDATE_TICKS));
 	}
 }
 
+size_t CSubSystem::GetRawStateSize(bool includeRam) const
+{
+	size_t size = sizeof(m_cpu.m_State) + IOP_SCRATCH_SIZE;
+	if(includeRam)
+	{
+		size += IOP_RAM_SIZE + SPU_RAM_SIZE;
+	}
+	size += m_spuCore0.GetRawStateSize();
+	size += m_spuCore1.GetRawStateSize();
+	size += sizeof(int) * 2;
+	size += m_intc.GetRawStateSize();
+	size += m_dmac.GetRawStateSize();
+	size += m_counters.GetRawStateSize();
+	size += m_spuIrqWatcher.GetRawStateSize();
+	size += m_ilink.GetRawStateSize();
+#ifdef _IOP_EMULATE_MODULES
+	size += m_sio2.GetRawStateSize();
+#endif
+	size += m_bios->GetRawStateSize();
+	return size;
+}
+
+void CSubSystem::SaveRawState(CRawStateWriter& writer, bool includeRam)
+{
+	m_spuRenderThread.Sync();
+	writer.Write(m_cpu.m_State);
+	if(includeRam)
+	{
+		writer.Write(m_ram, IOP_RAM_SIZE);
+	}
+	writer.Write(m_scratchPad, IOP_SCRATCH_SIZE);
+	if(includeRam)
+	{
+		writer.Write(m_spuRam, SPU_RAM_SIZE);
+	}
+	m_spuCore0.SaveRawState(writer);
+	m_spuCore1.SaveRawState(writer);
+	writer.Write(GetEventElapsedTicks(m_dmaUpdateEvent, DMA_UPDATE_DELAY));
+	writer.Write(GetEventElapsedTicks(m_spuIrqCheckEvent, SPU_IRQ_CHECK_DELAY));
+	m_intc.SaveRawState(writer);
+	m_dmac.SaveRawState(writer);
+	m_counters.SaveRawState(writer);
+	m_spuIrqWatcher.SaveRawState(writer);
+	m_ilink.SaveRawState(writer);
+#ifdef _IOP_EMULATE_MODULES
+	m_sio2.SaveRawState(writer);
+#endif
+	m_bios->SaveRawState(writer);
+}
+
+void CSubSystem::LoadRawState(CRawStateReader& reader, bool includeRam)
+{
+	m_spuRenderThread.Sync();
+	m_bios->PreLoadState();
+
+	reader.Read(m_cpu.m_State);
+
+	//Check differences in memory to invalidate executor blocks only if necessary
+	if(includeRam)
+	{
+		static const uint32 bufferSize = 0x1000;
+		uint8 buffer[bufferSize];
+		for(uint32 i = 0; i < IOP_RAM_SIZE; i += bufferSize)
+		{
+			reader.Read(buffer, bufferSize);
+			if(memcmp(m_ram + i, buffer, bufferSize))
+			{
+				m_cpu.m_executor->ClearActiveBlocksInRange(i, i + bufferSize, false);
+			}
+			memcpy(m_ram + i, buffer, bufferSize);
+		}
+	}
+
+	reader.Read(m_scratchPad, IOP_SCRATCH_SIZE);
+	if(includeRam)
+	{
+		reader.Read(m_spuRam, SPU_RAM_SIZE);
+	}
+	m_spuSampleCache.Clear();
+	m_spuCore0.LoadRawState(reader);
+	m_spuCore1.LoadRawState(reader);
+	{
+		int dmaUpdateTicks = 0;
+		int spuIrqUpdateTicks = 0;
+		reader.Read(dmaUpdateTicks);
+		reader.Read(spuIrqUpdateTicks);
+		ScheduleEvent(m_dmaUpdateEvent, DMA_UPDATE_DELAY, dmaUpdateTicks);
+		ScheduleEvent(m_spuIrqCheckEvent, SPU_IRQ_CHECK_DELAY, spuIrqUpdateTicks);
+	}
+
+	m_intc.LoadRawState(reader);
+	m_dmac.LoadRawState(reader);
+	m_counters.LoadRawState(reader);
+	m_spuIrqWatcher.LoadRawState(reader);
+	m_ilink.LoadRawState(reader);
+#ifdef _IOP_EMULATE_MODULES
+	m_sio2.LoadRawState(reader);
+#endif
+	m_bios->LoadRawState(reader);
+}
+
 void CSubSystem::Reset()
 {
+	m_spuRenderThread.Reset();
 	memset(m_ram, 0, IOP_RAM_SIZE);
 	memset(m_scratchPad, 0, IOP_SCRATCH_SIZE);
 	memset(m_spuRam, 0, SPU_RAM_SIZE);
@@ -206,8 +332,8 @@ void CSubSystem::Reset()
 	m_cpu.m_Comments.RemoveTags();
 	m_cpu.m_Functions.RemoveTags();
 
-	m_dmaUpdateTicks = 0;
-	m_spuIrqUpdateTicks = 0;
+	m_scheduler.Reset();
+	m_isIdle = false;
 }
 
 void CSubSystem::SetupPageTable()
@@ -233,6 +359,7 @@ uint32 CSubSystem::ReadIoRegister(uint32 address)
 	}
 	else if(address >= CSpu::SPU_BEGIN && address <= CSpu::SPU_END)
 	{
+		m_spuRenderThread.Sync();
 		return m_spu.ReadRegister(address);
 	}
 	else if(
@@ -260,6 +387,7 @@ uint32 CSubSystem::ReadIoRegister(uint32 address)
 #endif
 	else if(address >= CSpu2::REGS_BEGIN && address <= CSpu2::REGS_END)
 	{
+		m_spuRenderThread.Sync();
 		return m_spu2.ReadRegister(address);
 	}
 	else if((address >= 0x1F801000 && address <= 0x1F801020) || (address >= 0x1F801400 && address <= 0x1F801420))
@@ -289,7 +417,12 @@ uint32 CSubSystem::WriteIoRegister(uint32 address, uint32 value)
 {
 	if(address >= CSpu::SPU_BEGIN && address <= CSpu::SPU_END)
 	{
-		m_spu.WriteRegister(address, static_cast<uint16>(value));
+		bool isControl = (address == CSpu::SPU_CTRL0);
+		m_spuRenderThread.WriteRegister(address, value, isControl);
+		if(isControl)
+		{
+			ScheduleSpuIrqCheck();
+		}
 	}
 	else if(
 	    (address >= CDmac::DMAC_ZONE1_START && address <= CDmac::DMAC_ZONE1_END) ||
@@ -297,6 +430,7 @@ uint32 CSubSystem::WriteIoRegister(uint32 address, uint32 value)
 	    (address >= CDmac::DMAC_ZONE3_START && address <= CDmac::DMAC_ZONE3_END))
 	{
 		m_dmac.WriteRegister(address, value);
+		ScheduleDmaUpdate();
 	}
 	else if(address >= CIntc::ADDR_BEGIN && address <= CIntc::ADDR_END)
 	{
@@ -316,7 +450,13 @@ uint32 CSubSystem::WriteIoRegister(uint32 address, uint32 value)
 #endif
 	else if(address >= CSpu2::REGS_BEGIN && address <= CSpu2::REGS_END)
 	{
-		return m_spu2.WriteRegister(address, value);
+		bool isControl = (address & ~0x400) == Spu2::CCore::CORE_ATTR;
+		m_spuRenderThread.WriteRegister(address, value, isControl);
+		if(isControl)
+		{
+			ScheduleSpuIrqCheck();
+		}
+		return 0;
 	}
 	else if((address >= 0x1F801000 && address <= 0x1F801020) || (address >= 0x1F801400 && address <= 0x1F801420))
 	{
@@ -350,6 +490,25 @@ uint32 CSubSystem::WriteIoRegister(uint32 address, uint32 value)
 	return 0;
 }
 
+void CSubSystem::WriteSpuRegister(uint32 address, uint32 value)
+{
+	//Called from the SPU render thread if it's busy when the write happens
+	if(address >= CSpu2::REGS_BEGIN && address <= CSpu2::REGS_END)
+	{
+		m_spu2.WriteRegister(address, value);
+	}
+	else
+	{
+		m_spu.WriteRegister(address, static_cast<uint16>(value));
+	}
+}
+
+uint32 CSubSystem::ReceiveSpuDma(CSpuBase* spu, uint8* buffer, uint32 blockSize, uint32 blockAmount, uint32 direction)
+{
+	m_spuRenderThread.Sync();
+	return spu->ReceiveDma(buffer, blockSize, blockAmount, direction);
+}
+
 void CSubSystem::CheckPendingInterrupts()
 {
 	if(!m_cpu.m_State.nHasException)
@@ -363,43 +522,76 @@ void CSubSystem::CheckPendingInterrupts()
 
 bool CSubSystem::IsCpuIdle()
 {
-	return m_bios->IsIdle();
+	return m_bios->IsIdle() || m_isIdle;
 }
 
 void CSubSystem::CountTicks(int ticks)
 {
-	static const int g_dmaUpdateDelay = 10000;
-	static const int g_spuIrqCheckDelay = 1000;
 	m_counters.Update(ticks);
 	m_speed.CountTicks(ticks);
 	m_bios->CountTicks(ticks);
-	m_dmaUpdateTicks += ticks;
-	if(m_dmaUpdateTicks >= g_dmaUpdateDelay)
+	m_scheduler.Advance(ticks);
+	m_scheduler.ProcessEvents();
+}
+
+void CSubSystem::UpdateDma()
+{
+	m_dmac.ResumeDma(Iop::CDmac::CHANNEL_SPU0);
+	m_dmac.ResumeDma(Iop::CDmac::CHANNEL_SPU1);
+	ScheduleDmaUpdate();
+}
+
+void CSubSystem::CheckSpuIrq()
+{
+	bool irqPending = m_spuRenderThread.GetIrqPending();
+	if(irqPending)
 	{
-		m_dmac.ResumeDma(Iop::CDmac::CHANNEL_SPU0);
-		m_dmac.ResumeDma(Iop::CDmac::CHANNEL_SPU1);
-		m_dmaUpdateTicks -= g_dmaUpdateDelay;
+		m_intc.AssertLine(CIntc::LINE_SPU2);
 	}
-	m_spuIrqUpdateTicks += ticks;
-	if(m_spuIrqUpdateTicks >= g_spuIrqCheckDelay)
+	else
 	{
-		bool irqPending = false;
-		irqPending |= m_spuCore0.GetIrqPending();
-		irqPending |= m_spuCore1.GetIrqPending();
-		if(irqPending)
-		{
-			m_intc.AssertLine(CIntc::LINE_SPU2);
-		}
-		else
-		{
-			m_intc.ClearLine(CIntc::LINE_SPU2);
-		}
-		m_spuIrqUpdateTicks -= g_spuIrqCheckDelay;
+		m_intc.ClearLine(CIntc::LINE_SPU2);
+	}
+	//Rendering can only raise the IRQ of a core that has it enabled, a pending IRQ stays
+	//asserted until a control write clears it
+	if(irqPending || m_spuRenderThread.IsIrqArmed())
+	{
+		ScheduleSpuIrqCheck();
+	}
+}
+
+void CSubSystem::ScheduleDmaUpdate()
+{
+	//Transfers are started right away, only those the SPU couldn't take in full are retried
+	if(m_scheduler.IsScheduled(m_dmaUpdateEvent)) return;
+	if(m_dmac.IsDmaActive(Iop::CDmac::CHANNEL_SPU0) || m_dmac.IsDmaActive(Iop::CDmac::CHANNEL_SPU1))
+	{
+		m_scheduler.Schedule(m_dmaUpdateEvent, DMA_UPDATE_DELAY);
 	}
 }
 
+void CSubSystem::ScheduleSpuIrqCheck()
+{
+	if(m_scheduler.IsScheduled(m_spuIrqCheckEvent)) return;
+	m_scheduler.Schedule(m_spuIrqCheckEvent, SPU_IRQ_CHECK_DELAY);
+}
+
+int CSubSystem::GetEventElapsedTicks(CScheduler::EventId eventId, int period) const
+{
+	//Saved timing keeps the ticks counted since the last time the event ran. Events that
+	//aren't scheduled are saved as due, they go back to idle on their own once loaded.
+	if(!m_scheduler.IsScheduled(eventId)) return period;
+	return period - static_cast<int>(m_scheduler.GetTicksUntil(eventId));
+}
+
+void CSubSystem::ScheduleEvent(CScheduler::EventId eventId, int period, int elapsedTicks)
+{
+	m_scheduler.Schedule(eventId, std::max<int>(period - elapsedTicks, 0));
+}
+
 int CSubSystem::ExecuteCpu(int quota)
 {
+	m_isIdle = false;
 	int executed = 0;
 	CheckPendingInterrupts();
 	if(!m_cpu.m_State.nHasException)
@@ -422,6 +614,12 @@ int CSubSystem::ExecuteCpu(int quota)
 			m_cpu.m_State.nHasException = MIPS_EXCEPTION_NONE;
 		}
 		break;
+		case MIPS_EXCEPTION_IDLE:
+		{
+			m_isIdle = true;
+			m_cpu.m_State.nHasException = MIPS_EXCEPTION_NONE;
+		}
+		break;
 		}
 		assert(m_cpu.m_State.nHasException == MIPS_EXCEPTION_NONE);
 	}
@@ -13,7 +13,9 @@
 #include "Iop_SpuBase.h"
 #include "Iop_Spu.h"
 #include "Iop_Spu2.h"
+#include "Iop_SpuRenderThread.h"
 #include "Iop_Sio2.h"
+#include "../Scheduler.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
 
@@ -33,8 +35,12 @@ namespace Iop
 		void NotifyVBlankStart();
 		void NotifyVBlankEnd();
 
-		void SaveState(Framework::CZipArchiveWriter&);
-		void LoadState(Framework::CZipArchiveReader&);
+		void SaveState(Framework::CZipArchiveWriter&, bool = true);
+		void LoadState(Framework::CZipArchiveReader&, bool = true);
+
+		size_t GetRawStateSize(bool = true) const;
+		void SaveRawState(CRawStateWriter&, bool = true);
+		void LoadRawState(CRawStateReader&, bool = true);
 
 		CMIPS m_cpu;
 		CMA_MIPSIV m_cpuArch;
@@ -51,6 +57,7 @@ namespace Iop
 		CSpuBase m_spuCore1;
 		CSpu m_spu;
 		CSpu2 m_spu2;
+		CSpuRenderThread m_spuRenderThread;
 		CDev9 m_dev9;
 #ifdef _IOP_EMULATE_MODULES
 		CSio2 m_sio2;
@@ -68,14 +75,33 @@ namespace Iop
 			HW_REG_END = 0x1F9FFFFF
 		};
 
+		//Only scheduled while a SPU DMA transfer is stalled or a SPU IRQ is armed or pending
+		enum
+		{
+			DMA_UPDATE_DELAY = 10000,
+			SPU_IRQ_CHECK_DELAY = 1000,
+		};
+
 		void SetupPageTable();
 
 		uint32 ReadIoRegister(uint32);
 		uint32 WriteIoRegister(uint32, uint32);
+		void WriteSpuRegister(uint32, uint32);
+		uint32 ReceiveSpuDma(CSpuBase*, uint8*, uint32, uint32, uint32);
 
 		void CheckPendingInterrupts();
 
-		int m_dmaUpdateTicks = 0;
-		int m_spuIrqUpdateTicks = 0;
+		void UpdateDma();
+		void CheckSpuIrq();
+		void ScheduleDmaUpdate();
+		void ScheduleSpuIrqCheck();
+
+		int GetEventElapsedTicks(CScheduler::EventId, int) const;
+		void ScheduleEvent(CScheduler::EventId, int, int);
+
+		CScheduler m_scheduler;
+		CScheduler::EventId m_dmaUpdateEvent = 0;
+		CScheduler::EventId m_spuIrqCheckEvent = 0;
+		bool m_isIdle = false;
 	};
 }
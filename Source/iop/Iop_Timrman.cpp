@@ -191,6 +191,21 @@ void CTimrman::LoadState(Framework::CZipArchiveReader& archive)
 	m_hardTimerAlloc = registerFile.GetRegister32(STATE_HARDTIMERALLOC);
 }
 
+size_t CTimrman::GetRawStateSize() const
+{
+	return sizeof(m_hardTimerAlloc);
+}
+
+void CTimrman::SaveRawState(CRawStateWriter& writer) const
+{
+	writer.Write(m_hardTimerAlloc);
+}
+
+void CTimrman::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_hardTimerAlloc);
+}
+
 int32 CTimrman::AllocHardTimer(uint32 source, uint32 size, uint32 prescale)
 {
 #ifdef _DEBUG
@@ -18,6 +18,9 @@ namespace Iop
 
 		void SaveState(Framework::CZipArchiveWriter&) const override;
 		void LoadState(Framework::CZipArchiveReader&) override;
+		size_t GetRawStateSize() const override;
+		void SaveRawState(CRawStateWriter&) const override;
+		void LoadRawState(CRawStateReader&) override;
 
 	private:
 		int32 AllocHardTimer(uint32, uint32, uint32);
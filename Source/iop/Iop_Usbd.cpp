@@ -1,4 +1,5 @@
 #include "Iop_Usbd.h"
+#include <algorithm>
 #include <cstring>
 #include "IopBios.h"
 #include "Log.h"
@@ -121,6 +122,54 @@ void CUsbd::LoadState(Framework::CZipArchiveReader& reader)
 	}
 }
 
+size_t CUsbd::GetRawStateSize() const
+{
+	//Every registered device gets a record, used or not
+	size_t size = 0;
+	for(const auto& devicePair : m_devices)
+	{
+		size += sizeof(uint8) + devicePair.second->GetRawStateSize();
+	}
+	return size;
+}
+
+void CUsbd::SaveRawState(CRawStateWriter& writer) const
+{
+	for(const auto& devicePair : m_devices)
+	{
+		const auto& device = devicePair.second;
+		bool active = std::find(std::begin(m_activeDeviceIds), std::end(m_activeDeviceIds), devicePair.first) != std::end(m_activeDeviceIds);
+		writer.Write<uint8>(active ? 1 : 0);
+		if(active)
+		{
+			device->SaveRawState(writer);
+		}
+		else
+		{
+			writer.Skip(device->GetRawStateSize());
+		}
+	}
+}
+
+void CUsbd::LoadRawState(CRawStateReader& reader)
+{
+	m_activeDeviceIds.clear();
+	for(const auto& devicePair : m_devices)
+	{
+		const auto& device = devicePair.second;
+		bool active = reader.Read<uint8>() != 0;
+		if(active)
+		{
+			device->LoadRawState(reader);
+			m_activeDeviceIds.push_back(devicePair.first);
+		}
+		else
+		{
+			reader.Skip(device->GetRawStateSize());
+		}
+	}
+}
+
 void CUsbd::CountTicks(uint32 ticks)
 {
 	for(auto activeDeviceId : m_activeDeviceIds)
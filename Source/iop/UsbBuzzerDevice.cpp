@@ -45,6 +45,37 @@ void CBuzzerUsbDevice::LoadState(const CRegisterState& state)
 	}
 }
 
+size_t CBuzzerUsbDevice::GetRawStateSize() const
+{
+	return sizeof(m_descriptorMemPtr) + sizeof(m_nextTransferTicks) + sizeof(m_transferBufferPtr) +
+	       sizeof(m_transferSize) + sizeof(m_transferCb) + sizeof(m_transferCbArg);
+}
+
+void CBuzzerUsbDevice::SaveRawState(CRawStateWriter& writer) const
+{
+	writer.Write(m_descriptorMemPtr);
+	writer.Write(m_nextTransferTicks);
+	writer.Write(m_transferBufferPtr);
+	writer.Write(m_transferSize);
+	writer.Write(m_transferCb);
+	writer.Write(m_transferCbArg);
+}
+
+void CBuzzerUsbDevice::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_descriptorMemPtr);
+	reader.Read(m_nextTransferTicks);
+	reader.Read(m_transferBufferPtr);
+	reader.Read(m_transferSize);
+	reader.Read(m_transferCb);
+	reader.Read(m_transferCbArg);
+
+	if(!m_padHandler->HasListener(this))
+	{
+		m_padHandler->InsertListener(this);
+	}
+}
+
 void CBuzzerUsbDevice::SetPadHandler(CPadHandler* padHandler)
 {
 	m_padHandler = padHandler;
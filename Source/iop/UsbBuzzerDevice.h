@@ -27,6 +27,9 @@ namespace Iop
 
 		void SaveState(CRegisterState&) const override;
 		void LoadState(const CRegisterState&) override;
+		size_t GetRawStateSize() const override;
+		void SaveRawState(CRawStateWriter&) const override;
+		void LoadRawState(CRawStateReader&) override;
 
 		void CountTicks(uint32) override;
 
@@ -2,6 +2,7 @@
 
 #include "Types.h"
 #include <memory>
+#include "../states/RawState.h"
 
 class CRegisterState;
 
@@ -18,6 +19,13 @@ namespace Iop
 		virtual void SaveState(CRegisterState&) const {};
 		virtual void LoadState(const CRegisterState&){};
 
+		virtual size_t GetRawStateSize() const
+		{
+			return 0;
+		}
+		virtual void SaveRawState(CRawStateWriter&) const {};
+		virtual void LoadRawState(CRawStateReader&){};
+
 		virtual void CountTicks(uint32) = 0;
 
 		virtual void OnLldRegistered() = 0;
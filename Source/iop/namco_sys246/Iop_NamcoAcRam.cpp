@@ -113,6 +113,21 @@ void CAcRam::LoadState(Framework::CZipArchiveReader& archive)
 	archive.BeginReadFile(STATE_EXTRAM_FILE)->Read(m_extRam, g_extRamSize);
 }
 
+size_t CAcRam::GetRawStateSize() const
+{
+	return sizeof(m_extRam);
+}
+
+void CAcRam::SaveRawState(CRawStateWriter& writer) const
+{
+	writer.Write(m_extRam);
+}
+
+void CAcRam::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_extRam);
+}
+
 void CAcRam::Read(uint32 extRamAddr, uint8* buffer, uint32 size)
 {
 	assert((extRamAddr + size) <= g_extRamSize);
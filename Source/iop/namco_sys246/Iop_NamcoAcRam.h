@@ -19,6 +19,9 @@ namespace Iop
 
 			void SaveState(Framework::CZipArchiveWriter&) const override;
 			void LoadState(Framework::CZipArchiveReader&) override;
+			size_t GetRawStateSize() const override;
+			void SaveRawState(CRawStateWriter&) const override;
+			void LoadRawState(CRawStateReader&) override;
 
 			void Read(uint32, uint8*, uint32);
 			void Write(uint32, const uint8*, uint32);
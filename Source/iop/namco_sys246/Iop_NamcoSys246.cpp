@@ -532,6 +532,23 @@ void CSys246::LoadState(Framework::CZipArchiveReader& archive)
 	m_sendAddr = registerFile.GetRegister32(STATE_SEND_ADDR);
 }
 
+size_t CSys246::GetRawStateSize() const
+{
+	return sizeof(m_recvAddr) + sizeof(m_sendAddr);
+}
+
+void CSys246::SaveRawState(CRawStateWriter& writer) const
+{
+	writer.Write(m_recvAddr);
+	writer.Write(m_sendAddr);
+}
+
+void CSys246::LoadRawState(CRawStateReader& reader)
+{
+	reader.Read(m_recvAddr);
+	reader.Read(m_sendAddr);
+}
+
 void CSys246::SetJvsMode(JVS_MODE jvsMode)
 {
 	m_jvsMode = jvsMode;
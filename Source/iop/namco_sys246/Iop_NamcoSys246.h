@@ -41,6 +41,9 @@ namespace Iop
 
 			void SaveState(Framework::CZipArchiveWriter&) const override;
 			void LoadState(Framework::CZipArchiveReader&) override;
+			size_t GetRawStateSize() const override;
+			void SaveRawState(CRawStateWriter&) const override;
+			void LoadRawState(CRawStateReader&) override;
 
 			void SetJvsMode(JVS_MODE);
 			void SetBoardId(std::string);
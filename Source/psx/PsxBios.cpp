@@ -161,6 +161,19 @@ void CPsxBios::LoadState(Framework::CZipArchiveReader& archive)
 {
 }
 
+size_t CPsxBios::GetRawStateSize() const
+{
+	return 0;
+}
+
+void CPsxBios::SaveRawState(CRawStateWriter& writer)
+{
+}
+
+void CPsxBios::LoadRawState(CRawStateReader& reader)
+{
+}
+
 void CPsxBios::NotifyVBlankStart()
 {
 }
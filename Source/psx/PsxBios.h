@@ -43,6 +43,10 @@ public:
 	void SaveState(Framework::CZipArchiveWriter&) override;
 	void LoadState(Framework::CZipArchiveReader&) override;
 
+	size_t GetRawStateSize() const override;
+	void SaveRawState(CRawStateWriter&) override;
+	void LoadRawState(CRawStateReader&) override;
+
 	void NotifyVBlankStart() override;
 	void NotifyVBlankEnd() override;
 
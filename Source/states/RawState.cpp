@@ -0,0 +1,97 @@
+#include <cstring>
+#include <stdexcept>
+#include "RawState.h"
+
+CRawStateWriter::CRawStateWriter(void* buffer, size_t bufferSize)
+    : m_buffer(reinterpret_cast<uint8*>(buffer))
+    , m_bufferSize(bufferSize)
+{
+}
+
+void CRawStateWriter::Write(const void* data, size_t size)
+{
+	if(m_buffer)
+	{
+		if(size > (m_bufferSize - m_position))
+		{
+			throw std::runtime_error("Raw state buffer is too small.");
+		}
+		memcpy(m_buffer + m_position, data, size);
+	}
+	m_position += size;
+}
+
+void CRawStateWriter::Skip(size_t size)
+{
+	if(m_buffer)
+	{
+		if(size > (m_bufferSize - m_position))
+		{
+			throw std::runtime_error("Raw state buffer is too small.");
+		}
+		memset(m_buffer + m_position, 0, size);
+	}
+	m_position += size;
+}
+
+void CRawStateWriter::WriteString(const std::string& value, size_t capacity)
+{
+	//Always keep a terminator
+	if(value.size() >= capacity)
+	{
+		throw std::runtime_error("String doesn't fit in raw state record.");
+	}
+	Write(value.c_str(), value.size());
+	Skip(capacity - value.size());
+}
+
+size_t CRawStateWriter::GetSize() const
+{
+	return m_position;
+}
+
+CRawStateReader::CRawStateReader(const void* buffer, size_t bufferSize)
+    : m_buffer(reinterpret_cast<const uint8*>(buffer))
+    , m_bufferSize(bufferSize)
+{
+}
+
+void CRawStateReader::Read(void* data, size_t size)
+{
+	if(size > GetRemainingSize())
+	{
+		throw std::runtime_error("Unexpected end of raw state.");
+	}
+	memcpy(data, m_buffer + m_position, size);
+	m_position += size;
+}
+
+void CRawStateReader::Skip(size_t size)
+{
+	if(size > GetRemainingSize())
+	{
+		throw std::runtime_error("Unexpected end of raw state.");
+	}
+	m_position += size;
+}
+
+std::string CRawStateReader::ReadString(size_t capacity)
+{
+	if(capacity > GetRemainingSize())
+	{
+		throw std::runtime_error("Unexpected end of raw state.");
+	}
+	auto value = reinterpret_cast<const char*>(m_buffer + m_position);
+	m_position += capacity;
+	return std::string(value, strnlen(value, capacity));
+}
+
+const uint8* CRawStateReader::GetCurrentPointer() const
+{
+	return m_buffer + m_position;
+}
+
+size_t CRawStateReader::GetRemainingSize() const
+{
+	return m_bufferSize - m_position;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <type_traits>
+#include "Types.h"
+
+//Fixed layout binary state serialization. Values are copied as-is to or from a caller
+//supplied buffer without any allocation, which makes this suitable for states that need
+//to be saved very often (rewind, run-ahead). The layout isn't meant to be stable across
+//versions, use the archive based state files for anything persisted by the user.
+class CRawStateWriter
+{
+public:
+	//Writer without a buffer, only computes the size of the state
+	CRawStateWriter() = default;
+	CRawStateWriter(void*, size_t);
+
+	void Write(const void*, size_t);
+
+	template <typename ValueType>
+	void Write(const ValueType& value)
+	{
+		static_assert(std::is_trivially_copyable<ValueType>::value, "Value must be trivially copyable.");
+		Write(&value, sizeof(ValueType));
+	}
+
+	//Fills the space left in fixed capacity records with zeroes
+	void Skip(size_t);
+	void WriteString(const std::string&, size_t);
+
+	size_t GetSize() const;
+
+private:
+	uint8* m_buffer = nullptr;
+	size_t m_bufferSize = 0;
+	size_t m_position = 0;
+};
+
+class CRawStateReader
+{
+public:
+	CRawStateReader(const void*, size_t);
+
+	void Read(void*, size_t);
+
+	template <typename ValueType>
+	void Read(ValueType& value)
+	{
+		static_assert(std::is_trivially_copyable<ValueType>::value, "Value must be trivially copyable.");
+		Read(&value, sizeof(ValueType));
+	}
+
+	template <typename ValueType>
+	ValueType Read()
+	{
+		ValueType value;
+		Read(value);
+		return value;
+	}
+
+	void Skip(size_t);
+	std::string ReadString(size_t);
+	const uint8* GetCurrentPointer() const;
+	size_t GetRemainingSize() const;
+
+private:
+	const uint8* m_buffer = nullptr;
+	size_t m_bufferSize = 0;
+	size_t m_position = 0;
+};
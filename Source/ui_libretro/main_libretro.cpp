@@ -16,9 +16,12 @@
 
 #include "filesystem_def.h"
 #include "DefaultAppConfig.h"
+#include "ee/Ee_NativeFunctions.h"
+#include "ee_functions_xml.h"
 
 #include <vector>
 #include <cstdlib>
+#include <cstring>
 
 #define LOG_NAME "LIBRETRO"
 
@@ -243,38 +246,27 @@ size_t retro_serialize_size(void)
 {
 	CLog::GetInstance().Print(LOG_NAME, "%s\n", __FUNCTION__);
 
-	return 40 * 1024 * 1024;
+	return m_virtualMachine->GetRawStateSize();
 }
 
 bool retro_serialize(void* data, size_t size)
 {
 	CLog::GetInstance().Print(LOG_NAME, "%s\n", __FUNCTION__);
 
-	try
-	{
-		Framework::CMemStream stateStream;
-		Framework::CZipArchiveWriter archive;
-
-		m_virtualMachine->m_ee->SaveState(archive);
-		m_virtualMachine->m_iop->SaveState(archive);
-		m_virtualMachine->m_ee->m_gs->SaveState(archive);
-
-		archive.Write(stateStream);
-		stateStream.Seek(0, Framework::STREAM_SEEK_DIRECTION::STREAM_SEEK_SET);
-		stateStream.Read(data, size);
-	}
-	catch(...)
-	{
-		return false;
-	}
-
-	return true;
+	return m_virtualMachine->SaveRawState(data, size);
 }
 
 bool retro_unserialize(const void* data, size_t size)
 {
 	CLog::GetInstance().Print(LOG_NAME, "%s\n", __FUNCTION__);
 
+	//States saved by older versions are zip archives
+	bool isArchive = (size >= 2) && (memcmp(data, "PK", 2) == 0);
+	if(!isArchive)
+	{
+		return m_virtualMachine->LoadRawState(data, size);
+	}
+
 	try
 	{
 		Framework::CPtrStream stateStream(data, size);
@@ -556,6 +548,9 @@ void retro_init()
 
 	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_AUDIO_SPUBLOCKCOUNT, 22);
 
+	//The core is a single library, resource files are built into it
+	Ee::NativeFunctions::SetFunctionsFileData(g_eeFunctionsXml, sizeof(g_eeFunctionsXml));
+
 	m_virtualMachine = new CPS2VM();
 	m_virtualMachine->Initialize();
 
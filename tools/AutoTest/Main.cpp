@@ -6,12 +6,14 @@
 #include "iop/IopBios.h"
 #include "JUnitTestReportWriter.h"
 #include "gs/GSH_Null.h"
+#include "gs/GSH_Software.h"
 #ifdef _WIN32
 #include "gs/GSH_OpenGLWin32/GSH_OpenGLWin32.h"
 #include "gs/GSH_Direct3D9/GSH_Direct3D9.h"
 #endif
 
 #define GS_HANDLER_NAME_NULL "null"
+#define GS_HANDLER_NAME_SOFTWARE "soft"
 #define GS_HANDLER_NAME_OGL "ogl"
 #define GS_HANDLER_NAME_D3D9 "d3d9"
 
@@ -20,6 +22,7 @@
 static std::set<std::string> g_validGsHandlersNames =
     {
         GS_HANDLER_NAME_NULL,
+        GS_HANDLER_NAME_SOFTWARE,
 #ifdef _WIN32
         GS_HANDLER_NAME_OGL,
         GS_HANDLER_NAME_D3D9,
@@ -46,6 +49,10 @@ CGSHandler::FactoryFunction GetGsHandlerFactoryFunction(const std::string& gsHan
 	{
 		return CGSH_Null::GetFactoryFunction();
 	}
+	else if(gsHandlerName == GS_HANDLER_NAME_SOFTWARE)
+	{
+		return CGSH_Software::GetFactoryFunction();
+	}
 #ifdef _WIN32
 	else if(gsHandlerName == GS_HANDLER_NAME_OGL)
 	{
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "GsSoftwareRasterTest.h"
+#include "gs/GSH_Software.h"
+
+//Every scene is rendered with and without rasterizer workers, GS RAM must come out the same
+
+typedef CGSHandler::RegisterWriteList RegisterWriteList;
+
+static uint64 MakeFrame(uint32 psm, uint32 bufPtr, uint32 bufWidth)
+{
+	assert((bufPtr & 0x1FFF) == 0);
+	assert((bufWidth & 0x3F) == 0);
+
+	auto frame = make_convertible<CGSHandler::FRAME>(0);
+	frame.nPtr = bufPtr / 0x2000;
+	frame.nWidth = bufWidth / 0x40;
+	frame.nPsm = psm;
+	return frame;
+}
+
+static uint64 MakeZbuf(uint32 psm, uint32 bufPtr, bool mask)
+{
+	assert((bufPtr & 0x1FFF) == 0);
+
+	auto zbuf = make_convertible<CGSHandler::ZBUF>(0);
+	zbuf.nPtr = bufPtr / 0x2000;
+	zbuf.nPsm = psm & 0x0F;
+	zbuf.nMask = mask ? 1 : 0;
+	return zbuf;
+}
+
+static uint64 MakeScissor(uint32 width, uint32 height)
+{
+	auto scissor = make_convertible<CGSHandler::SCISSOR>(0);
+	scissor.scax1 = width - 1;
+	scissor.scay1 = height - 1;
+	return scissor;
+}
+
+static uint64 MakeTest(bool depthEnabled)
+{
+	auto test = make_convertible<CGSHandler::TEST>(0);
+	test.nDepthEnabled = depthEnabled ? 1 : 0;
+	test.nDepthMethod = CGSHandler::DEPTH_TEST_ALWAYS;
+	return test;
+}
+
+static uint64 MakeAlpha()
+{
+	//(Cs - Cd) * As + Cd
+	auto alpha = make_convertible<CGSHandler::ALPHA>(0);
+	alpha.nA = CGSHandler::ALPHABLEND_ABD_CS;
+	alpha.nB = CGSHandler::ALPHABLEND_ABD_CD;
+	alpha.nC = CGSHandler::ALPHABLEND_C_AS;
+	alpha.nD = CGSHandler::ALPHABLEND_ABD_CD;
+	return alpha;
+}
+
+static uint64 MakePrim(uint32 type, bool alphaEnabled)
+{
+	auto prim = make_convertible<CGSHandler::PRIM>(0);
+	prim.nType = type;
+	prim.nShading = 1;
+	prim.nAlpha = alphaEnabled ? 1 : 0;
+	return prim;
+}
+
+static uint32 NextRandom(uint32& seed)
+{
+	seed = (seed * 1664525) + 1013904223;
+	return seed >> 8;
+}
+
+static void SetupContext(RegisterWriteList& writes, uint64 frame, uint64 zbuf, uint64 scissor, bool depthEnabled)
+{
+	writes.push_back(std::make_pair(GS_REG_PRMODECONT, 1));
+	writes.push_back(std::make_pair(GS_REG_XYOFFSET_1, 0));
+	writes.push_back(std::make_pair(GS_REG_FRAME_1, frame));
+	writes.push_back(std::make_pair(GS_REG_ZBUF_1, zbuf));
+	writes.push_back(std::make_pair(GS_REG_SCISSOR_1, scissor));
+	writes.push_back(std::make_pair(GS_REG_TEST_1, MakeTest(depthEnabled)));
+	writes.push_back(std::make_pair(GS_REG_ALPHA_1, MakeAlpha()));
+}
+
+//Vertices are random, within a width x height area
+static void AddPrimitives(RegisterWriteList& writes, uint32 type, bool alphaEnabled, uint32 count,
+                          uint32 width, uint32 height, uint32& seed)
+{
+	uint32 vertexCount = (type == CGSHandler::PRIM_SPRITE) ? 2 : 3;
+	writes.push_back(std::make_pair(GS_REG_PRIM, MakePrim(type, alphaEnabled)));
+	for(uint32 i = 0; i < count * vertexCount; i++)
+	{
+		auto rgbaq = make_convertible<CGSHandler::RGBAQ>(0);
+		rgbaq.nR = NextRandom(seed) & 0xFF;
+		rgbaq.nG = NextRandom(seed) & 0xFF;
+		rgbaq.nB = NextRandom(seed) & 0xFF;
+		rgbaq.nA = NextRandom(seed) & 0xFF;
+		rgbaq.nQ = 1.0f;
+
+		auto xyz = make_convertible<CGSHandler::XYZ>(0);
+		xyz.nX = (NextRandom(seed) % width) << 4;
+		xyz.nY = (NextRandom(seed) % height) << 4;
+		xyz.nZ = NextRandom(seed);
+
+		writes.push_back(std::make_pair(GS_REG_RGBAQ, rgbaq));
+		writes.push_back(std::make_pair(GS_REG_XYZ2, xyz));
+	}
+}
+
+static void CompleteFrame(CGSHandler* gs)
+{
+	gs->Flip(CGSHandler::FLIP_FLAG_FORCE);
+	gs->ProcessSingleFrame();
+}
+
+static std::vector<uint8> RenderScene(const RegisterWriteList& writes, bool rasterThreaded)
+{
+	auto gs = std::make_unique<CGSH_Software>(false, rasterThreaded);
+	gs->Initialize();
+	gs->Reset();
+	CompleteFrame(gs.get());
+
+	for(const auto& write : writes)
+	{
+		gs->WriteRegister(write);
+	}
+	gs->ProcessWriteBuffer(nullptr);
+	gs->Finish();
+	CompleteFrame(gs.get());
+
+	auto ram = gs->GetRam();
+	std::vector<uint8> result(ram, ram + CGSHandler::RAMSIZE);
+
+	gs->Release();
+	CompleteFrame(gs.get());
+
+	return result;
+}
+
+static void CheckScene(const RegisterWriteList& writes)
+{
+	auto serialRam = RenderScene(writes, false);
+	auto threadedRam = RenderScene(writes, true);
+	TEST_VERIFY(std::any_of(serialRam.begin(), serialRam.end(), [](uint8 value) { return value != 0; }));
+	TEST_VERIFY(serialRam == threadedRam);
+}
+
+void CGsSoftwareRasterTest::Execute()
+{
+	CheckBlendedTriangles();
+	CheckDepthAsColor();
+	CheckScissorPastWidth();
+	CheckOverlappingBuffers();
+}
+
+void CGsSoftwareRasterTest::CheckBlendedTriangles()
+{
+	//Primitives overlap across tiles, blending makes the result depend on their order
+	uint32 seed = 1;
+	RegisterWriteList writes;
+	SetupContext(writes, MakeFrame(CGSHandler::PSMCT32, 0, 640), MakeZbuf(CGSHandler::PSMZ32, 0x1A0000, true), MakeScissor(640, 448), false);
+	AddPrimitives(writes, CGSHandler::PRIM_TRIANGLE, true, 200, 640, 448, seed);
+	AddPrimitives(writes, CGSHandler::PRIM_SPRITE, true, 50, 640, 448, seed);
+	CheckScene(writes);
+}
+
+void CGsSoftwareRasterTest::CheckDepthAsColor()
+{
+	//Depth buffer shares memory with the frame buffer but uses a different layout
+	uint32 seed = 2;
+	RegisterWriteList writes;
+	SetupContext(writes, MakeFrame(CGSHandler::PSMCT32, 0, 640), MakeZbuf(CGSHandler::PSMZ32, 0, false), MakeScissor(640, 448), true);
+	AddPrimitives(writes, CGSHandler::PRIM_TRIANGLE, false, 200, 640, 448, seed);
+	CheckScene(writes);
+}
+
+void CGsSoftwareRasterTest::CheckScissorPastWidth()
+{
+	//Pixels past the buffer width wrap around and land in rows covered by other tiles
+	uint32 seed = 3;
+	RegisterWriteList writes;
+	SetupContext(writes, MakeFrame(CGSHandler::PSMCT32, 0, 64), MakeZbuf(CGSHandler::PSMZ32, 0x1A0000, true), MakeScissor(512, 64), false);
+	AddPrimitives(writes, CGSHandler::PRIM_SPRITE, true, 100, 512, 64, seed);
+	CheckScene(writes);
+}
+
+void CGsSoftwareRasterTest::CheckOverlappingBuffers()
+{
+	//Draws of the same batch render to buffers with different base pointers, widths and formats that overlap
+	uint32 seed = 4;
+	RegisterWriteList writes;
+	auto zbuf = MakeZbuf(CGSHandler::PSMZ32, 0x1A0000, true);
+	for(uint32 i = 0; i < 4; i++)
+	{
+		SetupContext(writes, MakeFrame(CGSHandler::PSMCT32, 0, 640), zbuf, MakeScissor(640, 448), false);
+		AddPrimitives(writes, CGSHandler::PRIM_TRIANGLE, true, 50, 640, 448, seed);
+		SetupContext(writes, MakeFrame(CGSHandler::PSMCT16, 0x10000, 256), zbuf, MakeScissor(256, 256), false);
+		AddPrimitives(writes, CGSHandler::PRIM_TRIANGLE, true, 50, 256, 256, seed);
+	}
+	CheckScene(writes);
+}
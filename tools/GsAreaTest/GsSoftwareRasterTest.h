@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Test.h"
+
+class CGsSoftwareRasterTest : public CTest
+{
+public:
+	void Execute() override;
+
+private:
+	void CheckBlendedTriangles();
+	void CheckDepthAsColor();
+	void CheckScissorPastWidth();
+	void CheckOverlappingBuffers();
+};
@@ -0,0 +1,158 @@
+#include <cstring>
+#include <random>
+#include <vector>
+#include "GsSwizzleTest.h"
+#include "gs/GsPixelFormats.h"
+#include "gs/GsTransfer_Kernels.h"
+
+//Column kernels are checked against the pixel indexors over a whole page
+
+typedef bool (*WriteColumnFunction)(uint8*, const uint8*, uint32, uint32);
+typedef void (*ReadColumnFunction)(const uint8*, uint8*, uint32, uint32);
+
+static std::vector<uint8> MakeRandomBuffer(std::mt19937& random, size_t size)
+{
+	std::vector<uint8> buffer(size);
+	for(auto& value : buffer)
+	{
+		value = static_cast<uint8>(random());
+	}
+	return buffer;
+}
+
+static uint32 GetImagePixel(const std::vector<uint8>& image, uint32 pitch, uint32 pixelBits, uint32 x, uint32 y)
+{
+	const uint8* row = image.data() + (y * pitch);
+	switch(pixelBits)
+	{
+	case 32:
+		return *reinterpret_cast<const uint32*>(row + (x * 4));
+	case 24:
+		return row[(x * 3) + 0] | (row[(x * 3) + 1] << 8) | (row[(x * 3) + 2] << 16);
+	case 16:
+		return *reinterpret_cast<const uint16*>(row + (x * 2));
+	case 8:
+		return row[x];
+	default:
+		return (row[x / 2] >> ((x & 1) * 4)) & 0x0F;
+	}
+}
+
+template <typename Storage>
+static void ColumnKernelTest(uint32 pixelBits, WriteColumnFunction writeColumn, ReadColumnFunction readColumn)
+{
+	std::mt19937 random(pixelBits);
+
+	uint32 pitch = (Storage::PAGEWIDTH * pixelBits) / 8;
+	auto image = MakeRandomBuffer(random, pitch * Storage::PAGEHEIGHT);
+
+	//Start with garbage to make sure every bit gets written
+	auto ram = MakeRandomBuffer(random, CGSHandler::RAMSIZE);
+	auto referenceRam = ram;
+
+	CGsPixelFormats::CPixelIndexor<Storage> indexor(ram.data(), 0, Storage::PAGEWIDTH / 64);
+	CGsPixelFormats::CPixelIndexor<Storage> referenceIndexor(referenceRam.data(), 0, Storage::PAGEWIDTH / 64);
+
+	for(uint32 y = 0; y < Storage::PAGEHEIGHT; y++)
+	{
+		for(uint32 x = 0; x < Storage::PAGEWIDTH; x++)
+		{
+			referenceIndexor.SetPixel(x, y, static_cast<typename Storage::Unit>(GetImagePixel(image, pitch, pixelBits, x, y)));
+		}
+	}
+
+	auto writePage =
+	    [&]() {
+		    bool changed = false;
+		    for(uint32 y = 0; y < Storage::PAGEHEIGHT; y += Storage::COLUMNHEIGHT)
+		    {
+			    for(uint32 x = 0; x < Storage::PAGEWIDTH; x += Storage::COLUMNWIDTH)
+			    {
+				    unsigned int columnX = x;
+				    unsigned int columnY = y;
+				    uint32 address = indexor.GetColumnAddress(columnX, columnY);
+				    const uint8* src = image.data() + (y * pitch) + ((x * pixelBits) / 8);
+				    changed |= writeColumn(ram.data() + address, src, pitch, y / Storage::COLUMNHEIGHT);
+			    }
+		    }
+		    return changed;
+	    };
+
+	TEST_VERIFY(writePage());
+	TEST_VERIFY(memcmp(ram.data(), referenceRam.data(), CGsPixelFormats::PAGESIZE) == 0);
+
+	//Nothing changes the second time around
+	TEST_VERIFY(!writePage());
+
+	if(readColumn)
+	{
+		std::vector<uint8> readImage(image.size());
+		for(uint32 y = 0; y < Storage::PAGEHEIGHT; y += Storage::COLUMNHEIGHT)
+		{
+			for(uint32 x = 0; x < Storage::PAGEWIDTH; x += Storage::COLUMNWIDTH)
+			{
+				unsigned int columnX = x;
+				unsigned int columnY = y;
+				uint32 address = indexor.GetColumnAddress(columnX, columnY);
+				uint8* dst = readImage.data() + (y * pitch) + ((x * pixelBits) / 8);
+				readColumn(ram.data() + address, dst, pitch, y / Storage::COLUMNHEIGHT);
+			}
+		}
+		TEST_VERIFY(readImage == image);
+	}
+}
+
+static void Column24KernelTest()
+{
+	typedef CGsPixelFormats::STORAGEPSMCT32 Storage;
+
+	std::mt19937 random(24);
+
+	uint32 pitch = Storage::PAGEWIDTH * 3;
+	auto image = MakeRandomBuffer(random, pitch * Storage::PAGEHEIGHT);
+
+	auto ram = MakeRandomBuffer(random, CGSHandler::RAMSIZE);
+	auto referenceRam = ram;
+
+	CGsPixelFormats::CPixelIndexorPSMCT32 indexor(ram.data(), 0, Storage::PAGEWIDTH / 64);
+	CGsPixelFormats::CPixelIndexorPSMCT32 referenceIndexor(referenceRam.data(), 0, Storage::PAGEWIDTH / 64);
+
+	for(uint32 y = 0; y < Storage::PAGEHEIGHT; y++)
+	{
+		for(uint32 x = 0; x < Storage::PAGEWIDTH; x++)
+		{
+			uint32 pixel = referenceIndexor.GetPixel(x, y) & 0xFF000000;
+			referenceIndexor.SetPixel(x, y, pixel | GetImagePixel(image, pitch, 24, x, y));
+		}
+	}
+
+	for(uint32 y = 0; y < Storage::PAGEHEIGHT; y += Storage::COLUMNHEIGHT)
+	{
+		for(uint32 x = 0; x < Storage::PAGEWIDTH; x += Storage::COLUMNWIDTH)
+		{
+			unsigned int columnX = x;
+			unsigned int columnY = y;
+			uint32 address = indexor.GetColumnAddress(columnX, columnY);
+			GsTransfer::Kernels::WriteColumn24(ram.data() + address, image.data() + (y * pitch) + (x * 3), pitch);
+		}
+	}
+
+	TEST_VERIFY(memcmp(ram.data(), referenceRam.data(), CGsPixelFormats::PAGESIZE) == 0);
+}
+
+void CGsSwizzleTest::Execute()
+{
+	auto writeColumn32 = [](uint8* column, const uint8* src, uint32 pitch, uint32) { return GsTransfer::Kernels::WriteColumn32(column, src, pitch); };
+	auto writeColumn16 = [](uint8* column, const uint8* src, uint32 pitch, uint32) { return GsTransfer::Kernels::WriteColumn16(column, src, pitch); };
+	auto readColumn32 = [](const uint8* column, uint8* dst, uint32 pitch, uint32) { GsTransfer::Kernels::ReadColumn32(column, dst, pitch); };
+	auto readColumn16 = [](const uint8* column, uint8* dst, uint32 pitch, uint32) { GsTransfer::Kernels::ReadColumn16(column, dst, pitch); };
+
+	ColumnKernelTest<CGsPixelFormats::STORAGEPSMCT32>(32, writeColumn32, readColumn32);
+	ColumnKernelTest<CGsPixelFormats::STORAGEPSMZ32>(32, writeColumn32, readColumn32);
+	ColumnKernelTest<CGsPixelFormats::STORAGEPSMCT16>(16, writeColumn16, readColumn16);
+	ColumnKernelTest<CGsPixelFormats::STORAGEPSMCT16S>(16, writeColumn16, readColumn16);
+	ColumnKernelTest<CGsPixelFormats::STORAGEPSMZ16S>(16, writeColumn16, readColumn16);
+	ColumnKernelTest<CGsPixelFormats::STORAGEPSMT8>(8, &GsTransfer::Kernels::WriteColumn8, &GsTransfer::Kernels::ReadColumn8);
+	ColumnKernelTest<CGsPixelFormats::STORAGEPSMT4>(4, &GsTransfer::Kernels::WriteColumn4, nullptr);
+	Column24KernelTest();
+}
@@ -0,0 +1,170 @@
+#include "GsTextureCacheTest.h"
+#include "gs/GSHandler.h"
+#include "gs/GsPixelFormats.h"
+#include "gs/GsTextureCache.h"
+
+typedef CGsTextureCache<uint32> TextureCache;
+
+static CGSHandler::TEX0 MakeTex0(uint32 psm, uint32 bufPtr, uint32 bufWidth, uint32 widthLog, uint32 heightLog)
+{
+	assert((bufPtr & 0xFF) == 0);
+	assert((bufWidth & 0x3F) == 0);
+
+	auto tex0 = make_convertible<CGSHandler::TEX0>(0);
+	tex0.nPsm = psm;
+	tex0.nBufPtr = bufPtr / 0x100;
+	tex0.nBufWidth = bufWidth / 0x40;
+	tex0.nWidth = widthLog;
+	tex0.nPad0 = heightLog & 0x3;
+	tex0.nPad1 = heightLog >> 2;
+	return tex0;
+}
+
+void CGsTextureCacheTest::Execute()
+{
+	CheckSearch();
+	CheckEviction();
+	CheckInvalidate();
+	CheckFlush();
+}
+
+void CGsTextureCacheTest::CheckSearch()
+{
+	auto cache = std::make_unique<TextureCache>();
+
+	auto tex0 = MakeTex0(CGSHandler::PSMT8, 0x100000, 256, 8, 8);
+	TEST_VERIFY(cache->Search(tex0) == nullptr);
+
+	cache->Insert(tex0, 1);
+	auto texture = cache->Search(tex0);
+	TEST_VERIFY(texture != nullptr);
+	TEST_VERIFY(texture->m_textureHandle == 1);
+
+	//CLUT info is not part of the key
+	{
+		auto clutTex0 = tex0;
+		clutTex0.nCBP = 0x100;
+		clutTex0.nCSA = 4;
+		TEST_VERIFY(cache->Search(clutTex0) == texture);
+	}
+
+	//Anything else is
+	{
+		auto otherTex0 = MakeTex0(CGSHandler::PSMT8, 0x100000, 256, 8, 7);
+		TEST_VERIFY(cache->Search(otherTex0) == nullptr);
+	}
+
+	//Inserting the same key again replaces the previous texture
+	cache->Insert(tex0, 2);
+	texture = cache->Search(tex0);
+	TEST_VERIFY(texture != nullptr);
+	TEST_VERIFY(texture->m_textureHandle == 2);
+}
+
+void CGsTextureCacheTest::CheckEviction()
+{
+	auto cache = std::make_unique<TextureCache>();
+
+	auto getTex0 = [](uint32 index) { return MakeTex0(CGSHandler::PSMCT32, index * 0x100, 64, 6, 6); };
+
+	for(uint32 i = 0; i < TextureCache::MAX_TEXTURE_CACHE; i++)
+	{
+		cache->Insert(getTex0(i), i + 1);
+	}
+
+	//Keep the oldest texture alive, second oldest becomes the least recently used one
+	TEST_VERIFY(cache->Search(getTex0(0)) != nullptr);
+
+	cache->Insert(getTex0(TextureCache::MAX_TEXTURE_CACHE), TextureCache::MAX_TEXTURE_CACHE + 1);
+
+	TEST_VERIFY(cache->Search(getTex0(0)) != nullptr);
+	TEST_VERIFY(cache->Search(getTex0(1)) == nullptr);
+	for(uint32 i = 2; i <= TextureCache::MAX_TEXTURE_CACHE; i++)
+	{
+		auto texture = cache->Search(getTex0(i));
+		TEST_VERIFY(texture != nullptr);
+		TEST_VERIFY(texture->m_textureHandle == (i + 1));
+	}
+}
+
+void CGsTextureCacheTest::CheckInvalidate()
+{
+	auto cache = std::make_unique<TextureCache>();
+
+	//256x32 PSMCT32, 4 pages, starts in the middle of a GS page
+	auto tex0A = MakeTex0(CGSHandler::PSMCT32, 0x1000, 256, 8, 5);
+	//64x32 PSMCT32, 1 page, right after the first texture
+	auto tex0B = MakeTex0(CGSHandler::PSMCT32, 0x1000 + (4 * CGsPixelFormats::PAGESIZE), 64, 6, 5);
+	//Far away, at the end of RAM
+	auto tex0C = MakeTex0(CGSHandler::PSMCT32, CGSHandler::RAMSIZE - CGsPixelFormats::PAGESIZE, 64, 6, 5);
+
+	cache->Insert(tex0A, 1);
+	cache->Insert(tex0B, 2);
+	cache->Insert(tex0C, 3);
+
+	auto textureA = cache->Search(tex0A);
+	auto textureB = cache->Search(tex0B);
+	auto textureC = cache->Search(tex0C);
+
+	auto clearAll = [&]() {
+		textureA->m_cachedArea.ClearDirtyPages();
+		textureB->m_cachedArea.ClearDirtyPages();
+		textureC->m_cachedArea.ClearDirtyPages();
+	};
+
+	//Before the first texture
+	cache->InvalidateRange(0, 0x1000);
+	TEST_VERIFY(!textureA->m_cachedArea.HasDirtyPages());
+	TEST_VERIFY(!textureB->m_cachedArea.HasDirtyPages());
+	TEST_VERIFY(!textureC->m_cachedArea.HasDirtyPages());
+
+	//Shares a GS page with texture A and B, but only touches A
+	cache->InvalidateRange(0x1000 + (3 * CGsPixelFormats::PAGESIZE), 0x100);
+	TEST_VERIFY(textureA->m_cachedArea.HasDirtyPages());
+	TEST_VERIFY(textureA->m_cachedArea.IsPageDirty(3));
+	TEST_VERIFY(!textureB->m_cachedArea.HasDirtyPages());
+	TEST_VERIFY(!textureC->m_cachedArea.HasDirtyPages());
+	clearAll();
+
+	//Last byte of A and first byte of B
+	cache->InvalidateRange(0x1000 + (4 * CGsPixelFormats::PAGESIZE) - 1, 2);
+	TEST_VERIFY(textureA->m_cachedArea.IsPageDirty(3));
+	TEST_VERIFY(textureB->m_cachedArea.IsPageDirty(0));
+	TEST_VERIFY(!textureC->m_cachedArea.HasDirtyPages());
+	clearAll();
+
+	//Whole RAM
+	cache->InvalidateRange(0, CGSHandler::RAMSIZE);
+	TEST_VERIFY(textureA->m_cachedArea.HasDirtyPages());
+	TEST_VERIFY(textureB->m_cachedArea.HasDirtyPages());
+	TEST_VERIFY(textureC->m_cachedArea.HasDirtyPages());
+	clearAll();
+
+	//Replaced texture is tracked in place of the previous one
+	cache->Insert(tex0A, 4);
+	textureA = cache->Search(tex0A);
+	TEST_VERIFY(textureA->m_textureHandle == 4);
+	cache->InvalidateRange(0x1000, CGsPixelFormats::PAGESIZE);
+	TEST_VERIFY(textureA->m_cachedArea.IsPageDirty(0));
+	TEST_VERIFY(!textureB->m_cachedArea.HasDirtyPages());
+}
+
+void CGsTextureCacheTest::CheckFlush()
+{
+	auto cache = std::make_unique<TextureCache>();
+
+	auto tex0 = MakeTex0(CGSHandler::PSMCT16, 0, 128, 7, 7);
+	cache->Insert(tex0, 1);
+	TEST_VERIFY(cache->Search(tex0) != nullptr);
+
+	cache->Flush();
+	TEST_VERIFY(cache->Search(tex0) == nullptr);
+
+	//Cache is usable after a flush
+	cache->Insert(tex0, 2);
+	cache->InvalidateRange(0, CGsPixelFormats::PAGESIZE);
+	auto texture = cache->Search(tex0);
+	TEST_VERIFY(texture != nullptr);
+	TEST_VERIFY(texture->m_textureHandle == 2);
+	TEST_VERIFY(texture->m_cachedArea.HasDirtyPages());
+}
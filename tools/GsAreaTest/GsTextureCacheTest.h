@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Test.h"
+
+class CGsTextureCacheTest : public CTest
+{
+public:
+	void Execute() override;
+
+private:
+	void CheckSearch();
+	void CheckEviction();
+	void CheckInvalidate();
+	void CheckFlush();
+};
@@ -1,6 +1,9 @@
 #include <functional>
 #include "GsCachedAreaTest.h"
+#include "GsSoftwareRasterTest.h"
 #include "GsSpriteRegionTest.h"
+#include "GsSwizzleTest.h"
+#include "GsTextureCacheTest.h"
 #include "GsTransferInvalidationTest.h"
 
 typedef std::function<CTest*()> TestFactoryFunction;
@@ -10,7 +13,10 @@ static const TestFactoryFunction s_factories[] =
 {
 	[]() { return new CGsCachedAreaTest(); },
 	[]() { return new CGsSpriteRegionTest(); },
-	[]() { return new CGsTransferInvalidationTest(); }
+	[]() { return new CGsTransferInvalidationTest(); },
+	[]() { return new CGsSwizzleTest(); },
+	[]() { return new CGsTextureCacheTest(); },
+	[]() { return new CGsSoftwareRasterTest(); }
 };
 // clang-format on
 
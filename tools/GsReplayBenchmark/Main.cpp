@@ -0,0 +1,232 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "filesystem_def.h"
+#include "AppConfig.h"
+#include "PathUtils.h"
+#include "StdStreamUtils.h"
+#include "FrameDump.h"
+#include "gs/GSH_Null.h"
+#include "gs/GSH_Software.h"
+#include "xxhash.h"
+
+//Replays a frame dump (see CGSHandler::TriggerFrameDump) through GS handlers, with and without
+//the GS thread, and reports time spent on each frame along with a checksum of the resulting GS RAM.
+
+typedef std::function<CGSHandler*(bool)> HandlerFactoryFunction;
+
+struct BACKEND
+{
+	const char* name;
+	HandlerFactoryFunction factory;
+};
+
+static const BACKEND g_backends[] =
+    {
+        {"null", [](bool gsThreaded) -> CGSHandler* { return new CGSH_Null(gsThreaded); }},
+        {"software", [](bool gsThreaded) -> CGSHandler* { return new CGSH_Software(gsThreaded); }},
+};
+
+struct FRAME_RESULT
+{
+	double time = 0;
+	uint32 drawCallCount = 0;
+	uint32 transferBytes = 0;
+	uint64 ramChecksum = 0;
+};
+
+template <typename Function>
+static double MeasureSeconds(const Function& function)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	function();
+	auto endTime = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(endTime - startTime).count();
+}
+
+//Returns once everything sent to the handler so far went through
+static void CompleteFrame(CGSHandler* gs, bool gsThreaded)
+{
+	if(gsThreaded)
+	{
+		gs->Flip(CGSHandler::FLIP_FLAG_FORCE | CGSHandler::FLIP_FLAG_WAIT);
+	}
+	else
+	{
+		gs->Flip(CGSHandler::FLIP_FLAG_FORCE);
+		gs->ProcessSingleFrame();
+	}
+}
+
+static FRAME_RESULT ReplayFrame(CGSHandler* gs, bool gsThreaded, CFrameDump& frameDump, const uint32& drawCallCount)
+{
+	FRAME_RESULT result;
+
+	gs->Reset();
+	CompleteFrame(gs, gsThreaded);
+	gs->InitFromFrameDump(&frameDump);
+
+	result.time = MeasureSeconds([&]() {
+		for(const auto& packet : frameDump.GetPackets())
+		{
+			if(packet.registerWrites.empty())
+			{
+				gs->FeedImageData(packet.imageData.data(), packet.imageData.size());
+			}
+			else
+			{
+				for(const auto& registerWrite : packet.registerWrites)
+				{
+					gs->WriteRegister(registerWrite);
+				}
+				gs->ProcessWriteBuffer(&packet.metadata);
+			}
+		}
+		gs->Finish();
+		CompleteFrame(gs, gsThreaded);
+	});
+
+	result.drawCallCount = drawCallCount;
+	result.transferBytes = gs->GetImageStagingStats().lastFrameTransferBytes;
+
+	gs->SyncRam();
+	if(!gsThreaded)
+	{
+		CompleteFrame(gs, gsThreaded);
+	}
+	result.ramChecksum = XXH3_64bits(gs->GetRam(), CGSHandler::RAMSIZE);
+
+	return result;
+}
+
+static bool RunBenchmark(const BACKEND& backend, bool gsThreaded, CFrameDump& frameDump, unsigned int iterationCount, uint64& ramChecksum)
+{
+	auto gs = std::unique_ptr<CGSHandler>(backend.factory(gsThreaded));
+	gs->Initialize();
+
+	uint32 drawCallCount = 0;
+	auto newFrameConnection = gs->OnNewFrame.Connect([&drawCallCount](uint32 frameDrawCallCount) { drawCallCount = frameDrawCallCount; });
+
+	printf("%s (%s):\n", backend.name, gsThreaded ? "threaded" : "not threaded");
+
+	bool matches = true;
+	double totalTime = 0;
+	double minTime = 0;
+	double maxTime = 0;
+	for(unsigned int i = 0; i < iterationCount; i++)
+	{
+		auto result = ReplayFrame(gs.get(), gsThreaded, frameDump, drawCallCount);
+
+		//Every replay starts from the same state, results should never change
+		if((i == 0) && (ramChecksum == 0))
+		{
+			ramChecksum = result.ramChecksum;
+		}
+		bool frameMatches = (result.ramChecksum == ramChecksum);
+		matches &= frameMatches;
+
+		printf("\tFrame %3d: %8.3fms, %5d draw calls, %8.2fKB transferred, RAM checksum %016llX (%s)\n",
+		       i, result.time * 1000.0, result.drawCallCount, static_cast<double>(result.transferBytes) / 1024,
+		       static_cast<unsigned long long>(result.ramChecksum), frameMatches ? "matches" : "MISMATCH");
+
+		totalTime += result.time;
+		minTime = (i == 0) ? result.time : std::min(minTime, result.time);
+		maxTime = std::max(maxTime, result.time);
+	}
+
+	printf("\tAverage: %8.3fms, Min: %8.3fms, Max: %8.3fms\n",
+	       totalTime * 1000.0 / iterationCount, minTime * 1000.0, maxTime * 1000.0);
+
+	auto ringStats = gs->GetCommandRingStats();
+	printf("\tCommand ring: peak occupancy %d/%d, %llu producer stalls, %llu overflows\n",
+	       ringStats.peakOccupancy, ringStats.capacity, static_cast<unsigned long long>(ringStats.producerStallCount),
+	       static_cast<unsigned long long>(ringStats.overflowCount));
+
+	gs->Release();
+	if(!gsThreaded)
+	{
+		CompleteFrame(gs.get(), gsThreaded);
+	}
+
+	return matches;
+}
+
+int main(int argc, const char** argv)
+{
+	if(argc < 2)
+	{
+		printf("Usage: GsReplayBenchmark <frame dump path> [iteration count] [backend]\n");
+		return 1;
+	}
+
+	CFrameDump frameDump;
+	try
+	{
+		auto inputStream = Framework::CreateInputStdStream(fs::path(argv[1]).native());
+		frameDump.Read(inputStream);
+	}
+	catch(const std::exception& exception)
+	{
+		printf("Failed to open frame dump: %s\n", exception.what());
+		return 1;
+	}
+
+	unsigned int iterationCount = (argc >= 3) ? atoi(argv[2]) : 10;
+	const char* backendName = (argc >= 4) ? argv[3] : nullptr;
+	if(iterationCount == 0)
+	{
+		printf("Iteration count must be at least 1.\n");
+		return 1;
+	}
+
+	{
+		size_t registerWriteCount = 0;
+		size_t imageDataSize = 0;
+		for(const auto& packet : frameDump.GetPackets())
+		{
+			registerWriteCount += packet.registerWrites.size();
+			imageDataSize += packet.imageData.size();
+		}
+		printf("Frame dump: %d packets, %d register writes, %.2fKB of image data.\n",
+		       static_cast<int>(frameDump.GetPackets().size()), static_cast<int>(registerWriteCount),
+		       static_cast<double>(imageDataSize) / 1024);
+	}
+
+	bool succeeded = true;
+	bool foundBackend = false;
+	for(const auto& backend : g_backends)
+	{
+		if(backendName && strcmp(backendName, backend.name)) continue;
+		foundBackend = true;
+
+		//Threaded and non threaded runs must end up with the same GS RAM
+		uint64 ramChecksum = 0;
+		succeeded &= RunBenchmark(backend, true, frameDump, iterationCount, ramChecksum);
+		succeeded &= RunBenchmark(backend, false, frameDump, iterationCount, ramChecksum);
+	}
+
+	if(!foundBackend)
+	{
+		printf("Unknown backend '%s'.\n", backendName);
+		return 1;
+	}
+
+	return succeeded ? 0 : 1;
+}
+
+fs::path CAppConfig::GetBasePath() const
+{
+	static const char* BASE_DATA_PATH = "GsReplayBenchmark Data Files";
+	static const auto basePath =
+	    []() {
+		    auto result = Framework::PathUtils::GetPersonalDataPath() / BASE_DATA_PATH;
+		    Framework::PathUtils::EnsurePathExists(result);
+		    return result;
+	    }();
+	return basePath;
+}
@@ -0,0 +1,232 @@
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+#include "HostMemoryAccess.h"
+
+//Checks that the instructions the code generator emits for loads and stores are decoded with
+//the right operand size, register, immediate and length and that anything else is rejected.
+
+#define CHECK(condition)                                  \
+	if(!(condition))                                      \
+	{                                                     \
+		throw std::runtime_error("Failed: " #condition); \
+	}
+
+typedef std::vector<uint8> Code;
+
+static HOST_MEMORY_ACCESS Decode(Code code)
+{
+	HOST_MEMORY_ACCESS access;
+	//Trailing bytes make sure the decoder doesn't count them in the instruction
+	size_t length = code.size();
+	code.insert(code.end(), {0xCC, 0xCC, 0xCC, 0xCC});
+	CHECK(HostMemoryAccess_Decode(code.data(), access));
+	CHECK(access.length == length);
+	return access;
+}
+
+static bool IsRejected(Code code)
+{
+	HOST_MEMORY_ACCESS access;
+	code.insert(code.end(), {0xCC, 0xCC, 0xCC, 0xCC});
+	return !HostMemoryAccess_Decode(code.data(), access);
+}
+
+static void TestLoads()
+{
+	{
+		//mov eax, [rbx]
+		auto access = Decode({0x8B, 0x03});
+		CHECK(!access.isStore);
+		CHECK(access.size == 4);
+		CHECK(access.registerSize == 4);
+		CHECK(access.reg == 0);
+		CHECK(access.extend == HOST_MEMORY_ACCESS::EXTEND_ZERO);
+	}
+	{
+		//mov rax, [r15 + rcx + 0x10]
+		auto access = Decode({0x49, 0x8B, 0x44, 0x0F, 0x10});
+		CHECK(access.size == 8);
+		CHECK(access.registerSize == 8);
+		CHECK(access.reg == 0);
+	}
+	{
+		//mov r10w, [rsi + 0x12345678]
+		auto access = Decode({0x66, 0x44, 0x8B, 0x96, 0x78, 0x56, 0x34, 0x12});
+		CHECK(access.size == 2);
+		CHECK(access.registerSize == 2);
+		CHECK(access.reg == 10);
+	}
+	{
+		//mov rax, [rbp * 1 + 0x100]
+		auto access = Decode({0x48, 0x8B, 0x04, 0x2D, 0x00, 0x01, 0x00, 0x00});
+		CHECK(access.size == 8);
+	}
+	{
+		//mov cl, [rip + 0x100]
+		auto access = Decode({0x8A, 0x0D, 0x00, 0x01, 0x00, 0x00});
+		CHECK(access.size == 1);
+		CHECK(access.registerSize == 1);
+		CHECK(access.reg == 1);
+		CHECK(!access.isHighByteReg);
+	}
+	{
+		//mov dh, [rax]
+		auto access = Decode({0x8A, 0x30});
+		CHECK(access.reg == 2);
+		CHECK(access.isHighByteReg);
+	}
+}
+
+static void TestExtendingLoads()
+{
+	{
+		//movzx eax, byte [rdx]
+		auto access = Decode({0x0F, 0xB6, 0x02});
+		CHECK(access.size == 1);
+		CHECK(access.registerSize == 4);
+		CHECK(access.extend == HOST_MEMORY_ACCESS::EXTEND_ZERO);
+		CHECK(!access.isHighByteReg);
+	}
+	{
+		//movzx r8d, word [rdx]
+		auto access = Decode({0x44, 0x0F, 0xB7, 0x02});
+		CHECK(access.size == 2);
+		CHECK(access.registerSize == 4);
+		CHECK(access.reg == 8);
+	}
+	{
+		//movsx rcx, word [rdx]
+		auto access = Decode({0x48, 0x0F, 0xBF, 0x0A});
+		CHECK(access.size == 2);
+		CHECK(access.registerSize == 8);
+		CHECK(access.reg == 1);
+		CHECK(access.extend == HOST_MEMORY_ACCESS::EXTEND_SIGN);
+	}
+	{
+		//movsx esp, byte [rdx], destination is never a high byte register
+		auto access = Decode({0x0F, 0xBE, 0x22});
+		CHECK(access.size == 1);
+		CHECK(access.reg == 4);
+		CHECK(!access.isHighByteReg);
+	}
+	{
+		//movsxd rax, dword [rdx]
+		auto access = Decode({0x48, 0x63, 0x02});
+		CHECK(access.size == 4);
+		CHECK(access.registerSize == 8);
+		CHECK(access.extend == HOST_MEMORY_ACCESS::EXTEND_SIGN);
+	}
+}
+
+static void TestStores()
+{
+	{
+		//mov [rsi + 0x12345678], r9d
+		auto access = Decode({0x44, 0x89, 0x8E, 0x78, 0x56, 0x34, 0x12});
+		CHECK(access.isStore);
+		CHECK(access.size == 4);
+		CHECK(access.reg == 9);
+	}
+	{
+		//mov [rax], dx
+		auto access = Decode({0x66, 0x89, 0x10});
+		CHECK(access.isStore);
+		CHECK(access.size == 2);
+		CHECK(access.reg == 2);
+	}
+	{
+		//mov [rax], ah
+		auto access = Decode({0x88, 0x20});
+		CHECK(access.isStore);
+		CHECK(access.size == 1);
+		CHECK(access.reg == 0);
+		CHECK(access.isHighByteReg);
+	}
+	{
+		//mov [rax], spl
+		auto access = Decode({0x40, 0x88, 0x20});
+		CHECK(access.reg == 4);
+		CHECK(!access.isHighByteReg);
+	}
+	{
+		//mov qword [rax], rbx
+		auto access = Decode({0x48, 0x89, 0x18});
+		CHECK(access.size == 8);
+		CHECK(access.reg == 3);
+	}
+}
+
+static void TestImmediateStores()
+{
+	{
+		//mov dword [rip + 0x100], 0xFFFFFFF0
+		auto access = Decode({0xC7, 0x05, 0x00, 0x01, 0x00, 0x00, 0xF0, 0xFF, 0xFF, 0xFF});
+		CHECK(access.isStore);
+		CHECK(access.size == 4);
+		CHECK(access.reg == -1);
+		CHECK(access.immediate == 0xFFFFFFFFFFFFFFF0ULL);
+	}
+	{
+		//mov byte [rax], 0x80
+		auto access = Decode({0xC6, 0x00, 0x80});
+		CHECK(access.size == 1);
+		CHECK(access.immediate == 0xFFFFFFFFFFFFFF80ULL);
+	}
+	{
+		//mov word [rax + 8], 0x1234
+		auto access = Decode({0x66, 0xC7, 0x40, 0x08, 0x34, 0x12});
+		CHECK(access.size == 2);
+		CHECK(access.immediate == 0x1234);
+	}
+	{
+		//mov qword [rax], 0x7FFFFFFF
+		auto access = Decode({0x48, 0xC7, 0x00, 0xFF, 0xFF, 0xFF, 0x7F});
+		CHECK(access.size == 8);
+		CHECK(access.immediate == 0x7FFFFFFF);
+	}
+}
+
+static void TestRejected()
+{
+	//mov eax, ecx
+	CHECK(IsRejected({0x8B, 0xC1}));
+	//add eax, [rbx]
+	CHECK(IsRejected({0x03, 0x03}));
+	//movsxd without REX.W
+	CHECK(IsRejected({0x63, 0x02}));
+	//Group 11 encoding other than mov
+	CHECK(IsRejected({0xC7, 0x08, 0x00, 0x00, 0x00, 0x00}));
+	//imul eax, [rbx]
+	CHECK(IsRejected({0x0F, 0xAF, 0x03}));
+}
+
+static void TestSignExtend()
+{
+	CHECK(HostMemoryAccess_SignExtend(0x7F, 1) == 0x7F);
+	CHECK(HostMemoryAccess_SignExtend(0x80, 1) == 0xFFFFFFFFFFFFFF80ULL);
+	CHECK(HostMemoryAccess_SignExtend(0x8000, 2) == 0xFFFFFFFFFFFF8000ULL);
+	CHECK(HostMemoryAccess_SignExtend(0x80000000, 4) == 0xFFFFFFFF80000000ULL);
+	CHECK(HostMemoryAccess_SignExtend(0x8000000000000000ULL, 8) == 0x8000000000000000ULL);
+}
+
+int main(int argc, const char** argv)
+{
+	try
+	{
+		TestLoads();
+		TestExtendingLoads();
+		TestStores();
+		TestImmediateStores();
+		TestRejected();
+		TestSignExtend();
+	}
+	catch(const std::exception& exception)
+	{
+		printf("%s\r\n", exception.what());
+		return -1;
+	}
+
+	printf("All host memory access tests passed.\r\n");
+	return 0;
+}
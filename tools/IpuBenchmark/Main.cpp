@@ -0,0 +1,234 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "filesystem_def.h"
+#include "StdStreamUtils.h"
+#include "ee/IPU.h"
+#include "ee/IPU_Kernels.h"
+#include "ee/INTC.h"
+
+//Runs the IPU kernels against their scalar counterparts and reports throughput.
+//If a capture (see CIPU::SetCaptureStream) is provided, replays it through the IPU.
+
+struct CAPTURE_RECORD
+{
+	uint32 type = 0;
+	uint32 param0 = 0;
+	uint32 param1 = 0;
+	std::vector<uint8> data;
+};
+
+typedef std::vector<CAPTURE_RECORD> Capture;
+
+template <typename Function>
+static double MeasureSeconds(const Function& function)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	function();
+	auto endTime = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(endTime - startTime).count();
+}
+
+static bool RunKernelBenchmark()
+{
+	static const unsigned int blockCount = 0x1000;
+	static const unsigned int iterationCount = 16;
+
+	std::mt19937 random(1234);
+
+	//IDCT input is sparse, mostly low frequency coefficients
+	std::vector<int16> idctInput(blockCount * 0x40);
+	for(unsigned int i = 0; i < idctInput.size(); i++)
+	{
+		unsigned int coefIndex = i % 0x40;
+		bool isSet = (coefIndex < 8) || ((random() % 8) == 0);
+		idctInput[i] = isSet ? static_cast<int16>((random() % 4096) - 2048) : 0;
+	}
+
+	std::vector<uint8> cscInput(blockCount * IPU::Kernels::MACROBLOCK_PIXEL_COUNT * 3 / 2);
+	for(auto& value : cscInput)
+	{
+		value = static_cast<uint8>(random());
+	}
+
+	std::vector<int16> idctOutput(idctInput.size());
+	std::vector<int16> idctOutputScalar(idctInput.size());
+	std::vector<uint32> cscOutput(blockCount * IPU::Kernels::MACROBLOCK_PIXEL_COUNT);
+	std::vector<uint32> cscOutputScalar(cscOutput.size());
+	std::vector<uint16> cvtOutput(cscOutput.size());
+	std::vector<uint16> cvtOutputScalar(cscOutput.size());
+
+	const uint16 alphaTh0 = 0x20;
+	const uint16 alphaTh1 = 0x80;
+
+	double idctTime = MeasureSeconds([&]() {
+		for(unsigned int it = 0; it < iterationCount; it++)
+		{
+			for(unsigned int i = 0; i < blockCount; i++)
+			{
+				IPU::Kernels::Idct(idctInput.data() + (i * 0x40), idctOutput.data() + (i * 0x40));
+			}
+		}
+	});
+	double idctScalarTime = MeasureSeconds([&]() {
+		for(unsigned int it = 0; it < iterationCount; it++)
+		{
+			for(unsigned int i = 0; i < blockCount; i++)
+			{
+				IPU::Kernels::IdctScalar(idctInput.data() + (i * 0x40), idctOutputScalar.data() + (i * 0x40));
+			}
+		}
+	});
+
+	static const unsigned int cscBlockSize = IPU::Kernels::MACROBLOCK_PIXEL_COUNT * 3 / 2;
+	double cscTime = MeasureSeconds([&]() {
+		for(unsigned int it = 0; it < iterationCount; it++)
+		{
+			for(unsigned int i = 0; i < blockCount; i++)
+			{
+				IPU::Kernels::ConvertYCbCrToRgba32(cscInput.data() + (i * cscBlockSize), cscOutput.data() + (i * IPU::Kernels::MACROBLOCK_PIXEL_COUNT), alphaTh0, alphaTh1);
+			}
+		}
+	});
+	double cscScalarTime = MeasureSeconds([&]() {
+		for(unsigned int it = 0; it < iterationCount; it++)
+		{
+			for(unsigned int i = 0; i < blockCount; i++)
+			{
+				IPU::Kernels::ConvertYCbCrToRgba32Scalar(cscInput.data() + (i * cscBlockSize), cscOutputScalar.data() + (i * IPU::Kernels::MACROBLOCK_PIXEL_COUNT), alphaTh0, alphaTh1);
+			}
+		}
+	});
+
+	IPU::Kernels::ConvertRgba32ToRgba16(cscOutput.data(), cvtOutput.data(), cscOutput.size());
+	IPU::Kernels::ConvertRgba32ToRgba16Scalar(cscOutput.data(), cvtOutputScalar.data(), cscOutput.size());
+
+	bool idctMatches = (idctOutput == idctOutputScalar);
+	bool cscMatches = (cscOutput == cscOutputScalar);
+	bool cvtMatches = (cvtOutput == cvtOutputScalar);
+
+	double blocksProcessed = static_cast<double>(blockCount) * iterationCount;
+	printf("IDCT (blocks per second):\n");
+	printf("\tScalar:     %.2fM\n", blocksProcessed / idctScalarTime / 1e6);
+	printf("\tVectorized: %.2fM (%s)\n", blocksProcessed / idctTime / 1e6, idctMatches ? "matches" : "MISMATCH");
+	printf("CSC (macroblocks per second):\n");
+	printf("\tScalar:     %.2fM\n", blocksProcessed / cscScalarTime / 1e6);
+	printf("\tVectorized: %.2fM (%s)\n", blocksProcessed / cscTime / 1e6, cscMatches ? "matches" : "MISMATCH");
+	printf("RGBA16 conversion: %s\n", cvtMatches ? "matches" : "MISMATCH");
+
+	return idctMatches && cscMatches && cvtMatches;
+}
+
+static Capture LoadCapture(const fs::path& capturePath)
+{
+	Capture capture;
+	auto stream = Framework::CreateInputStdStream(capturePath.native());
+	while(true)
+	{
+		CAPTURE_RECORD record;
+		record.type = stream.Read32();
+		if(stream.IsEOF()) break;
+		record.param0 = stream.Read32();
+		record.param1 = stream.Read32();
+		if(record.type == CIPU::CAPTURE_RECORD_INFIFO)
+		{
+			record.data.resize(record.param0);
+			stream.Read(record.data.data(), record.param0);
+		}
+		capture.push_back(std::move(record));
+	}
+	return capture;
+}
+
+static uint64 ReplayCapture(const Capture& capture)
+{
+	CINTC intc;
+	CIPU ipu(intc);
+	ipu.Reset();
+
+	uint64 outputSize = 0;
+	ipu.SetDMA3ReceiveHandler(
+	    [&](const void*, uint32 qwc) {
+		    outputSize += qwc * 0x10;
+		    return qwc;
+	    });
+
+	auto executeCommands =
+	    [&]() {
+		    while(ipu.WillExecuteCommand())
+		    {
+			    ipu.ExecuteCommand();
+			    if(ipu.IsCommandDelayed())
+			    {
+				    ipu.CountTicks(~0U >> 1);
+				    continue;
+			    }
+			    if(ipu.WillExecuteCommand())
+			    {
+				    //Waiting for more input
+				    break;
+			    }
+		    }
+	    };
+
+	for(const auto& record : capture)
+	{
+		switch(record.type)
+		{
+		case CIPU::CAPTURE_RECORD_REGISTER:
+			ipu.SetRegister(record.param0, record.param1);
+			break;
+		case CIPU::CAPTURE_RECORD_INFIFO:
+		{
+			uint32 qwc = record.param0 / 0x10;
+			uint32 offset = 0;
+			bool stalled = false;
+			while(offset != qwc)
+			{
+				uint32 received = ipu.ReceiveDMA4(offset * 0x10, qwc - offset, false, const_cast<uint8*>(record.data.data()), nullptr);
+				offset += received;
+				executeCommands();
+				if(received == 0)
+				{
+					//FIFO is full and nothing consumes it, give up on this record
+					if(stalled) break;
+					stalled = true;
+				}
+				else
+				{
+					stalled = false;
+				}
+			}
+		}
+		break;
+		}
+		executeCommands();
+	}
+
+	return outputSize;
+}
+
+int main(int argc, const char** argv)
+{
+	bool succeeded = RunKernelBenchmark();
+
+	if(argc >= 2)
+	{
+		auto capture = LoadCapture(fs::path(argv[1]));
+		unsigned int iterationCount = (argc >= 3) ? atoi(argv[2]) : 10;
+		uint64 outputSize = 0;
+		double replayTime = MeasureSeconds([&]() {
+			for(unsigned int i = 0; i < iterationCount; i++)
+			{
+				outputSize = ReplayCapture(capture);
+			}
+		});
+		printf("Capture replay: %d records, %.2fMB of output per pass, %.2f passes per second.\n",
+		       static_cast<int>(capture.size()), static_cast<double>(outputSize) / (1024 * 1024), iterationCount / replayTime);
+	}
+
+	return succeeded ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "RewindBuffer.h"
+
+//Checks that restoring a snapshot brings back the memory regions and state blob as they were
+//when it was pushed, and that dropping old snapshots to stay within the memory budget (which
+//includes the base image) keeps the remaining ones intact.
+
+#define CHECK(condition)                                  \
+	if(!(condition))                                      \
+	{                                                     \
+		throw std::runtime_error("Failed: " #condition); \
+	}
+
+enum
+{
+	PAGE_SIZE = CRewindBuffer::PAGE_SIZE,
+	REGION0_PAGE_COUNT = 4,
+	REGION1_PAGE_COUNT = 2,
+	TOTAL_PAGE_COUNT = REGION0_PAGE_COUNT + REGION1_PAGE_COUNT,
+	FRAME_COUNT = 10,
+};
+
+struct MEMORY
+{
+	MEMORY()
+	    : region0(REGION0_PAGE_COUNT * PAGE_SIZE)
+	    , region1(REGION1_PAGE_COUNT * PAGE_SIZE)
+	{
+	}
+
+	uint8* GetPage(uint32 pageIndex)
+	{
+		return const_cast<uint8*>(static_cast<const MEMORY*>(this)->GetPage(pageIndex));
+	}
+
+	const uint8* GetPage(uint32 pageIndex) const
+	{
+		return (pageIndex < REGION0_PAGE_COUNT) ? &region0[pageIndex * PAGE_SIZE] : &region1[(pageIndex - REGION0_PAGE_COUNT) * PAGE_SIZE];
+	}
+
+	bool operator==(const MEMORY& rhs) const
+	{
+		return (region0 == rhs.region0) && (region1 == rhs.region1);
+	}
+
+	std::vector<uint8> region0;
+	std::vector<uint8> region1;
+};
+
+typedef std::set<std::pair<uint32, uint32>> RestoredPageSet;
+
+static void SetupRegions(CRewindBuffer& rewindBuffer, MEMORY& memory)
+{
+	CRewindBuffer::MemoryRegionList regions =
+	    {
+	        {memory.region0.data(), static_cast<uint32>(memory.region0.size())},
+	        {memory.region1.data(), static_cast<uint32>(memory.region1.size())},
+	    };
+	rewindBuffer.SetMemoryRegions(std::move(regions));
+}
+
+//Every frame changes a single page and pushes a snapshot with the frame number as state
+static std::vector<MEMORY> PushFrames(CRewindBuffer& rewindBuffer, MEMORY& memory)
+{
+	std::vector<MEMORY> history;
+	for(uint32 frame = 0; frame < FRAME_COUNT; frame++)
+	{
+		memset(memory.GetPage(frame % TOTAL_PAGE_COUNT), frame + 1, PAGE_SIZE);
+		rewindBuffer.PushSnapshot(&frame, sizeof(frame));
+		history.push_back(memory);
+	}
+	return history;
+}
+
+static uint32 GetStateFrame(const CRewindBuffer::StateBlob& state)
+{
+	CHECK(state.size() == sizeof(uint32));
+	uint32 frame = 0;
+	memcpy(&frame, state.data(), sizeof(uint32));
+	return frame;
+}
+
+static void TestRoundTrip()
+{
+	MEMORY memory;
+	CRewindBuffer rewindBuffer;
+	SetupRegions(rewindBuffer, memory);
+
+	auto history = PushFrames(rewindBuffer, memory);
+	CHECK(rewindBuffer.GetSnapshotCount() == FRAME_COUNT);
+
+	//Changes made after the last snapshot must also be reverted
+	memset(memory.GetPage(TOTAL_PAGE_COUNT - 1), 0xFF, PAGE_SIZE);
+
+	static const uint32 stepsBack = 3;
+	const auto& expected = history[FRAME_COUNT - stepsBack - 1];
+	RestoredPageSet expectedPages;
+	for(uint32 pageIndex = 0; pageIndex < TOTAL_PAGE_COUNT; pageIndex++)
+	{
+		if(memcmp(memory.GetPage(pageIndex), expected.GetPage(pageIndex), PAGE_SIZE) == 0) continue;
+		uint32 regionIndex = (pageIndex < REGION0_PAGE_COUNT) ? 0 : 1;
+		uint32 regionPage = (pageIndex < REGION0_PAGE_COUNT) ? pageIndex : (pageIndex - REGION0_PAGE_COUNT);
+		expectedPages.insert(std::make_pair(regionIndex, regionPage * PAGE_SIZE));
+	}
+
+	CRewindBuffer::StateBlob state;
+	RestoredPageSet restoredPages;
+	bool restored = rewindBuffer.Restore(stepsBack, state,
+	                                     [&restoredPages](uint32 regionIndex, uint32 offset) {
+		                                     restoredPages.insert(std::make_pair(regionIndex, offset));
+	                                     });
+	CHECK(restored);
+	CHECK(memory == expected);
+	CHECK(GetStateFrame(state) == (FRAME_COUNT - stepsBack - 1));
+	CHECK(rewindBuffer.GetSnapshotCount() == (FRAME_COUNT - stepsBack));
+	for(const auto& page : expectedPages)
+	{
+		CHECK(restoredPages.count(page) != 0);
+	}
+
+	//Nothing changed since the restore, newest snapshot doesn't need to touch memory
+	restoredPages.clear();
+	restored = rewindBuffer.Restore(0, state,
+	                                [&restoredPages](uint32 regionIndex, uint32 offset) {
+		                                restoredPages.insert(std::make_pair(regionIndex, offset));
+	                                });
+	CHECK(restored);
+	CHECK(restoredPages.empty());
+	CHECK(memory == expected);
+
+	//Can't go further back than the oldest snapshot
+	CHECK(!rewindBuffer.Restore(rewindBuffer.GetSnapshotCount(), state, CRewindBuffer::PageRestoredHandler()));
+}
+
+static void TestEviction()
+{
+	static const uint64 baseSize = TOTAL_PAGE_COUNT * PAGE_SIZE;
+	static const uint64 snapshotSize = sizeof(uint32) + sizeof(uint32) + PAGE_SIZE;
+	static const uint64 maxMemoryUsage = baseSize + (3 * snapshotSize);
+
+	MEMORY memory;
+	CRewindBuffer rewindBuffer;
+	SetupRegions(rewindBuffer, memory);
+	rewindBuffer.SetMaxMemoryUsage(maxMemoryUsage);
+
+	//Base image counts towards the memory usage as soon as the first snapshot is pushed
+	{
+		uint32 frame = 0;
+		rewindBuffer.PushSnapshot(&frame, sizeof(frame));
+		CHECK(rewindBuffer.GetStats().memoryUsage == (baseSize + sizeof(uint32)));
+		rewindBuffer.Clear();
+		CHECK(rewindBuffer.GetStats().memoryUsage == 0);
+	}
+
+	auto history = PushFrames(rewindBuffer, memory);
+	auto stats = rewindBuffer.GetStats();
+	CHECK(stats.memoryUsage <= maxMemoryUsage);
+	CHECK(stats.snapshotCount > 1);
+	CHECK(stats.snapshotCount < FRAME_COUNT);
+
+	//Oldest remaining snapshot had older snapshots folded in the base image
+	uint32 oldestFrame = FRAME_COUNT - stats.snapshotCount;
+	CRewindBuffer::StateBlob state;
+	CHECK(rewindBuffer.Restore(stats.snapshotCount - 1, state, CRewindBuffer::PageRestoredHandler()));
+	CHECK(GetStateFrame(state) == oldestFrame);
+	CHECK(memory == history[oldestFrame]);
+
+	//Budget smaller than the base image still keeps the newest snapshot around
+	history = PushFrames(rewindBuffer, memory);
+	rewindBuffer.SetMaxMemoryUsage(baseSize / 2);
+	CHECK(rewindBuffer.GetSnapshotCount() == 1);
+	CHECK(rewindBuffer.Restore(0, state, CRewindBuffer::PageRestoredHandler()));
+	CHECK(GetStateFrame(state) == (FRAME_COUNT - 1));
+	CHECK(memory == history.back());
+}
+
+int main(int argc, const char** argv)
+{
+	try
+	{
+		TestRoundTrip();
+		TestEviction();
+	}
+	catch(const std::exception& exception)
+	{
+		printf("%s\r\n", exception.what());
+		return -1;
+	}
+
+	printf("All rewind buffer tests passed.\r\n");
+	return 0;
+}
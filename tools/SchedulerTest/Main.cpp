@@ -0,0 +1,189 @@
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+#include "Scheduler.h"
+
+//Checks that scheduler events run in due time order, that events due at the same time run in
+//the order they were scheduled and that rescheduled or cancelled events never run from their
+//old entries.
+
+#define CHECK(condition)                                  \
+	if(!(condition))                                      \
+	{                                                     \
+		throw std::runtime_error("Failed: " #condition); \
+	}
+
+enum
+{
+	EVENT_COUNT = 8,
+	RESCHEDULE_COUNT = 1000,
+	PERIODIC_RUN_COUNT = 10000,
+	FRACTION_PRECISION = 32,
+};
+
+typedef std::vector<CScheduler::EventId> EventLog;
+
+static std::vector<CScheduler::EventId> RegisterLoggedEvents(CScheduler& scheduler, EventLog& log)
+{
+	std::vector<CScheduler::EventId> events;
+	for(uint32 i = 0; i < EVENT_COUNT; i++)
+	{
+		auto id = static_cast<CScheduler::EventId>(i);
+		events.push_back(scheduler.RegisterEvent([&log, id]() { log.push_back(id); }));
+	}
+	return events;
+}
+
+static void TestOrdering()
+{
+	CScheduler scheduler;
+	EventLog log;
+	auto events = RegisterLoggedEvents(scheduler, log);
+
+	//Due times: 300, 100, 200, 100, 200, 100, 300, 50
+	static const uint64 delays[EVENT_COUNT] = {300, 100, 200, 100, 200, 100, 300, 50};
+	for(uint32 i = 0; i < EVENT_COUNT; i++)
+	{
+		scheduler.Schedule(events[i], delays[i]);
+	}
+	CHECK(scheduler.GetTicksUntilNextEvent(1000) == 50);
+
+	scheduler.Advance(99);
+	scheduler.ProcessEvents();
+	CHECK(log == EventLog({7}));
+	CHECK(scheduler.GetTicksUntilNextEvent(1000) == 1);
+
+	scheduler.Advance(1000);
+	scheduler.ProcessEvents();
+	CHECK(log == EventLog({7, 1, 3, 5, 2, 4, 0, 6}));
+	CHECK(scheduler.GetTicksUntilNextEvent(1000) == 1000);
+}
+
+static void TestStaleEntries()
+{
+	CScheduler scheduler;
+	EventLog log;
+	auto events = RegisterLoggedEvents(scheduler, log);
+
+	//Moving an event around leaves entries behind, only the last one counts
+	for(uint32 i = 0; i < RESCHEDULE_COUNT; i++)
+	{
+		scheduler.Schedule(events[0], (i % 2) ? 10 : 5000);
+	}
+	scheduler.Schedule(events[0], 500);
+	CHECK(scheduler.GetTicksUntil(events[0]) == 500);
+
+	//Cancelled events don't run and don't limit the next slice
+	scheduler.Schedule(events[1], 20);
+	scheduler.Schedule(events[2], 700);
+	scheduler.Cancel(events[1]);
+	CHECK(!scheduler.IsScheduled(events[1]));
+	CHECK(scheduler.GetTicksUntilNextEvent(1000) == 500);
+
+	scheduler.Advance(600);
+	scheduler.ProcessEvents();
+	CHECK(log == EventLog({0}));
+	CHECK(!scheduler.IsScheduled(events[0]));
+
+	//Event rescheduled earlier than the entry left behind runs once
+	scheduler.Schedule(events[3], 400);
+	scheduler.Schedule(events[3], 50);
+	scheduler.Advance(1000);
+	scheduler.ProcessEvents();
+	CHECK(log == EventLog({0, 3, 2}));
+	CHECK(scheduler.GetTicksUntilNextEvent(1000) == 1000);
+
+	//Reset drops everything
+	scheduler.Schedule(events[4], 10);
+	scheduler.Reset();
+	CHECK(scheduler.GetCurrentTime() == 0);
+	CHECK(!scheduler.IsScheduled(events[4]));
+	scheduler.Advance(100);
+	scheduler.ProcessEvents();
+	CHECK(log == EventLog({0, 3, 2}));
+}
+
+static void TestHandlerScheduling()
+{
+	CScheduler scheduler;
+	EventLog log;
+	std::vector<uint64> runTimes;
+
+	//Periodic event running late keeps its phase
+	CScheduler::EventId periodicEvent = 0;
+	periodicEvent = scheduler.RegisterEvent(
+	    [&]() {
+		    runTimes.push_back(scheduler.GetCurrentTime());
+		    scheduler.ScheduleNext(periodicEvent, 100);
+	    });
+
+	//Event scheduled by a handler that is already due runs in the same pass
+	CScheduler::EventId followEvent = 0;
+	followEvent = scheduler.RegisterEvent([&]() { log.push_back(followEvent); });
+	auto leadEvent = scheduler.RegisterEvent(
+	    [&]() {
+		    log.push_back(0xFF);
+		    scheduler.Schedule(followEvent, 0);
+	    });
+
+	scheduler.Schedule(periodicEvent, 100);
+	scheduler.Schedule(leadEvent, 150);
+	scheduler.Advance(130);
+	scheduler.ProcessEvents();
+	scheduler.Advance(100);
+	scheduler.ProcessEvents();
+	CHECK(log == EventLog({0xFF, followEvent}));
+	CHECK(runTimes == std::vector<uint64>({130, 230}));
+	CHECK(scheduler.GetTicksUntil(periodicEvent) == 70);
+}
+
+static void TestFractionalPeriod()
+{
+	//Same scheme as the SPU update: scheduler gets the whole part of the period and the
+	//fraction left behind is added to the next period. Updates must not drift.
+	static const uint64 fractionMask = (1ULL << FRACTION_PRECISION) - 1;
+	const uint64 period = (294912000ULL << FRACTION_PRECISION) / 44100 * 45;
+
+	CScheduler scheduler;
+	uint64 fraction = 0;
+	std::vector<uint64> runTimes;
+	CScheduler::EventId event = 0;
+	event = scheduler.RegisterEvent(
+	    [&]() {
+		    runTimes.push_back(scheduler.GetCurrentTime());
+		    uint64 ticks = period + fraction;
+		    fraction = ticks & fractionMask;
+		    scheduler.ScheduleNext(event, ticks >> FRACTION_PRECISION);
+	    });
+
+	fraction = period & fractionMask;
+	scheduler.Schedule(event, period >> FRACTION_PRECISION);
+	while(runTimes.size() < PERIODIC_RUN_COUNT)
+	{
+		scheduler.Advance(scheduler.GetTicksUntilNextEvent(~0ULL));
+		scheduler.ProcessEvents();
+	}
+	for(uint64 i = 0; i < PERIODIC_RUN_COUNT; i++)
+	{
+		CHECK(runTimes[i] == (((i + 1) * period) >> FRACTION_PRECISION));
+	}
+}
+
+int main(int argc, const char** argv)
+{
+	try
+	{
+		TestOrdering();
+		TestStaleEntries();
+		TestHandlerScheduling();
+		TestFractionalPeriod();
+	}
+	catch(const std::exception& exception)
+	{
+		printf("%s\r\n", exception.what());
+		return -1;
+	}
+
+	printf("All scheduler tests passed.\r\n");
+	return 0;
+}
@@ -0,0 +1,400 @@
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "Ps2Const.h"
+#include "SifDefs.h"
+#include "SifModule.h"
+#include "MIPS.h"
+#include "IopThread.h"
+#include "ee/DMAC.h"
+#include "ee/SIF.h"
+#include "iop/Iop_SifManPs2.h"
+
+//Sends SIF RPC traffic between a fake EE client and fake IOP servers, once with the IOP
+//stepping on the same thread and a few times with the IOP on its own thread.
+//Results seen by the EE must be the same in all cases. The IOP also calls into the EE once in a
+//while, those calls must never run while the EE is in the middle of its step.
+
+//Same as what CSIF uses
+#define RPC_RECVADDR 0xDEADBEF0
+#define RPC_SERVERID_XOR (0xACACACAC)
+
+#define CHECK(condition)                                  \
+	if(!(condition))                                      \
+	{                                                     \
+		throw std::runtime_error("Failed: " #condition); \
+	}
+
+enum
+{
+	SERVER_COUNT = 4,
+	SERVER_ID_BASE = 0x5F100000,
+	CALLS_PER_SERVER = 200,
+	ARG_WORD_COUNT = 8,
+	RESULT_WORD_COUNT = 16,
+	NOTIFY_COUNT = 64,
+	NOTIFY_STEP_INTERVAL = 13,
+	NOTIFY_WORD_COUNT = 4,
+	NOTIFY_COMMAND_ID = 0x80000100,
+	EE_CALL_STEP_INTERVAL = 7,
+	MAX_STEP_COUNT = 0x100000,
+	EE_TICKS_PER_STEP = 4800,
+	THREADED_RUN_COUNT = 8,
+
+	EE_RECV_ADDR = 0x00100000,
+	EE_CMD_ADDR = 0x00100100,
+	EE_ARGS_ADDR = 0x00101000,
+	EE_RESULT_ADDR = 0x00102000,
+	EE_NOTIFY_ADDR = 0x00110000,
+
+	IOP_CMD_BUFFER_ADDR = 0x00100000,
+	IOP_NOTIFY_ADDR = 0x00120000,
+};
+
+struct RESULTS
+{
+	std::vector<uint32> serverResults[SERVER_COUNT];
+	std::vector<uint32> notifications;
+};
+
+//Lives on the IOP, replies to calls later on like a server thread would
+class CTestServer : public CSifModule
+{
+public:
+	CTestServer(Iop::CSifManPs2& sifMan, uint32 id)
+	    : m_sifMan(sifMan)
+	    , m_id(id)
+	{
+	}
+
+	bool Invoke(uint32 method, uint32* args, uint32 argsSize, uint32* ret, uint32 retSize, uint8* ram) override
+	{
+		REQUEST request;
+		request.method = method;
+		request.args.assign(args, args + (argsSize / 4));
+		m_requests.push_back(std::move(request));
+		return false;
+	}
+
+	void Process()
+	{
+		if(m_requests.empty()) return;
+		auto request = std::move(m_requests.front());
+		m_requests.pop_front();
+
+		//Result depends on previous calls to make sure they're processed in order
+		uint32 result[RESULT_WORD_COUNT];
+		for(uint32 i = 0; i < RESULT_WORD_COUNT; i++)
+		{
+			uint32 value = m_state ^ (request.method * 0x9E3779B9) ^ (i * 0x85EBCA6B);
+			for(uint32 arg : request.args)
+			{
+				value = (value * 31) + arg;
+			}
+			result[i] = value;
+		}
+		m_state = result[RESULT_WORD_COUNT - 1];
+		m_sifMan.SendCallReply(m_id, result);
+	}
+
+private:
+	struct REQUEST
+	{
+		uint32 method = 0;
+		std::vector<uint32> args;
+	};
+
+	Iop::CSifManPs2& m_sifMan;
+	uint32 m_id = 0;
+	uint32 m_state = 0;
+	std::deque<REQUEST> m_requests;
+};
+
+//Lives on the EE, keeps every server busy and collects what comes back
+class CTestClient
+{
+public:
+	CTestClient(CSIF& sif, uint8* eeRam)
+	    : m_sif(sif)
+	    , m_eeRam(eeRam)
+	{
+	}
+
+	void Initialize(uint32 cmdBufferAddr)
+	{
+		m_cmdBufferAddr = cmdBufferAddr;
+
+		struct INIT
+		{
+			SIFCMDHEADER header;
+			uint32 eeAddress;
+		};
+
+		auto init = reinterpret_cast<INIT*>(m_eeRam + EE_CMD_ADDR);
+		memset(init, 0, sizeof(INIT));
+		init->header.packetSize = sizeof(INIT);
+		init->header.commandId = SIF_CMD_INIT;
+		init->header.optional = 0;
+		init->eeAddress = EE_RECV_ADDR;
+		m_sif.ReceiveDMA6(EE_CMD_ADDR, sizeof(INIT), m_cmdBufferAddr, false);
+	}
+
+	void Step()
+	{
+		m_sif.CountTicks(EE_TICKS_PER_STEP);
+
+		auto header = reinterpret_cast<SIFCMDHEADER*>(m_eeRam + EE_RECV_ADDR);
+		if(header->commandId != 0)
+		{
+			ProcessPacket();
+			memset(header, 0, sizeof(SIFCMDHEADER));
+			m_sif.MarkPacketProcessed();
+		}
+
+		for(uint32 i = 0; i < SERVER_COUNT; i++)
+		{
+			if(m_callPending[i]) continue;
+			if(m_callCount[i] == CALLS_PER_SERVER) continue;
+			SendCall(i);
+		}
+	}
+
+	bool IsDone() const
+	{
+		for(uint32 i = 0; i < SERVER_COUNT; i++)
+		{
+			if(m_callPending[i] || (m_callCount[i] != CALLS_PER_SERVER)) return false;
+		}
+		return m_results.notifications.size() == (NOTIFY_COUNT * NOTIFY_WORD_COUNT);
+	}
+
+	const RESULTS& GetResults() const
+	{
+		return m_results;
+	}
+
+private:
+	void SendCall(uint32 serverIndex)
+	{
+		uint32 callIndex = m_callCount[serverIndex];
+		uint32 argsAddr = EE_ARGS_ADDR + (serverIndex * ARG_WORD_COUNT * 4);
+		uint32 resultAddr = EE_RESULT_ADDR + (serverIndex * RESULT_WORD_COUNT * 4);
+
+		auto args = reinterpret_cast<uint32*>(m_eeRam + argsAddr);
+		for(uint32 i = 0; i < ARG_WORD_COUNT; i++)
+		{
+			args[i] = (serverIndex << 24) | (callIndex << 8) | i;
+		}
+		m_sif.ReceiveDMA6(argsAddr, ARG_WORD_COUNT * 4, RPC_RECVADDR, false);
+
+		auto call = reinterpret_cast<SIFRPCCALL*>(m_eeRam + EE_CMD_ADDR);
+		memset(call, 0, sizeof(SIFRPCCALL));
+		call->header.packetSize = sizeof(SIFRPCCALL);
+		call->header.commandId = SIF_CMD_CALL;
+		call->rpcId = serverIndex;
+		call->clientDataAddr = serverIndex;
+		call->rpcNumber = callIndex % 7;
+		call->sendSize = ARG_WORD_COUNT * 4;
+		call->recv = resultAddr;
+		call->recvSize = RESULT_WORD_COUNT * 4;
+		call->serverDataAddr = (SERVER_ID_BASE + serverIndex) ^ RPC_SERVERID_XOR;
+		m_sif.ReceiveDMA6(EE_CMD_ADDR, sizeof(SIFRPCCALL), m_cmdBufferAddr, false);
+
+		m_callPending[serverIndex] = true;
+		m_callCount[serverIndex]++;
+	}
+
+	void ProcessPacket()
+	{
+		auto header = reinterpret_cast<const SIFCMDHEADER*>(m_eeRam + EE_RECV_ADDR);
+		if(header->commandId == SIF_CMD_REND)
+		{
+			auto rend = reinterpret_cast<const SIFRPCREQUESTEND*>(header);
+			CHECK(rend->commandId == SIF_CMD_CALL);
+			uint32 serverIndex = rend->clientDataAddr;
+			CHECK(serverIndex < SERVER_COUNT);
+			CHECK(m_callPending[serverIndex]);
+
+			auto result = reinterpret_cast<const uint32*>(m_eeRam + EE_RESULT_ADDR + (serverIndex * RESULT_WORD_COUNT * 4));
+			auto& serverResults = m_results.serverResults[serverIndex];
+			serverResults.insert(serverResults.end(), result, result + RESULT_WORD_COUNT);
+			m_callPending[serverIndex] = false;
+		}
+		else if(header->commandId == NOTIFY_COMMAND_ID)
+		{
+			//Data was written to EE memory before the packet was sent, it must be there
+			uint32 notifyIndex = header->optional;
+			CHECK(notifyIndex < NOTIFY_COUNT);
+			auto data = reinterpret_cast<const uint32*>(m_eeRam + EE_NOTIFY_ADDR + (notifyIndex * NOTIFY_WORD_COUNT * 4));
+			m_results.notifications.insert(m_results.notifications.end(), data, data + NOTIFY_WORD_COUNT);
+		}
+		else
+		{
+			CHECK(false);
+		}
+	}
+
+	CSIF& m_sif;
+	uint8* m_eeRam = nullptr;
+	uint32 m_cmdBufferAddr = 0;
+	bool m_callPending[SERVER_COUNT] = {};
+	uint32 m_callCount[SERVER_COUNT] = {};
+	RESULTS m_results;
+};
+
+//Sends data to the EE through SIF DMA once in a while, followed by a packet telling it's there
+static void SendNotification(Iop::CSifManPs2& sifMan, uint8* iopRam, uint32 notifyIndex)
+{
+	uint32 baseAddr = IOP_NOTIFY_ADDR + (notifyIndex * 0x100);
+	uint32 dataAddr = baseAddr + 0x20;
+	uint32 packetAddr = baseAddr + 0x40;
+
+	auto data = reinterpret_cast<uint32*>(iopRam + dataAddr);
+	for(uint32 i = 0; i < NOTIFY_WORD_COUNT; i++)
+	{
+		data[i] = (notifyIndex * 0x1000) + i;
+	}
+
+	auto packet = reinterpret_cast<SIFCMDHEADER*>(iopRam + packetAddr);
+	memset(packet, 0, sizeof(SIFCMDHEADER));
+	packet->packetSize = sizeof(SIFCMDHEADER);
+	packet->commandId = NOTIFY_COMMAND_ID;
+	packet->optional = notifyIndex;
+
+	auto dmaRegs = reinterpret_cast<SIFDMAREG*>(iopRam + baseAddr);
+	dmaRegs[0].srcAddr = dataAddr;
+	dmaRegs[0].dstAddr = EE_NOTIFY_ADDR + (notifyIndex * NOTIFY_WORD_COUNT * 4);
+	dmaRegs[0].size = NOTIFY_WORD_COUNT * 4;
+	dmaRegs[0].flags = 0;
+	dmaRegs[1].srcAddr = packetAddr;
+	dmaRegs[1].dstAddr = EE_RECV_ADDR;
+	dmaRegs[1].size = sizeof(SIFCMDHEADER);
+	dmaRegs[1].flags = SIFDMAREG_FLAG_INT_O;
+
+	sifMan.ExecuteSifDma(baseAddr, 2);
+}
+
+static RESULTS RunTraffic(bool threaded)
+{
+	std::vector<uint8> eeRam(PS2::EE_RAM_SIZE);
+	std::vector<uint8> spr(PS2::EE_SPR_SIZE);
+	std::vector<uint8> vuMem0(PS2::VUMEM0SIZE);
+	std::vector<uint8> vuMem1(PS2::VUMEM1SIZE);
+	std::vector<uint8> iopRam(PS2::IOP_RAM_SIZE);
+
+	CMIPS ee(MEMORYMAP_ENDIAN_LSBF);
+	CDMAC dmac(eeRam.data(), spr.data(), vuMem0.data(), vuMem1.data(), ee);
+	CSIF sif(dmac, eeRam.data(), iopRam.data());
+	dmac.Reset();
+	sif.Reset();
+	dmac.SetChannelTransferFunction(CDMAC::CHANNEL_ID_SIF0, [&sif](uint32 address, uint32 size, uint32 param, bool isTagIncluded) {
+		return sif.ReceiveDMA5(address, size, param, isTagIncluded);
+	});
+
+	Iop::CSifManPs2 sifMan(sif, eeRam.data(), iopRam.data());
+
+	std::vector<std::unique_ptr<CTestServer>> servers;
+	for(uint32 i = 0; i < SERVER_COUNT; i++)
+	{
+		servers.push_back(std::make_unique<CTestServer>(sifMan, SERVER_ID_BASE + i));
+		sifMan.RegisterModule(SERVER_ID_BASE + i, servers[i].get());
+	}
+	sifMan.SetCmdBuffer(IOP_CMD_BUFFER_ADDR, 0x100);
+
+	uint32 iopStepCount = 0;
+	uint32 notifyCount = 0;
+	bool eeStepRunning = false;
+	uint32 eeCallCount = 0;
+	uint32 eeCallInStepCount = 0;
+	auto iopStep = [&]() {
+		for(auto& server : servers)
+		{
+			server->Process();
+		}
+		iopStepCount++;
+		if(((iopStepCount % NOTIFY_STEP_INTERVAL) == 0) && (notifyCount < NOTIFY_COUNT))
+		{
+			SendNotification(sifMan, iopRam.data(), notifyCount++);
+		}
+		if((iopStepCount % EE_CALL_STEP_INTERVAL) == 0)
+		{
+			sif.CallOnEe([&]() {
+				if(eeStepRunning) eeCallInStepCount++;
+				eeCallCount++;
+			});
+		}
+	};
+
+	CTestClient client(sif, eeRam.data());
+	client.Initialize(IOP_CMD_BUFFER_ADDR);
+
+	{
+		CIopThread iopThread(iopStep, CIopThread::ThreadInitHandler(), threaded);
+		sif.SetIopSyncHandler([&]() { iopThread.Sync(); });
+		sif.SetEeCallHandler([&](const CSIF::EeFunction& function) { iopThread.RunOnEe(function); });
+
+		for(uint32 step = 0; step < MAX_STEP_COUNT; step++)
+		{
+			iopThread.BeginStep();
+			eeStepRunning = true;
+			client.Step();
+			eeStepRunning = false;
+			iopThread.ProcessEeCalls();
+			iopThread.EndStep();
+			if(client.IsDone()) break;
+		}
+
+		sif.SetIopSyncHandler(CSIF::IopSyncHandler());
+		sif.SetEeCallHandler(CSIF::EeCallHandler());
+	}
+
+	CHECK(client.IsDone());
+	CHECK(eeCallCount == (iopStepCount / EE_CALL_STEP_INTERVAL));
+	CHECK(eeCallInStepCount == 0);
+	return client.GetResults();
+}
+
+static bool CompareResults(const RESULTS& reference, const RESULTS& results)
+{
+	for(uint32 i = 0; i < SERVER_COUNT; i++)
+	{
+		if(reference.serverResults[i] != results.serverResults[i])
+		{
+			printf("Results for server %d differ.\r\n", i);
+			return false;
+		}
+	}
+	if(reference.notifications != results.notifications)
+	{
+		printf("Notifications differ.\r\n");
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, const char** argv)
+{
+	try
+	{
+		auto reference = RunTraffic(false);
+		auto deterministic = RunTraffic(false);
+		CHECK(CompareResults(reference, deterministic));
+
+		for(uint32 i = 0; i < THREADED_RUN_COUNT; i++)
+		{
+			auto results = RunTraffic(true);
+			CHECK(CompareResults(reference, results));
+		}
+	}
+	catch(const std::exception& exception)
+	{
+		printf("%s\r\n", exception.what());
+		return -1;
+	}
+
+	printf("All SIF traffic results matched.\r\n");
+	return 0;
+}
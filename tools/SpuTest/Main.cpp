@@ -1,7 +1,9 @@
 #include <functional>
 #include "DefaultAppConfig.h"
 #include "KeyOnOffTest.h"
+#include "MixerBenchmark.h"
 #include "MultiCoreIrqTest.h"
+#include "SampleCacheTest.h"
 #include "SetRepeatTest.h"
 #include "SetRepeatTest2.h"
 #include "SimpleIrqTest.h"
@@ -13,7 +15,9 @@ typedef std::function<CTest*()> TestFactoryFunction;
 static const TestFactoryFunction s_factories[] =
 {
 	[]() { return new CKeyOnOffTest(); },
+	[]() { return new CMixerBenchmark(); },
 	[]() { return new CMultiCoreIrqTest(); },
+	[]() { return new CSampleCacheTest(); },
 	[]() { return new CSetRepeatTest(); },
 	[]() { return new CSetRepeatTest2(); },
 	[]() { return new CSimpleIrqTest(); },
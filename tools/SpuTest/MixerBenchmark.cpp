@@ -0,0 +1,117 @@
+#include "MixerBenchmark.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "Ps2Const.h"
+
+//Renders a block of busy voices on both cores with the sample by sample renderer
+//and with the batched one, makes sure they match and reports how fast each one is.
+
+static constexpr unsigned int BLOCK_SIZE = 90; //Same as the VM's SPU update size
+static constexpr unsigned int BLOCK_COUNT = 2000;
+static constexpr uint32 SAMPLE_AREA_ADDRESS = 0x10000;
+static constexpr uint32 SAMPLE_AREA_SIZE = 0x40000;
+static constexpr uint32 REVERB_WORK_AREA_START = 0x100000;
+static constexpr uint32 REVERB_WORK_AREA_END = 0x11FFFF;
+
+void CMixerBenchmark::Execute()
+{
+	SampleBuffer referenceSamples;
+	SampleBuffer batchedSamples;
+
+	double referenceTime = RenderVoices(false, referenceSamples);
+	double batchedTime = RenderVoices(true, batchedSamples);
+
+	TEST_VERIFY(referenceSamples == batchedSamples);
+
+	double voiceSampleCount = static_cast<double>(CORE_COUNT * VOICE_COUNT) * static_cast<double>(BLOCK_SIZE / 2) * static_cast<double>(BLOCK_COUNT);
+	printf("SPU mixer benchmark (voices x samples per second):\r\n");
+	printf("\tSample by sample: %.2fM\r\n", (voiceSampleCount / referenceTime) / 1000000.0);
+	printf("\tBatched:          %.2fM\r\n", (voiceSampleCount / batchedTime) / 1000000.0);
+}
+
+void CMixerBenchmark::SetupVoices()
+{
+	//Fill sample area with ADPCM blocks using all filters and shift factors
+	uint32 randomState = 0x12345678;
+	auto nextRandom = [&randomState]() {
+		randomState = (randomState * 1103515245) + 12345;
+		return randomState >> 16;
+	};
+
+	memset(m_ram, 0, PS2::SPU_RAM_SIZE);
+	for(uint32 blockAddress = SAMPLE_AREA_ADDRESS; blockAddress < (SAMPLE_AREA_ADDRESS + SAMPLE_AREA_SIZE); blockAddress += 0x10)
+	{
+		uint8* block = m_ram + blockAddress;
+		block[0] = static_cast<uint8>(((nextRandom() % 5) << 4) | (nextRandom() % 13));
+		block[1] = 0;
+		for(unsigned int i = 2; i < 0x10; i++)
+		{
+			block[i] = static_cast<uint8>(nextRandom());
+		}
+	}
+	//Loop back to start at the end of the sample area
+	m_ram[SAMPLE_AREA_ADDRESS + 1] = 0x04;
+	m_ram[SAMPLE_AREA_ADDRESS + SAMPLE_AREA_SIZE - 0x10 + 1] = 0x03;
+
+	for(unsigned int coreIndex = 0; coreIndex < CORE_COUNT; coreIndex++)
+	{
+		for(unsigned int i = 0; i < VOICE_COUNT; i++)
+		{
+			uint32 startAddress = SAMPLE_AREA_ADDRESS + ((nextRandom() % (SAMPLE_AREA_SIZE / 0x10)) * 0x10);
+			SetVoiceAddress(coreIndex, i, Iop::Spu2::CCore::VA_SSA_HI, startAddress);
+			SetVoiceRegister(coreIndex, i, Iop::Spu2::CCore::VP_PITCH, 0x400 + (nextRandom() % 0x3000));
+			SetVoiceRegister(coreIndex, i, Iop::Spu2::CCore::VP_ADSR1, nextRandom() & 0xFFFF);
+			SetVoiceRegister(coreIndex, i, Iop::Spu2::CCore::VP_ADSR2, nextRandom() & 0x7FFF);
+			//Mix of fixed volumes (some with inverted phase) and linear sweeps
+			SetVoiceRegister(coreIndex, i, Iop::Spu2::CCore::VP_VOLL, (i & 1) ? (nextRandom() & 0x7FFF) : (0x8000 | (nextRandom() & 0x207F)));
+			SetVoiceRegister(coreIndex, i, Iop::Spu2::CCore::VP_VOLR, 0x3FFF - (i * 0x100));
+		}
+
+		auto& spuBase = (coreIndex == 0) ? m_spuCore0 : m_spuCore1;
+		spuBase.SetReverbEnabled(true);
+		spuBase.SetReverbWorkAddressStart(REVERB_WORK_AREA_START);
+		spuBase.SetReverbWorkAddressEnd(REVERB_WORK_AREA_END);
+		for(unsigned int i = 0; i < Iop::CSpuBase::REVERB_PARAM_COUNT; i++)
+		{
+			uint32 value = Iop::CSpuBase::g_reverbParamIsAddress[i] ? ((i + 1) * 0x100) : (nextRandom() & 0x3FFF);
+			spuBase.SetReverbParam(i, value);
+		}
+		spuBase.SetChannelReverbLo(0x5555);
+		spuBase.SetChannelReverbHi(0x55);
+		spuBase.SetControl(spuBase.GetControl() | Iop::CSpuBase::CONTROL_REVERB);
+
+		SetCoreRegister(coreIndex, Iop::Spu2::CCore::A_KON_HI, 0xFFFF);
+		SetCoreRegister(coreIndex, Iop::Spu2::CCore::A_KON_LO, 0xFF);
+	}
+}
+
+double CMixerBenchmark::RenderVoices(bool batched, SampleBuffer& output)
+{
+	m_spuSampleCache.Clear();
+	m_irqWatcher.Reset();
+	m_spuCore0.Reset();
+	m_spuCore1.Reset();
+	m_spu.Reset();
+
+	constexpr unsigned int DST_SAMPLE_RATE = 44100;
+	m_spuCore0.SetDestinationSamplingRate(DST_SAMPLE_RATE);
+	m_spuCore1.SetDestinationSamplingRate(DST_SAMPLE_RATE);
+	m_spuCore0.SetBatchedRenderEnabled(batched);
+	m_spuCore1.SetBatchedRenderEnabled(batched);
+
+	SetupVoices();
+
+	output.resize(BLOCK_SIZE * BLOCK_COUNT * CORE_COUNT);
+	auto startTime = std::chrono::steady_clock::now();
+	for(unsigned int i = 0; i < BLOCK_COUNT; i++)
+	{
+		int16* blockSamples = output.data() + (i * BLOCK_SIZE * CORE_COUNT);
+		m_spuCore0.Render(blockSamples, BLOCK_SIZE);
+		m_spuCore1.Render(blockSamples + BLOCK_SIZE, BLOCK_SIZE);
+	}
+	auto endTime = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(endTime - startTime).count();
+}
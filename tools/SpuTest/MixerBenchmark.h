@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+#include "Test.h"
+
+class CMixerBenchmark : public CTest
+{
+public:
+	void Execute() override;
+
+private:
+	typedef std::vector<int16> SampleBuffer;
+
+	void SetupVoices();
+	double RenderVoices(bool, SampleBuffer&);
+};
@@ -0,0 +1,63 @@
+#include "SampleCacheTest.h"
+
+void CSampleCacheTest::Execute()
+{
+	Iop::CSpuSampleCache cache;
+
+	static const uint32 blockAddress = 0x5000;
+
+	//Same address with different predictor state are separate entries
+	{
+		auto& item0 = cache.RegisterItem(Iop::CSpuSampleCache::KEY{blockAddress, 0, 0});
+		item0.outS1 = 1;
+		auto& item1 = cache.RegisterItem(Iop::CSpuSampleCache::KEY{blockAddress, 10, 20});
+		item1.outS1 = 2;
+
+		auto result0 = cache.GetItem(Iop::CSpuSampleCache::KEY{blockAddress, 0, 0});
+		auto result1 = cache.GetItem(Iop::CSpuSampleCache::KEY{blockAddress, 10, 20});
+		TEST_VERIFY(result0 && (result0->outS1 == 1));
+		TEST_VERIFY(result1 && (result1->outS1 == 2));
+		TEST_VERIFY(cache.GetItem(Iop::CSpuSampleCache::KEY{blockAddress, 10, 0}) == nullptr);
+		TEST_VERIFY(cache.GetStats().hits == 2);
+		TEST_VERIFY(cache.GetStats().misses == 1);
+	}
+
+	//Writing anywhere in a block invalidates it, neighbours are kept
+	{
+		cache.RegisterItem(Iop::CSpuSampleCache::KEY{blockAddress + 0x10, 0, 0});
+		cache.ClearRange(blockAddress + 0x06, 2);
+		TEST_VERIFY(cache.GetItem(Iop::CSpuSampleCache::KEY{blockAddress, 0, 0}) == nullptr);
+		TEST_VERIFY(cache.GetItem(Iop::CSpuSampleCache::KEY{blockAddress, 10, 20}) == nullptr);
+		TEST_VERIFY(cache.GetItem(Iop::CSpuSampleCache::KEY{blockAddress + 0x10, 0, 0}) != nullptr);
+		TEST_VERIFY(cache.GetStats().invalidations == 2);
+	}
+
+	//Large ranges
+	{
+		cache.Clear();
+		for(uint32 i = 0; i < 0x100; i++)
+		{
+			cache.RegisterItem(Iop::CSpuSampleCache::KEY{i * 0x10, 0, 0});
+		}
+		cache.ClearRange(0x400, 0x400);
+		for(uint32 i = 0; i < 0x100; i++)
+		{
+			bool cleared = (i >= 0x40) && (i <= 0x80);
+			TEST_VERIFY((cache.GetItem(Iop::CSpuSampleCache::KEY{i * 0x10, 0, 0}) == nullptr) == cleared);
+		}
+	}
+
+	//Blocks that map to the same bucket evict each other once the bucket is full
+	{
+		cache.Clear();
+		cache.ResetStats();
+		static const uint32 bucketStride = Iop::CSpuSampleCache::BUCKET_COUNT * Iop::CSpuSampleCache::BLOCK_SIZE;
+		for(uint32 i = 0; i < Iop::CSpuSampleCache::BUCKET_WAYS + 1; i++)
+		{
+			cache.RegisterItem(Iop::CSpuSampleCache::KEY{i * bucketStride, 0, 0});
+		}
+		TEST_VERIFY(cache.GetStats().evictions == 1);
+		TEST_VERIFY(cache.GetItem(Iop::CSpuSampleCache::KEY{0, 0, 0}) == nullptr);
+		TEST_VERIFY(cache.GetItem(Iop::CSpuSampleCache::KEY{Iop::CSpuSampleCache::BUCKET_WAYS * bucketStride, 0, 0}) != nullptr);
+	}
+}
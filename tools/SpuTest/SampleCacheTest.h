@@ -0,0 +1,9 @@
+#pragma once
+
+#include "Test.h"
+
+class CSampleCacheTest : public CTest
+{
+public:
+	void Execute() override;
+};
@@ -0,0 +1,115 @@
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "ee/Vif_Kernels.h"
+
+//Runs the VIF UNPACK kernels against their scalar counterparts and reports throughput.
+
+struct UNPACK_FORMAT
+{
+	uint8 dataType;
+	const char* name;
+};
+
+static const UNPACK_FORMAT g_formats[] =
+    {
+        {0x00, "S-32"},
+        {0x01, "S-16"},
+        {0x02, "S-8"},
+        {0x04, "V2-32"},
+        {0x05, "V2-16"},
+        {0x06, "V2-8"},
+        {0x08, "V3-32"},
+        {0x09, "V3-16"},
+        {0x0A, "V3-8"},
+        {0x0C, "V4-32"},
+        {0x0D, "V4-16"},
+        {0x0E, "V4-8"},
+        {0x0F, "V4-5"},
+};
+
+template <typename Function>
+static double MeasureSeconds(const Function& function)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	function();
+	auto endTime = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(endTime - startTime).count();
+}
+
+static bool RunFormatBenchmark(const UNPACK_FORMAT& format, const std::vector<uint8>& input)
+{
+	//Same as an UNPACK with NUM = 0 (256 elements), which is what most games send
+	static const uint32 elementCount = 0x100;
+	static const unsigned int iterationCount = 0x4000;
+	static const uint32 row[4] = {0x3F800000, 0x12345678, 0x80000000, 0xFFFFFFFF};
+
+	uint32 elementSize = Vif::Kernels::GetUnpackElementSize(format.dataType);
+	uint32 batchCount = static_cast<uint32>(input.size()) / (elementCount * elementSize);
+
+	std::vector<uint128> output(elementCount);
+	std::vector<uint128> outputScalar(elementCount);
+
+	bool matches = true;
+	for(unsigned int variant = 0; variant < 4; variant++)
+	{
+		bool usn = (variant & 1) != 0;
+		const uint32* rowPtr = (variant & 2) ? row : nullptr;
+
+		//Use an odd element count to also go through the tails
+		for(uint32 i = 0; i < batchCount; i++)
+		{
+			const uint8* src = input.data() + (i * elementCount * elementSize);
+			uint32 count = elementCount - (i % 5);
+			memset(output.data(), 0, output.size() * sizeof(uint128));
+			memset(outputScalar.data(), 0, outputScalar.size() * sizeof(uint128));
+			Vif::Kernels::Unpack(format.dataType, usn, src, output.data(), count, rowPtr);
+			Vif::Kernels::UnpackScalar(format.dataType, usn, src, outputScalar.data(), count, rowPtr);
+			matches &= (memcmp(output.data(), outputScalar.data(), count * sizeof(uint128)) == 0);
+		}
+	}
+
+	double time = MeasureSeconds([&]() {
+		for(unsigned int it = 0; it < iterationCount; it++)
+		{
+			const uint8* src = input.data() + ((it % batchCount) * elementCount * elementSize);
+			Vif::Kernels::Unpack(format.dataType, false, src, output.data(), elementCount, nullptr);
+		}
+	});
+	double scalarTime = MeasureSeconds([&]() {
+		for(unsigned int it = 0; it < iterationCount; it++)
+		{
+			const uint8* src = input.data() + ((it % batchCount) * elementCount * elementSize);
+			Vif::Kernels::UnpackScalar(format.dataType, false, src, outputScalar.data(), elementCount, nullptr);
+		}
+	});
+
+	double elementsProcessed = static_cast<double>(elementCount) * iterationCount;
+	printf("%-6s Scalar: %8.2fM, Vectorized: %8.2fM elements per second (%s)\n",
+	       format.name, elementsProcessed / scalarTime / 1e6, elementsProcessed / time / 1e6,
+	       matches ? "matches" : "MISMATCH");
+
+	return matches;
+}
+
+int main(int argc, const char** argv)
+{
+	std::mt19937 random(1234);
+
+	//Large enough for a few batches of the biggest format
+	std::vector<uint8> input(0x100 * 0x10 * 8);
+	for(auto& value : input)
+	{
+		value = static_cast<uint8>(random());
+	}
+
+	bool succeeded = true;
+	for(const auto& format : g_formats)
+	{
+		succeeded &= RunFormatBenchmark(format, input);
+	}
+
+	return succeeded ? 0 : 1;
+}